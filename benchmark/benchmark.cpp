@@ -0,0 +1,332 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2011  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+//
+// Headless layout benchmark.
+//
+// Loads each diagram given on the command line (or every diagram found
+// under the given directories) and lays it out with GraphLayout, with each
+// combination of layout mode, overlap prevention and topology preservation.
+// One CSV row is written per diagram and configuration, with the elapsed
+// time spent in each phase, so runs before and after a change can be 
+// compared:
+//
+//     dunnart-benchmark [-i iterations] [-o output.csv] examples
+//
+// With topology preservation, layout is then restarted without changing
+// the diagram, and a warning is given for any connector whose topology
+// route had to be traced again rather than being reused.
+//
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "libdunnartcanvas/canvasapplication.h"
+#include "libdunnartcanvas/canvas.h"
+#include "libdunnartcanvas/canvasview.h"
+#include "libdunnartcanvas/graphlayout.h"
+#include "libdunnartcanvas/graphdata.h"
+#include "libdunnartcanvas/visibility.h"
+#include "libdunnartcanvas/pluginfileiofactory.h"
+
+using namespace dunnart;
+
+
+class BenchmarkApplication : public CanvasApplication
+{
+    public:
+        BenchmarkApplication(int& argc, char **argv)
+            : CanvasApplication(argc, argv)
+        {
+        }
+        virtual bool openDiagram(const QFileInfo& file)
+        {
+            Q_UNUSED (file)
+            return false;
+        }
+};
+
+
+struct Configuration
+{
+    GraphLayout::Mode mode;
+    const char *modeName;
+    bool preventOverlaps;
+    bool preserveTopology;
+};
+
+
+// Elapsed time since the timer was started, in seconds.
+static double secondsSince(const QElapsedTimer& timer)
+{
+    return timer.nsecsElapsed() / 1e9;
+}
+
+
+// The peak resident set size of the process so far, in kilobytes.  This
+// is a high-water mark for the whole run, not for a single layout.
+static long peakResidentSetSize(void)
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                sizeof(counters)))
+    {
+        return (long) (counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MAC)
+    // Reported in bytes on OS X.
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+static void findDiagrams(const QString& path, const QStringList& filters,
+        QStringList& diagrams)
+{
+    QFileInfo info(path);
+    if (!info.isDir())
+    {
+        diagrams.append(path);
+        return;
+    }
+    QStringList found;
+    QDirIterator it(path, filters, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        found.append(it.next());
+    }
+    found.sort();
+    diagrams += found;
+}
+
+
+static void benchmark(const QString& filename, const Configuration& config,
+        unsigned iterations, QTextStream& out)
+{
+    Canvas *canvas = new Canvas();
+    // Some file loaders expect the canvas to have a view.
+    CanvasView *view = new CanvasView(canvas);
+
+    // Stop the canvas' own layout thread from running, so it doesn't
+    // compete with the layout being measured.
+    canvas->setLayoutSuspended(true);
+
+    QString errorMessage;
+    if (!sharedPluginFileIOFactory()->loadDiagramFromFile(canvas,
+                QFileInfo(filename), errorMessage))
+    {
+        fprintf(stderr, "%s: %s\n", qPrintable(filename),
+                qPrintable(errorMessage));
+        delete view;
+        delete canvas;
+        return;
+    }
+    canvas->setOptPreventOverlaps(config.preventOverlaps);
+    canvas->setOptPreserveTopology(config.preserveTopology);
+
+    // Lay out the diagram the way batch layout does: both run levels of
+    // GraphLayout to convergence, in this thread.
+    GraphLayout *layout = canvas->layout();
+    layout->setLayoutMode(config.mode);
+    layout->graph_layout_iterations = iterations;
+    LayoutTimings timings;
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    layout->runSynchronously(&timings);
+    double layoutTime = secondsSince(totalTimer);
+
+    if (config.preserveTopology)
+    {
+        // Nothing has changed, so every connector's route from the last
+        // layout should be reused.
+        layout->runSynchronously();
+        const GraphData::RouteChanges& changes = 
+                layout->getGraphData()->getRouteChanges();
+        if (changes.traced > 0)
+        {
+            fprintf(stderr, "%s: %s: %u of %u connector routes were traced "
+                    "again when layout was restarted.\n",
+                    qPrintable(filename), config.modeName, changes.traced,
+                    changes.traced + changes.reused);
+        }
+    }
+
+    QElapsedTimer routingTimer;
+    routingTimer.start();
+    reroute_connectors(canvas, true);
+    double routingTime = secondsSince(routingTimer);
+
+    double totalTime = layoutTime + routingTime;
+
+    GraphData *graph = layout->getGraphData();
+    unsigned nodes = graph->getNodeCount();
+    unsigned edges = graph->getEdgeCount();
+    unsigned constraints = graph->ccs.size();
+
+    out << '"' << filename << "\"," << config.modeName << ','
+        << (int) config.preventOverlaps << ','
+        << (int) config.preserveTopology << ','
+        << nodes << ',' << edges << ',' << constraints << ','
+        << timings.graph << ',' << timings.shortestPaths << ','
+        << timings.layout.feasibility << ','
+        << timings.layout.forces << ',' << timings.layout.projection << ','
+        << timings.layout.topology << ',' << layoutTime << ','
+        << routingTime << ',' << totalTime << ','
+        << timings.layout.iterations << ',' << timings.stress << ','
+        << peakResidentSetSize() << '\n';
+    out.flush();
+
+    delete view;
+    delete canvas;
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-i iterations] [-o output.csv] "
+            "file-or-directory ...\n", name);
+    fprintf(stderr, "  -i  maximum layout iterations per stage "
+            "(default 100)\n");
+    fprintf(stderr, "  -o  write results to this file rather than "
+            "standard output\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    // No windows are shown, so don't require a display.
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    BenchmarkApplication app(argc, argv);
+
+    unsigned iterations = 100;
+    QString outputFilename;
+    QStringList paths;
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i)
+    {
+        if ((args[i] == "-i") && (i + 1 < args.size()))
+        {
+            iterations = args[++i].toUInt();
+        }
+        else if ((args[i] == "-o") && (i + 1 < args.size()))
+        {
+            outputFilename = args[++i];
+        }
+        else if (args[i].startsWith("-"))
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            paths.append(args[i]);
+        }
+    }
+    if (paths.isEmpty() || (iterations == 0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    QStringList filters = sharedPluginFileIOFactory()->
+            openableFileTypesString().split(' ', QString::SkipEmptyParts);
+    QStringList diagrams;
+    foreach (QString path, paths)
+    {
+        findDiagrams(path, filters, diagrams);
+    }
+
+    QFile outputFile;
+    if (outputFilename.isEmpty())
+    {
+        outputFile.open(stdout, QIODevice::WriteOnly);
+    }
+    else
+    {
+        outputFile.setFileName(outputFilename);
+    }
+    if (!outputFile.isOpen() && !outputFile.open(QIODevice::WriteOnly))
+    {
+        fprintf(stderr, "Could not write to %s\n",
+                qPrintable(outputFilename));
+        return EXIT_FAILURE;
+    }
+    QTextStream out(&outputFile);
+    out << "file,mode,overlap,topology,nodes,edges,constraints,"
+           "build_s,apsp_s,feasible_s,forces_s,vpsc_s,topology_s,"
+           "layout_s,routing_s,total_s,iterations,stress,peak_rss_kb\n";
+
+    const Configuration configurations[] = {
+        { GraphLayout::ORGANIC, "organic", false, false },
+        { GraphLayout::ORGANIC, "organic", true,  false },
+        { GraphLayout::ORGANIC, "organic", false, true  },
+        { GraphLayout::ORGANIC, "organic", true,  true  },
+        { GraphLayout::FLOW,    "flow",    false, false },
+        { GraphLayout::FLOW,    "flow",    true,  false },
+        { GraphLayout::FLOW,    "flow",    false, true  },
+        { GraphLayout::FLOW,    "flow",    true,  true  },
+        { GraphLayout::LAYERED, "layered", false, false },
+        { GraphLayout::LAYERED, "layered", true,  false },
+        { GraphLayout::LAYERED, "layered", false, true  },
+        { GraphLayout::LAYERED, "layered", true,  true  }
+    };
+    const unsigned configurationCount =
+            sizeof(configurations) / sizeof(configurations[0]);
+
+    foreach (QString diagram, diagrams)
+    {
+        for (unsigned c = 0; c < configurationCount; ++c)
+        {
+            benchmark(diagram, configurations[c], iterations, out);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -0,0 +1,37 @@
+
+TEMPLATE = app
+DEPENDPATH =  .. .
+INCLUDEPATH = .. ../libvpsc ../libcola ../libtopology ../libproject \
+        ../libavoid ../libogdf ../libdunnartcanvas $$OUT_PWD/../libdunnartcanvas/gen-ui ../libdunnartcanvas/qtpropertybrowser
+DEPENDPATH += ..
+TARGET = dunnart-benchmark
+
+CONFIG += link_pkgconfig qt thread warn_off console
+QT += xml svg widgets printsupport
+
+include(../common_options.qmake)
+
+# Built alongside the editor so that the same plugins directory is found.
+DESTDIR = $$DUNNARTBASE/build
+
+CONFIG -= app_bundle
+
+macx {
+LIBS += -L$$DUNNARTBASE/Dunnart.app/Contents/Frameworks
+}
+else {
+LIBS += -L$$DESTDIR
+}
+
+LIBS += -ldunnartcanvas
+
+# The linker on OS X Tiger requires that we resupply these.
+LIBS += -ltopology -lcola -lvpsc -logdf -lavoid
+
+win32 {
+LIBS += -lpsapi
+}
+
+# Input
+SOURCES += \
+	benchmark.cpp
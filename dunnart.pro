@@ -5,12 +5,15 @@ TEMPLATE = subdirs
 SUBDIRS = \
 	libavoid \
 	libvpsc \
+	libvpsc/tests \
         libcola \
         libtopology \
+        libcola/tests \
         libogdf \
 	libdunnartcanvas \
 	plugins \
-	editor
+	editor \
+	benchmark
 
 CONFIG += ordered
 
@@ -0,0 +1,321 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QPair>
+#include <QProcess>
+#include <QTextStream>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "batch.h"
+
+#include "libdunnartcanvas/canvas.h"
+#include "libdunnartcanvas/pluginfileiofactory.h"
+
+#include "libavoid/router.h"
+
+namespace dunnart {
+
+// Hands out the diagrams to be laid out, along with where to save each,
+// reading from standard input only as more jobs are needed.
+class BatchJobs
+{
+    public:
+        BatchJobs(const QStringList& inputs, const BatchOptions& options)
+            : m_inputs(inputs),
+              m_output_directory(options.outputDirectory),
+              m_stdin(NULL)
+        {
+            m_filters = sharedPluginFileIOFactory()->
+                    openableFileTypesString().split(' ',
+                    QString::SkipEmptyParts);
+        }
+        ~BatchJobs()
+        {
+            delete m_stdin;
+        }
+
+        bool next(QString& input, QString& output)
+        {
+            while (m_pending.isEmpty())
+            {
+                QString path;
+                if (!m_inputs.isEmpty())
+                {
+                    path = m_inputs.takeFirst();
+                }
+                else if (m_stdin && !m_stdin->atEnd())
+                {
+                    path = m_stdin->readLine().trimmed();
+                }
+                else
+                {
+                    return false;
+                }
+
+                if (path == "-")
+                {
+                    if (!m_stdin)
+                    {
+                        m_stdin = new QTextStream(stdin, QIODevice::ReadOnly);
+                    }
+                }
+                else if (!path.isEmpty())
+                {
+                    addPath(path);
+                }
+            }
+            input = m_pending.first().first;
+            output = m_pending.first().second;
+            m_pending.removeFirst();
+            return true;
+        }
+
+    private:
+        void addPath(const QString& path)
+        {
+            QFileInfo info(path);
+            if (!info.isDir())
+            {
+                m_pending.append(qMakePair(path,
+                        outputFor(info, info.fileName())));
+                return;
+            }
+
+            QDir dir(path);
+            QStringList found;
+            QDirIterator it(path, m_filters, QDir::Files,
+                    QDirIterator::Subdirectories);
+            while (it.hasNext())
+            {
+                QString file = it.next();
+                // Skip the results of an earlier run over the same
+                // directory.
+                if (m_output_directory.isEmpty() &&
+                        QFileInfo(file).completeBaseName().endsWith("-layout"))
+                {
+                    continue;
+                }
+                found.append(file);
+            }
+            found.sort();
+            foreach (QString file, found)
+            {
+                m_pending.append(qMakePair(file,
+                        outputFor(QFileInfo(file), dir.relativeFilePath(file))));
+            }
+        }
+
+        // Results are saved beside the input, or with the same relative
+        // path under the output directory, if there is one.
+        QString outputFor(const QFileInfo& info, const QString& relativePath)
+        {
+            if (m_output_directory.isEmpty())
+            {
+                return info.absoluteDir().filePath(
+                        info.completeBaseName() + "-layout.svg");
+            }
+            QFileInfo relative(relativePath);
+            return QDir(m_output_directory).filePath(relative.path() + "/" +
+                    relative.completeBaseName() + ".svg");
+        }
+
+        QStringList m_inputs;
+        QString m_output_directory;
+        QStringList m_filters;
+        QTextStream *m_stdin;
+        QList<QPair<QString, QString> > m_pending;
+};
+
+
+static bool layoutDiagram(const QString& input, const QString& output,
+        const BatchOptions& options)
+{
+    // No view is ever attached, so nothing is drawn or animated.
+    Canvas *canvas = new Canvas();
+    if (options.roundedConnectors)
+    {
+        canvas->setOptConnRoundingDist(7);
+    }
+    if (options.crossingPenalty >= 0)
+    {
+        canvas->router()->setRoutingParameter(Avoid::crossingPenalty,
+                options.crossingPenalty);
+    }
+    if (options.nudgeDistance > 0)
+    {
+        canvas->setNudgeDistance(options.nudgeDistance);
+    }
+
+    QString errorMessage;
+    PluginFileIOFactory *fileIOFactory = sharedPluginFileIOFactory();
+    bool successful = fileIOFactory->loadDiagramFromFile(canvas,
+            QFileInfo(input), errorMessage);
+    if (successful)
+    {
+        canvas->setFilename(input);
+        canvas->postDiagramLoad();
+        canvas->runBatchLayout();
+
+        QFileInfo outputInfo(output);
+        QDir().mkpath(outputInfo.absolutePath());
+        successful = fileIOFactory->saveDiagramToFile(canvas, outputInfo,
+                errorMessage);
+    }
+
+    if (successful)
+    {
+        printf("%s\n", qPrintable(output));
+        fflush(stdout);
+    }
+    else
+    {
+        fprintf(stderr, "%s: %s\n", qPrintable(input),
+                qPrintable(errorMessage));
+    }
+    delete canvas;
+    return successful;
+}
+
+
+// A QGraphicsScene may only be used from the thread that owns it, so
+// diagrams are laid out in parallel by running a copy of this program in
+// batch mode for each.
+static QStringList workerArguments(const QString& input, const QString& output,
+        const BatchOptions& options)
+{
+    QStringList args;
+    args << "-b";
+    if (options.roundedConnectors)
+    {
+        args << "-y";
+    }
+    if (options.crossingPenalty >= 0)
+    {
+        args << "-z" << QString::number(options.crossingPenalty);
+    }
+    if (options.nudgeDistance > 0)
+    {
+        args << "-w" << QString::number(options.nudgeDistance);
+    }
+    if (!options.outputDirectory.isEmpty())
+    {
+        // The worker saves to <dir>/<name>.svg, which is the output
+        // already worked out for this job.
+        args << "-o" << QFileInfo(output).absolutePath();
+    }
+    args << input;
+    return args;
+}
+
+
+static bool workerSucceeded(QProcess *worker)
+{
+    return (worker->exitStatus() == QProcess::NormalExit) &&
+            (worker->exitCode() == EXIT_SUCCESS);
+}
+
+
+int runBatch(const QStringList& inputs, const BatchOptions& options)
+{
+    BatchJobs jobs(inputs, options);
+    QString input, output;
+    int failures = 0;
+
+    if (options.workers <= 1)
+    {
+        while (jobs.next(input, output))
+        {
+            if (!layoutDiagram(input, output, options))
+            {
+                ++failures;
+            }
+        }
+        return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    QString program = QCoreApplication::applicationFilePath();
+    QList<QProcess *> workers;
+    bool moreJobs = true;
+    while (true)
+    {
+        while (moreJobs && (workers.size() < options.workers))
+        {
+            moreJobs = jobs.next(input, output);
+            if (!moreJobs)
+            {
+                break;
+            }
+            QProcess *worker = new QProcess();
+            worker->setProcessChannelMode(QProcess::ForwardedChannels);
+            worker->start(program, workerArguments(input, output, options));
+            if (!worker->waitForStarted())
+            {
+                fprintf(stderr, "%s: %s\n", qPrintable(input),
+                        qPrintable(worker->errorString()));
+                ++failures;
+                delete worker;
+                continue;
+            }
+            workers.append(worker);
+        }
+
+        if (workers.isEmpty())
+        {
+            break;
+        }
+
+        // Wait for a worker to finish, to make room for the next job.
+        bool finished = false;
+        while (!finished)
+        {
+            for (int i = 0; i < workers.size(); ++i)
+            {
+                QProcess *worker = workers[i];
+                if ((worker->state() == QProcess::NotRunning) ||
+                        worker->waitForFinished(20))
+                {
+                    if (!workerSucceeded(worker))
+                    {
+                        ++failures;
+                    }
+                    workers.removeAt(i);
+                    delete worker;
+                    finished = true;
+                    break;
+                }
+            }
+        }
+    }
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
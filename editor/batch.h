@@ -0,0 +1,62 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <QString>
+#include <QStringList>
+
+namespace dunnart {
+
+// Options applied to every diagram laid out in batch mode.
+struct BatchOptions
+{
+    BatchOptions()
+        : roundedConnectors(false),
+          crossingPenalty(-1),
+          nudgeDistance(0),
+          workers(1)
+    {
+    }
+
+    bool roundedConnectors;
+    // Negative to leave the router's default.
+    double crossingPenalty;
+    double nudgeDistance;
+    // Directory results are written to, or empty to write each beside
+    // its input.
+    QString outputDirectory;
+    // Number of diagrams laid out at once, each in its own process.
+    int workers;
+};
+
+// Lays out each of the given diagrams without a window, routes their
+// connectors and saves the result as SVG.  Inputs may be diagram files,
+// directories to search for diagrams, or "-" to read further inputs from
+// standard input, one per line.  Returns the process exit status.
+int runBatch(const QStringList& inputs, const BatchOptions& options);
+
+}
+
+#endif // BATCH_H_
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -50,6 +50,7 @@
 #include "libavoid/debug.h"
 
 #include "mainwindow.h"
+#include "batch.h"
 
 
 using namespace dunnart;
@@ -60,11 +61,22 @@ using namespace dunnart;
 
 
 static void usage(char *title, char *editor);
+static bool findBatchOption(int argc, char *argv[], const char *optstr);
 
 
 
 int main(int argc, char *argv[])
 {
+    char args[] = "bhj:o:vw:xyz:";
+
+    // Batch mode shows no windows, so doesn't require a display.  This 
+    // has to be known before the application is created.
+    bool batch = findBatchOption(argc, argv, args);
+    if (batch && qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     Application app(argc, argv);
 
     namespaces.setPrefix(x_dunnartNs, x_dunnartURI);
@@ -74,21 +86,21 @@ int main(int argc, char *argv[])
     namespaces.setPrefix("xlink", "http://www.w3.org/1999/xlink");
 
     bool save_svg_and_exit = false;
-
-    MainWindow window(&app);
-
-    QIcon appIcon(":/resources/nuvola_icons/kfig.png");
-    app.setWindowIcon(appIcon);
-    window.setWindowIcon(appIcon);
+    BatchOptions batchOptions;
 
     int c = -1;
-    char args[] = "bhvw:xyz:";
     while ((c = mj_getopt(argc, argv, args)) != -1)
     {
         switch (c)
         {
             case 'b':
-                //QT window.canvas()->m_batch_diagram_layout = true;
+                batch = true;
+                break;
+            case 'j':
+                batchOptions.workers = qMax(1, atoi(mj_optarg));
+                break;
+            case 'o':
+                batchOptions.outputDirectory = QString(mj_optarg);
                 break;
             case 'x':
                 save_svg_and_exit = true;
@@ -101,14 +113,13 @@ int main(int argc, char *argv[])
                 exit(EXIT_SUCCESS);
                 break;
             case 'y':
-                window.canvas()->setOptConnRoundingDist(7);
+                batchOptions.roundedConnectors = true;
                 break;
             case 'z':
-                window.canvas()->router()->setRoutingParameter(
-                        Avoid::crossingPenalty, atof(mj_optarg));
+                batchOptions.crossingPenalty = atof(mj_optarg);
                 break;
             case'w':
-                window.canvas()->setNudgeDistance(atof(mj_optarg));
+                batchOptions.nudgeDistance = atof(mj_optarg);
                 break;
             case '?':
                 qFatal("Please run `%s -h' to see valid options.", argv[0]);
@@ -119,6 +130,40 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (batch)
+    {
+        QStringList inputs;
+        for (int o = mj_optind; o < argc; ++o)
+        {
+            inputs.append(QString(argv[o]));
+        }
+        if (inputs.isEmpty())
+        {
+            qFatal("Please give the diagrams to lay out, or `-' to read "
+                    "them from standard input.");
+        }
+        return runBatch(inputs, batchOptions);
+    }
+
+    MainWindow window(&app);
+
+    QIcon appIcon(":/resources/nuvola_icons/kfig.png");
+    app.setWindowIcon(appIcon);
+    window.setWindowIcon(appIcon);
+
+    if (batchOptions.roundedConnectors)
+    {
+        window.canvas()->setOptConnRoundingDist(7);
+    }
+    if (batchOptions.crossingPenalty >= 0)
+    {
+        window.canvas()->router()->setRoutingParameter(
+                Avoid::crossingPenalty, batchOptions.crossingPenalty);
+    }
+    if (batchOptions.nudgeDistance > 0)
+    {
+        window.canvas()->setNudgeDistance(batchOptions.nudgeDistance);
+    }
 
 #if 1
     int diagrams = 1;
@@ -205,17 +250,74 @@ int main(int argc, char *argv[])
 }
 
 
+// Looks for the batch option, either alone, as "--batch", or in a group of
+// short options such as "-bj4", before getopt is run.  Any "--batch" is
+// replaced by "-b" for getopt, which only handles short options.
+static bool findBatchOption(int argc, char *argv[], const char *optstr)
+{
+    static char batchOption[] = "-b";
+    bool batch = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--") == 0)
+        {
+            // The remaining arguments are all files.
+            break;
+        }
+        else if (strcmp(argv[i], "--batch") == 0)
+        {
+            argv[i] = batchOption;
+            batch = true;
+        }
+        else if ((argv[i][0] == '-') && (argv[i][1] != '-'))
+        {
+            for (const char *o = argv[i] + 1; *o; ++o)
+            {
+                const char *spec = strchr(optstr, *o);
+                if (spec == NULL)
+                {
+                    // Not one of ours, perhaps one of Qt's.
+                    break;
+                }
+                if (*o == 'b')
+                {
+                    batch = true;
+                }
+                if (spec[1] == ':')
+                {
+                    // The rest of the group, or else the next argument,
+                    // is this option's argument.
+                    if (o[1] == '\0')
+                    {
+                        ++i;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    return batch;
+}
+
+
 static void usage(char *title, char *editor)
 {
     printf("%s\n\n"
-"Usage: %s [options] file\n"
+"Usage: %s [options] file ...\n"
 "\n"
 "General Options:\n"
 "   -h                Show usage information.\n"
 "   -v                Show version information.\n"
 "   -x                Load the diagram, then immediately write out SVG and quit.\n"
-"   -b                Batch processing: Run graphlayout, reroute connectors,\n"
-"                     Fit page to diagram, write out SVG and then exit.\n"
+"   -b, --batch       Batch processing: Without showing a window, run\n"
+"                     graphlayout to convergence, reroute connectors, write\n"
+"                     out SVG and then exit.  Each file may also be a\n"
+"                     directory of diagrams, or `-' to read further files\n"
+"                     from standard input, one per line.  Results are\n"
+"                     written beside each input as <name>-layout.svg.\n"
+"   -j workers        Lay out this many diagrams at once in batch mode.\n"
+"   -o directory      Write batch results to this directory instead,\n"
+"                     as <name>.svg.\n"
 "   -y                Enable rounded poly-line segment corners on connectors.\n"
 "   -z xing_penalty   Set the connector crossing penalty (0 to 500).\n"
 "   -w nudge_distance 'Nudge' connectors by this amount to separate then.\n"
@@ -98,10 +98,12 @@ QMAKE_EXTRA_TARGETS += dunnart-linux.tar.gz
 # Input
 SOURCES += \ 
 	editor.cpp \
+	batch.cpp \
 	getopt.cpp \
 	mainwindow.cpp \
     application.cpp
 HEADERS += \
+	batch.h \
 	getopt.h \
 	mainwindow.h \
     application.h
@@ -21,6 +21,7 @@
 */
 
 #include <sstream>
+#include <queue>
 
 #include "libcola/cola.h"
 #include "libcola/compound_constraints.h"
@@ -113,8 +114,7 @@ class ShapePairInfo
     public:
         ShapePairInfo(unsigned ind1, unsigned ind2, unsigned ord = 1) 
             : order(ord),
-              satisfied(false),
-              processed(false)
+              overlapMax(0)
         {
             COLA_ASSERT(ind1 != ind2);
             // Assign the lesser value to varIndex1.
@@ -124,13 +124,6 @@ class ShapePairInfo
         }
         bool operator<(const ShapePairInfo& rhs) const
         {
-            // Make sure the processed ones are at the end after sorting.
-            int processedInt = processed ? 1 : 0;
-            int rhsProcessedInt = rhs.processed ? 1 : 0;
-            if (processedInt != rhsProcessedInt)
-            {
-                return processedInt < rhsProcessedInt;
-            }
             // Use cluster ordering for primary sorting.
             if (order != rhs.order)
             {
@@ -139,19 +132,187 @@ class ShapePairInfo
             return overlapMax > rhs.overlapMax;
         }
         unsigned short order;
-        unsigned short varIndex1;
-        unsigned short varIndex2;
-        bool satisfied;
-        bool processed;
+        unsigned varIndex1;
+        unsigned varIndex2;
         double overlapMax;
 };
 
 
+// The extent of a shape or cluster, used when sweeping for candidate pairs.
+class SweepRect
+{
+    public:
+        SweepRect(unsigned id)
+            : id(id)
+        {
+        }
+        bool operator<(const SweepRect& rhs) const
+        {
+            // Order by the minimum value in the sweep dimension, which the
+            // caller stores in min[0].
+            return min[0] < rhs.min[0];
+        }
+        unsigned id;
+        double min[2];
+        double max[2];
+};
+
+
+// Orders expiring active rectangles by the maximum value in the sweep
+// dimension, earliest first.
+struct LaterExpiry
+{
+    template <typename T>
+    bool operator()(const T& lhs, const T& rhs) const
+    {
+        return lhs.first > rhs.first;
+    }
+};
+
+
+// Sorts the given rectangles by min[0].  If they are given in the order of
+// a previous sweep they will be nearly sorted, since shapes only move a 
+// little between passes, so insertion sort is used to do this in close to
+// linear time.
+static void sortSweepRects(std::vector<SweepRect>& rects, 
+        const bool nearlySorted)
+{
+    if (!nearlySorted)
+    {
+        std::sort(rects.begin(), rects.end());
+        return;
+    }
+    for (size_t i = 1; i < rects.size(); ++i)
+    {
+        SweepRect curr = rects[i];
+        size_t j = i;
+        for (; (j > 0) && (curr < rects[j - 1]); --j)
+        {
+            rects[j] = rects[j - 1];
+        }
+        rects[j] = curr;
+    }
+}
+
+
+// Sorts the given rectangles and returns all pairs whose extents intersect 
+// in min[0]/max[0] and, if checkOtherDim is set, also in min[1]/max[1].  
+// Intersection is tested inclusively, so the result is a superset of pairs 
+// that strictly overlap; callers apply the exact test.
+static void sweepForIntersectingPairs(std::vector<SweepRect>& rects,
+        const bool nearlySorted, const bool checkOtherDim, 
+        std::vector<std::pair<unsigned, unsigned> >& pairs)
+{
+    sortSweepRects(rects, nearlySorted);
+
+    if (!checkOtherDim)
+    {
+        // Every active rectangle intersects the current one, so each one
+        // looked at is either a result or has been passed by the sweep.
+        std::vector<size_t> active;
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            const SweepRect& curr = rects[i];
+            size_t activeCount = 0;
+            for (size_t j = 0; j < active.size(); ++j)
+            {
+                const SweepRect& other = rects[active[j]];
+                if (other.max[0] < curr.min[0])
+                {
+                    // The sweep line has passed this rectangle.
+                    continue;
+                }
+                active[activeCount++] = active[j];
+                pairs.push_back(std::make_pair(other.id, curr.id));
+            }
+            active.resize(activeCount);
+            active.push_back(i);
+        }
+        return;
+    }
+
+    // The active rectangles are kept ordered by min[1], along with their
+    // extents in that dimension, so only those that can reach the current
+    // rectangle in the other dimension are looked at.
+    typedef std::multimap<double, size_t> ActiveSet;
+    typedef std::pair<double, ActiveSet::iterator> Expiry;
+    ActiveSet active;
+    std::multiset<double> activeExtents;
+    std::priority_queue<Expiry, std::vector<Expiry>, LaterExpiry> expiries;
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        const SweepRect& curr = rects[i];
+        while (!expiries.empty() && (expiries.top().first < curr.min[0]))
+        {
+            // The sweep line has passed this rectangle.
+            ActiveSet::iterator passed = expiries.top().second;
+            const SweepRect& other = rects[passed->second];
+            activeExtents.erase(activeExtents.find(
+                    other.max[1] - other.min[1]));
+            active.erase(passed);
+            expiries.pop();
+        }
+
+        if (!active.empty())
+        {
+            const double longest = *activeExtents.rbegin();
+            ActiveSet::iterator last = active.upper_bound(curr.max[1]);
+            for (ActiveSet::iterator a = 
+                    active.lower_bound(curr.min[1] - longest); a != last; ++a)
+            {
+                const SweepRect& other = rects[a->second];
+                if (other.max[1] < curr.min[1])
+                {
+                    continue;
+                }
+                pairs.push_back(std::make_pair(other.id, curr.id));
+            }
+        }
+
+        ActiveSet::iterator added = 
+                active.insert(std::make_pair(curr.min[1], i));
+        activeExtents.insert(curr.max[1] - curr.min[1]);
+        expiries.push(Expiry(curr.max[0], added));
+    }
+}
+
+
+// Computes the current bounds of a shape or cluster from the variable 
+// positions.
+static void computeShapeBounds(unsigned id, const OverlapShapeOffsets& shape,
+        vpsc::Variables vs[], double& left, double& right, double& bottom,
+        double& top)
+{
+    double xPos = vs[0][id]->finalPosition;
+    double yPos = vs[1][id]->finalPosition;
+
+    left   = xPos - shape.halfDim[0];
+    right  = xPos + shape.halfDim[0];
+    bottom = yPos - shape.halfDim[1];
+    top    = yPos + shape.halfDim[1];
+
+    if (shape.cluster)
+    {
+        COLA_ASSERT(shape.halfDim[0] == 0);
+        COLA_ASSERT(shape.halfDim[1] == 0);
+        COLA_ASSERT(id + 1 < vs[0].size());
+        right = vs[0][id + 1]->finalPosition;
+        COLA_ASSERT(id + 1 < vs[1].size());
+        top   = vs[1][id + 1]->finalPosition;
+        left -= shape.rectPadding.min(XDIM);
+        bottom -= shape.rectPadding.min(YDIM);
+        right += shape.rectPadding.max(XDIM);
+        top += shape.rectPadding.max(YDIM);
+    }
+}
+
+
 NonOverlapConstraints::NonOverlapConstraints(
         NonOverlapConstraintExemptions *exemptions, unsigned int priority)
     : CompoundConstraint(vpsc::HORIZONTAL, priority),
       pairInfoListSorted(false),
       initialSortCompleted(false),
+      allOverlapResolved(false),
       m_exemptions(exemptions)
 {
     // All work is done by repeated addShape() calls.
@@ -160,23 +321,11 @@ NonOverlapConstraints::NonOverlapConstraints(
 void NonOverlapConstraints::addShape(unsigned id, double halfW, double halfH,
         unsigned int group)
 {
-    // Setup pairInfos for all other shapes. 
-    for (std::map<unsigned, OverlapShapeOffsets>::iterator curr =
-            shapeOffsets.begin(); curr != shapeOffsets.end(); ++curr)
-    {
-        unsigned otherId = curr->first;
-        if ((shapeOffsets[otherId].group == group) && (id != otherId))
-        {
-            if (m_exemptions &&
-                    m_exemptions->shapePairIsExempt(ShapePair(otherId, id)))
-            {
-                continue;
-            }
-
-            // Apply non-overlap only to objects in the same group (cluster).
-            pairInfoList.push_back(ShapePairInfo(otherId, id));
-        }
-    }
+    // Apply non-overlap only to objects in the same group (cluster).
+    // Candidate pairs are found later from the shape positions.
+    groupMembers[group].insert(id);
+    sweepOrder[XDIM].erase(group);
+    sweepOrder[YDIM].erase(group);
 
     shapeOffsets[id] = OverlapShapeOffsets(id, halfW, halfH, group);
 }
@@ -186,34 +335,47 @@ void NonOverlapConstraints::addShape(unsigned id, double halfW, double halfH,
 void NonOverlapConstraints::addCluster(Cluster *cluster, unsigned int group)
 {
     unsigned id = cluster->clusterVarId;
-    // Setup pairInfos for all other shapes. 
-    for (std::map<unsigned, OverlapShapeOffsets>::iterator curr =
-            shapeOffsets.begin(); curr != shapeOffsets.end(); ++curr)
-    {
-        unsigned otherId = curr->first;
-        if (shapeOffsets[otherId].group != group)
-        {
-            // Don't apply if not in same group.
-            continue;
-        }
-        if (cluster->nodes.count(otherId) > 0)
-        {
-            // Don't apply non-overlap to child nodes.
-            continue;
-        }
-        if (m_cluster_cluster_exemptions.count(ShapePair(id, otherId)) > 0)
-        {
-            // Don't apply  if exempt due to non-strict cluster hierarchy.
-            continue;
-        }
-        // Apply non-overlap only to objects in the same group (cluster).
-        pairInfoList.push_back(ShapePairInfo(otherId, id));
-    }
+    groupMembers[group].insert(id);
+    sweepOrder[XDIM].erase(group);
+    sweepOrder[YDIM].erase(group);
     
     shapeOffsets[id] = OverlapShapeOffsets(id, cluster, group);
 }
 
 
+// Returns whether non-overlap should be enforced between the two given 
+// members of the same group.
+bool NonOverlapConstraints::shapePairRequiresNonOverlap(unsigned id1,
+        unsigned id2) const
+{
+    if (id1 == id2)
+    {
+        return false;
+    }
+    const OverlapShapeOffsets& shape1 = shapeOffsets.find(id1)->second;
+    const OverlapShapeOffsets& shape2 = shapeOffsets.find(id2)->second;
+
+    if (!shape1.cluster && !shape2.cluster)
+    {
+        return !(m_exemptions &&
+                m_exemptions->shapePairIsExempt(ShapePair(id1, id2)));
+    }
+
+    if ((shape1.cluster && (shape1.cluster->nodes.count(id2) > 0)) ||
+        (shape2.cluster && (shape2.cluster->nodes.count(id1) > 0)))
+    {
+        // Don't apply non-overlap to child nodes.
+        return false;
+    }
+    if (m_cluster_cluster_exemptions.count(ShapePair(id1, id2)) > 0)
+    {
+        // Don't apply  if exempt due to non-strict cluster hierarchy.
+        return false;
+    }
+    return true;
+}
+
+
 void NonOverlapConstraints::setClusterClusterExemptions(
         std::set<ShapePair> exemptions)
 {
@@ -230,51 +392,12 @@ void NonOverlapConstraints::generateVariables(const vpsc::Dim dim,
 void NonOverlapConstraints::computeOverlapForShapePairInfo(ShapePairInfo& info,
         vpsc::Variables vs[])
 {
-    OverlapShapeOffsets& shape1 = shapeOffsets[info.varIndex1];
-    OverlapShapeOffsets& shape2 = shapeOffsets[info.varIndex2];
-
-    double xPos1 = vs[0][info.varIndex1]->finalPosition;
-    double xPos2 = vs[0][info.varIndex2]->finalPosition;
-    double yPos1 = vs[1][info.varIndex1]->finalPosition;
-    double yPos2 = vs[1][info.varIndex2]->finalPosition;
-
-    double left1   = xPos1 - shape1.halfDim[0];
-    double right1  = xPos1 + shape1.halfDim[0];
-    double bottom1 = yPos1 - shape1.halfDim[1];
-    double top1    = yPos1 + shape1.halfDim[1];
-
-    if (shape1.cluster)
-    {
-        COLA_ASSERT(shape1.halfDim[0] == 0);
-        COLA_ASSERT(shape1.halfDim[1] == 0);
-        COLA_ASSERT(info.varIndex1 + 1 < vs[0].size());
-        right1 = vs[0][info.varIndex1 + 1]->finalPosition;
-        COLA_ASSERT(info.varIndex1 + 1 < vs[1].size());
-        top1    = vs[1][info.varIndex1 + 1]->finalPosition;
-        left1 -= shape1.rectPadding.min(XDIM);
-        bottom1 -= shape1.rectPadding.min(YDIM);
-        right1 += shape1.rectPadding.max(XDIM);
-        top1 += shape1.rectPadding.max(YDIM);
-    }
-
-    double left2   = xPos2 - shape2.halfDim[0];
-    double right2  = xPos2 + shape2.halfDim[0];
-    double bottom2 = yPos2 - shape2.halfDim[1];
-    double top2    = yPos2 + shape2.halfDim[1];
-
-    if (shape2.cluster)
-    {
-        COLA_ASSERT(shape2.halfDim[0] == 0);
-        COLA_ASSERT(shape2.halfDim[1] == 0);
-        COLA_ASSERT(info.varIndex2 + 1 < vs[0].size());
-        right2 = vs[0][info.varIndex2 + 1]->finalPosition;
-        COLA_ASSERT(info.varIndex2 + 1 < vs[1].size());
-        top2   = vs[1][info.varIndex2 + 1]->finalPosition;
-        left2 -= shape2.rectPadding.min(XDIM);
-        bottom2 -= shape2.rectPadding.min(YDIM);
-        right2 += shape2.rectPadding.max(XDIM);
-        top2 += shape2.rectPadding.max(YDIM);
-    }
+    double left1, right1, bottom1, top1;
+    computeShapeBounds(info.varIndex1, shapeOffsets[info.varIndex1], vs,
+            left1, right1, bottom1, top1);
+    double left2, right2, bottom2, top2;
+    computeShapeBounds(info.varIndex2, shapeOffsets[info.varIndex2], vs,
+            left2, right2, bottom2, top2);
 
     // If lr < 0, then left edge of shape1 is on the left 
     // of right edge of shape2.
@@ -356,19 +479,51 @@ std::string NonOverlapConstraints::toString(void) const
 
 void NonOverlapConstraints::computeAndSortOverlap(vpsc::Variables vs[])
 {
-    for (std::list<ShapePairInfo>::iterator curr = pairInfoList.begin();
-            curr != pairInfoList.end(); ++curr)
+    // Rebuild the candidate list from the pairs that currently overlap.
+    pairInfoList.clear();
+
+    std::vector<SweepRect> rects;
+    std::vector<std::pair<unsigned, unsigned> > pairs;
+    for (std::map<unsigned, std::set<unsigned> >::iterator group =
+            groupMembers.begin(); group != groupMembers.end(); ++group)
     {
-        ShapePairInfo& info = static_cast<ShapePairInfo&> (*curr);
-        
-        if (info.processed)
+        rects.clear();
+        pairs.clear();
+        std::vector<unsigned>& order = sweepOrder[XDIM][group->first];
+        const bool nearlySorted = (order.size() == group->second.size());
+        if (!nearlySorted)
+        {
+            order.assign(group->second.begin(), group->second.end());
+        }
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            SweepRect rect(order[i]);
+            computeShapeBounds(order[i], shapeOffsets[order[i]], vs, 
+                    rect.min[0], rect.max[0], rect.min[1], rect.max[1]);
+            rects.push_back(rect);
+        }
+        sweepForIntersectingPairs(rects, nearlySorted, true, pairs);
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            order[i] = rects[i].id;
+        }
+
+        for (size_t i = 0; i < pairs.size(); ++i)
         {
-            // Once we reach the processed nodes, which will always be at 
-            // the back, we can some computing overlap since this no longer
-            // matters.
-            break;
+            unsigned id1 = pairs[i].first;
+            unsigned id2 = pairs[i].second;
+            if ((processedPairs.count(ShapePair(id1, id2)) > 0) ||
+                    !shapePairRequiresNonOverlap(id1, id2))
+            {
+                continue;
+            }
+            ShapePairInfo info(id1, id2);
+            computeOverlapForShapePairInfo(info, vs);
+            if (info.overlapMax > 0)
+            {
+                pairInfoList.push_back(info);
+            }
         }
-        computeOverlapForShapePairInfo(info, vs);
     }
     pairInfoList.sort();
 }
@@ -376,14 +531,12 @@ void NonOverlapConstraints::computeAndSortOverlap(vpsc::Variables vs[])
 
 void NonOverlapConstraints::markCurrSubConstraintAsActive(const bool satisfiable)
 {
-    ShapePairInfo info = pairInfoList.front();
+    COLA_UNUSED(satisfiable);
+
+    ShapePairInfo& info = pairInfoList.front();
+    processedPairs.insert(ShapePair(info.varIndex1, info.varIndex2));
     pairInfoList.pop_front();
 
-    info.processed = true;
-    info.satisfied = satisfiable;
-    info.overlapMax = 0;
-    
-    pairInfoList.push_back(info);
     pairInfoListSorted = false;
 }
 
@@ -401,27 +554,28 @@ NonOverlapConstraints::getCurrSubConstraintAlternatives(vpsc::Variables vs[])
         initialSortCompleted = true;
     }
 
-    // Take the first in the list.
-    ShapePairInfo& info = pairInfoList.front();
-    if (pairInfoListSorted == false)
+    if (!pairInfoList.empty() && (pairInfoListSorted == false))
     {
         // Only need to compute if not sorted.
-        computeOverlapForShapePairInfo(info, vs);
+        computeOverlapForShapePairInfo(pairInfoList.front(), vs);
     }
 
-    if (info.overlapMax == 0)
+    if (pairInfoList.empty() || (pairInfoList.front().overlapMax == 0))
     {
         if (pairInfoListSorted)
         {
             // Seeing no overlap in the sorted list means we have solved
             // all non-overlap.  Nothing more to do.
-            _currSubConstraintIndex = pairInfoList.size();
+            allOverlapResolved = true;
             return alternatives;
         }
         computeAndSortOverlap(vs);
         pairInfoListSorted = true;
         return alternatives;
     }
+
+    // Take the first in the list.
+    ShapePairInfo& info = pairInfoList.front();
     OverlapShapeOffsets& shape1 = shapeOffsets[info.varIndex1];
     OverlapShapeOffsets& shape2 = shapeOffsets[info.varIndex2];
 
@@ -536,22 +690,32 @@ NonOverlapConstraints::getCurrSubConstraintAlternatives(vpsc::Variables vs[])
 
 bool NonOverlapConstraints::subConstraintsRemaining(void) const
 {
-    //printf(". %3d of %4d\n", _currSubConstraintIndex, pairInfoList.size());
-    return _currSubConstraintIndex < pairInfoList.size();
+    return !allOverlapResolved;
 }
 
 
 void NonOverlapConstraints::markAllSubConstraintsAsInactive(void)
 {
-    for (std::list<ShapePairInfo>::iterator curr = pairInfoList.begin();
-            curr != pairInfoList.end(); ++curr)
-    {
-        ShapePairInfo& info = (*curr);
-        info.satisfied = false;
-        info.processed = false;
-    }
+    pairInfoList.clear();
+    processedPairs.clear();
     _currSubConstraintIndex = 0;
     initialSortCompleted = false;
+    allOverlapResolved = false;
+}
+
+
+// Computes the rectangle used for a shape or cluster when generating 
+// separation constraints.
+static vpsc::Rectangle separationRectangle(unsigned id,
+        const OverlapShapeOffsets& shape,
+        std::vector<vpsc::Rectangle*>& boundingBoxes)
+{
+    if (shape.cluster)
+    {
+        return shape.cluster->margin().rectangleByApplyingBox(
+                shape.cluster->bounds);
+    }
+    return *boundingBoxes[id];
 }
 
 
@@ -559,8 +723,49 @@ void NonOverlapConstraints::generateSeparationConstraints(
         const vpsc::Dim dim, vpsc::Variables& vs, vpsc::Constraints& cs,
         std::vector<vpsc::Rectangle*>& boundingBoxes) 
 {
-    for (std::list<ShapePairInfo>::iterator info = pairInfoList.begin();
-            info != pairInfoList.end(); ++info)
+    // Only pairs that overlap in the other dimension can be given a
+    // separation constraint in this dimension, so sweep for those.
+    std::list<ShapePairInfo> candidates;
+    std::vector<SweepRect> rects;
+    std::vector<std::pair<unsigned, unsigned> > pairs;
+    for (std::map<unsigned, std::set<unsigned> >::iterator group =
+            groupMembers.begin(); group != groupMembers.end(); ++group)
+    {
+        rects.clear();
+        pairs.clear();
+        std::vector<unsigned>& order = sweepOrder[!dim][group->first];
+        const bool nearlySorted = (order.size() == group->second.size());
+        if (!nearlySorted)
+        {
+            order.assign(group->second.begin(), group->second.end());
+        }
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            vpsc::Rectangle bounds = separationRectangle(order[i], 
+                    shapeOffsets[order[i]], boundingBoxes);
+            SweepRect rect(order[i]);
+            rect.min[0] = bounds.getMinD(!dim);
+            rect.max[0] = bounds.getMaxD(!dim);
+            rects.push_back(rect);
+        }
+        sweepForIntersectingPairs(rects, nearlySorted, false, pairs);
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            order[i] = rects[i].id;
+        }
+
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            if (shapePairRequiresNonOverlap(pairs[i].first, pairs[i].second))
+            {
+                candidates.push_back(
+                        ShapePairInfo(pairs[i].first, pairs[i].second));
+            }
+        }
+    }
+
+    for (std::list<ShapePairInfo>::iterator info = candidates.begin();
+            info != candidates.end(); ++info)
     {
         assertValidVariableIndex(vs, info->varIndex1);
         assertValidVariableIndex(vs, info->varIndex2);
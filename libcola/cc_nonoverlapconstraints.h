@@ -24,6 +24,8 @@
 #define COLA_CC_NONOVERLAPCONSTRAINTS_H
 
 #include <vector>
+#include <map>
+#include <set>
 #include "libcola/compound_constraints.h"
 #include "libcola/shapepair.h"
 
@@ -50,6 +52,11 @@ class NonOverlapConstraintExemptions {
 };
 
 // Non-overlap constraints prevent a set of given shapes from overlapping.
+//
+// Shape pairs are not enumerated up front.  Instead, candidate pairs are
+// found by sweeping over the current shape positions each time they are
+// needed, so only shapes that actually overlap (or, when generating
+// separation constraints, overlap in the other dimension) are considered.
 class NonOverlapConstraints : public CompoundConstraint {
     public:
         NonOverlapConstraints(NonOverlapConstraintExemptions *exemptions,
@@ -79,11 +86,21 @@ class NonOverlapConstraints : public CompoundConstraint {
     private:
         void computeOverlapForShapePairInfo(ShapePairInfo& info,
                 vpsc::Variables vs[]);
+        bool shapePairRequiresNonOverlap(unsigned id1, unsigned id2) const;
         
+        // Candidate pairs that currently overlap and are unprocessed.
         std::list<ShapePairInfo> pairInfoList;
         std::map<unsigned, OverlapShapeOffsets> shapeOffsets;
+        // The IDs of shapes and clusters in each non-overlap group.
+        std::map<unsigned, std::set<unsigned> > groupMembers;
+        // The IDs in each group in the order they were last swept in each
+        // dimension, which the next sweep starts from.
+        std::map<unsigned, std::vector<unsigned> > sweepOrder[2];
+        // Pairs already resolved during the current makeFeasible pass.
+        std::set<ShapePair> processedPairs;
         bool pairInfoListSorted;
         bool initialSortCompleted;
+        bool allOverlapResolved;
 
         // Cluster variables
         size_t clusterVarStartIndex;
@@ -37,6 +37,8 @@ Cluster::Cluster()
       clusterVarId(0),
       varWeight(0.0001),
       internalEdgeWeightFactor(1.), 
+      m_bounds_dirty(true),
+      m_parent_cluster(NULL),
       desiredBoundsSet(false), 
       desiredBounds()
 {
@@ -98,11 +100,36 @@ void Cluster::countContainedNodes(std::vector<unsigned>& counts)
 
 void Cluster::computeBoundingRect(const vpsc::Rectangles& rs) 
 {
-    bounds = vpsc::Rectangle();
     for (vector<Cluster*>::const_iterator i = clusters.begin(); 
             i != clusters.end(); ++i)
     {
         (*i)->computeBoundingRect(rs);
+    }
+    computeBoundingRectFromContents(rs);
+}
+
+void Cluster::updateBoundingRect(const vpsc::Rectangles& rs) 
+{
+    if (!m_bounds_dirty)
+    {
+        return;
+    }
+    for (vector<Cluster*>::const_iterator i = clusters.begin(); 
+            i != clusters.end(); ++i)
+    {
+        (*i)->updateBoundingRect(rs);
+    }
+    computeBoundingRectFromContents(rs);
+}
+
+// Sets bounds from the current bounds of the child clusters and the
+// rectangles of the child nodes.
+void Cluster::computeBoundingRectFromContents(const vpsc::Rectangles& rs)
+{
+    bounds = vpsc::Rectangle();
+    for (vector<Cluster*>::const_iterator i = clusters.begin(); 
+            i != clusters.end(); ++i)
+    {
         vpsc::Rectangle rectangle = 
                 (*i)->margin().rectangleByApplyingBox((*i)->bounds);
         bounds = bounds.unionWith(rectangle);
@@ -114,6 +141,45 @@ void Cluster::computeBoundingRect(const vpsc::Rectangles& rs)
         bounds = bounds.unionWith(*r);
     }
     bounds = padding().rectangleByApplyingBox(bounds);
+    m_bounds_dirty = false;
+}
+
+// Records the parent of each cluster, and the clusters directly containing
+// each rectangle the bounds are computed from.
+void Cluster::recRecordParents(std::vector<Clusters>& rectParents,
+        Cluster *parent)
+{
+    m_parent_cluster = parent;
+    for (unsigned i = 0; i < clusters.size(); ++i) 
+    {
+        clusters[i]->recRecordParents(rectParents, this);
+    }
+
+    RectangularCluster *rc = dynamic_cast<RectangularCluster *> (this);
+    if (rc && rc->clusterIsFromFixedRectangle() &&
+            ((size_t) rc->rectangleIndex() < rectParents.size()))
+    {
+        rectParents[rc->rectangleIndex()].push_back(this);
+    }
+    for (std::set<unsigned>::iterator it = nodes.begin();
+            it != nodes.end(); ++it)
+    {
+        if (*it < rectParents.size())
+        {
+            rectParents[*it].push_back(this);
+        }
+    }
+}
+
+// Marks this cluster and its ancestors as needing their bounds recomputed.
+// The ancestors of a dirty cluster are already dirty, so this can stop at 
+// the first one found.
+void Cluster::markBoundsDirty(void)
+{
+    for (Cluster *c = this; c && !c->m_bounds_dirty; c = c->m_parent_cluster)
+    {
+        c->m_bounds_dirty = true;
+    }
 }
 
 void Cluster::computeVarRect(vpsc::Variables& vars, size_t dim)
@@ -164,6 +230,25 @@ void ConvexCluster::computeBoundary(const vpsc::Rectangles& rs)
         printf("X[%d]=%f, Y[%d]=%f;\n",i,X[i],i,Y[i]);
     }
     */
+    if ((nodesVector == m_hull_nodes) && (m_hull_input_X.size() == n))
+    {
+        bool moved = false;
+        for (unsigned i = 0; i < n && !moved; ++i)
+        {
+            moved = (X[i] != m_hull_input_X[i]) || (Y[i] != m_hull_input_Y[i]);
+        }
+        if (!moved)
+        {
+            // None of the nodes have moved, so the hull is still valid.
+            return;
+        }
+    }
+    m_hull_nodes = nodesVector;
+    m_hull_input_X.resize(n);
+    m_hull_input_X = X;
+    m_hull_input_Y.resize(n);
+    m_hull_input_Y = Y;
+
     vector<unsigned> hull;
     hull::convex(X,Y,hull);
     hullX.resize(hull.size());
@@ -439,12 +524,29 @@ void RectangularCluster::computeBoundingRect(const vpsc::Rectangles& rs)
     {
         // For bounds, just use this shape's rectangle.
         bounds = *(rs[m_rectangle_index]);
+        m_bounds_dirty = false;
     }
     else
     {
         Cluster::computeBoundingRect(rs);
     }
 }
+
+void RectangularCluster::updateBoundingRect(const vpsc::Rectangles& rs) 
+{
+    if (clusterIsFromFixedRectangle())
+    {
+        if (m_bounds_dirty)
+        {
+            bounds = *(rs[m_rectangle_index]);
+            m_bounds_dirty = false;
+        }
+    }
+    else
+    {
+        Cluster::updateBoundingRect(rs);
+    }
+}
 void RectangularCluster::addChildNode(unsigned index)
 {
     if ((m_rectangle_index == (int) index) && (m_rectangle_index > 0))
@@ -458,8 +560,60 @@ void RectangularCluster::addChildNode(unsigned index)
 
 
 RootCluster::RootCluster()
-    : m_allows_multiple_parents(false)
+    : m_allows_multiple_parents(false),
+      m_bounds_x_border(0),
+      m_bounds_y_border(0)
+{
+}
+
+void RootCluster::computeBoundingRect(const vpsc::Rectangles& rs)
+{
+    m_rect_parents.clear();
+    m_rect_parents.resize(rs.size());
+    recRecordParents(m_rect_parents, NULL);
+
+    Cluster::computeBoundingRect(rs);
+
+    m_bounds_rects.clear();
+    m_bounds_rects.reserve(rs.size());
+    for (size_t i = 0; i < rs.size(); ++i)
+    {
+        m_bounds_rects.push_back(*rs[i]);
+    }
+    m_bounds_x_border = vpsc::Rectangle::xBorder;
+    m_bounds_y_border = vpsc::Rectangle::yBorder;
+}
+
+void RootCluster::updateBoundingRects(const vpsc::Rectangles& rs)
 {
+    if ((m_bounds_rects.size() != rs.size()) ||
+            (m_bounds_x_border != vpsc::Rectangle::xBorder) ||
+            (m_bounds_y_border != vpsc::Rectangle::yBorder))
+    {
+        computeBoundingRect(rs);
+        return;
+    }
+
+    // Mark the clusters containing each changed rectangle as dirty.
+    for (size_t i = 0; i < rs.size(); ++i)
+    {
+        const vpsc::Rectangle& r = *rs[i];
+        vpsc::Rectangle& last = m_bounds_rects[i];
+        if ((r.getMinX() == last.getMinX()) && 
+                (r.getMaxX() == last.getMaxX()) &&
+                (r.getMinY() == last.getMinY()) && 
+                (r.getMaxY() == last.getMaxY()))
+        {
+            continue;
+        }
+        last = r;
+        const Clusters& parents = m_rect_parents[i];
+        for (size_t j = 0; j < parents.size(); ++j)
+        {
+            parents[j]->markBoundsDirty();
+        }
+    }
+    updateBoundingRect(rs);
 }
 
 void Cluster::recPathToCluster(RootCluster *rootCluster, Clusters currentPath)
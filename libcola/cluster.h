@@ -120,6 +120,16 @@ class Cluster
         void recPathToCluster(RootCluster *rootCluster, 
                 Clusters currentPath);
         bool includesAllNodesFrom(const Cluster *rhs) const;
+
+        // Recomputes the bounds of this cluster, and of any descendants,
+        // if they have been marked as dirty by a moved rectangle.  See 
+        // RootCluster::updateBoundingRects().
+        virtual void updateBoundingRect(const vpsc::Rectangles& rs);
+        void recRecordParents(std::vector<Clusters>& rectParents,
+                Cluster *parent);
+        void markBoundsDirty(void);
+        bool m_bounds_dirty;
+        Cluster *m_parent_cluster;
         
         // The following are for handling the generation of the correct
         // set of non-overlap constraints in the case overlapping clusters
@@ -140,6 +150,8 @@ class Cluster
         friend class ConstrainedFDLayout;
         friend class RootCluster;
 
+        void computeBoundingRectFromContents(const vpsc::Rectangles& rs);
+
         bool desiredBoundsSet;
         vpsc::Rectangle desiredBounds;
 
@@ -174,6 +186,23 @@ class RootCluster : public Cluster
     public:
         RootCluster();
         void computeBoundary(const vpsc::Rectangles& rs);
+        virtual void computeBoundingRect(const vpsc::Rectangles& rs);
+        /**
+         * @brief  Brings the bounds of all clusters up to date with the
+         *         given rectangles.
+         *
+         * This gives the same bounds as computeBoundingRect(), but only 
+         * recomputes them for clusters containing (at any depth) a 
+         * rectangle that has moved or been resized since the bounds were
+         * last computed.  Unchanged subtrees keep their existing bounds.
+         *
+         * The hierarchy is assumed to be unchanged since the last call to
+         * computeBoundingRect(), which should be called instead after 
+         * nodes or clusters have been added.
+         *
+         * @param[in] rs  The rectangles for the nodes.
+         */
+        void updateBoundingRects(const vpsc::Rectangles& rs);
         // There are just shapes at the top level, so
         // effectively no clusters in the diagram scene.
         bool flat(void) const
@@ -207,6 +236,13 @@ class RootCluster : public Cluster
         bool m_allows_multiple_parents;
         
         std::vector<ClustersList> m_cluster_vectors_leading_to_nodes;
+
+        // The clusters whose bounds directly depend on each rectangle, and
+        // the rectangles (and borders) the current bounds were computed from.
+        std::vector<Clusters> m_rect_parents;
+        std::vector<vpsc::Rectangle> m_bounds_rects;
+        double m_bounds_x_border;
+        double m_bounds_y_border;
 };
 
 /**
@@ -343,6 +379,9 @@ class RectangularCluster : public Cluster
                 cola::CompoundConstraints& idleConstraints,
                 vpsc::Rectangles& rc, vpsc::Variables (&vars)[2]) const;
     
+    protected:
+        virtual void updateBoundingRect(const vpsc::Rectangles& rs);
+
     private:
         vpsc::Rectangle *minEdgeRect[2];
         vpsc::Rectangle *maxEdgeRect[2];
@@ -364,6 +403,11 @@ class ConvexCluster : public Cluster
 
         std::valarray<unsigned> hullRIDs;
         std::valarray<unsigned char> hullCorners;
+
+    private:
+        // The nodes and corner points the current hull was computed from.
+        std::vector<unsigned> m_hull_nodes;
+        std::valarray<double> m_hull_input_X, m_hull_input_Y;
 };
 
 
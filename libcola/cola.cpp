@@ -29,6 +29,7 @@
 #include "libcola/straightener.h"
 #include "libcola/shortest_paths.h"
 #include "libcola/cluster.h"
+#include "libcola/sparse_stress.h"
 
 using namespace std;
 using namespace vpsc;
@@ -46,8 +47,10 @@ ConstrainedMajorizationLayout
         TestConvergence *doneTest,
         PreIteration* preIteration)
     : n(rs.size()),
-      lap2(valarray<double>(n*n)), 
-      Dij(valarray<double>(n*n)),
+      haveFullStress(false),
+      sparseStress(NULL),
+      sparseStressPivots(0),
+      edges(es),
       tol(1e-7),
       done(doneTest),
       using_default_done(false),
@@ -82,12 +85,8 @@ ConstrainedMajorizationLayout
 
     COLA_ASSERT(!straightenEdges||straightenEdges->size()==es.size());
 
-    double** D=new double*[n];
-    for(unsigned i=0;i<n;i++) {
-        D[i]=new double[n];
-    }
-
-    std::valarray<double> edgeLengths(eLengths.data(), eLengths.size());
+    edgeLengths.resize(eLengths.size());
+    edgeLengths = valarray<double>(eLengths.data(), eLengths.size());
     // Correct zero or negative entries in eLengths array.
     for (size_t i = 0; i < edgeLengths.size(); ++i)
     {
@@ -99,9 +98,57 @@ ConstrainedMajorizationLayout
         }
     }
 
-    shortest_paths::johnsons(n,D,es,edgeLengths);
-    //shortest_paths::neighbours(n,D,es,edgeLengths);
     edge_length = idealLength;
+    for(unsigned i = 0; i<n; i++) {
+        X[i]=rs[i]->getCentreX();
+        Y[i]=rs[i]->getCentreY();
+    }
+}
+
+ConstrainedMajorizationLayout::~ConstrainedMajorizationLayout() {
+    if (using_default_done)
+    {
+        delete done;
+    }
+
+    if(constrainedLayout) {
+        delete gpX;
+        delete gpY;
+    }
+    delete sparseStress;
+}
+
+void ConstrainedMajorizationLayout::setSparseStress(unsigned pivots) {
+    sparseStressPivots = pivots;
+    delete sparseStress;
+    sparseStress = NULL;
+}
+
+// Builds the sparse stress terms from the current graph and cluster
+// hierarchy, replacing any built before.
+void ConstrainedMajorizationLayout::setUpSparseStress() {
+    delete sparseStress;
+    sparseStress = new SparseStress(n, edges, edgeLengths, edge_length,
+            sparseStressPivots, clusterHierarchy);
+}
+
+// Builds the all pairs shortest path distances and the Laplacian used for
+// full stress, unless this has already been done.
+void ConstrainedMajorizationLayout::setUpFullStress() {
+    if (haveFullStress) {
+        return;
+    }
+    haveFullStress = true;
+    lap2.resize(n*n);
+    Dij.resize(n*n);
+
+    double** D=new double*[n];
+    for(unsigned i=0;i<n;i++) {
+        D[i]=new double[n];
+    }
+
+    shortest_paths::johnsons(n,D,edges,edgeLengths);
+    //shortest_paths::neighbours(n,D,edges,edgeLengths);
     if(clusterHierarchy) {
         for(Clusters::const_iterator i=clusterHierarchy->clusters.begin();
                 i!=clusterHierarchy->clusters.end();i++) {
@@ -118,8 +165,6 @@ ConstrainedMajorizationLayout
     // Lij_{i!=j}=1/(Dij^2)
     //
     for(unsigned i = 0; i<n; i++) {
-        X[i]=rs[i]->getCentreX();
-        Y[i]=rs[i]->getCentreY();
         double degree = 0;
         for(unsigned j=0;j<n;j++) {
             double d = edge_length * D[i][j];
@@ -132,6 +177,9 @@ ConstrainedMajorizationLayout
             degree += lap2[i*n + j] = lij;
         }
         lap2[i*n + i]=-degree;
+        if(stickyNodes) {
+            lap2[i*n + i]-=stickyWeight;
+        }
         delete [] D[i];
     }
     //GradientProjection::dumpSquareMatrix(Dij);
@@ -151,8 +199,10 @@ void ConstrainedMajorizationLayout::setStickyNodes(
     this->stickyWeight=stickyWeight;
     this->startX = startX;
     this->startY = startY;
-    for(unsigned i = 0; i<n; i++) {
-        lap2[i*n+i]-=stickyWeight;
+    if(haveFullStress) {
+        for(unsigned i = 0; i<n; i++) {
+            lap2[i*n+i]-=stickyWeight;
+        }
     }
 }
 
@@ -161,6 +211,11 @@ void ConstrainedMajorizationLayout::majorize(
         valarray<double>& coords,
         valarray<double> const & startCoords)
 {
+    if(usingSparseStress()) {
+        sparseStress->majorize(X, Y, coords, tol, n);
+        moveBoundingBoxes();
+        return;
+    }
     double L_ij,dist_ij,degree;
     /* compute the vector b */
     /* multiply on-the-fly with distance-based laplacian */
@@ -280,6 +335,9 @@ void ConstrainedMajorizationLayout::newton(
 }
 inline double ConstrainedMajorizationLayout
 ::compute_stress(valarray<double> const &Dij) {
+    if(usingSparseStress()) {
+        return sparseStress->stress(X, Y);
+    }
     double sum = 0, d, diff;
     for (unsigned i = 1; i < n; i++) {
         for (unsigned j = 0; j < i; j++) {
@@ -302,6 +360,11 @@ inline double ConstrainedMajorizationLayout
 }
 
 void ConstrainedMajorizationLayout::run(bool x, bool y) {
+    if(usingSparseStress()) {
+        setUpSparseStress();
+    } else {
+        setUpFullStress();
+    }
     if(constrainedLayout) {
         vector<vpsc::Rectangle*>* pbb = boundingBoxes.empty()?NULL:&boundingBoxes;
         SolveWithMosek mosek = Off;
@@ -377,9 +440,19 @@ void ConstrainedMajorizationLayout::run(bool x, bool y) {
     } while(!(*done)(compute_stress(Dij),X,Y));
 }
 double ConstrainedMajorizationLayout::computeStress() {
+    if(!usingSparseStress()) {
+        setUpFullStress();
+    } else if(!sparseStress) {
+        setUpSparseStress();
+    }
     return compute_stress(Dij);
 }
 void ConstrainedMajorizationLayout::runOnce(bool x, bool y) {
+    if(!usingSparseStress()) {
+        setUpFullStress();
+    } else if(!sparseStress) {
+        setUpSparseStress();
+    }
     if(constrainedLayout) {
         vector<vpsc::Rectangle*>* pbb = boundingBoxes.empty()?NULL:&boundingBoxes;
         SolveWithMosek mosek = Off;
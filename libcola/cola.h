@@ -53,6 +53,7 @@ namespace cola {
 
 class NonOverlapConstraints;
 class NonOverlapConstraintExemptions;
+class SparseStress;
 
 //! Edges are simply a pair of indices to entries in the Node vector
 typedef std::pair<unsigned, unsigned> Edge;
@@ -374,6 +375,27 @@ public:
         this->bendWeight = bendWeight;
         this->potBendWeight = potBendWeight;
     }
+    /**
+     * @brief  Use a sparse approximation of stress for unconstrained layout.
+     *
+     * Full stress needs all pairs shortest paths and an n*n Laplacian,
+     * which is impractical for large graphs.  The sparse approximation
+     * only has terms for edges and for pairs between each node and a
+     * number of pivot nodes, so it is set up in O(pivots*m*log n) time and
+     * each iteration takes O(pivots*n).  It is only used when the layout
+     * is unconstrained (no compound constraints, overlap avoidance, sticky
+     * nodes or edge straightening) and uses majorization; otherwise the
+     * full stress matrices are built as usual.
+     *
+     * The terms are built from the graph and the cluster hierarchy at the
+     * start of each call to run(), so changes made to the clusters before
+     * then are taken into account.  runOnce() and computeStress() build 
+     * them only if they haven't been built yet.
+     *
+     * @param[in] pivots  The number of pivot nodes (default: 50), or 0 to
+     *                    go back to full stress.
+     */
+    void setSparseStress(unsigned pivots = 50);
     /** 
      * Update position of bounding boxes.
      */
@@ -383,17 +405,7 @@ public:
         }
     }
 
-    ~ConstrainedMajorizationLayout() {
-        if (using_default_done)
-        {
-            delete done;
-        }
-
-        if(constrainedLayout) {
-            delete gpX;
-            delete gpY;
-        }
-    }
+    ~ConstrainedMajorizationLayout();
     /**
      * @brief  Implements the main layout loop, taking descent steps until
      *         stress is no-longer significantly reduced.
@@ -427,6 +439,11 @@ private:
             (X[i] - X[j]) * (X[i] - X[j]) +
             (Y[i] - Y[j]) * (Y[i] - Y[j]));
     }
+    bool usingSparseStress(void) const {
+        return (sparseStressPivots > 0) && !constrainedLayout && majorization;
+    }
+    void setUpFullStress(void);
+    void setUpSparseStress(void);
     double compute_stress(std::valarray<double> const & Dij);
     void majorize(std::valarray<double> const & Dij,GradientProjection* gp, std::valarray<double>& coords, std::valarray<double> const & startCoords);
     void newton(std::valarray<double> const & Dij,GradientProjection* gp, std::valarray<double>& coords, std::valarray<double> const & startCoords);
@@ -435,6 +452,13 @@ private:
     std::valarray<double> lap2; //< graph laplacian
     std::valarray<double> Q; //< quadratic terms matrix used in computations
     std::valarray<double> Dij; //< all pairs shortest path distances
+    // lap2 and Dij are only built when first needed, by setUpFullStress().
+    bool haveFullStress;
+    SparseStress *sparseStress;
+    // The number of pivots to use for sparse stress, or 0 for full stress.
+    unsigned sparseStressPivots;
+    std::vector<Edge> edges;
+    std::valarray<double> edgeLengths;
     double tol; //< convergence tolerance
     TestConvergence *done; //< functor used to determine if layout is finished
     bool using_default_done; // Whether we allocated a default TestConvergence object.
@@ -503,6 +527,38 @@ vpsc::Rectangle bounds(vpsc::Rectangles& rs);
 
 class ConstrainedFDLayout;
 
+/**
+ * @brief  Elapsed time, in seconds, spent in each phase of a
+ *         ConstrainedFDLayout, for profiling.
+ *
+ * Times are added to on each call to run() or makeFeasible(), so the same
+ * instance may be used to total the phases over several layouts.
+ *
+ * @sa ConstrainedFDLayout::setPhaseTimings()
+ */
+struct PhaseTimings
+{
+    PhaseTimings()
+        : forces(0),
+          projection(0),
+          topology(0),
+          feasibility(0),
+          iterations(0)
+    {
+    }
+    //! Computing forces and taking descent steps, including stress.
+    double forces;
+    //! Generating separation constraints and solving them with VPSC.
+    double projection;
+    //! Taking steps with the topology addon, which does its own forces
+    //! and projection.
+    double topology;
+    //! Finding a feasible starting position in makeFeasible().
+    double feasibility;
+    //! The number of iterations of the main layout loop.
+    unsigned iterations;
+};
+
 /**
  * @brief  Interface for writing COLA addons to handle topology preserving 
  *         layout.
@@ -629,6 +685,12 @@ public:
      *                  default TestConvergence object.
      * @param[in] preIteration  An operation called before each iteration
      *                          (optional).
+     * @param[in] pathLengths  Precomputed shortest path lengths between all
+     *                         pairs of nodes, as an n*n matrix in units of
+     *                         eLengths with DBL_MAX between disconnected
+     *                         nodes (optional).  If given, these are used
+     *                         rather than computing them again, see 
+     *                         ShortestPathsCache.
      */
     ConstrainedFDLayout(
         const vpsc::Rectangles& rs,
@@ -637,7 +699,8 @@ public:
         const bool preventOverlaps,
         const EdgeLengths& eLengths = StandardEdgeLengths, 
         TestConvergence* doneTest = NULL,
-        PreIteration* preIteration=NULL);
+        PreIteration* preIteration=NULL,
+        double const * const * pathLengths = NULL);
     ~ConstrainedFDLayout();
   
     /**
@@ -688,6 +751,17 @@ public:
     void setDesiredPositions(DesiredPositions *desiredPositions) {
         this->desiredPositions = desiredPositions;
     }
+    /**
+     * @brief  Specify where to record the time spent in each phase of
+     *         layout (optional).
+     *
+     * @param[in] timings  The PhaseTimings to add to, or NULL to stop
+     *                     timing.
+     */
+    void setPhaseTimings(PhaseTimings *timings)
+    {
+        m_phase_timings = timings;
+    }
     /**
      * @brief  Specifies an optional hierarchy for clustering nodes.
      *
@@ -790,6 +864,9 @@ private:
     void computeDescentVectorOnBothAxes(const bool xaxis, const bool yaxis,
             double stress, std::valarray<double>& x0, std::valarray<double>& x1);
     void moveTo(const vpsc::Dim dim, std::valarray<double>& target);
+    void project(const vpsc::Dim dim, vpsc::Variables& vs, 
+            vpsc::Constraints& cs, std::valarray<double>& coords);
+    void freeCachedProjection(const vpsc::Dim dim);
     double applyDescentVector(
             const std::valarray<double>& d,
             const std::valarray<double>& oldCoords,
@@ -797,8 +874,9 @@ private:
             const double oldStress, 
             double stepsize
             /*,topology::TopologyConstraints *s=NULL*/);
-    void computePathLengths(
-            const std::vector<Edge>& es, std::valarray<double> eLengths);
+    void computePathLengths(const std::vector<Edge>& es, 
+            std::valarray<double> eLengths, 
+            double const * const * pathLengths = NULL);
     void generateNonOverlapAndClusterCompoundConstraints(
             vpsc::Variables (&vs)[2]);
     void handleResizes(const Resizes&);
@@ -838,6 +916,14 @@ private:
     const std::valarray<double> m_edge_lengths;
 
     NonOverlapConstraintExemptions *m_nonoverlap_exemptions;
+    PhaseTimings *m_phase_timings;
+
+    // VPSC instances kept between projections (and between calls to run())
+    // so that, while the generated constraints are unchanged, each 
+    // projection is an incremental re-solve from the previous blocks.
+    vpsc::Variables m_cached_vs[2];
+    vpsc::Constraints m_cached_cs[2];
+    vpsc::IncSolver *m_cached_solver[2];
 
     friend class topology::ColaTopologyAddon;
 };
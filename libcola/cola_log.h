@@ -80,7 +80,9 @@ Log<T>::~Log()
 template <typename T>
 TLogLevel& Log<T>::ReportingLevel()
 {
-    static TLogLevel reportingLevel = cola::logDEBUG4;
+    // Per thread, since each ConstrainedFDLayout sets it and several may
+    // be run at once.
+    static thread_local TLogLevel reportingLevel = cola::logDEBUG4;
     return reportingLevel;
 }
 
@@ -23,6 +23,7 @@
 
 // cmath needs ::strcpy_s under MinGW so include cstring.
 #include <cstring>
+#include <chrono>
 
 #include <vector>
 #include <cmath>
@@ -61,6 +62,34 @@ void delete_vector(vector<T*> &v) {
 }
 Resizes PreIteration::__resizesNotUsed;
 Locks PreIteration::__locksNotUsed;
+
+// Adds the elapsed time since the last lap to a phase of PhaseTimings,
+// when timing has been requested.  This uses a monotonic wall clock rather
+// than processor time, which would include time spent by other threads.
+class PhaseTimer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    PhaseTimer(PhaseTimings *timings)
+        : m_timings(timings),
+          m_start((timings) ? Clock::now() : Clock::time_point())
+    {
+    }
+    void lap(double PhaseTimings::*phase)
+    {
+        if (m_timings)
+        {
+            Clock::time_point now = Clock::now();
+            m_timings->*phase += 
+                    std::chrono::duration<double>(now - m_start).count();
+            m_start = now;
+        }
+    }
+private:
+    PhaseTimings *m_timings;
+    Clock::time_point m_start;
+};
+
 inline double dotProd(valarray<double> x, valarray<double> y) {
     COLA_ASSERT(x.size()==y.size());
     double dp=0;
@@ -87,7 +116,8 @@ void dumpSquareMatrix(unsigned n, T** L) {
 ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         const std::vector< Edge >& es, const double idealLength,
         const bool preventOverlaps, const EdgeLengths& eLengths, 
-        TestConvergence *doneTest, PreIteration* preIteration)
+        TestConvergence *doneTest, PreIteration* preIteration,
+        double const * const * pathLengths)
     : n(rs.size()),
       X(valarray<double>(n)),
       Y(valarray<double>(n)),
@@ -102,7 +132,8 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
       m_idealEdgeLength(idealLength),
       m_generateNonOverlapConstraints(preventOverlaps),
       m_edge_lengths(eLengths.data(), eLengths.size()),
-      m_nonoverlap_exemptions(new NonOverlapConstraintExemptions())
+      m_nonoverlap_exemptions(new NonOverlapConstraintExemptions()),
+      m_phase_timings(NULL)
 {
     minD = DBL_MAX;
 
@@ -112,6 +143,8 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         using_default_done = true;
     }
 
+    m_cached_solver[0] = m_cached_solver[1] = NULL;
+
     //FILELog::ReportingLevel() = logDEBUG1;
     FILELog::ReportingLevel() = logERROR;
     boundingBoxes = rs;
@@ -129,7 +162,7 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         G[i]=new unsigned short[n];
     }
 
-    computePathLengths(es,m_edge_lengths);
+    computePathLengths(es,m_edge_lengths,pathLengths);
 }
 
 void dijkstra(const unsigned s, const unsigned n, double* d, 
@@ -152,22 +185,33 @@ void dijkstra(const unsigned s, const unsigned n, double* d,
  *      is computed elsewhere))
  *   2 if no attractive force is required between u and v but there is
  *     a connected path between them.
+ * If pathLengths is given it already holds the unscaled shortest path
+ * lengths, so they are just copied rather than recomputed.
  */
-void ConstrainedFDLayout::computePathLengths(
-        const vector<Edge>& es, std::valarray<double> eLengths) 
+void ConstrainedFDLayout::computePathLengths(const vector<Edge>& es, 
+        std::valarray<double> eLengths, double const * const * pathLengths) 
 {
-    // Correct zero or negative entries in eLengths array.
-    for (size_t i = 0; i < eLengths.size(); ++i)
+    if (pathLengths)
     {
-        if (eLengths[i] <= 0)
-        {
-            fprintf(stderr, "Warning: ignoring non-positive length at index %d "
-                    "in ideal edge length array.\n", (int) i);
-            eLengths[i] = 1;
+        for(unsigned i=0;i<n;i++) {
+            std::copy(pathLengths[i], pathLengths[i] + n, D[i]);
         }
     }
+    else
+    {
+        // Correct zero or negative entries in eLengths array.
+        for (size_t i = 0; i < eLengths.size(); ++i)
+        {
+            if (eLengths[i] <= 0)
+            {
+                fprintf(stderr, "Warning: ignoring non-positive length at "
+                        "index %d in ideal edge length array.\n", (int) i);
+                eLengths[i] = 1;
+            }
+        }
 
-    shortest_paths::johnsons(n,D,es,eLengths);
+        shortest_paths::johnsons(n,D,es,eLengths);
+    }
     //dumpSquareMatrix<double>(n,D);
     for(unsigned i=0;i<n;i++) {
         for(unsigned j=0;j<n;j++) {
@@ -284,8 +328,14 @@ void ConstrainedFDLayout::run(const bool xAxis, const bool yAxis)
         } else {
             computeDescentVectorOnBothAxes(xAxis,yAxis,stress,x0,x1);
         }
+        PhaseTimer timer(m_phase_timings);
         setPosition(x1);
         stress=computeStress();
+        timer.lap(&PhaseTimings::forces);
+        if (m_phase_timings)
+        {
+            ++m_phase_timings->iterations;
+        }
         FILE_LOG(logDEBUG) << "stress="<<stress;
     } while(!(*done)(stress,X,Y));
     for(unsigned i=0;i<n;i++) {
@@ -532,6 +582,7 @@ void ConstrainedFDLayout::generateNonOverlapAndClusterCompoundConstraints(
 
 void ConstrainedFDLayout::makeFeasible(void)
 {
+    PhaseTimer timer(m_phase_timings);
     vpsc::Variables vs[2];
     vpsc::Constraints valid[2];
 
@@ -819,6 +870,7 @@ void ConstrainedFDLayout::makeFeasible(void)
     // Clear extra constraints for cluster containment and non-overlap.
     for_each(extraConstraints.begin(), extraConstraints.end(), delete_object());
     extraConstraints.clear();
+    timer.lap(&PhaseTimings::feasibility);
 }
 
 ConstrainedFDLayout::~ConstrainedFDLayout()
@@ -828,6 +880,9 @@ ConstrainedFDLayout::~ConstrainedFDLayout()
         delete done;
     }
 
+    freeCachedProjection(vpsc::HORIZONTAL);
+    freeCachedProjection(vpsc::VERTICAL);
+
     for (unsigned i = 0; i < n; ++i)
     {
         delete [] G[i];
@@ -895,7 +950,7 @@ void setupVarsAndConstraints(unsigned n, const CompoundConstraints& ccs,
     if (clusterHierarchy && !clusterHierarchy->flat())
     {
         // Create variables for clusters
-        clusterHierarchy->computeBoundingRect(boundingBoxes);
+        clusterHierarchy->updateBoundingRects(boundingBoxes);
         clusterHierarchy->createVars(dim, boundingBoxes, vs);
     }
 
@@ -937,12 +992,142 @@ void updateCompoundConstraints(const vpsc::Dim dim,
         (*c)->updatePosition(dim);
     }
 }
-void project(vpsc::Variables& vs, vpsc::Constraints& cs, valarray<double>& coords) {
-    unsigned n=coords.size();
-    vpsc::IncSolver s(vs,cs);
-    s.solve();
-    for(unsigned i=0;i<n;++i) {
-        coords[i]=vs[i]->finalPosition;
+// Returns true if the cached variables and constraints describe the same
+// VPSC problem as the newly generated ones, differing at most in desired
+// positions and weights of the variables.
+static bool sameProblemStructure(const vpsc::Variables& cachedVs, 
+        const vpsc::Constraints& cachedCs, const vpsc::Variables& vs,
+        const vpsc::Constraints& cs)
+{
+    if ((cachedVs.size() != vs.size()) || (cachedCs.size() != cs.size()))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < vs.size(); ++i)
+    {
+        if (cachedVs[i]->scale != vs[i]->scale)
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < cs.size(); ++i)
+    {
+        const vpsc::Constraint *cached = cachedCs[i];
+        const vpsc::Constraint *c = cs[i];
+        if ((cached->left->id != c->left->id) || 
+                (cached->right->id != c->right->id) ||
+                (cached->gap != c->gap) || 
+                (cached->equality != c->equality))
+        {
+            return false;
+        }
+        if (cached->unsatisfiable)
+        {
+            // This constraint was dropped by the cached solver instance, 
+            // so give it another chance with a fresh solver.
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConstrainedFDLayout::freeCachedProjection(const vpsc::Dim dim)
+{
+    delete m_cached_solver[dim];
+    m_cached_solver[dim] = NULL;
+    for_each(m_cached_cs[dim].begin(), m_cached_cs[dim].end(), 
+            delete_object());
+    m_cached_cs[dim].clear();
+    for_each(m_cached_vs[dim].begin(), m_cached_vs[dim].end(), 
+            delete_object());
+    m_cached_vs[dim].clear();
+}
+
+/*
+ * Projects coords onto the feasible region defined by the constraints cs 
+ * over the variables vs.  The VPSC instance is kept after solving and if 
+ * the next projection in this dimension has the same constraint structure
+ * the previous instance is reused, with only the desired positions of its
+ * variables updated.  The block structure from the previous solution is 
+ * then a warm start for the new solve.  Results are always written back 
+ * to vs and cs, which remain owned by the caller.
+ */
+void ConstrainedFDLayout::project(const vpsc::Dim dim, vpsc::Variables& vs, 
+        vpsc::Constraints& cs, valarray<double>& coords) 
+{
+    vpsc::Variables& cachedVs = m_cached_vs[dim];
+    vpsc::Constraints& cachedCs = m_cached_cs[dim];
+
+    for (size_t i = 0; i < vs.size(); ++i)
+    {
+        if (vs[i]->id != (int) i)
+        {
+            // The cache matches constraints to variables by ID, so can't
+            // be used here.  Just solve this instance directly.
+            freeCachedProjection(dim);
+            vpsc::IncSolver s(vs, cs);
+            s.solve();
+            for (unsigned j = 0; j < coords.size(); ++j) 
+            {
+                coords[j] = vs[j]->finalPosition;
+            }
+            return;
+        }
+    }
+
+    if (m_cached_solver[dim] && 
+            sameProblemStructure(cachedVs, cachedCs, vs, cs))
+    {
+        for (size_t i = 0; i < vs.size(); ++i)
+        {
+            cachedVs[i]->desiredPosition = vs[i]->desiredPosition;
+            cachedVs[i]->weight = vs[i]->weight;
+            cachedVs[i]->fixedDesiredPosition = vs[i]->fixedDesiredPosition;
+        }
+    }
+    else
+    {
+        // Start again with a copy of the new problem.
+        freeCachedProjection(dim);
+        for (size_t i = 0; i < vs.size(); ++i)
+        {
+            vpsc::Variable *v = new vpsc::Variable(vs[i]->id, 
+                    vs[i]->desiredPosition, vs[i]->weight, vs[i]->scale);
+            v->fixedDesiredPosition = vs[i]->fixedDesiredPosition;
+            cachedVs.push_back(v);
+        }
+        for (size_t i = 0; i < cs.size(); ++i)
+        {
+            vpsc::Constraint *c = new vpsc::Constraint(
+                    cachedVs[cs[i]->left->id], cachedVs[cs[i]->right->id],
+                    cs[i]->gap, cs[i]->equality);
+            c->creator = cs[i]->creator;
+            cachedCs.push_back(c);
+        }
+        m_cached_solver[dim] = new vpsc::IncSolver(cachedVs, cachedCs);
+    }
+
+    try
+    {
+        m_cached_solver[dim]->solve();
+    }
+    catch (...)
+    {
+        freeCachedProjection(dim);
+        throw;
+    }
+
+    for (size_t i = 0; i < vs.size(); ++i)
+    {
+        vs[i]->finalPosition = cachedVs[i]->finalPosition;
+    }
+    for (size_t i = 0; i < cs.size(); ++i)
+    {
+        cs[i]->unsatisfiable = cachedCs[i]->unsatisfiable;
+    }
+    for (unsigned i = 0; i < coords.size(); ++i) 
+    {
+        coords[i] = vs[i]->finalPosition;
     }
 }
 void setVariableDesiredPositions(vpsc::Variables& vs, vpsc::Constraints& cs,
@@ -1014,7 +1199,7 @@ void ConstrainedFDLayout::moveTo(const vpsc::Dim dim, Position& target) {
         // Add non-overlap constraints, but not variables again.
         setupExtraConstraints(extraConstraints, dim, vs, cs, boundingBoxes);
         // Projection.
-        project(vs,cs,coords);
+        project(dim,vs,cs,coords);
         moveBoundingBoxes();
     }
     updateCompoundConstraints(dim, ccs);
@@ -1043,24 +1228,30 @@ double ConstrainedFDLayout::applyForcesAndConstraints(const vpsc::Dim dim, const
     vpsc::Variables vs;
     vpsc::Constraints cs;
     double stress;
+    PhaseTimer timer(m_phase_timings);
     setupVarsAndConstraints(n, ccs, dim, boundingBoxes,
             clusterHierarchy, vs, cs, coords);
+    timer.lap(&PhaseTimings::projection);
 
     if (topologyAddon->useTopologySolver())
     {
         stress = topologyAddon->applyForcesAndConstraints(this, dim, g, vs, cs, 
                 coords, des, oldStress);
+        timer.lap(&PhaseTimings::topology);
     } else {
         // Add non-overlap constraints, but not variables again.
         setupExtraConstraints(extraConstraints, dim, vs, cs, boundingBoxes);
+        timer.lap(&PhaseTimings::projection);
         // Projection.
         SparseMap HMap(n);
         computeForces(dim,HMap,g);
         SparseMatrix H(HMap);
         valarray<double> oldCoords=coords;
         applyDescentVector(g,oldCoords,coords,oldStress,computeStepSize(H,g,g));
+        timer.lap(&PhaseTimings::forces);
         setVariableDesiredPositions(vs,cs,des,coords);
-        project(vs,cs,coords);
+        project(dim,vs,cs,coords);
+        timer.lap(&PhaseTimings::projection);
         valarray<double> d(n);
         d=oldCoords-coords;
         double stepsize=computeStepSize(H,g,d);
@@ -1068,6 +1259,7 @@ double ConstrainedFDLayout::applyForcesAndConstraints(const vpsc::Dim dim, const
         //printf(" dim=%d beta: ",dim);
         stress = applyDescentVector(d,oldCoords,coords,oldStress,stepsize);
         moveBoundingBoxes();
+        timer.lap(&PhaseTimings::forces);
     }
     updateCompoundConstraints(dim, ccs);
     if(unsatisfiable.size()==2) {
@@ -1077,11 +1269,12 @@ double ConstrainedFDLayout::applyForcesAndConstraints(const vpsc::Dim dim, const
     if (clusterHierarchy)
     {
         clusterHierarchy->computeVarRect(vs, dim);
-        clusterHierarchy->computeBoundingRect(boundingBoxes);
+        clusterHierarchy->updateBoundingRects(boundingBoxes);
     }
 
     for_each(vs.begin(),vs.end(),delete_object());
     for_each(cs.begin(),cs.end(),delete_object());
+    timer.lap(&PhaseTimings::projection);
     return stress;
 }
 /*
@@ -77,6 +77,12 @@ void BoundaryConstraint::updatePosition(const vpsc::Dim dim)
 }
 
 
+void BoundaryConstraint::translate(const double dx, const double dy)
+{
+    position += (_primaryDim == XDIM) ? dx : dy;
+}
+
+
 void BoundaryConstraint::addShape(const unsigned int index, 
         const double offset)
 {
@@ -137,6 +143,12 @@ void BoundaryConstraint::generateVariables(const vpsc::Dim dim,
 }
 
 
+void BoundaryConstraint::clearVariables(void)
+{
+    variable = NULL;
+}
+
+
 void BoundaryConstraint::generateSeparationConstraints(const vpsc::Dim dim,
         vpsc::Variables& vars, vpsc::Constraints& cs,
         vpsc::Rectangles& bbs) 
@@ -234,6 +246,12 @@ void AlignmentConstraint::updatePosition(const vpsc::Dim dim)
 }
 
 
+void AlignmentConstraint::translate(const double dx, const double dy)
+{
+    _position += (_primaryDim == XDIM) ? dx : dy;
+}
+
+
 void AlignmentConstraint::fixPos(double pos) 
 {
     _position = pos;
@@ -274,6 +292,12 @@ void AlignmentConstraint::generateVariables(const vpsc::Dim dim,
 }
 
 
+void AlignmentConstraint::clearVariables(void)
+{
+    variable = NULL;
+}
+
+
 void AlignmentConstraint::generateSeparationConstraints(const vpsc::Dim dim,
         vpsc::Variables& vars, vpsc::Constraints& cs,
         vpsc::Rectangles& bbs) 
@@ -634,6 +658,14 @@ std::string OrthogonalEdgeConstraint::toString(void) const
 }
 
 
+void OrthogonalEdgeConstraint::updateVarIDsWithMapping(
+        const VariableIDMap& idMap, bool forward)
+{
+    left = idMap.mappingForVariable(left, forward);
+    right = idMap.mappingForVariable(right, forward);
+}
+
+
 
 SubConstraintAlternatives 
 OrthogonalEdgeConstraint::getCurrSubConstraintAlternatives(
@@ -1377,6 +1409,12 @@ void PageBoundaryConstraints::generateVariables(const vpsc::Dim dim,
 }
 
 
+void PageBoundaryConstraints::clearVariables(void)
+{
+    vl[0] = vl[1] = vr[0] = vr[1] = NULL;
+}
+
+
 void PageBoundaryConstraints::generateSeparationConstraints(
         const vpsc::Dim dim, vpsc::Variables& vs, vpsc::Constraints& cs,
         vpsc::Rectangles& bbs) 
@@ -1471,6 +1509,15 @@ void generateVariables(CompoundConstraints& ccs, const vpsc::Dim dim,
 }
 
 
+void clearVariables(CompoundConstraints& ccs)
+{
+    for (CompoundConstraints::iterator c = ccs.begin(); c != ccs.end(); ++c)
+    {
+        (*c)->clearVariables();
+    }
+}
+
+
 CompoundConstraint::CompoundConstraint(vpsc::Dim primaryDim,
         unsigned int priority) : 
     _primaryDim(primaryDim),
@@ -164,6 +164,16 @@ public:
      */
     virtual void generateVariables(const vpsc::Dim dim, 
             vpsc::Variables& vars) = 0;
+    /**
+     * @brief Implemented by compound constraints that keep pointers to the
+     *        variables they generate, to forget those variables.
+     *
+     * This should be called once the caller has deleted the variables, so 
+     * that the compound constraint isn't left pointing at them.
+     */
+    virtual void clearVariables(void)
+    {
+    }
     /**
      * @brief Implemented by the compound constraint to generate the low-level
      *        separation constraints in the given dimension.
@@ -196,6 +206,22 @@ public:
     {
         COLA_UNUSED(dim);
     }
+    /**
+     * @brief Implemented by compound constraints that hold a position, to
+     *        move that position along with their nodes.
+     *
+     * This is called when all the nodes the compound constraint relates 
+     * are moved by the same amount, such as when a connected component is
+     * moved to keep it clear of the others.
+     *
+     * @param[in]     dx    The distance moved in the X dimension.
+     * @param[in]     dy    The distance moved in the Y dimension.
+     */
+    virtual void translate(const double dx, const double dy)
+    {
+        COLA_UNUSED(dx);
+        COLA_UNUSED(dy);
+    }
 
     /**
      *  @brief Returns a textual description of the compound constraint.
@@ -274,6 +300,13 @@ void generateVariables(CompoundConstraints& ccs, const vpsc::Dim dim,
         vpsc::Variables& vars);
 
 
+/**
+ * @brief Make a collection of CompoundConstraints forget the variables 
+ *        they generated, once those variables have been deleted.
+ */
+void clearVariables(CompoundConstraints& ccs);
+
+
 /**
  * @brief A boundary constraint specifies a bounding line that a set of nodes 
  *        must be either to the left or right of.
@@ -314,10 +347,12 @@ class BoundaryConstraint : public CompoundConstraint
         SubConstraintAlternatives getCurrSubConstraintAlternatives(
                 vpsc::Variables vs[]);
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void);
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& cs,
                 vpsc::Rectangles& bbs);
         void updatePosition(const vpsc::Dim dim);
+        void translate(const double dx, const double dy);
         void printCreationCode(FILE *fp) const;
         
         //! Holds the position of the boundary line, once layout is complete.
@@ -394,10 +429,12 @@ class AlignmentConstraint : public CompoundConstraint
         SubConstraintAlternatives getCurrSubConstraintAlternatives(
                 vpsc::Variables vs[]);
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void);
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& cs,
                 vpsc::Rectangles& bbs);
         void updatePosition(const vpsc::Dim dim);
+        void translate(const double dx, const double dy);
         double position(void) const;
         void printCreationCode(FILE *fp) const;
         void updateShapeOffsetsForDifferentCentres(
@@ -511,6 +548,8 @@ class OrthogonalEdgeConstraint : public CompoundConstraint
                 std::vector<vpsc::Constraint*>& cs);
         void printCreationCode(FILE *fp) const;
         std::string toString(void) const;
+        void updateVarIDsWithMapping(const VariableIDMap& idMap,
+                bool forward = true);
 
         unsigned left;
         unsigned right;
@@ -760,6 +799,7 @@ class PageBoundaryConstraints : public CompoundConstraint {
         SubConstraintAlternatives getCurrSubConstraintAlternatives(
                 vpsc::Variables vs[]);
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void);
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& gcs,
                 vpsc::Rectangles& bbs);
@@ -45,6 +45,9 @@ namespace cola {
             rects[i]->moveCentreX(rects[i]->getCentreX()+x);
             rects[i]->moveCentreY(rects[i]->getCentreY()+y);
         }
+        for(unsigned i=0;i<ccs.size();i++) {
+            ccs[i]->translate(x,y);
+        }
     }
     Rectangle* Component::getBoundingBox() 
     {
@@ -55,6 +58,24 @@ namespace cola {
         }
         return new Rectangle(boundingBox);
     }
+    void Component::mapConstraintsToComponent() {
+        if(ccs.empty()) {
+            return;
+        }
+        idMap.clear();
+        for(unsigned i=0;i<node_ids.size();i++) {
+            idMap.addMappingForVariable(node_ids[i],i);
+        }
+        for(unsigned i=0;i<ccs.size();i++) {
+            ccs[i]->updateVarIDsWithMapping(idMap);
+        }
+    }
+    void Component::mapConstraintsFromComponent() {
+        bool forward=false;
+        for(unsigned i=0;i<ccs.size();i++) {
+            ccs[i]->updateVarIDsWithMapping(idMap,forward);
+        }
+    }
 
     namespace ccomponents {
         struct Node {
@@ -81,6 +102,51 @@ namespace cola {
                 }
             }
         }
+        // Find the components of the graph whose connectivity is given by
+        // links, then assign the edges es to those components.
+        void findComponents(
+                const vector<Rectangle*> &rs,
+                const vector<Edge> &es,
+                const vector<Edge> &links,
+                vector<Component*> &components,
+                map<unsigned,pair<Component*,unsigned> > &cmap) {
+            unsigned n=rs.size();
+            vector<Node> vs(n);
+            list<Node*> remaining;
+            for(unsigned i=0;i<n;i++) {
+                vs[i].id=i;
+                vs[i].visited=false;
+                vs[i].r=rs[i];
+                vs[i].listPos = remaining.insert(remaining.end(),&vs[i]);
+            }
+            vector<Edge>::const_iterator ei;
+            for(ei=links.begin();ei!=links.end();ei++) {
+                vs[ei->first].neighbours.push_back(&vs[ei->second]);
+                vs[ei->second].neighbours.push_back(&vs[ei->first]);
+            }
+            while(!remaining.empty()) {
+                Component* component=new Component;
+                Node* v=*remaining.begin();
+                dfs(v,remaining,component,cmap);
+                components.push_back(component);
+            }
+            unsigned edgeIndex=0;
+            for(ei=es.begin();ei!=es.end();ei++,edgeIndex++) {
+                pair<Component*,unsigned> u=cmap[ei->first],
+                                          v=cmap[ei->second];
+                COLA_ASSERT(u.first==v.first);
+                u.first->edges.push_back(make_pair(u.second,v.second));
+                u.first->edge_ids.push_back(edgeIndex);
+            }
+        }
+        // Disjoint-set lookup with path halving.
+        unsigned findSet(vector<unsigned> &parent, unsigned v) {
+            while(parent[v]!=v) {
+                parent[v]=parent[parent[v]];
+                v=parent[v];
+            }
+            return v;
+        }
     }
 
     using namespace ccomponents;
@@ -89,55 +155,101 @@ namespace cola {
     void connectedComponents(
             const vector<Rectangle*> &rs,
             const vector<Edge> &es, 
-            //const SeparationConstraints &scx,
-            //const SeparationConstraints &scy,
             vector<Component*> &components) {
-        unsigned n=rs.size();
-        vector<Node> vs(n);
-        list<Node*> remaining;
-        for(unsigned i=0;i<n;i++) {
-            vs[i].id=i;
-            vs[i].visited=false;
-            vs[i].r=rs[i];
-            vs[i].listPos = remaining.insert(remaining.end(),&vs[i]);
-        }
-        vector<Edge>::const_iterator ei;
-        for(ei=es.begin();ei!=es.end();ei++) {
-            vs[ei->first].neighbours.push_back(&vs[ei->second]);
-            vs[ei->second].neighbours.push_back(&vs[ei->first]);
-        }
         map<unsigned,pair<Component*,unsigned> > cmap;
-        while(!remaining.empty()) {
-            Component* component=new Component;
-            Node* v=*remaining.begin();
-            dfs(v,remaining,component,cmap);
-            components.push_back(component);
-        }
-        for(ei=es.begin();ei!=es.end();ei++) {
-            pair<Component*,unsigned> u=cmap[ei->first],
-                                      v=cmap[ei->second];
-            COLA_ASSERT(u.first==v.first);
-            u.first->edges.push_back(make_pair(u.second,v.second));
+        findComponents(rs,es,es,components,cmap);
+    }
+
+    void connectedComponents(
+            const vector<Rectangle*> &rs,
+            const vector<Edge> &es, 
+            const CompoundConstraints &ccs,
+            vector<Component*> &components) {
+        const unsigned n=rs.size();
+        const unsigned m=ccs.size();
+        vector<Rectangle*> bbs(rs);
+        // extra links between nodes that are related by a constraint
+        vector<Edge> links(es);
+        // a node through which each compound constraint is attached
+        vector<unsigned> ccNode(m,n);
+        for(unsigned dim=0;dim<2;dim++) {
+            // Generate (but don't solve) the separation constraints in this
+            // dimension, to find out which variables each compound
+            // constraint relates, including any dummy variables it shares
+            // with other compound constraints.
+            Variables vs(n);
+            for(unsigned i=0;i<n;i++) {
+                vs[i]=new Variable(i,rs[i]->getCentreD(dim));
+            }
+            Constraints cs;
+            vector<unsigned> varsStart(m+1), csStart(m+1);
+            for(unsigned c=0;c<m;c++) {
+                varsStart[c]=vs.size();
+                ccs[c]->generateVariables((Dim)dim,vs);
+            }
+            varsStart[m]=vs.size();
+            for(unsigned c=0;c<m;c++) {
+                csStart[c]=cs.size();
+                ccs[c]->generateSeparationConstraints((Dim)dim,vs,cs,bbs);
+            }
+            csStart[m]=cs.size();
+
+            vector<unsigned> parent(vs.size());
+            for(unsigned i=0;i<vs.size();i++) {
+                parent[i]=i;
+            }
+            vector<unsigned> ccVar(m,vs.size());
+            for(unsigned c=0;c<m;c++) {
+                vector<unsigned> related;
+                for(unsigned i=varsStart[c];i<varsStart[c+1];i++) {
+                    related.push_back(i);
+                }
+                for(unsigned i=csStart[c];i<csStart[c+1];i++) {
+                    related.push_back(cs[i]->left->id);
+                    related.push_back(cs[i]->right->id);
+                }
+                for(unsigned i=0;i<related.size();i++) {
+                    COLA_ASSERT(related[i]<vs.size());
+                    if(ccVar[c]==vs.size()) {
+                        ccVar[c]=related[i];
+                    } else {
+                        parent[findSet(parent,related[i])]=
+                            findSet(parent,ccVar[c]);
+                    }
+                }
+            }
+            // Link each node to the first node in its set.
+            vector<unsigned> setNode(vs.size(),n);
+            for(unsigned i=0;i<n;i++) {
+                unsigned r=findSet(parent,i);
+                if(setNode[r]==n) {
+                    setNode[r]=i;
+                } else {
+                    links.push_back(make_pair(setNode[r],i));
+                }
+            }
+            for(unsigned c=0;c<m;c++) {
+                if(ccNode[c]==n && ccVar[c]<vs.size()) {
+                    ccNode[c]=setNode[findSet(parent,ccVar[c])];
+                }
+            }
+            for_each(vs.begin(),vs.end(),delete_object());
+            for_each(cs.begin(),cs.end(),delete_object());
+            // Don't leave the constraints pointing at deleted variables.
+            for(unsigned c=0;c<m;c++) {
+                ccs[c]->clearVariables();
+            }
         }
-        /*
-        SeparationConstraints::const_iterator ci;
-        for(ci=scx.begin();ci!=scx.end();ci++) {
-            SeparationConstraint *c=*ci;
-            pair<Component*,unsigned> u=cmap[c->left],
-                                      v=cmap[c->right];
-            COLA_ASSERT(u.first==v.first);
-            u.first->scx.push_back(
-                    new SeparationConstraint(u.second,v.second,c->gap));
-        }
-        for(ci=scy.begin();ci!=scy.end();ci++) {
-            SeparationConstraint *c=*ci;
-            pair<Component*,unsigned> u=cmap[c->left],
-                                      v=cmap[c->right];
-            COLA_ASSERT(u.first==v.first);
-            u.first->scy.push_back(
-                    new SeparationConstraint(u.second,v.second,c->gap));
+        map<unsigned,pair<Component*,unsigned> > cmap;
+        findComponents(rs,es,links,components,cmap);
+        for(unsigned c=0;c<m;c++) {
+            if(ccNode[c]<n) {
+                cmap[ccNode[c]].first->ccs.push_back(ccs[c]);
+            } else if(!components.empty()) {
+                // Relates no nodes, so it may as well go anywhere.
+                components.front()->ccs.push_back(ccs[c]);
+            }
         }
-        */
     }
     void separateComponents(const vector<Component*> &components) {
         unsigned n=components.size();
@@ -157,4 +269,32 @@ namespace cola {
             delete bbs[i];
         }
     }
+    void separateComponents(const vector<Component*> &components,
+            const set<unsigned> &fixed) {
+        unsigned n=components.size();
+        vector<Rectangle*> bbs(n);
+        valarray<double> origX(n);
+        valarray<double> origY(n);
+        for(unsigned i=0;i<n;i++) {
+            bbs[i]=components[i]->getBoundingBox();
+            origX[i]=bbs[i]->getCentreX();
+            origY[i]=bbs[i]->getCentreY();
+        }
+        bool overlapping=false;
+        for(unsigned i=0;i<n && !overlapping;i++) {
+            for(unsigned j=i+1;j<n && !overlapping;j++) {
+                overlapping=bbs[i]->overlapX(bbs[j])>0 &&
+                    bbs[i]->overlapY(bbs[j])>0;
+            }
+        }
+        if(overlapping) {
+            removeoverlaps(bbs,fixed);
+            for(unsigned i=0;i<n;i++) {
+                components[i]->moveRectangles(
+                        bbs[i]->getCentreX()-origX[i],
+                        bbs[i]->getCentreY()-origY[i]);
+            }
+        }
+        for_each(bbs.begin(),bbs.end(),delete_object());
+    }
 }
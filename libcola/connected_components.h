@@ -22,6 +22,7 @@
 #define CONNECTED_COMPONENTS_H
 #include "libcola/cola.h"
 #include <vector>
+#include <set>
 
 namespace cola {
 // a graph component with a list of node_ids giving indices for some larger list of nodes
@@ -32,22 +33,44 @@ public:
     std::vector<unsigned> node_ids;
     std::vector<vpsc::Rectangle*> rects;
     std::vector<cola::Edge> edges;
-    //CompoundConstraints cx, cy;
+    // indices of this component's edges in the original list of edges
+    std::vector<unsigned> edge_ids;
+    // compound constraints that only involve nodes in this component
+    CompoundConstraints ccs;
     ~Component();
+    // move the component's rectangles, and the positions held by its
+    // compound constraints, by the given amount
     void moveRectangles(double x, double y);
     vpsc::Rectangle* getBoundingBox();
+    // switch the variable indices used by ccs between indices into the
+    // larger list of nodes and indices relative to this component
+    void mapConstraintsToComponent();
+    void mapConstraintsFromComponent();
+private:
+    VariableIDMap idMap;
 };
 // for a graph of n nodes, return connected components
 void connectedComponents(
     const std::vector<vpsc::Rectangle*> &rs,
     const std::vector<cola::Edge> &es,
-    //const CompoundConstraints &cx,
-    //const CompoundConstraints &cy, 
+    std::vector<Component*> &components);
+// as above, but nodes that are related by a compound constraint are also
+// placed in the same component, and each constraint is assigned to the
+// component containing its nodes.  Each component can then be laid out
+// independently of the others.
+void connectedComponents(
+    const std::vector<vpsc::Rectangle*> &rs,
+    const std::vector<cola::Edge> &es,
+    const CompoundConstraints &ccs,
     std::vector<Component*> &components);
 
 // move the contents of each component so that the components do not
 // overlap.
 void separateComponents(const std::vector<Component*> &components);
+// as above, but the components whose indices are in fixed are not moved,
+// and nothing is moved at all unless some components overlap.
+void separateComponents(const std::vector<Component*> &components,
+    const std::set<unsigned> &fixed);
 
 } // namespace cola
 
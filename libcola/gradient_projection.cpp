@@ -68,6 +68,7 @@ GradientProjection::GradientProjection(
           tolerance(tol), 
           max_iterations(max_iterations),
           sparseQ(NULL),
+          solver(NULL),
           solveWithMosek(solveWithMosek),
           scaling(scaling)
 {
@@ -249,7 +250,7 @@ unsigned GradientProjection::solve(
 
     bool converged=false;
 
-    solver = setupVPSC();
+    setupVPSC();
 #ifdef MOSEK_AVAILABLE
     if(solveWithMosek==Outer) {
         float* ba=new float[vars.size()];
@@ -365,7 +366,7 @@ unsigned GradientProjection::solve(
             x[i]*=vars[i]->scale;
         }
     }
-    destroyVPSC(solver);
+    destroyVPSC();
     return counter;
 }
 // Setup an instance of the Variable Placement with Separation Constraints
@@ -374,7 +375,10 @@ unsigned GradientProjection::solve(
 // --- that are only relevant to one iteration, and merge these with the
 // global constraint list (including alignment constraints,
 // dir-edge constraints, containment constraints, etc).
-IncSolver* GradientProjection::setupVPSC() {
+// If the previous iteration used only the global constraints and this one
+// does too, then the existing solver (and its block structure) is kept and
+// simply re-solved from the new desired positions.
+void GradientProjection::setupVPSC() {
     if(nonOverlapConstraints!=None) {
         if(clusterHierarchy) {
             //printf("Setup up cluster constraints, dim=%d--------------\n",k);
@@ -397,6 +401,12 @@ IncSolver* GradientProjection::setupVPSC() {
             }
         }
     }
+    if(solver && solveWithMosek==Off && lcs.empty() 
+            && vars.size()==numStaticVars && !unsatisfiableConstraintsExist()) {
+        // Constraint set is unchanged: warm-start from the existing blocks.
+        return;
+    }
+    delete solver;
     cs=gcs;
     cs.insert(cs.end(),lcs.begin(),lcs.end());
     switch(solveWithMosek) {
@@ -423,9 +433,19 @@ IncSolver* GradientProjection::setupVPSC() {
         default:
             break;
     }
-    return new IncSolver(vars,cs);
+    solver=new IncSolver(vars,cs);
 }
-void GradientProjection::destroyVPSC(IncSolver *vpsc) {
+// A constraint found to be unsatisfiable is dropped by the solver that
+// found it, so in that case we start again with a fresh solver instance.
+bool GradientProjection::unsatisfiableConstraintsExist() const {
+    for(Constraints::const_iterator i=cs.begin();i!=cs.end();i++) {
+        if((*i)->unsatisfiable) {
+            return true;
+        }
+    }
+    return false;
+}
+void GradientProjection::destroyVPSC() {
     if(ccs) {
         for(CompoundConstraints::const_iterator c=ccs->begin(); 
                 c!=ccs->end();++c) {
@@ -446,6 +466,8 @@ void GradientProjection::destroyVPSC(IncSolver *vpsc) {
     if(clusterHierarchy) {
         clusterHierarchy->computeBoundary(*rs);
     }
+    // Dummy variables are added by straighten(), and deleted here.
+    const bool hadDummyVars = vars.size()!=numStaticVars;
     if(sparseQ) {
         for(unsigned i=numStaticVars;i<vars.size();i++) {
             delete vars[i];
@@ -453,11 +475,16 @@ void GradientProjection::destroyVPSC(IncSolver *vpsc) {
         vars.resize(numStaticVars);
         sparseQ=NULL;
     }
+    if(!lcs.empty() || hadDummyVars || solveWithMosek!=Off) {
+        // The solver refers to constraints or variables that are local to
+        // this iteration, so it can't be reused.
+        delete solver;
+        solver=NULL;
+    }
     for(vector<Constraint*>::iterator i=lcs.begin();i!=lcs.end();i++) {
         delete *i;
     }
     lcs.clear();
-    delete vpsc;
 #ifdef MOSEK_AVAILABLE
     if(solveWithMosek!=Off) mosek_delete(menv);
 #endif
@@ -87,7 +87,7 @@ public:
         return numStaticVars;
     }
     ~GradientProjection() {
-        //destroyVPSC(solver);
+        delete solver;
         for(vpsc::Constraints::iterator i(gcs.begin()); i!=gcs.end(); i++) {
             delete *i;
         }
@@ -119,7 +119,8 @@ public:
         return result;
     }
 private:
-    vpsc::IncSolver* setupVPSC();
+    void setupVPSC();
+    bool unsatisfiableConstraintsExist() const;
     double computeCost(std::valarray<double> const &b,
         std::valarray<double> const &x) const;
     double computeSteepestDescentVector(
@@ -131,7 +132,7 @@ private:
     double computeStepSize(
         std::valarray<double> const & g, std::valarray<double> const & d) const;
     bool runSolver(std::valarray<double> & result);
-    void destroyVPSC(vpsc::IncSolver *vpsc);
+    void destroyVPSC();
     vpsc::Dim k;
     unsigned numStaticVars; // number of variables that persist
                               // throughout iterations
@@ -156,6 +157,8 @@ private:
 #ifdef MOSEK_AVAILABLE
     MosekEnv* menv;
 #endif
+    // Persists between calls to solve() while the constraint set is
+    // unchanged, so that each projection can start from the previous blocks.
     vpsc::IncSolver* solver;
     SolveWithMosek solveWithMosek;
     const bool scaling;
@@ -26,7 +26,10 @@ SOURCES += cola.cpp \
     cc_nonoverlapconstraints.cpp \
     box.cpp \
     shapepair.cpp \
-    pseudorandom.cpp
+    pseudorandom.cpp \
+    shortest_paths_cache.cpp \
+    multilevel.cpp \
+    sparse_stress.cpp
 HEADERS += cola.h \
     cluster.h \
     commondefs.h \
@@ -36,10 +39,13 @@ HEADERS += cola.h \
     straightener.h \
     output_svg.h \
     shortest_paths.h \
+    shortest_paths_cache.h \
     cc_clustercontainmentconstraints.h \
     cc_nonoverlapconstraints.h \
     unused.h \
     box.h \
     shapepair.h \
+    multilevel.h \
+    sparse_stress.h \
     pseudorandom.h \
     config.h
@@ -0,0 +1,400 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+#include "libvpsc/rectangle.h"
+#include "libvpsc/variable.h"
+#include "libvpsc/constraint.h"
+#include "libvpsc/assertions.h"
+#include "libcola/commondefs.h"
+#include "libcola/cluster.h"
+#include "libcola/pseudorandom.h"
+#include "libcola/multilevel.h"
+
+using namespace std;
+using vpsc::Rectangle;
+
+namespace cola {
+
+// Coarsening stops once a level would have more than this fraction of the
+// nodes of the level below it, since further levels would gain little.
+static const double minimumCoarseningRatio = 0.9;
+
+static void moveCentre(Rectangle *r, const double x, const double y)
+{
+    r->moveCentreX(x);
+    r->moveCentreY(y);
+}
+
+struct CompareDegree
+{
+    CompareDegree(const vector<vector<unsigned> >& neighbours)
+        : neighbours(neighbours)
+    {
+    }
+    bool operator()(const unsigned u, const unsigned v) const
+    {
+        return neighbours[u].size() < neighbours[v].size();
+    }
+    const vector<vector<unsigned> >& neighbours;
+};
+
+
+MultilevelConstrainedFDLayout::MultilevelConstrainedFDLayout(
+        const vpsc::Rectangles& rs, const vector<Edge>& es,
+        const double idealLength, const bool preventOverlaps,
+        const EdgeLengths& eLengths, TestConvergence *doneTest,
+        PreIteration *preIteration)
+    : boundingBoxes(rs),
+      edges(es),
+      edgeLengths(eLengths),
+      idealLength(idealLength),
+      preventOverlaps(preventOverlaps),
+      done(doneTest),
+      preIteration(preIteration),
+      clusterHierarchy(NULL),
+      unsatisfiableX(NULL),
+      unsatisfiableY(NULL),
+      minimumLevelSize(50)
+{
+}
+
+MultilevelConstrainedFDLayout::~MultilevelConstrainedFDLayout()
+{
+    freeLevels();
+}
+
+void MultilevelConstrainedFDLayout::freeLevels(void)
+{
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        // The rectangles of the first level are the caller's.
+        if (l > 0)
+        {
+            for_each(levels[l]->rs.begin(), levels[l]->rs.end(),
+                    delete_object());
+        }
+        delete levels[l];
+    }
+    levels.clear();
+}
+
+/*
+ * Marks the nodes whose variables are used by the separation constraints
+ * generated for any compound constraint.  These are kept as distinct nodes
+ * at every level so that the constraints can be applied there.
+ */
+void MultilevelConstrainedFDLayout::findConstrainedNodes(
+        vector<bool>& constrained)
+{
+    const unsigned n = boundingBoxes.size();
+    constrained.assign(n, false);
+    for (unsigned dim = 0; dim < 2; ++dim)
+    {
+        vpsc::Variables vs(n);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            vs[i] = new vpsc::Variable(i,
+                    boundingBoxes[i]->getCentreD(dim));
+        }
+        vpsc::Constraints cs;
+        for (CompoundConstraints::iterator c = ccs.begin();
+                c != ccs.end(); ++c)
+        {
+            (*c)->generateVariables((vpsc::Dim) dim, vs);
+        }
+        for (CompoundConstraints::iterator c = ccs.begin();
+                c != ccs.end(); ++c)
+        {
+            (*c)->generateSeparationConstraints((vpsc::Dim) dim, vs, cs,
+                    boundingBoxes);
+        }
+        for (vpsc::Constraints::iterator c = cs.begin(); c != cs.end(); ++c)
+        {
+            if ((unsigned) (*c)->left->id < n)
+            {
+                constrained[(*c)->left->id] = true;
+            }
+            if ((unsigned) (*c)->right->id < n)
+            {
+                constrained[(*c)->right->id] = true;
+            }
+        }
+        for_each(vs.begin(), vs.end(), delete_object());
+        for_each(cs.begin(), cs.end(), delete_object());
+        clearVariables(ccs);
+    }
+}
+
+/*
+ * Builds the next coarser level by collapsing a maximal matching of the
+ * edges between unconstrained nodes.  Nodes are visited in order of
+ * increasing degree and matched with their lowest degree neighbour, so
+ * that leaves and chains are collapsed first.  Returns false, leaving
+ * coarse untouched, if this would not reduce the size of the graph much.
+ */
+bool MultilevelConstrainedFDLayout::coarsen(Level& fine, Level& coarse,
+        const vector<bool>& constrained)
+{
+    const unsigned n = fine.rs.size();
+    const unsigned unmatched = n;
+
+    vector<vector<unsigned> > neighbours(n);
+    for (size_t e = 0; e < fine.es.size(); ++e)
+    {
+        unsigned u = fine.es[e].first, v = fine.es[e].second;
+        if (u != v)
+        {
+            neighbours[u].push_back(v);
+            neighbours[v].push_back(u);
+        }
+    }
+    vector<unsigned> order(n);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), CompareDegree(neighbours));
+
+    vector<unsigned> match(n, unmatched);
+    for (unsigned k = 0; k < n; ++k)
+    {
+        unsigned u = order[k];
+        if ((match[u] != unmatched) || constrained[u])
+        {
+            continue;
+        }
+        unsigned best = unmatched;
+        for (size_t j = 0; j < neighbours[u].size(); ++j)
+        {
+            unsigned v = neighbours[u][j];
+            if ((match[v] == unmatched) && !constrained[v] &&
+                    ((best == unmatched) ||
+                     (neighbours[v].size() < neighbours[best].size())))
+            {
+                best = v;
+            }
+        }
+        if (best != unmatched)
+        {
+            match[u] = best;
+            match[best] = u;
+        }
+    }
+
+    fine.coarseIndex.assign(n, unmatched);
+    unsigned coarseCount = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (fine.coarseIndex[i] == unmatched)
+        {
+            fine.coarseIndex[i] = coarseCount;
+            if (match[i] != unmatched)
+            {
+                fine.coarseIndex[match[i]] = coarseCount;
+            }
+            ++coarseCount;
+        }
+    }
+    if (coarseCount > minimumCoarseningRatio * n)
+    {
+        fine.coarseIndex.clear();
+        return false;
+    }
+    fine.partner = match;
+
+    // Each coarse node is centred between the nodes collapsed into it, and
+    // is big enough to hold either of them.
+    coarse.rs.assign(coarseCount, NULL);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        unsigned c = fine.coarseIndex[i];
+        if (coarse.rs[c] != NULL)
+        {
+            continue;
+        }
+        Rectangle *r = fine.rs[i];
+        double cx = r->getCentreX(), cy = r->getCentreY();
+        double w = r->width(), h = r->height();
+        if (match[i] != unmatched)
+        {
+            Rectangle *m = fine.rs[match[i]];
+            cx = (cx + m->getCentreX()) / 2;
+            cy = (cy + m->getCentreY()) / 2;
+            w = max(w, m->width());
+            h = max(h, m->height());
+        }
+        coarse.rs[c] = new Rectangle(cx - w / 2, cx + w / 2,
+                cy - h / 2, cy + h / 2);
+    }
+
+    // Parallel edges between coarse nodes are merged, keeping the shortest.
+    map<Edge, double> coarseEdges;
+    for (size_t e = 0; e < fine.es.size(); ++e)
+    {
+        unsigned u = fine.coarseIndex[fine.es[e].first];
+        unsigned v = fine.coarseIndex[fine.es[e].second];
+        if (u == v)
+        {
+            continue;
+        }
+        Edge key(min(u, v), max(u, v));
+        double length = fine.eLengths.empty() ? 1 : fine.eLengths[e];
+        map<Edge, double>::iterator found = coarseEdges.find(key);
+        if (found == coarseEdges.end())
+        {
+            coarseEdges[key] = length;
+        }
+        else
+        {
+            found->second = min(found->second, length);
+        }
+    }
+    for (map<Edge, double>::iterator e = coarseEdges.begin();
+            e != coarseEdges.end(); ++e)
+    {
+        coarse.es.push_back(e->first);
+        if (!fine.eLengths.empty())
+        {
+            coarse.eLengths.push_back(e->second);
+        }
+    }
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (constrained[i])
+        {
+            fine.idMap.addMappingForVariable(i, fine.coarseIndex[i]);
+        }
+    }
+    return true;
+}
+
+/*
+ * Places the nodes of the finer level at the position of the coarse node
+ * they were collapsed into.  A pair of collapsed nodes is spread an ideal
+ * edge length apart about that position, keeping their initial relative
+ * direction.
+ */
+void MultilevelConstrainedFDLayout::prolongate(const Level& coarse,
+        Level& fine)
+{
+    const unsigned n = fine.rs.size();
+    PseudoRandom random;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        unsigned c = fine.coarseIndex[i];
+        double cx = coarse.rs[c]->getCentreX();
+        double cy = coarse.rs[c]->getCentreY();
+        unsigned partner = fine.partner[i];
+        if (partner == n)
+        {
+            moveCentre(fine.rs[i], cx, cy);
+        }
+        else if (i < partner)
+        {
+            double dx = fine.rs[i]->getCentreX() -
+                    fine.rs[partner]->getCentreX();
+            double dy = fine.rs[i]->getCentreY() -
+                    fine.rs[partner]->getCentreY();
+            double length = sqrt(dx * dx + dy * dy);
+            if (length < 1e-9)
+            {
+                dx = random.getNextBetween(-1, 1);
+                dy = random.getNextBetween(-1, 1);
+                length = sqrt(dx * dx + dy * dy) + 1e-9;
+            }
+            double offset = idealLength / (2 * length);
+            moveCentre(fine.rs[i], cx + dx * offset, cy + dy * offset);
+            moveCentre(fine.rs[partner], cx - dx * offset, cy - dy * offset);
+        }
+    }
+}
+
+void MultilevelConstrainedFDLayout::run(bool x, bool y)
+{
+    freeLevels();
+
+    Level *original = new Level();
+    original->rs = boundingBoxes;
+    original->es = edges;
+    original->eLengths = edgeLengths;
+    levels.push_back(original);
+
+    if ((clusterHierarchy == NULL) || clusterHierarchy->clusters.empty())
+    {
+        vector<bool> constrained;
+        findConstrainedNodes(constrained);
+        while (levels.back()->rs.size() > minimumLevelSize)
+        {
+            Level *fine = levels.back();
+            Level *coarse = new Level();
+            if (!coarsen(*fine, *coarse, constrained))
+            {
+                delete coarse;
+                break;
+            }
+            vector<bool> coarseConstrained(coarse->rs.size(), false);
+            for (unsigned i = 0; i < fine->rs.size(); ++i)
+            {
+                if (constrained[i])
+                {
+                    coarseConstrained[fine->coarseIndex[i]] = true;
+                }
+            }
+            constrained.swap(coarseConstrained);
+            for (CompoundConstraints::iterator c = ccs.begin();
+                    c != ccs.end(); ++c)
+            {
+                (*c)->updateVarIDsWithMapping(fine->idMap, true);
+            }
+            levels.push_back(coarse);
+        }
+    }
+
+    for (size_t l = levels.size() - 1; l > 0; --l)
+    {
+        Level *level = levels[l];
+        TestConvergence levelDone;
+        ConstrainedFDLayout alg(level->rs, level->es, idealLength, false,
+                level->eLengths, &levelDone);
+        alg.setConstraints(ccs);
+        alg.run(x, y);
+
+        prolongate(*level, *levels[l - 1]);
+        for (CompoundConstraints::iterator c = ccs.begin();
+                c != ccs.end(); ++c)
+        {
+            (*c)->updateVarIDsWithMapping(levels[l - 1]->idMap, false);
+        }
+    }
+
+    ConstrainedFDLayout alg(boundingBoxes, edges, idealLength,
+            preventOverlaps, edgeLengths, done, preIteration);
+    alg.setConstraints(ccs);
+    alg.setClusterHierarchy(clusterHierarchy);
+    alg.setUnsatisfiableConstraintInfo(unsatisfiableX, unsatisfiableY);
+    alg.run(x, y);
+}
+
+} // namespace cola
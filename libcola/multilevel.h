@@ -0,0 +1,166 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#ifndef COLA_MULTILEVEL_H
+#define COLA_MULTILEVEL_H
+
+#include <vector>
+
+#include "libcola/cola.h"
+#include "libcola/compound_constraints.h"
+
+namespace cola {
+
+/**
+ * @brief Runs a ConstrainedFDLayout over a hierarchy of successively
+ *        coarser versions of a graph.
+ *
+ * Each coarser graph is built by collapsing a matching of the edges of the
+ * graph below it.  Nodes involved in compound constraints are never
+ * collapsed, so the constraints can be kept on these nodes at every level
+ * just by remapping their variable indices.  The coarsest graph is laid
+ * out from the initial positions, then each level is used as the starting
+ * point for the level below it, down to the original graph which is laid
+ * out with the full set of options.
+ *
+ * This reaches a good layout of a large graph from poor starting positions
+ * in far fewer iterations on the full graph than a single ConstrainedFDLayout.
+ * If a cluster hierarchy is given, no coarsening is done since clusters may
+ * refer to any of the nodes.
+ */
+class MultilevelConstrainedFDLayout
+{
+public:
+    /**
+     * @brief Constructs a multilevel layout instance.
+     *
+     * The parameters are as for the ConstrainedFDLayout constructor.
+     * Overlaps are only prevented, and doneTest and preIteration only used,
+     * when laying out the original graph.
+     */
+    MultilevelConstrainedFDLayout(
+        const vpsc::Rectangles& rs,
+        const std::vector<cola::Edge>& es,
+        const double idealLength,
+        const bool preventOverlaps,
+        const EdgeLengths& eLengths = StandardEdgeLengths,
+        TestConvergence* doneTest = NULL,
+        PreIteration* preIteration = NULL);
+    ~MultilevelConstrainedFDLayout();
+
+    /**
+     * @brief  Specify a set of compound constraints to apply to the layout.
+     *
+     * @param[in] ccs  The compound constraints.
+     */
+    void setConstraints(const cola::CompoundConstraints& ccs)
+    {
+        this->ccs = ccs;
+    }
+    /**
+     * @brief  Specifies an optional hierarchy for clustering nodes.
+     *
+     * @param[in] hierarchy  A pointer to a RootCluster object defining the
+     *                      the cluster hierarchy (optional).
+     */
+    void setClusterHierarchy(RootCluster *hierarchy)
+    {
+        clusterHierarchy = hierarchy;
+    }
+    /**
+     * @brief  Set the graph size at which coarsening stops.
+     *
+     * @param[in] size  Graphs with this many nodes or fewer are not
+     *                  coarsened any further (default: 50).
+     */
+    void setMinimumLevelSize(const unsigned size)
+    {
+        minimumLevelSize = size;
+    }
+    /**
+     * @brief  Specify storage for unsatisfiable constraint info found when
+     *         laying out the original graph.
+     */
+    void setUnsatisfiableConstraintInfo(
+            UnsatisfiableConstraintInfos *unsatisfiableX,
+            UnsatisfiableConstraintInfos *unsatisfiableY)
+    {
+        this->unsatisfiableX = unsatisfiableX;
+        this->unsatisfiableY = unsatisfiableY;
+    }
+    /**
+     * @brief  Coarsens the graph, then lays out each level from the
+     *         coarsest to the original graph.
+     *
+     * @param[in] x  If true, layout will be performed in x-dimension
+     *               (default: true).
+     * @param[in] y  If true, layout will be performed in y-dimension
+     *               (default: true).
+     */
+    void run(bool x=true, bool y=true);
+    /**
+     * @brief  Returns the number of levels used by the last call to run(),
+     *         including the original graph.
+     */
+    unsigned levelCount(void) const
+    {
+        return levels.size();
+    }
+
+private:
+    struct Level
+    {
+        vpsc::Rectangles rs;
+        std::vector<Edge> es;
+        EdgeLengths eLengths;
+        // For each node, the index of the node it is collapsed into in the
+        // next coarser level.
+        std::vector<unsigned> coarseIndex;
+        // The same mapping for nodes involved in compound constraints.
+        VariableIDMap idMap;
+        // For each node, the other node collapsed along with it, if any
+        // (otherwise the number of nodes).
+        std::vector<unsigned> partner;
+    };
+
+    bool coarsen(Level& fine, Level& coarse,
+            const std::vector<bool>& constrained);
+    void prolongate(const Level& coarse, Level& fine);
+    void findConstrainedNodes(std::vector<bool>& constrained);
+    void freeLevels(void);
+
+    vpsc::Rectangles boundingBoxes;
+    std::vector<Edge> edges;
+    EdgeLengths edgeLengths;
+    double idealLength;
+    bool preventOverlaps;
+    TestConvergence *done;
+    PreIteration *preIteration;
+    CompoundConstraints ccs;
+    RootCluster *clusterHierarchy;
+    UnsatisfiableConstraintInfos *unsatisfiableX;
+    UnsatisfiableConstraintInfos *unsatisfiableY;
+    unsigned minimumLevelSize;
+    std::vector<Level *> levels;
+};
+
+} // namespace cola
+
+#endif // COLA_MULTILEVEL_H
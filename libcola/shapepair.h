@@ -36,8 +36,8 @@ class ShapePair
         bool operator<(const ShapePair& rhs) const;
 
     private:
-        unsigned short m_index1;
-        unsigned short m_index2;
+        unsigned m_index1;
+        unsigned m_index2;
 };
 
 
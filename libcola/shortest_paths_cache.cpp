@@ -0,0 +1,301 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#include <algorithm>
+#include <iterator>
+#include <cfloat>
+#include <cmath>
+
+#include "libcola/commondefs.h"
+#include "libcola/shortest_paths.h"
+#include "libcola/shortest_paths_cache.h"
+
+namespace cola {
+
+// Beyond this many edge insertions and removals it is cheaper to simply
+// recompute all path lengths.
+static const size_t maxIncrementalEdgeChanges = 8;
+
+struct ShortestPathsCache::WeightedEdge
+{
+    WeightedEdge(unsigned u, unsigned v, double w)
+        : u(std::min(u, v)),
+          v(std::max(u, v)),
+          w(w)
+    {
+    }
+    bool operator<(const WeightedEdge& rhs) const
+    {
+        if (u != rhs.u)
+        {
+            return u < rhs.u;
+        }
+        if (v != rhs.v)
+        {
+            return v < rhs.v;
+        }
+        return w < rhs.w;
+    }
+    unsigned u;
+    unsigned v;
+    double w;
+};
+
+
+ShortestPathsCache::ShortestPathsCache()
+    : m_n(0),
+      m_D(NULL),
+      m_version(0)
+{
+}
+
+ShortestPathsCache::~ShortestPathsCache()
+{
+    resize(0);
+}
+
+unsigned ShortestPathsCache::size(void) const
+{
+    return m_n;
+}
+
+double const * const * ShortestPathsCache::pathLengths(void) const
+{
+    return m_D;
+}
+
+unsigned long ShortestPathsCache::structureVersion(void) const
+{
+    return m_version;
+}
+
+void ShortestPathsCache::copyPathLengths(const std::vector<unsigned>& nodes,
+        double **D) const
+{
+    for (unsigned i = 0; i < nodes.size(); ++i)
+    {
+        COLA_ASSERT(nodes[i] < m_n);
+        const double *row = m_D[nodes[i]];
+        for (unsigned j = 0; j < nodes.size(); ++j)
+        {
+            D[i][j] = row[nodes[j]];
+        }
+    }
+}
+
+// Grows or shrinks the matrix to n*n.  Rows and columns for new nodes are
+// set up as if the nodes were isolated.
+void ShortestPathsCache::resize(const unsigned n)
+{
+    double **D = (n > 0) ? new double*[n] : NULL;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        D[i] = new double[n];
+        for (unsigned j = 0; j < n; ++j)
+        {
+            if (i < m_n && j < m_n)
+            {
+                D[i][j] = m_D[i][j];
+            }
+            else
+            {
+                D[i][j] = (i == j) ? 0 : DBL_MAX;
+            }
+        }
+    }
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        delete [] m_D[i];
+    }
+    delete [] m_D;
+    m_D = D;
+    m_n = n;
+}
+
+void ShortestPathsCache::recompute(void)
+{
+    shortest_paths::johnsons(m_n, m_D, m_edges, m_lengths);
+}
+
+void ShortestPathsCache::sortedEdges(WeightedEdges& sorted) const
+{
+    sorted.clear();
+    sorted.reserve(m_edges.size());
+    for (size_t i = 0; i < m_edges.size(); ++i)
+    {
+        double w = (m_lengths.size() > 0) ? m_lengths[i] : 1;
+        sorted.push_back(WeightedEdge(m_edges[i].first, m_edges[i].second, w));
+    }
+    std::sort(sorted.begin(), sorted.end());
+}
+
+/*
+ * Adding the edge (u,v) can only shorten paths by routing them through it,
+ * so every pair is relaxed against the two ways of doing so.  O(n^2).
+ */
+void ShortestPathsCache::insertEdge(const unsigned u, const unsigned v,
+        const double w)
+{
+    std::vector<double> du(m_D[u], m_D[u] + m_n);
+    std::vector<double> dv(m_D[v], m_D[v] + m_n);
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        double *row = m_D[i];
+        for (unsigned j = 0; j < m_n; ++j)
+        {
+            if (du[i] != DBL_MAX && dv[j] != DBL_MAX)
+            {
+                row[j] = std::min(row[j], du[i] + w + dv[j]);
+            }
+            if (dv[i] != DBL_MAX && du[j] != DBL_MAX)
+            {
+                row[j] = std::min(row[j], dv[i] + w + du[j]);
+            }
+        }
+    }
+}
+
+/*
+ * Removing edges can only lengthen paths from a source s if one of them is
+ * tight from s, i.e., lies on some shortest path from s.  Only the rows for
+ * such sources are recomputed, using Dijkstra over the remaining edges
+ * (m_edges must no longer contain the removed edges).
+ */
+void ShortestPathsCache::removeEdges(const WeightedEdges& removed)
+{
+    std::vector<unsigned> affected;
+    for (unsigned s = 0; s < m_n; ++s)
+    {
+        for (size_t i = 0; i < removed.size(); ++i)
+        {
+            const WeightedEdge& e = removed[i];
+            double su = m_D[s][e.u], sv = m_D[s][e.v];
+            if (su != DBL_MAX && sv != DBL_MAX &&
+                    std::fabs(su - sv) >= e.w * (1 - 1e-9))
+            {
+                affected.push_back(s);
+                break;
+            }
+        }
+    }
+    if (affected.empty())
+    {
+        return;
+    }
+
+    std::vector<shortest_paths::Node<double> > vs(m_n);
+    shortest_paths::dijkstra_init(vs, m_edges, m_lengths);
+    for (size_t k = 0; k < affected.size(); ++k)
+    {
+        unsigned s = affected[k];
+        shortest_paths::dijkstra(s, vs, m_D[s]);
+        // Paths from unaffected sources are unchanged, so the symmetric
+        // entries can simply be copied across.
+        for (unsigned j = 0; j < m_n; ++j)
+        {
+            m_D[j][s] = m_D[s][j];
+        }
+    }
+}
+
+void ShortestPathsCache::update(const unsigned n, const std::vector<Edge>& es,
+        const EdgeLengths& eLengths)
+{
+    COLA_ASSERT(eLengths.empty() || (eLengths.size() == es.size()));
+
+    std::valarray<double> lengths(eLengths.data(), eLengths.size());
+    for (size_t i = 0; i < lengths.size(); ++i)
+    {
+        if (lengths[i] <= 0)
+        {
+            lengths[i] = 1;
+        }
+    }
+
+    WeightedEdges oldEdges;
+    sortedEdges(oldEdges);
+    bool structureKnown = (m_D != NULL) && (n >= m_n);
+
+    m_edges = es;
+    m_lengths.resize(lengths.size());
+    m_lengths = lengths;
+
+    if (!structureKnown)
+    {
+        ++m_version;
+        resize(0);
+        resize(n);
+        recompute();
+        return;
+    }
+
+    WeightedEdges newEdges;
+    sortedEdges(newEdges);
+    WeightedEdges removed, inserted;
+    std::set_difference(oldEdges.begin(), oldEdges.end(),
+            newEdges.begin(), newEdges.end(), std::back_inserter(removed));
+    std::set_difference(newEdges.begin(), newEdges.end(),
+            oldEdges.begin(), oldEdges.end(), std::back_inserter(inserted));
+
+    if ((n == m_n) && removed.empty() && inserted.empty())
+    {
+        return;
+    }
+    ++m_version;
+
+    resize(n);
+    if ((removed.size() + inserted.size()) > maxIncrementalEdgeChanges)
+    {
+        recompute();
+        return;
+    }
+
+    // Handle the removals first, against the old edges less the removed
+    // ones, then add the new edges one at a time.
+    if (!removed.empty())
+    {
+        WeightedEdges remaining;
+        std::set_difference(oldEdges.begin(), oldEdges.end(),
+                removed.begin(), removed.end(),
+                std::back_inserter(remaining));
+        std::vector<Edge> edges;
+        std::valarray<double> edgeLengths(remaining.size());
+        for (size_t i = 0; i < remaining.size(); ++i)
+        {
+            edges.push_back(std::make_pair(remaining[i].u, remaining[i].v));
+            edgeLengths[i] = remaining[i].w;
+        }
+        m_edges.swap(edges);
+        m_lengths.resize(edgeLengths.size());
+        m_lengths = edgeLengths;
+
+        removeEdges(removed);
+
+        m_edges = es;
+        m_lengths.resize(lengths.size());
+        m_lengths = lengths;
+    }
+    for (size_t i = 0; i < inserted.size(); ++i)
+    {
+        insertEdge(inserted[i].u, inserted[i].v, inserted[i].w);
+    }
+}
+
+} // namespace cola
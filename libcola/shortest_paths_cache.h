@@ -0,0 +1,108 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#ifndef COLA_SHORTEST_PATHS_CACHE_H
+#define COLA_SHORTEST_PATHS_CACHE_H
+
+#include <vector>
+#include <valarray>
+
+#include "libcola/cola.h"
+
+namespace cola {
+
+/**
+ * @brief Holds the all-pairs shortest path lengths of a graph so that they
+ *        can be reused by successive layouts of that graph.
+ *
+ * Each call to update() compares the given graph structure with the one
+ * the cached lengths were computed for.  If nothing has changed the cached
+ * lengths are kept.  If a few edges have been added or removed, or nodes
+ * have been appended, the lengths are updated incrementally.  Otherwise
+ * they are recomputed from scratch.
+ *
+ * Path lengths are unscaled, i.e., in units of the given edge lengths (or
+ * of 1 when no edge lengths are given), with DBL_MAX between nodes in
+ * disconnected components.  This is the form expected by the
+ * ConstrainedFDLayout constructor.
+ */
+class ShortestPathsCache
+{
+public:
+    ShortestPathsCache();
+    ~ShortestPathsCache();
+
+    /**
+     * @brief  Brings the cached path lengths up to date with the given graph.
+     *
+     * @param[in] n         The number of nodes in the graph.
+     * @param[in] es        Simple pair edges between the nodes.
+     * @param[in] eLengths  Individual ideal lengths for edges.  Non-positive
+     *                      lengths are treated as 1, as ConstrainedFDLayout
+     *                      does.
+     */
+    void update(const unsigned n, const std::vector<Edge>& es,
+            const EdgeLengths& eLengths = StandardEdgeLengths);
+
+    /**
+     * @brief  Returns the number of nodes the path lengths are held for.
+     */
+    unsigned size(void) const;
+
+    /**
+     * @brief  Returns the n*n matrix of path lengths.
+     */
+    double const * const * pathLengths(void) const;
+
+    /**
+     * @brief  Copies the path lengths between a subset of nodes into D.
+     *
+     * @param[in]  nodes  Indices of the nodes, D[i][j] will be set to the
+     *                    path length between nodes[i] and nodes[j].
+     * @param[out] D      A nodes.size()*nodes.size() matrix.
+     */
+    void copyPathLengths(const std::vector<unsigned>& nodes, double **D) const;
+
+    /**
+     * @brief  Returns a number that changes whenever an update() alters
+     *         the graph structure, and so possibly the path lengths.
+     */
+    unsigned long structureVersion(void) const;
+
+private:
+    struct WeightedEdge;
+    typedef std::vector<WeightedEdge> WeightedEdges;
+
+    void resize(const unsigned n);
+    void recompute(void);
+    void insertEdge(const unsigned u, const unsigned v, const double w);
+    void removeEdges(const WeightedEdges& removed);
+    void sortedEdges(WeightedEdges& sorted) const;
+
+    unsigned m_n;
+    double **m_D;
+    std::vector<Edge> m_edges;
+    std::valarray<double> m_lengths;
+    unsigned long m_version;
+};
+
+} // namespace cola
+
+#endif // COLA_SHORTEST_PATHS_CACHE_H
@@ -0,0 +1,341 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "libvpsc/assertions.h"
+#include "libcola/commondefs.h"
+#include "libcola/cola.h"
+#include "libcola/cluster.h"
+#include "libcola/conjugate_gradient.h"
+#include "libcola/shortest_paths.h"
+#include "libcola/sparse_stress.h"
+
+using std::valarray;
+using std::vector;
+
+namespace cola {
+
+namespace {
+
+struct Term
+{
+    Term(unsigned u, unsigned v, double w, double d, bool edge)
+        : i(std::min(u, v)),
+          j(std::max(u, v)),
+          w(w),
+          d(d),
+          edge(edge)
+    {
+    }
+    bool operator<(const Term& rhs) const
+    {
+        if (i != rhs.i)
+        {
+            return i < rhs.i;
+        }
+        if (j != rhs.j)
+        {
+            return j < rhs.j;
+        }
+        // Edge terms first, so they take precedence for their pair.
+        return edge && !rhs.edge;
+    }
+    unsigned i;
+    unsigned j;
+    // For pivot terms, the number of nodes the term stands in for.
+    double w;
+    double d;
+    bool edge;
+};
+
+typedef vector<Term> Terms;
+
+} // namespace
+
+SparseStress::SparseStress(const unsigned n, const vector<Edge>& es,
+        const valarray<double>& eLengths, const double idealLength,
+        const unsigned pivots, RootCluster *clusterHierarchy)
+    : m_n(n),
+      m_pivots(0),
+      m_rowStart(n + 1, 0),
+      m_degree(0.0, n)
+{
+    COLA_ASSERT(eLengths.size() == 0 || eLengths.size() == es.size());
+    if (n == 0)
+    {
+        return;
+    }
+    const double unreachable = std::numeric_limits<double>::max();
+
+    // Choose pivots by maxmin: each is the node furthest from those chosen
+    // so far, nodes in components with no pivot yet being furthest of all.
+    vector<shortest_paths::Node<double> > vs(n);
+    shortest_paths::dijkstra_init(vs, es, eLengths);
+    unsigned k = std::min(pivots, n);
+    vector<unsigned> pivotNodes;
+    vector<double> pivotDists(static_cast<size_t>(k) * n);
+    vector<double> minDist(n, unreachable);
+    vector<unsigned> nearest(n, 0);
+    unsigned next = 0;
+    for (unsigned p = 0; p < k; ++p)
+    {
+        double *d = &pivotDists[static_cast<size_t>(p) * n];
+        shortest_paths::dijkstra(next, vs, d);
+        pivotNodes.push_back(next);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (p == 0 || d[i] < minDist[i])
+            {
+                minDist[i] = d[i];
+                nearest[i] = p;
+            }
+        }
+        next = static_cast<unsigned>(
+                std::max_element(minDist.begin(), minDist.end()) -
+                minDist.begin());
+        if (minDist[next] == 0)
+        {
+            // Every node is already a pivot.
+            k = p + 1;
+            break;
+        }
+    }
+    m_pivots = k;
+
+    // The region of a pivot is the set of nodes nearest to it.  Keep the
+    // distances from each pivot to its region, sorted.
+    vector<vector<double> > regions(k);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (minDist[i] != unreachable)
+        {
+            regions[nearest[i]].push_back(minDist[i]);
+        }
+    }
+    for (unsigned p = 0; p < k; ++p)
+    {
+        std::sort(regions[p].begin(), regions[p].end());
+    }
+
+    Terms terms;
+    terms.reserve(static_cast<size_t>(k) * n + es.size());
+    for (size_t e = 0; e < es.size(); ++e)
+    {
+        unsigned u = es[e].first, v = es[e].second;
+        COLA_ASSERT(u < n && v < n);
+        if (u == v)
+        {
+            continue;
+        }
+        double l = (eLengths.size() > 0) ? eLengths[e] : 1;
+        terms.push_back(Term(u, v, 1, l, true));
+    }
+    for (unsigned p = 0; p < k; ++p)
+    {
+        const double *d = &pivotDists[static_cast<size_t>(p) * n];
+        const vector<double>& region = regions[p];
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if (i == pivotNodes[p] || d[i] == unreachable || d[i] == 0)
+            {
+                continue;
+            }
+            // The term to the pivot stands in for the terms to the region
+            // nodes that are at most half way from the pivot to i.
+            double s = static_cast<double>(std::upper_bound(region.begin(),
+                    region.end(), d[i] / 2) - region.begin());
+            terms.push_back(Term(pivotNodes[p], i, std::max(s, 1.0), d[i],
+                    false));
+        }
+    }
+    vector<double>().swap(pivotDists);
+    std::sort(terms.begin(), terms.end());
+
+    // Top-level clusters containing each node, for scaling ideal distances
+    // between nodes in the same cluster.
+    vector<vector<Cluster *> > nodeClusters;
+    if (clusterHierarchy)
+    {
+        nodeClusters.resize(n);
+        for (Clusters::const_iterator c = clusterHierarchy->clusters.begin();
+                c != clusterHierarchy->clusters.end(); ++c)
+        {
+            for (std::set<unsigned>::const_iterator v = (*c)->nodes.begin();
+                    v != (*c)->nodes.end(); ++v)
+            {
+                nodeClusters[*v].push_back(*c);
+            }
+        }
+    }
+
+    // Merge terms for the same pair: an edge term replaces any pivot terms,
+    // and the two terms between a pair of pivots are added together.
+    m_cols.reserve(terms.size());
+    m_weights.reserve(terms.size());
+    m_dists.reserve(terms.size());
+    size_t t = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        m_rowStart[i] = m_cols.size();
+        while (t < terms.size() && terms[t].i == i)
+        {
+            const Term& first = terms[t];
+            double s = 0;
+            for (; t < terms.size() && terms[t].i == i &&
+                    terms[t].j == first.j; ++t)
+            {
+                if (!first.edge)
+                {
+                    s += terms[t].w;
+                }
+            }
+            double d = idealLength * first.d;
+            if (clusterHierarchy)
+            {
+                const vector<Cluster *>& ci = nodeClusters[i];
+                const vector<Cluster *>& cj = nodeClusters[first.j];
+                for (size_t a = 0; a < ci.size(); ++a)
+                {
+                    if (std::find(cj.begin(), cj.end(), ci[a]) != cj.end())
+                    {
+                        d /= ci[a]->internalEdgeWeightFactor;
+                    }
+                }
+            }
+            if (d <= 0 || std::isinf(d))
+            {
+                continue;
+            }
+            double w = (first.edge ? 1 : s) / (d * d);
+            m_cols.push_back(first.j);
+            m_weights.push_back(w);
+            m_dists.push_back(d);
+            m_degree[i] += w;
+            m_degree[first.j] += w;
+        }
+    }
+    m_rowStart[n] = m_cols.size();
+}
+
+void SparseStress::laplacianTimes(const valarray<double>& x,
+        valarray<double>& result) const
+{
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        result[i] = m_degree[i] * x[i];
+    }
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        double r = 0;
+        for (size_t k = m_rowStart[i]; k < m_rowStart[i + 1]; ++k)
+        {
+            unsigned j = m_cols[k];
+            double w = m_weights[k];
+            r += w * x[j];
+            result[j] -= w * x[i];
+        }
+        result[i] -= r;
+    }
+}
+
+void SparseStress::majorize(const valarray<double>& X,
+        const valarray<double>& Y, valarray<double>& coords,
+        const double tol, const unsigned maxIterations) const
+{
+    COLA_ASSERT(X.size() == m_n && Y.size() == m_n && coords.size() == m_n);
+    // b = L^Z coords, where the terms of L^Z are w_ij*d_ij/dist_ij.
+    valarray<double> b(0.0, m_n);
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        for (size_t k = m_rowStart[i]; k < m_rowStart[i + 1]; ++k)
+        {
+            unsigned j = m_cols[k];
+            double dx = X[i] - X[j], dy = Y[i] - Y[j];
+            double dist = sqrt(dx * dx + dy * dy);
+            // skip zero distances
+            if (dist > 1e-30)
+            {
+                double l = m_weights[k] * m_dists[k] / dist *
+                        (coords[i] - coords[j]);
+                b[i] += l;
+                b[j] -= l;
+            }
+        }
+        COLA_ASSERT(!std::isnan(b[i]));
+    }
+
+    // Solve L^w coords = b by conjugate gradient, preconditioned by the
+    // diagonal of L^w and warm started from the current positions.
+    valarray<double> r(m_n), z(m_n), p(m_n), Ap(m_n);
+    laplacianTimes(coords, Ap);
+    r = b - Ap;
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        z[i] = (m_degree[i] > 0) ? r[i] / m_degree[i] : 0;
+    }
+    p = z;
+    double r_z = inner(r, z);
+    const double tol_squared = tol * tol;
+    for (unsigned iter = 0; iter < maxIterations; ++iter)
+    {
+        if (inner(r, r) < tol_squared)
+        {
+            break;
+        }
+        laplacianTimes(p, Ap);
+        double p_Ap = inner(p, Ap);
+        if (p_Ap <= 0)
+        {
+            break;
+        }
+        double alpha = r_z / p_Ap;
+        coords += alpha * p;
+        r -= alpha * Ap;
+        for (unsigned i = 0; i < m_n; ++i)
+        {
+            z[i] = (m_degree[i] > 0) ? r[i] / m_degree[i] : 0;
+        }
+        double r_z_new = inner(r, z);
+        p = z + (r_z_new / r_z) * p;
+        r_z = r_z_new;
+    }
+}
+
+double SparseStress::stress(const valarray<double>& X,
+        const valarray<double>& Y) const
+{
+    double sum = 0;
+    for (unsigned i = 0; i < m_n; ++i)
+    {
+        for (size_t k = m_rowStart[i]; k < m_rowStart[i + 1]; ++k)
+        {
+            unsigned j = m_cols[k];
+            double dx = X[i] - X[j], dy = Y[i] - Y[j];
+            double diff = sqrt(dx * dx + dy * dy) - m_dists[k];
+            sum += m_weights[k] * diff * diff;
+        }
+    }
+    return sum;
+}
+
+} // namespace cola
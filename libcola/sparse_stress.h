@@ -0,0 +1,121 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2006-2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#ifndef COLA_SPARSE_STRESS_H
+#define COLA_SPARSE_STRESS_H
+
+#include <vector>
+#include <valarray>
+
+#include "libcola/cola.h"
+
+namespace cola {
+
+/**
+ * @brief The terms of a sparse approximation of stress, and the
+ *        majorization of it in one dimension.
+ *
+ * Full stress has a term for every pair of nodes, so takes quadratic time
+ * and memory.  Following the sparse stress model of Ortmann, Klimenta and
+ * Brandes, the approximation only has terms for the edges, and for the
+ * pairs between each node and a small set of pivot nodes.  Pivots are
+ * chosen to be spread across the graph, and each term to a pivot is
+ * weighted by the number of nodes near the pivot that it stands in for.
+ *
+ * Each term is stored once, in compressed sparse row form by its lower
+ * node index, and the majorization is solved by Jacobi-preconditioned
+ * conjugate gradient on the resulting weighted Laplacian.
+ */
+class SparseStress
+{
+public:
+    /**
+     * @brief Generates the stress terms for a graph.
+     *
+     * @param[in] n            The number of nodes.
+     * @param[in] es           Simple pair edges between the nodes.
+     * @param[in] eLengths     Individual ideal lengths for edges, all taken
+     *                         as 1 if empty.
+     * @param[in] idealLength  A scalar modifier of the ideal edge lengths.
+     * @param[in] pivots       The number of pivot nodes.
+     * @param[in] clusterHierarchy  If given, ideal distances between nodes
+     *                              in the same cluster are divided by the
+     *                              cluster's internalEdgeWeightFactor.
+     */
+    SparseStress(const unsigned n, const std::vector<Edge>& es,
+            const std::valarray<double>& eLengths, const double idealLength,
+            const unsigned pivots, RootCluster *clusterHierarchy = NULL);
+
+    /**
+     * @brief  Moves the nodes in one dimension to minimise the majorizing
+     *         function of stress at the current positions.
+     *
+     * @param[in]     X       Current x positions.
+     * @param[in]     Y       Current y positions.
+     * @param[in,out] coords  X or Y, the positions to be updated.
+     * @param[in]     tol     Convergence tolerance for the solver.
+     * @param[in]     maxIterations  Iteration limit for the solver.
+     */
+    void majorize(const std::valarray<double>& X,
+            const std::valarray<double>& Y, std::valarray<double>& coords,
+            const double tol, const unsigned maxIterations) const;
+
+    /**
+     * @brief  Returns the approximated stress at the given positions.
+     */
+    double stress(const std::valarray<double>& X,
+            const std::valarray<double>& Y) const;
+
+    /**
+     * @brief  Returns the number of pivot nodes actually used.
+     */
+    unsigned pivotCount(void) const
+    {
+        return m_pivots;
+    }
+
+    /**
+     * @brief  Returns the number of node pairs with a stress term.
+     */
+    size_t termCount(void) const
+    {
+        return m_cols.size();
+    }
+
+private:
+    void laplacianTimes(const std::valarray<double>& x,
+            std::valarray<double>& result) const;
+
+    unsigned m_n;
+    unsigned m_pivots;
+    // Term k, for m_rowStart[i] <= k < m_rowStart[i+1], is between node i
+    // and node m_cols[k] > i, with weight m_weights[k] and ideal distance
+    // m_dists[k].
+    std::vector<size_t> m_rowStart;
+    std::vector<unsigned> m_cols;
+    std::vector<double> m_weights;
+    std::vector<double> m_dists;
+    // Diagonal of the weighted Laplacian.
+    std::valarray<double> m_degree;
+};
+
+} // namespace cola
+
+#endif // COLA_SPARSE_STRESS_H
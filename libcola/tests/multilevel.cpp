@@ -0,0 +1,147 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+/*
+ * Test for the multilevel front-end to ConstrainedFDLayout.  A grid graph
+ * with some of its nodes aligned is coarsened and laid out, and afterwards
+ * the aligned nodes must still share an x position and the layout must
+ * have been spread out from its starting positions.  The time taken is
+ * printed along with that of a single ConstrainedFDLayout from the same
+ * starting positions, for comparison.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+#include "libvpsc/rectangle.h"
+#include "libcola/cola.h"
+#include "libcola/compound_constraints.h"
+#include "libcola/multilevel.h"
+
+using namespace cola;
+
+static const unsigned SIDE = 12;
+static const double IDEAL_LENGTH = 40;
+
+// Returns the time taken by f, in milliseconds.
+template <typename F>
+static double timed(F f)
+{
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void)
+{
+    // Start every node bunched up near the origin, so the layout has to
+    // untangle the grid.
+    vpsc::Rectangles rs, singleRs;
+    std::vector<Edge> es;
+    unsigned state = 1;
+    for (unsigned i = 0; i < SIDE * SIDE; ++i)
+    {
+        state = (state * 1103515245u) + 12345u;
+        double x = ((state >> 8) & 0xff) / 16.0;
+        state = (state * 1103515245u) + 12345u;
+        double y = ((state >> 8) & 0xff) / 16.0;
+        rs.push_back(new vpsc::Rectangle(x, x + 10, y, y + 10));
+        singleRs.push_back(new vpsc::Rectangle(x, x + 10, y, y + 10));
+        if ((i % SIDE) > 0)
+        {
+            es.push_back(Edge(i - 1, i));
+        }
+        if (i >= SIDE)
+        {
+            es.push_back(Edge(i - SIDE, i));
+        }
+    }
+
+    // Align the centres of the nodes down one diagonal of the grid.
+    std::vector<unsigned> aligned;
+    AlignmentConstraint *alignment = new AlignmentConstraint(vpsc::XDIM);
+    for (unsigned i = 0; i < SIDE; i += 3)
+    {
+        aligned.push_back(i * SIDE + i);
+        alignment->addShape(aligned.back(), 0);
+    }
+    CompoundConstraints ccs;
+    ccs.push_back(alignment);
+
+    MultilevelConstrainedFDLayout alg(rs, es, IDEAL_LENGTH, false);
+    alg.setConstraints(ccs);
+    alg.setMinimumLevelSize(20);
+    double multilevelTime = timed([&] { alg.run(); });
+
+    AlignmentConstraint *singleAlignment = 
+            new AlignmentConstraint(vpsc::XDIM);
+    for (unsigned i = 0; i < aligned.size(); ++i)
+    {
+        singleAlignment->addShape(aligned[i], 0);
+    }
+    CompoundConstraints singleCcs(1, singleAlignment);
+    ConstrainedFDLayout single(singleRs, es, IDEAL_LENGTH, false);
+    single.setConstraints(singleCcs);
+    double singleTime = timed([&] { single.run(); });
+
+    int result = 0;
+    if (alg.levelCount() < 2)
+    {
+        printf("The graph was not coarsened.\n");
+        result = 1;
+    }
+
+    const double x = rs[aligned[0]]->getCentreX();
+    for (unsigned i = 1; i < aligned.size(); ++i)
+    {
+        double error = fabs(rs[aligned[i]]->getCentreX() - x);
+        if (error > 1e-3)
+        {
+            printf("Node %u is %g from the alignment.\n", aligned[i], error);
+            result = 1;
+        }
+    }
+
+    // Opposite corners of the grid should end up well apart.
+    double dx = rs[0]->getCentreX() - rs[SIDE * SIDE - 1]->getCentreX();
+    double dy = rs[0]->getCentreY() - rs[SIDE * SIDE - 1]->getCentreY();
+    if (sqrt(dx * dx + dy * dy) < (SIDE - 1) * IDEAL_LENGTH / 2)
+    {
+        printf("The grid was not spread out.\n");
+        result = 1;
+    }
+
+    printf("Laid out %u nodes over %u levels in %.1fms (%.1fms with a "
+            "single level).\n", SIDE * SIDE, alg.levelCount(),
+            multilevelTime, singleTime);
+
+    delete alignment;
+    delete singleAlignment;
+    for (unsigned i = 0; i < rs.size(); ++i)
+    {
+        delete rs[i];
+        delete singleRs[i];
+    }
+    return result;
+}
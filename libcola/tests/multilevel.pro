@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = cola-multilevel
+
+include(tests.pri)
+
+# Input
+SOURCES += multilevel.cpp
@@ -0,0 +1,228 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+
+/*
+ * Test for the sweep that NonOverlapConstraints uses to find candidate
+ * shape pairs.  Many randomly placed shapes are given to a
+ * NonOverlapConstraints, and the overlapping pairs it offers as
+ * subconstraints, and the pairs it generates separation constraints for,
+ * must be exactly those found by testing every pair of shapes.  The
+ * overlapping pairs are also found for shapes spread out in a tall column,
+ * where many shapes are level with each other horizontally.  The time 
+ * taken by the sweeps is printed.
+ */
+
+#include <cstdio>
+#include <set>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+
+#include "libvpsc/rectangle.h"
+#include "libvpsc/variable.h"
+#include "libvpsc/constraint.h"
+#include "libcola/cola.h"
+#include "libcola/cc_nonoverlapconstraints.h"
+
+using namespace cola;
+
+typedef std::set<std::pair<unsigned, unsigned> > PairSet;
+
+static const unsigned SHAPES = 10000;
+
+// Returns the time taken by f, in milliseconds.
+template <typename F>
+static double timed(F f)
+{
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+static double nextRandom(unsigned& state)
+{
+    state = (state * 1103515245u) + 12345u;
+    return ((state >> 8) & 0xffff) / 65536.0;
+}
+
+static void addPair(PairSet& pairs, unsigned id1, unsigned id2)
+{
+    pairs.insert(std::make_pair(std::min(id1, id2), std::max(id1, id2)));
+}
+
+// Returns whether the given pairs are the same, printing a message if not.
+static bool samePairs(const char *what, const PairSet& swept,
+        const PairSet& allPairs)
+{
+    if (swept == allPairs)
+    {
+        return true;
+    }
+    printf("%s: the sweep found %u pairs, but %u pairs were expected.\n",
+            what, (unsigned) swept.size(), (unsigned) allPairs.size());
+    return false;
+}
+
+struct Shapes
+{
+    // Places SHAPES shapes at random within the given area.
+    Shapes(const double areaWidth, const double areaHeight)
+    {
+        // Its member types are private to libcola, so it must be created
+        // and destroyed there, as ConstrainedFDLayout does.
+        noc = new NonOverlapConstraints(NULL);
+        unsigned state = 1;
+        for (unsigned i = 0; i < SHAPES; ++i)
+        {
+            double width = 10 + (nextRandom(state) * 30);
+            double height = 10 + (nextRandom(state) * 20);
+            double x = nextRandom(state) * areaWidth;
+            double y = nextRandom(state) * areaHeight;
+            rs.push_back(new vpsc::Rectangle(x, x + width, y, y + height));
+            noc->addShape(i, width / 2, height / 2);
+            for (unsigned dim = 0; dim < 2; ++dim)
+            {
+                vpsc::Variable *v = new vpsc::Variable(i, 
+                        rs[i]->getCentreD(dim));
+                v->finalPosition = v->desiredPosition;
+                vs[dim].push_back(v);
+            }
+        }
+    }
+
+    ~Shapes()
+    {
+        delete (CompoundConstraint *) noc;
+        for (unsigned dim = 0; dim < 2; ++dim)
+        {
+            for_each(vs[dim].begin(), vs[dim].end(), delete_object());
+        }
+        for_each(rs.begin(), rs.end(), delete_object());
+    }
+
+    // Returns whether the overlapping pairs offered as subconstraints, as
+    // when making a layout feasible, are those found by testing every pair.
+    bool checkOverlappingPairs(const char *what)
+    {
+        PairSet overlapping;
+        double time = timed([&] {
+            while (noc->subConstraintsRemaining())
+            {
+                SubConstraintAlternatives alternatives =
+                        noc->getCurrSubConstraintAlternatives(vs);
+                if (alternatives.empty())
+                {
+                    continue;
+                }
+                const vpsc::Constraint& constraint = 
+                        alternatives.front().constraint;
+                addPair(overlapping, constraint.left->id, 
+                        constraint.right->id);
+                noc->markCurrSubConstraintAsActive(true);
+            }
+        });
+        printf("%s: found %u overlapping pairs of %u shapes in %.1fms.\n",
+                what, (unsigned) overlapping.size(), SHAPES, time);
+
+        PairSet allOverlapping;
+        for (unsigned i = 0; i < SHAPES; ++i)
+        {
+            for (unsigned j = i + 1; j < SHAPES; ++j)
+            {
+                if ((rs[i]->getMinX() < rs[j]->getMaxX()) &&
+                        (rs[j]->getMinX() < rs[i]->getMaxX()) &&
+                        (rs[i]->getMinY() < rs[j]->getMaxY()) &&
+                        (rs[j]->getMinY() < rs[i]->getMaxY()))
+                {
+                    addPair(allOverlapping, i, j);
+                }
+            }
+        }
+        return samePairs(what, overlapping, allOverlapping);
+    }
+
+    // Returns whether the pairs given separation constraints in the given
+    // dimension are those found to overlap in the other dimension by
+    // testing every pair.
+    bool checkSeparatedPairs(const char *what, const vpsc::Dim dim)
+    {
+        vpsc::Constraints cs;
+        double time = timed([&] {
+            noc->generateSeparationConstraints(dim, vs[dim], cs, rs);
+        });
+        PairSet separated;
+        for (unsigned i = 0; i < cs.size(); ++i)
+        {
+            addPair(separated, cs[i]->left->id, cs[i]->right->id);
+        }
+        for_each(cs.begin(), cs.end(), delete_object());
+        cs.clear();
+
+        // Sweeping again starts from the order found by the last sweep.
+        double secondTime = timed([&] {
+            noc->generateSeparationConstraints(dim, vs[dim], cs, rs);
+        });
+        for_each(cs.begin(), cs.end(), delete_object());
+        printf("%s: generated %u separation constraints in %.1fms, then "
+                "%.1fms.\n", what, (unsigned) separated.size(), time,
+                secondTime);
+
+        PairSet allSeparated;
+        for (unsigned i = 0; i < SHAPES; ++i)
+        {
+            for (unsigned j = i + 1; j < SHAPES; ++j)
+            {
+                if (rs[i]->overlapD(!dim, rs[j]) > 0.0005)
+                {
+                    addPair(allSeparated, i, j);
+                }
+            }
+        }
+        return samePairs(what, separated, allSeparated);
+    }
+
+    vpsc::Rectangles rs;
+    vpsc::Variables vs[2];
+    NonOverlapConstraints *noc;
+};
+
+int main(void)
+{
+    int result = 0;
+
+    Shapes square(3000, 3000);
+    if (!square.checkOverlappingPairs("Square") ||
+            !square.checkSeparatedPairs("Square, horizontal", vpsc::XDIM) ||
+            !square.checkSeparatedPairs("Square, vertical", vpsc::YDIM))
+    {
+        result = 1;
+    }
+
+    Shapes column(200, 45000);
+    if (!column.checkOverlappingPairs("Column"))
+    {
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = cola-nonoverlapsweep
+
+include(tests.pri)
+
+# Input
+SOURCES += nonoverlapsweep.cpp
@@ -0,0 +1,165 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+/*
+ * Test for the sparse stress approximation in ConstrainedMajorizationLayout.
+ * A small graph is laid out with full stress and with sparse stress from
+ * the same starting positions, and the full stress of the sparse layout
+ * must be close to that of the full layout.  A change made to the cluster
+ * hierarchy after setSparseStress() is called must also be taken into
+ * account when the layout is run.
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "libvpsc/rectangle.h"
+#include "libcola/cola.h"
+#include "libcola/cluster.h"
+
+using namespace cola;
+
+static const unsigned SIDE = 8;
+static const unsigned PIVOTS = 16;
+static const double IDEAL_LENGTH = 40;
+
+// A grid with a diagonal across each cell in one row, starting from the
+// same scattered positions every time.
+static void makeGraph(vpsc::Rectangles& rs, std::vector<Edge>& es)
+{
+    unsigned state = 1;
+    for (unsigned i = 0; i < SIDE * SIDE; ++i)
+    {
+        state = (state * 1103515245u) + 12345u;
+        double x = ((state >> 8) & 0xffff) / 256.0;
+        state = (state * 1103515245u) + 12345u;
+        double y = ((state >> 8) & 0xffff) / 256.0;
+        rs.push_back(new vpsc::Rectangle(x, x + 10, y, y + 10));
+        if ((i % SIDE) > 0)
+        {
+            es.push_back(Edge(i - 1, i));
+        }
+        if (i >= SIDE)
+        {
+            es.push_back(Edge(i - SIDE, i));
+        }
+        if ((i / SIDE == 3) && ((i % SIDE) > 0))
+        {
+            es.push_back(Edge(i - SIDE - 1, i));
+        }
+    }
+}
+
+static void freeGraph(vpsc::Rectangles& rs)
+{
+    for (unsigned i = 0; i < rs.size(); ++i)
+    {
+        delete rs[i];
+    }
+    rs.clear();
+}
+
+// The full stress of the layout given by rs.
+static double fullStress(vpsc::Rectangles& rs, const std::vector<Edge>& es)
+{
+    ConstrainedMajorizationLayout alg(rs, es, NULL, IDEAL_LENGTH);
+    return alg.computeStress();
+}
+
+// Lays out the graph with the given number of sparse stress pivots, or with
+// full stress if there are none, and returns the resulting full stress.
+static double layoutStress(const unsigned pivots, double& initialStress)
+{
+    vpsc::Rectangles rs;
+    std::vector<Edge> es;
+    makeGraph(rs, es);
+    initialStress = fullStress(rs, es);
+
+    ConstrainedMajorizationLayout alg(rs, es, NULL, IDEAL_LENGTH);
+    if (pivots > 0)
+    {
+        alg.setSparseStress(pivots);
+    }
+    alg.run();
+    double stress = fullStress(rs, es);
+    freeGraph(rs);
+    return stress;
+}
+
+// Lays out the graph with a cluster of its first two rows, whose internal
+// edge weight factor is set either before or after setSparseStress(), and
+// returns the positions of the nodes.
+static std::vector<double> clusteredLayout(const bool setFactorFirst)
+{
+    vpsc::Rectangles rs;
+    std::vector<Edge> es;
+    makeGraph(rs, es);
+    RootCluster root;
+    ConvexCluster *cluster = new ConvexCluster();
+    for (unsigned i = 0; i < 2 * SIDE; ++i)
+    {
+        cluster->addChildNode(i);
+    }
+    root.addChildCluster(cluster);
+
+    ConstrainedMajorizationLayout alg(rs, es, &root, IDEAL_LENGTH);
+    if (setFactorFirst)
+    {
+        cluster->internalEdgeWeightFactor = 3;
+    }
+    alg.setSparseStress(PIVOTS);
+    if (!setFactorFirst)
+    {
+        cluster->internalEdgeWeightFactor = 3;
+    }
+    alg.run();
+
+    std::vector<double> result;
+    for (unsigned i = 0; i < rs.size(); ++i)
+    {
+        result.push_back(rs[i]->getCentreX());
+        result.push_back(rs[i]->getCentreY());
+    }
+    freeGraph(rs);
+    return result;
+}
+
+int main(void)
+{
+    int result = 0;
+
+    double initialStress = 0;
+    double full = layoutStress(0, initialStress);
+    double sparse = layoutStress(PIVOTS, initialStress);
+    printf("Stress from %g: %g with full stress, %g with sparse stress.\n",
+            initialStress, full, sparse);
+    if (!(full < initialStress) || (sparse > 1.25 * full))
+    {
+        printf("Sparse stress layout is too far from full stress layout.\n");
+        result = 1;
+    }
+
+    if (clusteredLayout(true) != clusteredLayout(false))
+    {
+        printf("A cluster change after setSparseStress() was ignored.\n");
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = cola-sparsestress
+
+include(tests.pri)
+
+# Input
+SOURCES += sparsestress.cpp
@@ -0,0 +1,113 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+
+/*
+ * Test for re-solving with a GradientProjection after a straighten pass.
+ * straighten() adds dummy variables for the bends of the edges being
+ * straightened, and these are deleted once the pass has been solved.  The
+ * solver built for that pass refers to the dummy variables, so the next
+ * projection, made without straightening, must not reuse it.  This is the
+ * case even when there are no separation constraints to straighten with.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <valarray>
+
+#include "libcola/gradient_projection.h"
+#include "libcola/straightener.h"
+#include "libcola/sparse_matrix.h"
+
+using namespace cola;
+
+static const unsigned NODES = 3;
+static const unsigned DUMMY_NODES = 2;
+
+int main(void)
+{
+    // A path of three nodes, each drawn towards its neighbours.
+    std::valarray<double> denseQ(0.0, NODES * NODES);
+    for (unsigned i = 0; i + 1 < NODES; ++i)
+    {
+        denseQ[i * NODES + i] += 1;
+        denseQ[(i + 1) * NODES + (i + 1)] += 1;
+        denseQ[i * NODES + (i + 1)] -= 1;
+        denseQ[(i + 1) * NODES + i] -= 1;
+    }
+    GradientProjection gp(vpsc::HORIZONTAL, &denseQ, 0.0001, 100, NULL,
+            NULL);
+
+    // The straighten pass adds two dummy nodes, each drawn towards the
+    // first and last nodes.
+    std::vector<straightener::Node *> snodes;
+    for (unsigned i = 0; i < NODES + DUMMY_NODES; ++i)
+    {
+        snodes.push_back(new straightener::Node(i, 10.0 * i, 0));
+    }
+    SparseMap sparseMap(NODES + DUMMY_NODES);
+    for (unsigned i = NODES; i < NODES + DUMMY_NODES; ++i)
+    {
+        sparseMap[std::make_pair(i, i)] += 2;
+        sparseMap[std::make_pair(0u, 0u)] += 1;
+        sparseMap[std::make_pair(NODES - 1, NODES - 1)] += 1;
+        sparseMap[std::make_pair(0u, i)] -= 1;
+        sparseMap[std::make_pair(i, 0u)] -= 1;
+        sparseMap[std::make_pair(NODES - 1, i)] -= 1;
+        sparseMap[std::make_pair(i, NODES - 1)] -= 1;
+    }
+    SparseMatrix sparseQ(sparseMap);
+    std::vector<SeparationConstraint *> noConstraints;
+
+    std::valarray<double> b(0.0, NODES);
+    std::valarray<double> x(NODES);
+    for (unsigned i = 0; i < NODES; ++i)
+    {
+        x[i] = 20.0 * i;
+    }
+    gp.straighten(&sparseQ, noConstraints, snodes);
+    gp.solve(b, x);
+
+    // Project again without straightening.
+    gp.solve(b, x);
+
+    int result = 0;
+    for (unsigned i = 0; i < NODES; ++i)
+    {
+        if (std::isnan(x[i]) || std::isinf(x[i]))
+        {
+            printf("Node %u has no position after re-solving.\n", i);
+            result = 1;
+        }
+    }
+    if (gp.getFullResult().size() != NODES)
+    {
+        printf("Re-solving kept %u dummy variables.\n",
+                (unsigned) gp.getFullResult().size() - NODES);
+        result = 1;
+    }
+
+    for (unsigned i = 0; i < snodes.size(); ++i)
+    {
+        delete snodes[i];
+    }
+    return result;
+}
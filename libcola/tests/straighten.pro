@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = cola-straighten
+
+include(tests.pri)
+
+# Input
+SOURCES += straighten.cpp
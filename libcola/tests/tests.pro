@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+# Each test is its own program, built and run by "make check".
+SUBDIRS = \
+	multilevel.pro \
+	nonoverlapsweep.pro \
+	sparsestress.pro \
+	straighten.pro \
+	threadedlayout.pro
@@ -0,0 +1,262 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2015  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+/*
+ * Stress test for laying out connected components concurrently, as the
+ * Dunnart canvas does for large diagrams.  A graph made up of several
+ * components, some with alignment constraints, is split up with
+ * connectedComponents() and each component is laid out by its own
+ * ConstrainedFDLayout with overlaps prevented.  The components are laid
+ * out one after another, and then by a pool of threads, and every node
+ * must end up in exactly the same place both ways.  This is done once
+ * with plain layout, and once for a graph of rings preserving the topology
+ * of the components with libtopology, as the canvas does when its
+ * topology option is set.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "libvpsc/rectangle.h"
+#include "libcola/cola.h"
+#include "libcola/compound_constraints.h"
+#include "libcola/connected_components.h"
+#include "libtopology/topology_graph.h"
+#include "libtopology/cola_topology_addon.h"
+
+using namespace cola;
+
+static const unsigned COMPONENTS = 12;
+static const unsigned COMPONENT_NODES = 25;
+static const unsigned THREADS = 4;
+static const unsigned ROUNDS = 3;
+
+struct Graph
+{
+    vpsc::Rectangles rs;
+    std::vector<Edge> es;
+    CompoundConstraints ccs;
+    std::vector<Component *> components;
+
+    ~Graph()
+    {
+        for_each(components.begin(), components.end(), delete_object());
+        for_each(ccs.begin(), ccs.end(), delete_object());
+        for_each(rs.begin(), rs.end(), delete_object());
+    }
+};
+
+static double nextRandom(unsigned& state)
+{
+    state = (state * 1103515245u) + 12345u;
+    return ((state >> 8) & 0xffff) / 65536.0;
+}
+
+// Builds the same graph every time: each component is a random tree with
+// a few extra edges, and every other component aligns some of its nodes.
+static void makeGraph(Graph& graph)
+{
+    unsigned state = 1;
+    for (unsigned c = 0; c < COMPONENTS; ++c)
+    {
+        const unsigned first = graph.rs.size();
+        AlignmentConstraint *alignment = NULL;
+        if ((c % 2) == 0)
+        {
+            alignment = new AlignmentConstraint(vpsc::YDIM);
+            graph.ccs.push_back(alignment);
+        }
+        for (unsigned i = 0; i < COMPONENT_NODES; ++i)
+        {
+            double x = nextRandom(state) * 300;
+            double y = nextRandom(state) * 300;
+            graph.rs.push_back(new vpsc::Rectangle(x, x + 20, y, y + 15));
+            if (i > 0)
+            {
+                unsigned parent = first + (unsigned)
+                        (nextRandom(state) * i);
+                graph.es.push_back(Edge(parent, first + i));
+            }
+            if ((i > 2) && (nextRandom(state) < 0.2))
+            {
+                graph.es.push_back(Edge(first + i - 3, first + i));
+            }
+            if (alignment && ((i % 8) == 0))
+            {
+                alignment->addShape(first + i, 0);
+            }
+        }
+    }
+    connectedComponents(graph.rs, graph.es, graph.ccs, graph.components);
+}
+
+// Builds the same graph every time: each component is a ring, drawn as a
+// polygon so that no straight edge passes through a node.
+static void makeRingGraph(Graph& graph)
+{
+    unsigned state = 1;
+    for (unsigned c = 0; c < COMPONENTS; ++c)
+    {
+        const unsigned first = graph.rs.size();
+        const double radius = 100 + (nextRandom(state) * 50);
+        for (unsigned i = 0; i < COMPONENT_NODES; ++i)
+        {
+            double angle = (2 * M_PI * i) / COMPONENT_NODES;
+            double x = (c * 400) + (radius * cos(angle));
+            double y = radius * sin(angle);
+            graph.rs.push_back(new vpsc::Rectangle(x, x + 20, y, y + 15));
+            graph.es.push_back(Edge(first + i,
+                    first + ((i + 1) % COMPONENT_NODES)));
+        }
+    }
+    connectedComponents(graph.rs, graph.es, graph.ccs, graph.components);
+}
+
+static void layoutComponent(Component *component)
+{
+    component->mapConstraintsToComponent();
+    ConstrainedFDLayout alg(component->rects, component->edges, 40, true);
+    alg.setConstraints(component->ccs);
+    alg.run();
+    component->mapConstraintsFromComponent();
+}
+
+// Lays out a component from a feasible layout, keeping the topology of
+// straight line routes for its edges.
+static void layoutComponentPreservingTopology(Component *component)
+{
+    component->mapConstraintsToComponent();
+    ConstrainedFDLayout alg(component->rects, component->edges, 40, true);
+    alg.setConstraints(component->ccs);
+
+    topology::ColaTopologyAddon emptyTopology;
+    alg.setTopology(&emptyTopology);
+    alg.makeFeasible();
+    topology::ColaTopologyAddon *feasibleTopology =
+            dynamic_cast<topology::ColaTopologyAddon *> (alg.getTopology());
+    topology::Nodes nodes = feasibleTopology->topologyNodes;
+    delete feasibleTopology;
+
+    topology::Edges routes;
+    for (unsigned i = 0; i < component->edges.size(); ++i)
+    {
+        topology::EdgePoints points;
+        points.push_back(new topology::EdgePoint(
+                nodes[component->edges[i].first],
+                topology::EdgePoint::CENTRE));
+        points.push_back(new topology::EdgePoint(
+                nodes[component->edges[i].second],
+                topology::EdgePoint::CENTRE));
+        routes.push_back(new topology::Edge(i, 40, points));
+    }
+    topology::ColaTopologyAddon topology(nodes, routes);
+    alg.setTopology(&topology);
+    alg.run();
+    component->mapConstraintsFromComponent();
+
+    for_each(routes.begin(), routes.end(), delete_object());
+    for_each(nodes.begin(), nodes.end(), delete_object());
+}
+
+typedef void (*GraphFunction)(Graph&);
+typedef void (*LayoutFunction)(Component *);
+
+static void layoutComponentsFromQueue(std::vector<Component *> *components,
+        std::atomic<unsigned> *next, LayoutFunction layout)
+{
+    unsigned c;
+    while ((c = (*next)++) < components->size())
+    {
+        layout((*components)[c]);
+    }
+}
+
+static std::vector<double> positions(const Graph& graph)
+{
+    std::vector<double> result;
+    for (unsigned i = 0; i < graph.rs.size(); ++i)
+    {
+        result.push_back(graph.rs[i]->getCentreX());
+        result.push_back(graph.rs[i]->getCentreY());
+    }
+    return result;
+}
+
+// Lays out the graph one component at a time and then ROUNDS times with
+// a pool of threads, and returns the number of concurrent layouts that
+// differed from the serial one.
+static unsigned differingLayouts(GraphFunction make, LayoutFunction layout)
+{
+    Graph serial;
+    make(serial);
+    for (unsigned c = 0; c < serial.components.size(); ++c)
+    {
+        layout(serial.components[c]);
+    }
+    const std::vector<double> expected = positions(serial);
+
+    unsigned differing = 0;
+    for (unsigned round = 0; round < ROUNDS; ++round)
+    {
+        Graph parallel;
+        make(parallel);
+        std::atomic<unsigned> next(0);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < THREADS; ++i)
+        {
+            threads.push_back(std::thread(layoutComponentsFromQueue,
+                    &parallel.components, &next, layout));
+        }
+        for (unsigned i = 0; i < THREADS; ++i)
+        {
+            threads[i].join();
+        }
+
+        if (positions(parallel) != expected)
+        {
+            ++differing;
+        }
+    }
+    return differing;
+}
+
+int main(void)
+{
+    Graph graph;
+    makeGraph(graph);
+    if (graph.components.size() != COMPONENTS)
+    {
+        printf("Expected %u components, but found %u.\n", COMPONENTS,
+                (unsigned) graph.components.size());
+        return 1;
+    }
+
+    unsigned differing = differingLayouts(makeGraph, layoutComponent);
+    printf("%u of %u concurrent component layouts differed from the "
+            "serial layout.\n", differing, ROUNDS);
+    unsigned differingTopology =
+            differingLayouts(makeRingGraph, layoutComponentPreservingTopology);
+    printf("%u of %u concurrent topology preserving layouts differed from "
+            "the serial layout.\n", differingTopology, ROUNDS);
+    return ((differing == 0) && (differingTopology == 0)) ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = cola-threadedlayout
+
+# Also lays out with libtopology, which needs libcola.
+LIBS += -ltopology
+
+include(tests.pri)
+
+# Input
+SOURCES += threadedlayout.cpp
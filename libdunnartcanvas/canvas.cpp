@@ -29,6 +29,8 @@
 #include <QtWidgets>
 #include <QtSvg>
 #include <QParallelAnimationGroup>
+#include <QThreadPool>
+#include <QRunnable>
 
 #include "libdunnartcanvas/canvas.h"
 #include "libdunnartcanvas/shape.h"
@@ -43,6 +45,7 @@
 #include "libdunnartcanvas/gmlgraph.h"
 #include "libdunnartcanvas/connectionpininfo.h"
 #include "libdunnartcanvas/pluginfileiofactory.h"
+#include "libdunnartcanvas/diagramwriter.h"
 
 #include "libdunnartcanvas/graphlayout.h"
 #include "libdunnartcanvas/oldcanvas.h"
@@ -163,6 +166,7 @@ Canvas::Canvas()
       m_layout_update_timer(NULL),
       m_layout_finish_timer(NULL),
       m_processing_layout_updates(false),
+      m_in_layout_step(false),
       m_graphlayout(NULL),
       m_router(NULL),
       m_svg_renderer(NULL),
@@ -178,18 +182,26 @@ Canvas::Canvas()
       m_lone_selected_item(NULL),
       m_undo_stack(NULL),
       m_current_undo_macro(NULL),
+      m_undo_memory_limit(64 * 1024 * 1024),
+      m_undo_memory_usage(0),
+      m_edit_count(0),
       m_hide_selection_handles(false),
       m_overlay_router_raw_routes(false),
       m_overlay_router_display_routes(false),
       m_overlay_router_obstacles(false),
       m_overlay_router_visgraph(false),
       m_overlay_router_orthogonal_visgraph(false),
+      m_overlay_frame_rate(false),
+      m_lod_simplified_threshold(0.2),
+      m_lod_labels_threshold(0.4),
+      m_lod_caching(false),
       m_rendering_for_printing(false),
       m_edit_mode(ModeSelection),
       m_routing_event_posted(false),
       m_canvas_font(NULL),
       m_canvas_font_size(DEFAULT_CANVAS_FONT_SIZE),
-      m_animation_group(NULL)
+      m_animation_group(NULL),
+      m_save_thread_pool(new QThreadPool(this))
 {
     m_ideal_connector_length = 100;
     m_flow_separation_modifier = 0.5;
@@ -204,6 +216,10 @@ Canvas::Canvas()
     m_force_orthogonal_connectors = false;
 
     m_undo_stack = new QUndoStack(this);
+    connect(m_undo_stack, SIGNAL(indexChanged(int)), this,
+            SLOT(countEdit()));
+
+    m_save_thread_pool->setMaxThreadCount(1);
 
     // This is faster for dynamic scenes.
     setItemIndexMethod(QGraphicsScene::NoIndex);
@@ -272,6 +288,14 @@ Canvas::Canvas()
 
 Canvas::~Canvas()
 {
+    // Let any background save finish writing its snapshot.
+    m_save_thread_pool->waitForDone();
+
+    // Undo macros take themselves off m_undo_macros_kept when deleted,
+    // so the stack must go before the canvas's own members do.
+    delete m_undo_stack;
+    m_undo_stack = NULL;
+
     delete m_graphlayout;
     delete m_router;
     delete m_animation_group;
@@ -350,7 +374,7 @@ void Canvas::postDiagramLoad(void)
     setOptAutomaticGraphLayout(m_opt_automatic_graph_layout);
 
     // Update on-screen representation of dependant indicators.
-    foreach (CanvasItem *item, items())
+    foreach (Indicator *item, indicators())
     {
         Guideline *gobj =    dynamic_cast<Guideline *> (item);
         Distribution *dobj = dynamic_cast<Distribution *> (item);
@@ -387,27 +411,102 @@ void Canvas::postDiagramLoad(void)
 CanvasItem *Canvas::getItemByID(QString ID) const
 {
     assert(this != NULL);
-    foreach (CanvasItem *item, items())
+    return m_items_by_id.value(ID, NULL);
+}
+
+CanvasItem *Canvas::getItemByInternalId(uint internalId) const
+{
+    assert(this != NULL);
+    return m_items_by_internal_id.value(internalId, NULL);
+}
+
+
+template <typename T>
+static void addTypedItem(QList<T *>& list, T *item,
+        QHash<CanvasItem *, int>& positions)
+{
+    positions.insert(item, list.size());
+    list.append(item);
+}
+
+// Removes the item if it is at the given position in the list, by moving
+// the last item in the list into its place.
+template <typename T>
+static bool removeTypedItem(QList<T *>& list, int position, CanvasItem *item,
+        QHash<CanvasItem *, int>& positions)
+{
+    if ((position >= list.size()) ||
+            (static_cast<CanvasItem *> (list.at(position)) != item))
+    {
+        return false;
+    }
+    T *last = list.takeLast();
+    if (position < list.size())
+    {
+        list[position] = last;
+        positions[last] = position;
+    }
+    return true;
+}
+
+// Called by CanvasItem once it has been added to the canvas and given its
+// ids.
+void Canvas::indexItem(CanvasItem *item)
+{
+    m_items_by_id.insert(item->idString(), item);
+    m_items_by_internal_id.insert(item->internalId(), item);
+
+    if (ShapeObj *shape = dynamic_cast<ShapeObj *> (item))
     {
-        if (ID == item->idString())
+        addTypedItem(m_shapes, shape, m_typed_item_positions);
+        if (m_lod_caching)
         {
-            return item;
+            shape->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
         }
     }
-    return NULL;
+    else if (Connector *conn = dynamic_cast<Connector *> (item))
+    {
+        addTypedItem(m_connectors, conn, m_typed_item_positions);
+    }
+    else if (Indicator *indicator = dynamic_cast<Indicator *> (item))
+    {
+        addTypedItem(m_indicators, indicator, m_typed_item_positions);
+    }
 }
 
-CanvasItem *Canvas::getItemByInternalId(uint internalId) const
+// Called by CanvasItem as it is removed from the canvas, including from
+// its destructor, so this can't rely on the dynamic type of the item.
+void Canvas::unindexItem(CanvasItem *item)
 {
-    assert(this != NULL);
-    foreach (CanvasItem *item, items())
+    QHash<QString, CanvasItem *>::iterator byId =
+            m_items_by_id.find(item->idString());
+    if ((byId != m_items_by_id.end()) && (byId.value() == item))
     {
-        if (internalId == item->internalId())
+        m_items_by_id.erase(byId);
+    }
+    QHash<uint, CanvasItem *>::iterator byInternalId =
+            m_items_by_internal_id.find(item->internalId());
+    if ((byInternalId != m_items_by_internal_id.end()) &&
+            (byInternalId.value() == item))
+    {
+        m_items_by_internal_id.erase(byInternalId);
+    }
+
+    QHash<CanvasItem *, int>::iterator typed =
+            m_typed_item_positions.find(item);
+    if (typed != m_typed_item_positions.end())
+    {
+        int position = typed.value();
+        m_typed_item_positions.erase(typed);
+        if (!removeTypedItem(m_shapes, position, item,
+                    m_typed_item_positions) &&
+            !removeTypedItem(m_connectors, position, item,
+                    m_typed_item_positions))
         {
-            return item;
+            removeTypedItem(m_indicators, position, item,
+                    m_typed_item_positions);
         }
     }
-    return NULL;
 }
 
 QFont &Canvas::canvasFont(void)
@@ -427,6 +526,11 @@ QUndoStack *Canvas::undoStack(void) const
     return m_undo_stack;
 }
 
+void Canvas::countEdit(void)
+{
+    ++m_edit_count;
+}
+
 UndoMacro *Canvas::currentUndoMacro(void)
 {
     if (m_current_undo_macro == NULL)
@@ -438,6 +542,7 @@ UndoMacro *Canvas::currentUndoMacro(void)
 
 UndoMacro *Canvas::beginUndoMacro(const QString& text)
 {
+    endUndoMacro();
     m_current_undo_macro = new UndoMacro(this);
     m_current_undo_macro->setText(text);
     m_undo_stack->push(m_current_undo_macro);
@@ -447,7 +552,44 @@ UndoMacro *Canvas::beginUndoMacro(const QString& text)
 
 void Canvas::endUndoMacro(void)
 {
+    UndoMacro *macro = m_current_undo_macro;
     m_current_undo_macro = NULL;
+    if (macro == NULL)
+    {
+        return;
+    }
+    macro->squeeze();
+
+    // Only macros from beginUndoMacro() are on the stack, and the current
+    // one is always the newest command there.
+    int count = m_undo_stack->count();
+    if ((count == 0) || (m_undo_stack->command(count - 1) != macro))
+    {
+        return;
+    }
+    macro->m_counted_usage = macro->memoryUsage();
+    m_undo_memory_usage += macro->m_counted_usage;
+    m_undo_macros_kept.append(macro);
+
+    // Drop the oldest undo steps past the memory limit.  Only steps that
+    // have been done are dropped, so redo is never affected, and the
+    // latest of them is always kept.
+    while ((m_undo_memory_usage > m_undo_memory_limit) &&
+            (m_undo_macros_kept.size() > 1) &&
+            m_undo_macros_kept.at(1)->m_done)
+    {
+        m_undo_macros_kept.first()->discard();
+    }
+}
+
+qint64 Canvas::undoMemoryLimit(void) const
+{
+    return m_undo_memory_limit;
+}
+
+void Canvas::setUndoMemoryLimit(const qint64 bytes)
+{
+    m_undo_memory_limit = bytes;
 }
 
 
@@ -493,18 +635,12 @@ QString Canvas::assignStringId(QString id)
     return id;
 }
 
+// Whether no other item on the canvas has this id.  Items are only added
+// to the index once they've been assigned an id, so this is checked before
+// the item asking is in the index.
 bool Canvas::idIsUnique(QString id) const
 {
-    unsigned int count = 0;
-    CanvasItem *item;
-    foreach (item, items())
-    {
-        if (item->idString() == id)
-        {
-            ++count;
-        }
-    }
-    return (count == 1);
+    return !m_items_by_id.contains(id);
 }
 
 
@@ -578,11 +714,9 @@ void Canvas::drawForeground(QPainter *painter, const QRectF& rect)
         QPen pen(Qt::red);
         pen.setCosmetic(true);
         painter->setPen(pen);
-        foreach (CanvasItem *item, items())
+        foreach (ShapeObj *shape, shapes())
         {
-            ShapeObj *shape = dynamic_cast<ShapeObj *> (item);
-
-            if (shape && shape->avoidRef)
+            if (shape->avoidRef)
             {
                 // Draw the rectangular box used for orthogonal routing.
                 Avoid::Box bBox = shape->avoidRef->routingBox();
@@ -783,20 +917,14 @@ void Canvas::processSelectionDropEvent(QGraphicsSceneMouseEvent *event)
         QRectF selectedShapeRect = selectedShape->boundingRect().translated(
                 selectedShape->scenePos());
         
-        foreach (CanvasItem *item, items())
+        foreach (ShapeObj *shape, shapes())
         {
-            ShapeObj *shape = dynamic_cast<ShapeObj *> (item);
-            
-            if (shape)
-            {
-                shape->removeContainedShape(selectedShape);
-            }
+            shape->removeContainedShape(selectedShape);
         }
 
-        foreach (CanvasItem *item, items())
+        foreach (ShapeObj *shape, shapes())
         {
-            ShapeObj *shape = dynamic_cast<ShapeObj *> (item);
-            if (!shape || (shape == selectedShape))
+            if (shape == selectedShape)
             {
                 continue;
             }
@@ -1353,14 +1481,9 @@ void Canvas::setOptAutomaticGraphLayout(const bool value)
     {
         // If autolayout was set previously, then update all the positions
         // of obstacles with libavoid and reroute connectors.
-        QList<CanvasItem *> canvas_items = items();
-        for (int i = 0; i < canvas_items.size(); ++i)
+        foreach (ShapeObj *shape, shapes())
         {
-            ShapeObj *shape = dynamic_cast<ShapeObj *> (canvas_items.at(i));
-            if (shape)
-            {
-                router()->moveShape(shape->avoidRef, 0, 0);
-            }
+            router()->moveShape(shape->avoidRef, 0, 0);
         }
         reroute_connectors(this, true);
     }
@@ -1557,7 +1680,7 @@ bool Canvas::hasVisibleOverlays(void) const
 {
     return m_overlay_router_raw_routes|| m_overlay_router_display_routes ||
             m_overlay_router_obstacles || m_overlay_router_visgraph ||
-            m_overlay_router_orthogonal_visgraph;
+            m_overlay_router_orthogonal_visgraph || m_overlay_frame_rate;
 }
 
 void Canvas::setRenderingForPrinting(const bool printingMode)
@@ -1635,6 +1758,78 @@ bool Canvas::overlayRouterOrthogonalVisGraph(void) const
     return m_overlay_router_orthogonal_visgraph;
 }
 
+void Canvas::setOverlayFrameRate(const bool value)
+{
+    m_overlay_frame_rate = value;
+    emit debugOverlayEnabled(hasVisibleOverlays());
+    this->update();
+}
+
+
+bool Canvas::overlayFrameRate(void) const
+{
+    return m_overlay_frame_rate;
+}
+
+
+Canvas::RenderDetail Canvas::renderDetail(const QPainter *painter) const
+{
+    if (m_rendering_for_printing)
+    {
+        return RenderFullDetail;
+    }
+    qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+            painter->worldTransform());
+    if (scale < m_lod_simplified_threshold)
+    {
+        return RenderSimplified;
+    }
+    else if (scale < m_lod_labels_threshold)
+    {
+        return RenderWithoutLabels;
+    }
+    return RenderFullDetail;
+}
+
+
+double Canvas::levelOfDetailSimplifiedThreshold(void) const
+{
+    return m_lod_simplified_threshold;
+}
+
+
+double Canvas::levelOfDetailLabelsThreshold(void) const
+{
+    return m_lod_labels_threshold;
+}
+
+
+void Canvas::setLevelOfDetailThresholds(const double simplifiedBelow,
+        const double labelsBelow)
+{
+    m_lod_simplified_threshold = simplifiedBelow;
+    m_lod_labels_threshold = labelsBelow;
+    this->update();
+}
+
+
+bool Canvas::levelOfDetailCaching(void) const
+{
+    return m_lod_caching;
+}
+
+
+void Canvas::setLevelOfDetailCaching(const bool value)
+{
+    m_lod_caching = value;
+    QGraphicsItem::CacheMode mode = (value) ?
+            QGraphicsItem::DeviceCoordinateCache : QGraphicsItem::NoCache;
+    foreach (ShapeObj *shape, m_shapes)
+    {
+        shape->setCacheMode(mode);
+    }
+}
+
 
 double Canvas::optIdealEdgeLengthModifier(void) const
 {
@@ -1908,13 +2103,9 @@ void Canvas::deleteSelection(void)
     }
     
     // Remove containment relationships.
-    foreach (CanvasItem *item, items())
+    foreach (ShapeObj *shape, shapes())
     {
-        ShapeObj *shape = dynamic_cast<ShapeObj *> (item);
-        if (shape)
-        {
-            shape->removeContainedShapes(sel_shapes);
-        }
+        shape->removeContainedShapes(sel_shapes);
     }
 
     foreach (CanvasItem *item, sel_copy)
@@ -1984,6 +2175,24 @@ QList<CanvasItem *> Canvas::items(void) const
 }
 
 
+QList<ShapeObj *> Canvas::shapes(void) const
+{
+    return m_shapes;
+}
+
+
+QList<Connector *> Canvas::connectors(void) const
+{
+    return m_connectors;
+}
+
+
+QList<Indicator *> Canvas::indicators(void) const
+{
+    return m_indicators;
+}
+
+
 QList<CanvasItem *> Canvas::selectedItems(void) const
 {
     QList<CanvasItem *> filteredSelection;
@@ -2029,8 +2238,39 @@ void Canvas::setNudgeDistance(const double dist)
     m_connector_nudge_distance = dist;
 }
 
-void Canvas::updateConnectorsForLayout(void)
+// Shapes moved by layout steps are only rerouted once they have moved
+// this far, in any direction, since they were last routed.
+static const double x_routerMoveTolerance = 1.0;
+
+void Canvas::beginLayoutStep(void)
+{
+    m_in_layout_step = true;
+}
+
+void Canvas::updateConnectorsForLayout(const bool finalStep)
 {
+    m_in_layout_step = false;
+
+    // Shapes that haven't moved far enough stay noted, so small moves
+    // still add up over several steps.
+    QList<ShapeObj *> movedShapes;
+    foreach (ShapeObj *shape, m_router_moved_shapes)
+    {
+        if (finalStep ||
+                (shape->routerMoveDistance() > x_routerMoveTolerance))
+        {
+            movedShapes.append(shape);
+        }
+    }
+    foreach (ShapeObj *shape, movedShapes)
+    {
+        // Removes the shape from m_router_moved_shapes.
+        shape->routerMove();
+    }
+
+    // Connectors are only updated from libavoid if something they route
+    // around or attach to has changed, so those whose endpoints and
+    // paths are unaffected are left alone.
     if ((!m_opt_preserve_topology || (m_graphlayout->runLevel != 1)) &&
             !m_gml_graph && !m_batch_diagram_layout)
     {
@@ -2060,8 +2300,8 @@ void Canvas::processLayoutUpdateEvent(void)
         }
     }
 
+    // Connectors are redrawn by each step of the layout animation.
     m_graphlayout->processReturnPositions();
-    updateConnectorsForLayout();
 
     //qDebug("processLayoutUpdateEvent %7d", ++layoutUpdates);
 }
@@ -2103,37 +2343,14 @@ void Canvas::processLayoutFinishedEvent(void)
         // Do connector post-processing.
         reroute_connectors(this, false, true);
     }
-    bool changes = !getActions().empty();
     if (gl->runLevel == 0)
     {
         gl->runLevel=1;
         qDebug("runLevel=1");
         interrupt_graph_layout();
-        changes = true;
     }
 
     emit layoutHasConverged();
-
-    if (m_batch_diagram_layout && !changes)
-    {
-        // Reroute connectors.
-        reroute_connectors(this, true, true);
-        // Nudge connectors if requested (-w option)
-        if (m_connector_nudge_distance > 0)
-        {
-            nudgeConnectors(this, m_connector_nudge_distance, true);
-        }
-        // redo the connector interference coloring after nudging
-        if (m_opt_colour_interfering_connectors)
-        {
-            colourInterferingConnectors(this);
-        }
-        // Fit the page size to the entire diagram.
-        //QT getPageSize(NULL, NULL, NULL, NULL, BUT_FITPAGETODIAGRAM);
-        // Save the SVG and exit.
-        //QT saveDiagramAsSVG(this, filename());
-        exit(EXIT_SUCCESS);
-    }
 }
 
 
@@ -2171,6 +2388,27 @@ bool Canvas::isLayoutSuspended(void) const
     return m_graphlayout->isFreeShiftFromDunnart();
 }
 
+
+void Canvas::runBatchLayout(void)
+{
+    m_batch_diagram_layout = true;
+    m_graphlayout->runSynchronously();
+
+    // Reroute connectors.
+    reroute_connectors(this, true, true);
+    // Nudge connectors if requested (-w option)
+    if (m_connector_nudge_distance > 0)
+    {
+        nudgeConnectors(this, m_connector_nudge_distance, true);
+    }
+    // redo the connector interference coloring after nudging
+    if (m_opt_colour_interfering_connectors)
+    {
+        colourInterferingConnectors(this);
+    }
+    m_batch_diagram_layout = false;
+}
+
 void Canvas::createIndicatorHighlightCache(void)
 {
     if (!isLayoutSuspended())
@@ -2179,7 +2417,7 @@ void Canvas::createIndicatorHighlightCache(void)
         return;
     }
 
-    foreach (CanvasItem *item, items())
+    foreach (Indicator *item, indicators())
     {
         Guideline *g = dynamic_cast<Guideline *> (item);
         if (g && (g->isSelected() == false))
@@ -2260,7 +2498,7 @@ bool Canvas::inSelectionMode(void) const
 
 void Canvas::clearIndicatorHighlights(const bool clearCache)
 {
-    foreach (CanvasItem *item, items())
+    foreach (Indicator *item, indicators())
     {
         Guideline *g = dynamic_cast<Guideline *> (item);
         if (g)
@@ -2818,7 +3056,7 @@ void Canvas::recursiveMapIDs(QDomNode start, const QString& ns, int pass)
 
 // Return true for namespaces that are not used by Dunnart (since we
 // will be copy elements/properties in such namespaces straight through).
-static bool is_external_ns(const QString& ns)
+bool Canvas::isExternalNamespace(const QString& ns)
 {
     if (ns.isEmpty() || (ns == x_dunnartNs) || (ns == "inkscape") ||
             (ns ==  "sodipodi") )
@@ -2859,7 +3097,7 @@ void Canvas::recursiveReadSVG(const QDomNode& start, const QString& dunnartNS,
     {
         if (!curr.prefix().isEmpty())
         {
-            if (is_external_ns(curr.prefix()))
+            if (isExternalNamespace(curr.prefix()))
             {
                 m_extra_namespaces_map[curr.prefix()] = curr.namespaceURI();
             }
@@ -2891,7 +3129,7 @@ void Canvas::recursiveReadSVG(const QDomNode& start, const QString& dunnartNS,
                 {
                     this->loadSVGRootNodeAttributes(element);
                 }
-                else if (is_external_ns(element.prefix()))
+                else if (isExternalNamespace(element.prefix()))
                 {
                     // Save nodes for external namespaces to output
                     // unchanged on saving.
@@ -2970,16 +3208,117 @@ void Canvas::saveDiagram(const QString& outputFilename)
     }
     else
     {
-        // We weren't successful saving, so show an error message.
-        QString warning = QString(
-                QObject::tr("<p><b>The document \"%1\" could not be saved.</b></p>"
-                "<p>%2</p>")).arg(fileInfo.fileName()).arg(errorMessage);
+        showSaveError(outputFilename, errorMessage);
+    }
+}
 
-        QWidget *window = views().first()->window();
-        QMessageBox message(QMessageBox::Warning, "Error Saving File",
-                            warning, QMessageBox::Ok, window);
-        message.setWindowModality(Qt::WindowModal);
-        message.exec();
+
+void Canvas::showSaveError(const QString& outputFilename,
+        const QString& errorMessage)
+{
+    // We weren't successful saving, so show an error message.
+    QString warning = QString(
+            QObject::tr("<p><b>The document \"%1\" could not be saved.</b></p>"
+            "<p>%2</p>")).arg(QFileInfo(outputFilename).fileName()).
+            arg(errorMessage);
+
+    QWidget *window = views().first()->window();
+    QMessageBox message(QMessageBox::Warning, "Error Saving File",
+                        warning, QMessageBox::Ok, window);
+    message.setWindowModality(Qt::WindowModal);
+    message.exec();
+}
+
+
+// Writes a diagram snapshot to file, then reports back to the canvas on
+// the GUI thread.
+class BackgroundSaveTask : public QRunnable
+{
+    public:
+        BackgroundSaveTask(Canvas *canvas, DiagramWriter *snapshot,
+                const QString& outputFilename, quint64 editCount)
+            : m_canvas(canvas),
+              m_snapshot(snapshot),
+              m_output_filename(outputFilename),
+              m_edit_count(editCount)
+        {
+        }
+        ~BackgroundSaveTask()
+        {
+            delete m_snapshot;
+        }
+        void run(void)
+        {
+            QString errorMessage;
+            bool successful = m_snapshot->save(m_output_filename,
+                    errorMessage);
+            // The canvas waits for this task before being destroyed.
+            QMetaObject::invokeMethod(m_canvas, "backgroundSaveFinished",
+                    Qt::QueuedConnection, Q_ARG(QString, m_output_filename),
+                    Q_ARG(bool, successful), Q_ARG(QString, errorMessage),
+                    Q_ARG(quint64, m_edit_count));
+        }
+
+    private:
+        Canvas *m_canvas;
+        DiagramWriter *m_snapshot;
+        QString m_output_filename;
+        quint64 m_edit_count;
+};
+
+
+void Canvas::saveDiagramInBackground(const QString& outputFilename)
+{
+    QFileInfo fileInfo(outputFilename);
+    PluginFileIOFactory *fileIOFactory = sharedPluginFileIOFactory();
+    if (!fileIOFactory->canWriteDiagram(fileInfo))
+    {
+        saveDiagram(outputFilename);
+        return;
+    }
+
+    // Building the snapshot is the only part done on this thread.
+    DiagramWriter *snapshot = new DiagramWriter();
+    QString errorMessage;
+    if (!fileIOFactory->writeDiagram(this, fileInfo, *snapshot,
+            errorMessage))
+    {
+        delete snapshot;
+        showSaveError(outputFilename, errorMessage);
+        return;
+    }
+
+    m_save_thread_pool->start(new BackgroundSaveTask(this, snapshot,
+            outputFilename, m_edit_count));
+}
+
+
+void Canvas::waitForBackgroundSaves(void)
+{
+    m_save_thread_pool->waitForDone();
+    // Each save reports back with a queued call, so deliver those now
+    // rather than when control returns to the event loop.
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+
+void Canvas::backgroundSaveFinished(const QString& outputFilename,
+        bool successful, const QString& errorMessage, quint64 editCount)
+{
+    if (!successful)
+    {
+        showSaveError(outputFilename, errorMessage);
+        return;
+    }
+
+    this->setFilename(outputFilename);
+    // The diagram is only clean if it hasn't been edited since the
+    // snapshot was taken.  The undo index alone can't tell, since edits
+    // merged into the current macro or an undo followed by a new edit
+    // leave it unchanged.
+    if (m_edit_count == editCount)
+    {
+        undoStack()->setClean();
     }
 }
 
@@ -33,6 +33,8 @@
 #include <QAction>
 #include <QEvent>
 #include <QList>
+#include <QHash>
+#include <QSet>
 #include <QStack>
 #include <QString>
 #include <QDomDocument>
@@ -47,9 +49,11 @@ class QUndoStack;
 class QUndoCommand;
 class QFileInfo;
 class QParallelAnimationGroup;
+class QThreadPool;
 
 class BuiltinLayoutFileIOPlugin;
 class BuiltinSVGFileIOPlugin;
+class BuiltinBinaryFileIOPlugin;
 
 
 namespace Avoid {
@@ -63,6 +67,9 @@ class Graph;
 }
 
 class CanvasItem;
+class ShapeObj;
+class Connector;
+class Indicator;
 class Guideline;
 class GraphLayout;
 class SelectionResizeHandle;
@@ -165,6 +172,12 @@ class Canvas : public QGraphicsScene
         void setFilename(QString filename);
         QString filename(void);
         QList<CanvasItem *> items(void) const;
+        // The shapes, connectors and indicators on the canvas, in no
+        // particular order.  Use these rather than filtering items()
+        // where stacking order doesn't matter.
+        QList<ShapeObj *> shapes(void) const;
+        QList<Connector *> connectors(void) const;
+        QList<Indicator *> indicators(void) const;
         QList<CanvasItem *> selectedItems(void) const;
         void setSelection(const QList<CanvasItem *>& newSelection);
         void postDiagramLoad(void);
@@ -219,6 +232,27 @@ class Canvas : public QGraphicsScene
         bool overlayRouterObstacles(void) const;
         bool overlayRouterVisGraph(void) const;
         bool overlayRouterOrthogonalVisGraph(void) const;
+        bool overlayFrameRate(void) const;
+
+        // How much detail items should be painted with.  When zoomed out
+        // below the simplified threshold, shapes are painted as plain
+        // boxes and connectors as polylines without arrowheads.  Below
+        // the labels threshold, labels are not painted.  Thresholds are
+        // view scale factors, and a threshold of zero is never reached.
+        enum RenderDetail {
+            RenderSimplified,
+            RenderWithoutLabels,
+            RenderFullDetail
+        };
+        RenderDetail renderDetail(const QPainter *painter) const;
+        double levelOfDetailSimplifiedThreshold(void) const;
+        double levelOfDetailLabelsThreshold(void) const;
+        void setLevelOfDetailThresholds(const double simplifiedBelow,
+                const double labelsBelow);
+        // Whether shapes keep a rasterisation of themselves to paint
+        // from while they are unchanged.
+        bool levelOfDetailCaching(void) const;
+        void setLevelOfDetailCaching(const bool value);
         Actions& getActions(void);
         QString assignStringId(QString id);
         uint assignInternalId(void);
@@ -227,17 +261,41 @@ class Canvas : public QGraphicsScene
 
         void setLayoutSuspended(bool suspend);
         bool isLayoutSuspended(void) const;
+        // Lays out the diagram and routes its connectors to convergence
+        // before returning, for use without a view or event loop.
+        // Automatic layout is left suspended afterwards.
+        void runBatchLayout(void);
 
         void setDraggedItem(CanvasItem *item);
         bool layoutRunningAndNotProcessingUpdates(void) const;
+        // Starts a step of a layout update.  Until the step ends with
+        // updateConnectorsForLayout(), moved shapes are only noted rather
+        // than passed to the router.
+        void beginLayoutStep(void);
+        // Ends a layout step.  Passes shapes that have moved more than a
+        // pixel since they were last routed, or every moved shape on the
+        // final step, to the router in one transaction and then reroutes
+        // the connectors this affects.
+        void updateConnectorsForLayout(const bool finalStep = true);
 
         QSvgRenderer *svgRenderer(void) const;
         QUndoStack *undoStack(void) const;
         UndoMacro *currentUndoMacro(void);
         UndoMacro *beginUndoMacro(const QString& text);
         void endUndoMacro(void);
+        // Once the undo history uses more than this many bytes, the
+        // oldest undo steps are dropped.
+        qint64 undoMemoryLimit(void) const;
+        void setUndoMemoryLimit(const qint64 bytes);
 
         void saveDiagram(const QString& outputFilename);
+        // Takes a snapshot of the diagram and writes it to the file on a
+        // background thread, so editing can carry on meanwhile.  Falls
+        // back to saveDiagram() for formats that can't be snapshotted.
+        void saveDiagramInBackground(const QString& outputFilename);
+        // Blocks until every background save has been written and
+        // reported, so the undo stack is clean if they succeeded.
+        void waitForBackgroundSaves(void);
         const QList<QColor> interferingConnectorColours(void) const;
         double visualPageBuffer(void) const;
         bool useGmlClusters(void) const;
@@ -299,6 +357,7 @@ class Canvas : public QGraphicsScene
         void setOverlayRouterObstacles(const bool value);
         void setOverlayRouterVisGraph(const bool value);
         void setOverlayRouterOrthogonalVisGraph(const bool value);
+        void setOverlayFrameRate(const bool value);
 
         // When rendering for printing, constraint indicators, selection
         // cues and other decorations are not painted.  This mode is used
@@ -331,6 +390,10 @@ class Canvas : public QGraphicsScene
         void optChangedLayeredAlignmentPosition(LayeredAlignment pos);
 
     private slots:
+        void backgroundSaveFinished(const QString& outputFilename,
+                bool successful, const QString& errorMessage,
+                quint64 editCount);
+        void countEdit(void);
         void processLayoutUpdateEvent(void);
         void processLayoutFinishedEvent(void);
         void selectionChangeTriggers(void);
@@ -342,27 +405,34 @@ class Canvas : public QGraphicsScene
     private:
         bool loadDiagram(const QString& filename);
         bool idIsUnique(QString id) const;
+        void indexItem(CanvasItem *item);
+        void unindexItem(CanvasItem *item);
         void recursiveMapIDs(QDomNode start, const QString& ns, int pass);
         bool singlePropUpdateID(QDomElement& node, const QString& prop,
                 const QString ns = QString());
         QDomElement writeLayoutOptionsToDomElement(QDomDocument& doc) const;
         void loadLayoutOptionsFromDomElement(const QDomElement& options);
         void setSvgRendererForFile(const QString& filename);
+        void showSaveError(const QString& outputFilename,
+                const QString& errorMessage);
         void recursiveReadSVG(const QDomNode& start, const QString& dunnartNS,
                 int pass);
+        static bool isExternalNamespace(const QString& ns);
         void setInterferingConnectorColours(const QString colourListString);
         void hideSelectionResizeHandles(void);
         void createIndicatorHighlightCache(void);
         void clearIndicatorHighlights(const bool clearCache = false);
         void glueObjectsToIndicators(void);
         bool hasVisibleOverlays(void) const;
-        void updateConnectorsForLayout(void);
 
         double m_visual_page_buffer;
         QString m_filename;
         QTimer *m_layout_update_timer;
         QTimer *m_layout_finish_timer;
         bool m_processing_layout_updates;
+        bool m_in_layout_step;
+        // Shapes moved during layout steps but not yet passed to the router.
+        QSet<ShapeObj *> m_router_moved_shapes;
         QString m_clipboard;
         QRectF m_page;
         QRectF m_expanded_page;
@@ -373,6 +443,16 @@ class Canvas : public QGraphicsScene
         QStack<QString> m_status_messages;
         uint m_max_string_id;
         uint m_max_internal_id;
+        // Indexes of the items on the canvas, kept up to date by
+        // CanvasItem as items are added and removed.  Each shape,
+        // connector or indicator is also in one of the typed lists, at the
+        // position given by m_typed_item_positions.
+        QHash<QString, CanvasItem *> m_items_by_id;
+        QHash<uint, CanvasItem *> m_items_by_internal_id;
+        QList<ShapeObj *> m_shapes;
+        QList<Connector *> m_connectors;
+        QList<Indicator *> m_indicators;
+        QHash<CanvasItem *, int> m_typed_item_positions;
         gml::Graph *m_gml_graph;
         bool m_use_gml_clusters;
 
@@ -427,6 +507,14 @@ class Canvas : public QGraphicsScene
         CanvasItem *m_lone_selected_item;
         QUndoStack *m_undo_stack;
         UndoMacro *m_current_undo_macro;
+        qint64 m_undo_memory_limit;
+        // Finished undo macros on the stack that haven't been discarded,
+        // oldest first, and the memory they use between them.
+        QList<UndoMacro *> m_undo_macros_kept;
+        qint64 m_undo_memory_usage;
+        // Bumped on every undo, redo or recorded edit, including those
+        // merged into the current undo macro without moving the stack.
+        quint64 m_edit_count;
 
         QRectF m_selection_shapes_bounding_rect;
         QVector<SelectionResizeHandle *> m_selection_resize_handles;
@@ -438,12 +526,18 @@ class Canvas : public QGraphicsScene
         bool m_overlay_router_obstacles;
         bool m_overlay_router_visgraph;
         bool m_overlay_router_orthogonal_visgraph;
+        bool m_overlay_frame_rate;
+        double m_lod_simplified_threshold;
+        double m_lod_labels_threshold;
+        bool m_lod_caching;
         bool m_rendering_for_printing;
         int m_edit_mode;
         bool m_routing_event_posted;
         QFont *m_canvas_font;
         unsigned int m_canvas_font_size;
         QParallelAnimationGroup *m_animation_group;
+        // Runs background saves one at a time, in the order requested.
+        QThreadPool *m_save_thread_pool;
 
 #ifdef FPSTIMER
         QElapsedTimer m_convergence_timer;
@@ -451,8 +545,11 @@ class Canvas : public QGraphicsScene
         bool m_convergence_timer_running;
 #endif
 
+        friend class CanvasItem;
+        friend class ShapeObj;
         friend class GraphLayout;
         friend class GraphData;
+        friend class DiagramReader;
         friend class UndoMacro;
         friend class MainWindow;
         friend struct ShapePosInfo;
@@ -460,6 +557,7 @@ class Canvas : public QGraphicsScene
 
         friend class ::BuiltinLayoutFileIOPlugin;
         friend class ::BuiltinSVGFileIOPlugin;
+        friend class ::BuiltinBinaryFileIOPlugin;
 };
 
 
@@ -28,6 +28,7 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QSvgGenerator>
 #include <QStyleOptionGraphicsItem>
+#include <QXmlStreamWriter>
 
 #include "libdunnartcanvas/oldcanvas.h"
 #include "libdunnartcanvas/shape.h"
@@ -187,6 +188,12 @@ void CanvasItem::initWithXMLProperties(Canvas *canvas,
 CanvasItem::~CanvasItem()
 {
     resetQueryModeIllumination(false);
+
+    // Items deleted while still on the canvas don't get an ItemSceneChange.
+    if (canvas())
+    {
+        canvas()->unindexItem(this);
+    }
 }
 
 
@@ -356,7 +363,9 @@ void CanvasItem::setIdString(const QString& id)
 {
     if (canvas())
     {
+        canvas()->unindexItem(this);
         m_string_id = canvas()->assignStringId(id);
+        canvas()->indexItem(this);
     }
     else
     {
@@ -452,15 +461,40 @@ bool nodeHasAttribute(const QDomElement& node, const QString& ns,
 }
 
 
+static QStringList oldConnectorTypes(void)
+{
+    QStringList oldConnTypes;
+    oldConnTypes << "connStraight" << "connAvoidCurved" << "connAvoidPoly" <<
+                    "connOrthogonal" << "connAvoidOrtho";
+    return oldConnTypes;
+}
+
+
+int CanvasItem::loadPassForType(const QString& type)
+{
+    if (type == x_cluster)
+    {
+        return PASS_CLUSTERS;
+    }
+    else if ((type == x_connector) || oldConnectorTypes().contains(type))
+    {
+        return PASS_CONNECTORS;
+    }
+    else if (type == x_constraint)
+    {
+        return PASS_RELATIONSHIPS;
+    }
+    return PASS_SHAPES;
+}
+
+
 CanvasItem *CanvasItem::create(Canvas *canvas, const QDomElement& node,
         const QString& dunnartURI, int pass)
 {
     QString type = nodeAttribute(node, dunnartURI, x_type);
     assert(!type.isEmpty());
 
-    QStringList oldConnTypes;
-    oldConnTypes << "connStraight" << "connAvoidCurved" << "connAvoidPoly" <<
-                    "connOrthogonal" << "connAvoidOrtho";
+    QStringList oldConnTypes = oldConnectorTypes();
 
     CanvasItem *newObj = NULL;
 
@@ -576,13 +610,19 @@ CanvasItem *CanvasItem::create(Canvas *canvas, const QDomElement& node,
 void CanvasItem::addXmlProps(const unsigned int subset, QDomElement& node,
         QDomDocument& doc)
 {
-    Q_UNUSED (doc)
+    XmlElementSnapshot element(node.nodeName());
+    snapshotXmlProps(subset, element);
+    element.addToDomElement(node, doc);
+}
 
+void CanvasItem::snapshotXmlProps(const unsigned int subset,
+        XmlElementSnapshot& element)
+{
     if (subset & XMLSS_IOTHER)
     {
-        newProp(node, "id", idString());
+        newProp(element, "id", idString());
 
-        newProp(node, x_type, itemType());
+        newProp(element, x_type, itemType());
 
         // Add saved properties for props not used by Dunnart
         QList<QByteArray> propertyList = this->dynamicPropertyNames();
@@ -598,15 +638,18 @@ void CanvasItem::addXmlProps(const unsigned int subset, QDomElement& node,
                 prefix = nameParts.at(nameParts.length() - 2);
             }
 
-            if ((prefix == node.prefix()) || (prefix == "svg"))
+            // Item elements are created without a namespace, so have no
+            // prefix of their own.
+            if (prefix.isEmpty() || (prefix == "svg"))
             {
                 // Don't put this attribute in a namespace.
-                newProp(node, localName, this->property(propName).toString());
+                newProp(element, localName,
+                        this->property(propName).toString());
             }
             else
             {
                 // Add attribute in a NS prefix.
-                newProp(node, qualify(prefix, localName),
+                newProp(element, qualify(prefix, localName),
                           this->property(propName).toString());
             }
         }
@@ -623,6 +666,19 @@ QDomElement CanvasItem::to_QDomElement(const unsigned int subset,
 }
 
 
+XmlElementSnapshot CanvasItem::xmlSnapshot(const unsigned int subset)
+{
+    QDomDocument doc;
+    return XmlElementSnapshot(to_QDomElement(subset, doc));
+}
+
+
+void CanvasItem::writeXml(QXmlStreamWriter& writer, const unsigned int subset)
+{
+    xmlSnapshot(subset).write(writer);
+}
+
+
 QVariant CanvasItem::itemChange(GraphicsItemChange change,
         const QVariant &value)
 {
@@ -636,6 +692,7 @@ QVariant CanvasItem::itemChange(GraphicsItemChange change,
         {
             // Being removed from the canvas
             routerRemove();
+            canvas()->unindexItem(this);
         }
     }
     else if (change == QGraphicsItem::ItemSceneHasChanged)
@@ -645,6 +702,7 @@ QVariant CanvasItem::itemChange(GraphicsItemChange change,
             // Give this item an id if it doesn't have one.
             m_string_id = canvas()->assignStringId(m_string_id);
             m_internal_id = canvas()->assignInternalId();
+            canvas()->indexItem(this);
             // Being added to canvas
             routerAdd();
         }
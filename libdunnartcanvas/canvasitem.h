@@ -43,8 +43,10 @@
 #include <set>
 #include <iostream>
 
+#include "libdunnartcanvas/xmlelementsnapshot.h"
 
 class QGraphicsSceneMouseEvent;
+class QXmlStreamWriter;
 
 namespace dunnart {
 
@@ -178,8 +180,18 @@ class CanvasItem: public QGraphicsSvgItem
         void sendToBack(void);
         static CanvasItem *create(Canvas *canvas, const QDomElement& node, 
                 const QString& dunnartURI, int pass);
+        // The load pass in which create() builds items of the given type.
+        static int loadPassForType(const QString& type);
         virtual QDomElement to_QDomElement(const unsigned int subset, 
                 QDomDocument& doc);
+        // Records the same XML as to_QDomElement() as plain values, which
+        // may be written from another thread.  By default this builds the
+        // element with to_QDomElement() and copies it.  Shapes and
+        // connectors build the snapshot directly instead.
+        virtual XmlElementSnapshot xmlSnapshot(const unsigned int subset);
+        // Writes the same XML as to_QDomElement() straight to the given
+        // stream, from xmlSnapshot().
+        void writeXml(QXmlStreamWriter& writer, const unsigned int subset);
         virtual void cascade_distance(int dist, unsigned int dir,
                 CanvasItem **path) = 0;
         void update_after_unhide(void);
@@ -238,8 +250,13 @@ class CanvasItem: public QGraphicsSvgItem
 
         QVariant itemChange(QGraphicsItem::GraphicsItemChange change,
                 const QVariant &value);
-        virtual void addXmlProps(const unsigned int subset, QDomElement& node,
+        void addXmlProps(const unsigned int subset, QDomElement& node,
                 QDomDocument& doc);
+        // Adds the same attributes and children as addXmlProps() to an
+        // element snapshot.  Subclasses add their own properties here,
+        // and addXmlProps() copies them to the DOM.
+        virtual void snapshotXmlProps(const unsigned int subset,
+                XmlElementSnapshot& element);
         virtual QAction *buildAndExecContextMenu(
                 QGraphicsSceneMouseEvent *event, QMenu& menu);
 
@@ -350,6 +367,14 @@ void newProp(QDomElement& node, const QString& prop, T argument,
     node.setAttribute(prop, value);
 }
 
+template <typename T>
+void newProp(XmlElementSnapshot& element, const QString& prop, T argument,
+        const char *append = "")
+{
+    QString value = QString("%1%2").arg(argument).arg(append);
+    element.setAttribute(prop, value);
+}
+
 
 extern void returnAllInactive(void);
 extern void returnAppropriateConnectors(void);
@@ -159,6 +159,10 @@ CanvasTabWidget::CanvasTabWidget(QMainWindow *window) :
             tr("Routing - Orthogonal visibility graph"), this);
     m_action_overlay_router_orthogonal_visgraph->setCheckable(true);
 
+    m_action_overlay_frame_rate = new QAction(
+            tr("Rendering - Frame rate"), this);
+    m_action_overlay_frame_rate->setCheckable(true);
+
     m_action_overlay_router_raw_routes = new QAction(
             tr("Routing - Initial connector routes"), this);
     m_action_overlay_router_raw_routes->setCheckable(true);
@@ -342,6 +346,11 @@ void CanvasTabWidget::currentChanged(int index)
     m_action_overlay_router_orthogonal_visgraph->setChecked(
             m_canvas->overlayRouterOrthogonalVisGraph());
 
+    m_action_overlay_frame_rate->disconnect();
+    connect(m_action_overlay_frame_rate, SIGNAL(triggered(bool)),
+            m_canvas, SLOT(setOverlayFrameRate(bool)));
+    m_action_overlay_frame_rate->setChecked(m_canvas->overlayFrameRate());
+
     connect(m_canvas, SIGNAL(editModeChanged(int)),
             this, SLOT(currentCanvasEditModeChanged(int)));
 
@@ -384,6 +393,8 @@ bool CanvasTabWidget::closeAllRequest()
     for (int i = 0; i < count(); ++i)
     {
         Canvas *canvas = canvasViewAt(i)->canvas();
+        // A save still being written doesn't leave unsaved changes.
+        canvas->waitForBackgroundSaves();
         if (canvas->undoStack()->isClean() == false)
         {
             dirtyIndexes.push_back(i);
@@ -460,6 +471,7 @@ bool CanvasTabWidget::tabCloseRequested(int index)
 {
     CanvasView *view = static_cast<CanvasView *> (widget(index));
     Canvas *canvas  = view->canvas();
+    canvas->waitForBackgroundSaves();
     bool isClean = canvas->undoStack()->isClean();
 
     if (!isClean)
@@ -484,6 +496,9 @@ bool CanvasTabWidget::tabCloseRequested(int index)
         else if (ret == QMessageBox::Save)
         {
             currentCanvasSave();
+            // The save may be in the background, and must finish before
+            // the canvas can be closed.
+            canvas->waitForBackgroundSaves();
             if (m_window->isWindowModified())
             {
                 // The user cancelled Save dialog, so return.
@@ -507,6 +522,8 @@ void CanvasTabWidget::addDebugOverlayMenuActions(QMenu *overlay_menu)
     overlay_menu->addAction(m_action_overlay_router_orthogonal_visgraph);
     overlay_menu->addAction(m_action_overlay_router_raw_routes);
     overlay_menu->addAction(m_action_overlay_router_display_routes);
+    overlay_menu->addSeparator();
+    overlay_menu->addAction(m_action_overlay_frame_rate);
 }
 
 void CanvasTabWidget::addEditMenuActions(QMenu *edit_menu)
@@ -651,7 +668,8 @@ void CanvasTabWidget::currentCanvasSave(void)
     }
     else
     {
-        currentCanvas()->saveDiagram(filename);
+        // Saving over the current file needn't block editing.
+        currentCanvas()->saveDiagramInBackground(filename);
     }
 }
 
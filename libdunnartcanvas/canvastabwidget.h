@@ -104,6 +104,7 @@ private:
     QAction *m_action_overlay_router_orthogonal_visgraph;
     QAction *m_action_overlay_router_raw_routes;
     QAction *m_action_overlay_router_display_routes;
+    QAction *m_action_overlay_frame_rate;
     QAction *m_action_edit_separator;
     QAction *m_action_edit_separator2;
 };
@@ -28,6 +28,7 @@
 #include <QApplication>
 #include <QScrollBar>
 #include <QMenu>
+#include <QPainter>
 
 #include "libdunnartcanvas/canvasview.h"
 #include "libdunnartcanvas/graphlayout.h"
@@ -42,7 +43,9 @@ CanvasView *canvas_view = NULL;
 
 CanvasView::CanvasView(Canvas *canvas)
     : QGraphicsView(),
-      m_hand_scrolling(false)
+      m_hand_scrolling(false),
+      m_frames_this_second(0),
+      m_frames_per_second(0)
 {
     // We'd like antialiasing.
     setRenderHints(QPainter::Antialiasing);
@@ -188,6 +191,50 @@ void CanvasView::scrollContentsBy(int dx, int dy)
     emit viewportChanged(viewportRect());
 }
 
+void CanvasView::paintEvent(QPaintEvent *event)
+{
+    if ((canvas() == NULL) || !canvas()->overlayFrameRate())
+    {
+        QGraphicsView::paintEvent(event);
+        return;
+    }
+
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    QGraphicsView::paintEvent(event);
+    qint64 frameTime = frameTimer.elapsed();
+
+    // Frames are counted over one second windows.
+    if (!m_frame_rate_timer.isValid())
+    {
+        m_frame_rate_timer.start();
+        m_frames_this_second = 0;
+    }
+    ++m_frames_this_second;
+    if (m_frame_rate_timer.elapsed() >= 1000)
+    {
+        m_frames_per_second = m_frames_this_second;
+        m_frames_this_second = 0;
+        m_frame_rate_timer.restart();
+    }
+
+    drawFrameRate(frameTime);
+}
+
+void CanvasView::drawFrameRate(qint64 frameTime)
+{
+    QString text = QString("%1 fps, %2 ms/frame").arg(m_frames_per_second)
+            .arg(frameTime);
+
+    QPainter painter(viewport());
+    QRect textRect = painter.fontMetrics().boundingRect(text);
+    textRect.moveTopLeft(QPoint(8, 8));
+    painter.fillRect(textRect.adjusted(-4, -2, 4, 2),
+            QColor(255, 255, 255, 200));
+    painter.setPen(Qt::black);
+    painter.drawText(textRect, Qt::AlignLeft, text);
+}
+
 void CanvasView::dropEvent(QDropEvent *event)
 {
     if (canvas()->optStructuralEditingDisabled())
@@ -30,6 +30,7 @@
 #define CANVASVIEW_H_
 
 #include <QGraphicsView>
+#include <QElapsedTimer>
 #include <QList>
 
 class QMenu;
@@ -71,6 +72,7 @@ class CanvasView : public QGraphicsView
         virtual QAction *buildAndExecContextMenu(QMouseEvent *event,
                 QMenu& menu);
         virtual void scrollContentsBy(int dx, int dy);
+        virtual void paintEvent(QPaintEvent *event);
         bool handleContextMenuEvent(QMouseEvent * event);
     private slots:
         void adjustSceneRect(QRectF rect);
@@ -79,10 +81,15 @@ class CanvasView : public QGraphicsView
         void editModeChanged(int mode);
     private:
         void zoomToShowRect(const QRectF& rect);
+        void drawFrameRate(qint64 frameTime);
 
         QPoint m_last_mouse_pos;
         bool m_hand_scrolling;
         QTransform m_last_transform;
+        // Frame rate overlay.
+        QElapsedTimer m_frame_rate_timer;
+        int m_frames_this_second;
+        int m_frames_per_second;
 };
 
 
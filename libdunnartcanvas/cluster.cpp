@@ -802,16 +802,25 @@ void Cluster::setLabel(const QString& label)
 
 QDomElement Cluster::to_QDomElement(const unsigned int subset, 
         QDomDocument& doc)
+{
+    QDomElement node = doc.createElement("dunnart:node");
+    xmlSnapshot(subset).addToDomElement(node, doc);
+
+    return node;
+}
+
+
+XmlElementSnapshot Cluster::xmlSnapshot(const unsigned int subset)
 {
     QString value, str;
 
-    QDomElement node = doc.createElement("dunnart:node");
+    XmlElementSnapshot element("dunnart:node");
 
     if (subset & XMLSS_IOTHER)
     {
-        node.setAttribute("dunnart:type", x_cluster);
+        element.setAttribute("dunnart:type", x_cluster);
 
-        newProp(node, "id", idString());
+        newProp(element, "id", idString());
 
         int count = 0;
         for (ShapeList::iterator curr = members.begin(); curr != members.end();
@@ -824,20 +833,20 @@ QDomElement Cluster::to_QDomElement(const unsigned int subset,
             }
             count++;
         }
-        newProp(node, x_contains, value);
+        newProp(element, x_contains, value);
 
         if (m_fill_colour != clusterFillCol)
         {
             value = value.sprintf("%02x%02x%02x%02x", m_fill_colour.red(),
                     m_fill_colour.green(), m_fill_colour.blue(),
                     m_fill_colour.alpha());
-            newProp(node, x_fillCol, value);
+            newProp(element, x_fillCol, value);
         }
         
-        newProp(node, x_rectangular, rectangular);
+        newProp(element, x_rectangular, rectangular);
     }
 
-    return node;
+    return element;
 }
 
 
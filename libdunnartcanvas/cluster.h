@@ -61,6 +61,7 @@ class Cluster: public ShapeObj
 
         QDomElement to_QDomElement(const unsigned int subset,
                 QDomDocument& doc);
+        XmlElementSnapshot xmlSnapshot(const unsigned int subset);
         Avoid::Polygon polygon(void) const;
         virtual void setLabel(const QString& label);
         void recomputeBoundary(void);
@@ -136,9 +136,9 @@ void ConnectionPinInfo::createPin(Avoid::ShapeRef *avoidRef)
     pin->setExclusive(exclusive);
 }
 
-QDomElement ConnectionPinInfo::pinAsDomElement(QDomDocument& doc) const
+XmlElementSnapshot ConnectionPinInfo::pinAsXmlSnapshot(void) const
 {
-    QDomElement node = doc.createElement("pin");
+    XmlElementSnapshot node("pin");
 
     newProp(node, "classID", classId);
     newProp(node, "nodeXProp", xPortionOffset);
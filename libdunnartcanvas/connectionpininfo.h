@@ -28,11 +28,12 @@
 #define CONNECTIONPININFO_H
 
 #include <QString>
-#include <QDomElement>
 
 #include "libavoid/connectionpin.h"
 #include "libavoid/connend.h"
 
+#include "libdunnartcanvas/xmlelementsnapshot.h"
+
 namespace dunnart {
 
 class ConnectionPinInfo
@@ -47,7 +48,7 @@ public:
     void createPin(Avoid::ShapeRef *avoidRef);
     QString writeToString(void) const;
     bool operator==(const ConnectionPinInfo& rhs);
-    QDomElement pinAsDomElement(QDomDocument& doc) const;
+    XmlElementSnapshot pinAsXmlSnapshot(void) const;
 
     static Avoid::ConnDirFlags directionFlagsFromString(const QString& string);
 
@@ -393,45 +393,53 @@ QVariant Connector::itemChange(QGraphicsItem::GraphicsItemChange change,
 }
 
 
-void Connector::addXmlProps(const unsigned int subset, QDomElement& node,
-        QDomDocument& doc)
+XmlElementSnapshot Connector::xmlSnapshot(const unsigned int subset)
 {
-    CanvasItem::addXmlProps(subset, node, doc);
+    XmlElementSnapshot element("dunnart:node");
+    snapshotXmlProps(subset, element);
+    return element;
+}
+
+
+void Connector::snapshotXmlProps(const unsigned int subset,
+        XmlElementSnapshot& element)
+{
+    CanvasItem::snapshotXmlProps(subset, element);
 
     if (subset & XMLSS_IOTHER)
     {
         if (m_ideal_length != canvas()->idealConnectorLength())
         {
-            newProp(node, x_idealLength, m_ideal_length);
+            newProp(element, x_idealLength, m_ideal_length);
         }
 
         if ( ! m_obeys_directed_edge_constraints)
         {
-            newProp(node, x_obeysDirEdgeConstraints,
+            newProp(element, x_obeysDirEdgeConstraints,
                     m_obeys_directed_edge_constraints);
         }
 
         if (m_orthogonal_constraint != NONE)
         {
-            newProp(node, x_orthogonalConstraint,
+            newProp(element, x_orthogonalConstraint,
                     m_orthogonal_constraint);
         }
 
         if (m_routing_type != polyline)
         {
-            newProp(node, "routingType",
+            newProp(element, "routingType",
                       valueStringForEnum("RoutingType", m_routing_type));
         }
 
         if (m_arrow_head_type != normal)
         {
-            newProp(node, "arrowHeadType",
+            newProp(element, "arrowHeadType",
                       valueStringForEnum("ArrowHeadType", m_arrow_head_type));
         }
 
         if (m_is_directed)
         {
-            newProp(node, x_directed, m_is_directed);
+            newProp(element, x_directed, m_is_directed);
         }
 
         if (m_colour != defaultConnLineCol)
@@ -439,17 +447,17 @@ void Connector::addXmlProps(const unsigned int subset, QDomElement& node,
             QString value;
             value = value.sprintf("%02x%02x%02x%02x", m_colour.red(),
                     m_colour.green(), m_colour.blue(), m_colour.alpha());
-            newProp(node, x_lineCol, value);
+            newProp(element, x_lineCol, value);
         }
         
-        write_libavoid_path(node, doc);
+        write_libavoid_path(element);
 
         char value[40];
         // also add line style
         if (m_dashed_stroke)
         {
             strcpy(value, "dashed");
-            newProp(node, "LineStyle", value);
+            newProp(element, "LineStyle", value);
         }
     }
 
@@ -457,40 +465,40 @@ void Connector::addXmlProps(const unsigned int subset, QDomElement& node,
     {
         if (m_src_pt.shape)
         {
-            newProp(node, x_srcID, m_src_pt.shape->idString());
+            newProp(element, x_srcID, m_src_pt.shape->idString());
             if (m_src_pt.pinClassID != CENTRE_CONNECTION_PIN)
             {
-                newProp(node, x_srcPinID, m_src_pt.pinClassID);
+                newProp(element, x_srcPinID, m_src_pt.pinClassID);
             }
         }
         else
         {
-            newProp(node, x_srcID, 0);
+            newProp(element, x_srcID, 0);
         }
 
-        newProp(node, x_srcX, m_src_pt.x);
-        newProp(node, x_srcY, m_src_pt.y);
+        newProp(element, x_srcX, m_src_pt.x);
+        newProp(element, x_srcY, m_src_pt.y);
 
         if (m_dst_pt.shape)
         {
-            newProp(node, x_dstID, m_dst_pt.shape->idString());
+            newProp(element, x_dstID, m_dst_pt.shape->idString());
             if (m_dst_pt.pinClassID != CENTRE_CONNECTION_PIN)
             {
-                newProp(node, x_dstPinID, m_dst_pt.pinClassID);
+                newProp(element, x_dstPinID, m_dst_pt.pinClassID);
             }
         }
         else
         {
-            newProp(node, x_dstID, 0);
+            newProp(element, x_dstID, 0);
         }
-        newProp(node, x_dstX, m_dst_pt.x);
-        newProp(node, x_dstY, m_dst_pt.y);
+        newProp(element, x_dstX, m_dst_pt.x);
+        newProp(element, x_dstY, m_dst_pt.y);
     }
 
     if (subset & XMLSS_XMOVE)
     {
-        newProp(node, x_xPos, x());
-        newProp(node, x_yPos, y());
+        newProp(element, x_xPos, x());
+        newProp(element, x_yPos, y());
     }
 }
 
@@ -1456,6 +1464,30 @@ void Connector::paint(QPainter *painter,
     painter->drawRect(boundingRect());
 #endif
     bool showDecorations = canvas() && ! canvas()->isRenderingForPrinting();
+    Canvas::RenderDetail detail = (canvas()) ?
+            canvas()->renderDetail(painter) : Canvas::RenderFullDetail;
+
+    if (detail == Canvas::RenderSimplified)
+    {
+        // Zoomed well out, so just draw the route as a polyline, with
+        // the control points of any curves standing in for the curves.
+        QPolygonF polyline;
+        for (size_t i = 0; i < m_offset_route.size(); ++i)
+        {
+            polyline << QPointF(m_offset_route.ps[i].x,
+                    m_offset_route.ps[i].y);
+        }
+        QPen pen(m_colour);
+        pen.setCosmetic(true);
+        if ( isSelected() && showDecorations )
+        {
+            pen.setColor(QColor(0, 255, 255));
+        }
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(pen);
+        painter->drawPolyline(polyline);
+        return;
+    }
 
     // Draw downward constraint indicator:
     if ( m_has_downward_constraint && showDecorations &&
@@ -1529,6 +1561,11 @@ void Connector::paint(QPainter *painter,
         painter->drawPath(m_arrow_path);
     }
 
+    if ((detail != Canvas::RenderFullDetail) || m_label.isEmpty())
+    {
+        return;
+    }
+
     // Draw the connector's label.
     // XXX We need to work on positioning labels.
     painter->setPen(Qt::black);
@@ -1707,10 +1744,8 @@ QAction *Connector::buildAndExecContextMenu(QGraphicsSceneMouseEvent *event,
 }
 
 
-void Connector::write_libavoid_path(QDomElement& node, QDomDocument& doc)
+void Connector::write_libavoid_path(XmlElementSnapshot& element)
 {
-    Q_UNUSED (doc)
-
     QString pathStr;
     QString str;
     const Avoid::PolyLine& route = avoidRef->route();
@@ -1730,7 +1765,7 @@ void Connector::write_libavoid_path(QDomElement& node, QDomDocument& doc)
     
     if (!pathStr.isEmpty())
     {
-        newProp(node, x_libavoidPath, pathStr);
+        newProp(element, x_libavoidPath, pathStr);
     }
 
     const Avoid::PolyLine& displayRoute = avoidRef->displayRoute();
@@ -1742,7 +1777,7 @@ void Connector::write_libavoid_path(QDomElement& node, QDomDocument& doc)
     }
     if (!pathStr.isEmpty())
     {
-        newProp(node, "path", pathStr);
+        newProp(element, "path", pathStr);
     }
 }
 
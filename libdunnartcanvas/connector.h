@@ -175,8 +175,9 @@ class Connector : public CanvasItem
 
         void setRoutingCheckPoints(const QList<QPointF>& checkpoints);
         void forceReroute(void);
-        virtual void addXmlProps(const unsigned int subset, QDomElement& node,
-                QDomDocument& doc);
+        virtual XmlElementSnapshot xmlSnapshot(const unsigned int subset);
+        virtual void snapshotXmlProps(const unsigned int subset,
+                XmlElementSnapshot& element);
         QPair<CPoint, CPoint> get_connpts(void) const;
         void disconnect_from(ShapeObj *shape, uint pinClassID = 0);
         QPair<ShapeObj *, ShapeObj *> getAttachedShapes(void);
@@ -193,8 +194,7 @@ class Connector : public CanvasItem
         void applyNewRoute(const Avoid::Polygon& route);
         void applyNewRoute(const Avoid::PolyLine& route, bool updateLibavoid);
         void updateFromLibavoid(void);
-        virtual void write_libavoid_path(QDomElement& node,
-                QDomDocument& doc);
+        virtual void write_libavoid_path(XmlElementSnapshot& element);
         QRectF boundingRect(void) const;
         QPainterPath shape() const;
         void paint(QPainter *painter,
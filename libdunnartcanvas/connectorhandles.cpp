@@ -194,10 +194,9 @@ void ConnectorEndpointHandle::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     Avoid::ShapeRef *containingShapeRef = canvas()->router()->shapeContainingPoint(
             Avoid::Point(mousePoint.x(), mousePoint.y()));
     ShapeObj *containingShape = NULL;
-    foreach (CanvasItem *item, m_conn->canvas()->items())
+    foreach (ShapeObj *shape, m_conn->canvas()->shapes())
     {
-        ShapeObj *shape = dynamic_cast<ShapeObj *> (item);
-        if (shape && (shape != otherEndShape) &&
+        if ((shape != otherEndShape) &&
                 (shape->avoidRef == containingShapeRef))
         {
             containingShape = shape;
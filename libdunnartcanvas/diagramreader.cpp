@@ -0,0 +1,284 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#include <QXmlStreamReader>
+
+#include "libdunnartcanvas/diagramreader.h"
+#include "libdunnartcanvas/canvasitem.h"
+
+#include "libavoid/router.h"
+
+namespace dunnart {
+
+
+static bool isLayoutOptions(const QDomElement& element)
+{
+    return (element.localName() == "options") &&
+            (element.prefix() == x_dunnartNs);
+}
+
+static bool isProOrigamiIdentification(const QDomElement& element)
+{
+    return (element.localName() == "identification") &&
+            (element.prefix() == "proorigami");
+}
+
+static bool isDunnartNode(const QDomElement& element)
+{
+    return (element.localName() == "node") &&
+            (element.prefix() == x_dunnartNs);
+}
+
+
+DiagramReader::DiagramReader(Canvas *canvas)
+    : m_canvas(canvas)
+{
+}
+
+
+DiagramReader::~DiagramReader()
+{
+}
+
+
+bool DiagramReader::read(QIODevice *device, QString& errorMessage)
+{
+    QXmlStreamReader reader(device);
+    return readStream(reader, errorMessage);
+}
+
+
+bool DiagramReader::read(const QString& content, QString& errorMessage)
+{
+    QXmlStreamReader reader(content);
+    return readStream(reader, errorMessage);
+}
+
+
+bool DiagramReader::readStream(QXmlStreamReader& reader,
+        QString& errorMessage)
+{
+    // The elements currently open, innermost last.  Elements outside any
+    // kept element are not needed once started, so are null here.
+    QList<QDomElement> open;
+    QList<bool> kept;
+
+    while (!reader.atEnd())
+    {
+        reader.readNext();
+        QDomElement parent = (open.isEmpty()) ? QDomElement() : open.last();
+
+        if (reader.isStartElement())
+        {
+            QDomElement element = elementFromReader(reader);
+            bool keep = startElement(element);
+            if (!parent.isNull())
+            {
+                parent.appendChild(element);
+            }
+            open.append((keep || !parent.isNull()) ? element : QDomElement());
+            kept.append(keep);
+        }
+        else if (reader.isEndElement())
+        {
+            QDomElement element = open.takeLast();
+            if (kept.takeLast())
+            {
+                // A kept element inside another is part of that element
+                // too, so is passed on as a copy.
+                bool nested = !open.isEmpty() && !open.last().isNull();
+                readElement((nested) ?
+                        element.cloneNode().toElement() : element);
+            }
+        }
+        else if (!parent.isNull())
+        {
+            if (reader.isCDATA())
+            {
+                parent.appendChild(m_fragments.createCDATASection(
+                        reader.text().toString()));
+            }
+            else if (reader.isCharacters() && !reader.isWhitespace())
+            {
+                parent.appendChild(m_fragments.createTextNode(
+                        reader.text().toString()));
+            }
+            else if (reader.isComment())
+            {
+                parent.appendChild(m_fragments.createComment(
+                        reader.text().toString()));
+            }
+        }
+    }
+
+    if (reader.hasError())
+    {
+        errorMessage = QString("%1:%2: %3").arg(reader.lineNumber()).
+                arg(reader.columnNumber()).arg(reader.errorString());
+        return false;
+    }
+
+    finishReading();
+    return true;
+}
+
+
+void DiagramReader::readElementTree(QDomElement& element, bool insideKept)
+{
+    bool keep = startElement(element);
+    for (QDomElement child = element.firstChildElement(); !child.isNull();
+            child = child.nextSiblingElement())
+    {
+        readElementTree(child, insideKept || keep);
+    }
+    if (keep)
+    {
+        readElement((insideKept) ?
+                element.cloneNode().toElement() : element);
+    }
+}
+
+
+void DiagramReader::finishReading(void)
+{
+    // Cause shapes to be added before clusters try and reference them.
+    m_canvas->router()->processTransaction();
+
+    for (int pass = PASS_SHAPES + 1; pass < PASS_LAST; ++pass)
+    {
+        foreach (const DeferredItem& item, m_deferred[pass])
+        {
+            createItem(item.element, item.dunnartNs, pass);
+        }
+        m_deferred[pass].clear();
+    }
+}
+
+
+QDomElement DiagramReader::elementFromReader(const QXmlStreamReader& reader)
+{
+    QDomElement element = m_fragments.createElementNS(
+            reader.namespaceUri().toString(),
+            reader.qualifiedName().toString());
+
+    foreach (const QXmlStreamAttribute& attribute, reader.attributes())
+    {
+        element.setAttributeNS(attribute.namespaceUri().toString(),
+                attribute.qualifiedName().toString(),
+                attribute.value().toString());
+    }
+    return element;
+}
+
+
+bool DiagramReader::startElement(QDomElement& element)
+{
+    QString prefix = element.prefix();
+    if (Canvas::isExternalNamespace(prefix))
+    {
+        m_canvas->m_extra_namespaces_map[prefix] = element.namespaceURI();
+    }
+
+    bool keep = false;
+    if (isLayoutOptions(element))
+    {
+        keep = true;
+    }
+    else if (isProOrigamiIdentification(element))
+    {
+        // For Pro-origami diagrams, use orthogonal connectors.
+        m_canvas->m_force_orthogonal_connectors = true;
+        // Don't allow the user to change diagram structure.
+        m_canvas->setOptStructuralEditingDisabled(true);
+        // Prevent overlaps.
+        m_canvas->m_opt_prevent_overlaps = true;
+    }
+    else if ((element.localName() == "svg") && prefix.isEmpty())
+    {
+        m_canvas->loadSVGRootNodeAttributes(element);
+    }
+    else if (Canvas::isExternalNamespace(prefix))
+    {
+        keep = true;
+    }
+
+    return keep || nodeHasAttribute(element, x_dunnartNs, x_type) ||
+            isDunnartNode(element);
+}
+
+
+void DiagramReader::readElement(const QDomElement& element)
+{
+    if (isLayoutOptions(element))
+    {
+        m_canvas->loadLayoutOptionsFromDomElement(element);
+    }
+    else if (Canvas::isExternalNamespace(element.prefix()) &&
+            !isProOrigamiIdentification(element))
+    {
+        // Save nodes for external namespaces to output unchanged on
+        // saving.
+        m_canvas->m_external_node_list.push_back(element);
+    }
+
+    if (nodeHasAttribute(element, x_dunnartNs, x_type))
+    {
+        // A non-Dunnart node with a "dunnart:type" attribute, so other
+        // attributes in the Dunnart namespace describe the item.
+        QString type = nodeAttribute(element, x_dunnartNs, x_type);
+        addItem(element, x_dunnartNs, CanvasItem::loadPassForType(type));
+    }
+    if (isDunnartNode(element))
+    {
+        // A standard dunnart:node node, with attributes in no namespace.
+        QString type = nodeAttribute(element, QString(), x_type);
+        addItem(element, QString(), CanvasItem::loadPassForType(type));
+    }
+}
+
+
+void DiagramReader::createItem(const QDomElement& element,
+        const QString& dunnartNs, int pass)
+{
+    CanvasItem::create(m_canvas, element, dunnartNs, pass);
+}
+
+
+void DiagramReader::addItem(const QDomElement& element,
+        const QString& dunnartNs, int pass)
+{
+    if (pass == PASS_SHAPES)
+    {
+        createItem(element, dunnartNs, pass);
+        return;
+    }
+
+    DeferredItem item;
+    item.element = element;
+    item.dunnartNs = dunnartNs;
+    m_deferred[pass].append(item);
+}
+
+
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
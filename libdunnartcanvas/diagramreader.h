@@ -0,0 +1,114 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+//! @file
+//! DiagramReader class.  Reads a diagram in a single streaming pass.
+
+#ifndef DIAGRAMREADER_H_
+#define DIAGRAMREADER_H_
+
+#include <QDomDocument>
+#include <QList>
+#include <QString>
+
+#include "libdunnartcanvas/canvas.h"
+
+class QIODevice;
+class QXmlStreamReader;
+
+namespace dunnart {
+
+
+//! @brief  Reads a Dunnart diagram with QXmlStreamReader in one pass.
+//!
+//! The file is never parsed into a QDomDocument.  Instead, each element
+//! describing a canvas item is copied, along with its children, into a
+//! small standalone QDomElement, handed to the usual item constructors and
+//! then dropped.  Shapes and indicators are created as soon as they have
+//! been read.  Clusters, connectors and constraints refer to other items
+//! by ID, so their elements are held back and created once the whole file
+//! has been read, cluster before connector before constraint, just as the
+//! load passes of Canvas::recursiveReadSVG() order them.
+//!
+//! By default, this reads Dunnart's annotated SVG.  Subclasses may handle
+//! other formats by overriding startElement(), readElement() and
+//! createItem().
+//!
+class DiagramReader
+{
+    public:
+        DiagramReader(Canvas *canvas);
+        virtual ~DiagramReader();
+
+        //! Reads the diagram from the given device or string.  On failure,
+        //! errorMessage is set to "line:column: reason".  Items read
+        //! before the error are left on the canvas.
+        bool read(QIODevice *device, QString& errorMessage);
+        bool read(const QString& content, QString& errorMessage);
+
+    protected:
+        //! Called with each element once its attributes have been read.
+        //! Returns whether the element should be kept, along with its
+        //! children, and passed to readElement() once complete.
+        virtual bool startElement(QDomElement& element);
+        //! Called with each kept element once it has been read in full.
+        virtual void readElement(const QDomElement& element);
+        //! Creates the item described by element in the given load pass.
+        virtual void createItem(const QDomElement& element,
+                const QString& dunnartNs, int pass);
+
+        //! Creates the item now if it is made in the first load pass, or
+        //! else holds it back until the whole file has been read.
+        void addItem(const QDomElement& element, const QString& dunnartNs,
+                int pass);
+
+        //! For formats not read from XML.  Passes an element that has
+        //! already been built, and each element inside it, through
+        //! startElement() and readElement() as if it had been streamed.
+        void readElementTree(QDomElement& element, bool insideKept = false);
+        //! Creates the items held back by addItem().  Called once every
+        //! element has been read.
+        void finishReading(void);
+
+        Canvas *m_canvas;
+
+    private:
+        bool readStream(QXmlStreamReader& reader, QString& errorMessage);
+        QDomElement elementFromReader(const QXmlStreamReader& reader);
+
+        struct DeferredItem
+        {
+            QDomElement element;
+            QString dunnartNs;
+        };
+
+        // Owner of every element built while reading.  Elements are not
+        // added to it, so each is freed once no longer referenced.
+        QDomDocument m_fragments;
+        QList<DeferredItem> m_deferred[PASS_LAST];
+};
+
+
+}
+#endif // DIAGRAMREADER_H_
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
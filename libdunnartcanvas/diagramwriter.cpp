@@ -0,0 +1,181 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#include <QObject>
+#include <QSaveFile>
+#include <QXmlStreamWriter>
+
+#include "libdunnartcanvas/diagramwriter.h"
+#include "libdunnartcanvas/canvasitem.h"
+
+namespace dunnart {
+
+
+DiagramWriter::DiagramWriter()
+    : m_file(NULL)
+{
+}
+
+
+DiagramWriter::~DiagramWriter()
+{
+    // Discards anything written if commit() was never called.
+    delete m_file;
+}
+
+
+bool DiagramWriter::open(const QString& filename, QString& errorMessage)
+{
+    delete m_file;
+    m_file = new QSaveFile(filename);
+    if ( ! m_file->open(QIODevice::WriteOnly) )
+    {
+        errorMessage = QObject::tr("File could not be opened for writing.");
+        delete m_file;
+        m_file = NULL;
+        return false;
+    }
+    return true;
+}
+
+
+bool DiagramWriter::commit(QString& errorMessage)
+{
+    if (m_file == NULL)
+    {
+        errorMessage = QObject::tr("File could not be opened for writing.");
+        return false;
+    }
+
+    bool successful = m_file->commit();
+    if (!successful)
+    {
+        errorMessage = m_file->errorString();
+    }
+    delete m_file;
+    m_file = NULL;
+    return successful;
+}
+
+
+QDomDocument& DiagramWriter::document(void)
+{
+    return m_document;
+}
+
+
+void DiagramWriter::writeText(const QString& text)
+{
+    Piece piece;
+    piece.text = text;
+    if (m_file)
+    {
+        writePiece(m_file, piece);
+    }
+    else
+    {
+        m_pieces.append(piece);
+    }
+}
+
+
+void DiagramWriter::writeNode(const QDomNode& node)
+{
+    writeElement(XmlElementSnapshot(node));
+}
+
+
+void DiagramWriter::writeElement(const XmlElementSnapshot& element)
+{
+    Piece piece;
+    piece.element = element;
+    if (m_file)
+    {
+        writePiece(m_file, piece);
+    }
+    else
+    {
+        m_pieces.append(piece);
+    }
+}
+
+
+void DiagramWriter::writeItem(CanvasItem *item, const unsigned int subset)
+{
+    if (m_file)
+    {
+        QXmlStreamWriter writer(m_file);
+        writer.setAutoFormatting(true);
+        item->writeXml(writer, subset);
+        m_file->write("\n");
+    }
+    else
+    {
+        // Only the snapshot is taken here.  It's written by save().
+        Piece piece;
+        piece.element = item->xmlSnapshot(subset);
+        m_pieces.append(piece);
+    }
+}
+
+
+bool DiagramWriter::save(const QString& filename, QString& errorMessage) const
+{
+    QSaveFile file(filename);
+    if ( ! file.open(QIODevice::WriteOnly) )
+    {
+        errorMessage = QObject::tr("File could not be opened for writing.");
+        return false;
+    }
+
+    foreach (const Piece& piece, m_pieces)
+    {
+        writePiece(&file, piece);
+    }
+
+    if (!file.commit())
+    {
+        errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+void DiagramWriter::writePiece(QIODevice *device, const Piece& piece)
+{
+    if (piece.element.isNull())
+    {
+        device->write(piece.text.toUtf8());
+        return;
+    }
+
+    QXmlStreamWriter writer(device);
+    writer.setAutoFormatting(true);
+    piece.element.write(writer);
+    device->write("\n");
+}
+
+
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -0,0 +1,96 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+//! @file
+//! DiagramWriter class.  Writes a diagram file a piece at a time.
+
+#ifndef DIAGRAMWRITER_H_
+#define DIAGRAMWRITER_H_
+
+#include <QDomDocument>
+#include <QList>
+#include <QString>
+
+#include "libdunnartcanvas/xmlelementsnapshot.h"
+
+class QIODevice;
+class QSaveFile;
+
+namespace dunnart {
+
+class CanvasItem;
+
+
+//! @brief  Writes a diagram file a piece at a time.
+//!
+//! A writer that has been opened on a file streams each piece straight to
+//! it, so no more than one item is ever held in memory.  A writer that has
+//! not been opened instead records each piece, as text or as an
+//! XmlElementSnapshot, making an immutable snapshot of the diagram.  The
+//! snapshot holds only plain values, so it can then be written with save()
+//! on another thread, while the diagram carries on being edited.
+//!
+//! The file is written to a temporary file which replaces the original
+//! only once writing has succeeded.
+//!
+class DiagramWriter
+{
+    public:
+        DiagramWriter();
+        ~DiagramWriter();
+
+        //! Starts streaming to the given file.
+        bool open(const QString& filename, QString& errorMessage);
+        //! Finishes streaming, replacing the file with what was written.
+        bool commit(QString& errorMessage);
+
+        //! The document to create any nodes passed to writeNode() with.
+        QDomDocument& document(void);
+        //! Writes markup that is already formatted.
+        void writeText(const QString& text);
+        void writeNode(const QDomNode& node);
+        void writeElement(const XmlElementSnapshot& element);
+        void writeItem(CanvasItem *item, const unsigned int subset);
+
+        //! Writes a recorded snapshot to the given file.  This only reads
+        //! the snapshot, so may be called from any thread.
+        bool save(const QString& filename, QString& errorMessage) const;
+
+    private:
+        struct Piece
+        {
+            QString text;
+            XmlElementSnapshot element;
+        };
+
+        static void writePiece(QIODevice *device, const Piece& piece);
+
+        QDomDocument m_document;
+        QSaveFile *m_file;
+        QList<Piece> m_pieces;
+};
+
+
+}
+#endif // DIAGRAMWRITER_H_
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
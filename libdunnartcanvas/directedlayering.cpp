@@ -0,0 +1,186 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2011  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#include <algorithm>
+
+#include <ogdf/basic/Graph.h>
+#include <ogdf/layered/GreedyCycleRemoval.h>
+#include <ogdf/layered/LongestPathRanking.h>
+
+#include "libdunnartcanvas/directedlayering.h"
+
+namespace dunnart {
+
+namespace {
+
+struct LowerLevel
+{
+    LowerLevel(const std::vector<unsigned>& levels)
+        : levels(levels)
+    {
+    }
+    bool operator()(unsigned a, unsigned b) const
+    {
+        return levels[a] < levels[b];
+    }
+    const std::vector<unsigned>& levels;
+};
+
+}
+
+DirectedLayering::DirectedLayering(unsigned nodeCount,
+        const std::vector<cola::Edge>& edges)
+    : m_acyclic(edges.size(), false),
+      m_implied(edges.size(), false),
+      m_levels(nodeCount, 0),
+      m_max_level(0)
+{
+    ogdf::Graph graph;
+    std::vector<ogdf::node> nodes(nodeCount);
+    for (unsigned i = 0; i < nodeCount; ++i)
+    {
+        nodes[i] = graph.newNode();
+    }
+    std::vector<ogdf::edge> graphEdges(edges.size());
+    for (unsigned i = 0; i < edges.size(); ++i)
+    {
+        graphEdges[i] = graph.newEdge(nodes[edges[i].first],
+                nodes[edges[i].second]);
+    }
+
+    // Remove a small set of edges, including any self-loops, to leave
+    // the graph acyclic.
+    ogdf::GreedyCycleRemoval cycleRemoval;
+    ogdf::List<ogdf::edge> arcSet;
+    cycleRemoval.call(graph, arcSet);
+    ogdf::EdgeArray<bool> inArcSet(graph, false);
+    for (ogdf::ListConstIterator<ogdf::edge> e = arcSet.begin(); e.valid();
+            ++e)
+    {
+        inArcSet[*e] = true;
+    }
+    std::vector<bool> hasEdge(nodeCount, false);
+    for (unsigned i = 0; i < edges.size(); ++i)
+    {
+        m_acyclic[i] = !inArcSet[graphEdges[i]];
+        if (m_acyclic[i])
+        {
+            hasEdge[edges[i].first] = true;
+            hasEdge[edges[i].second] = true;
+        }
+    }
+    for (ogdf::ListConstIterator<ogdf::edge> e = arcSet.begin(); e.valid();
+            ++e)
+    {
+        graph.delEdge(*e);
+    }
+
+    // Plain longest path ranking, with sources at the top.
+    ogdf::LongestPathRanking ranking;
+    ranking.optimizeEdgeLength(false);
+    ranking.separateMultiEdges(false);
+    ogdf::NodeArray<int> rank(graph, 0);
+    ranking.call(graph, rank);
+    for (unsigned i = 0; i < nodeCount; ++i)
+    {
+        if (hasEdge[i])
+        {
+            m_levels[i] = rank[nodes[i]] + 1;
+            m_max_level = std::max(m_max_level, m_levels[i]);
+        }
+    }
+
+    transitivelyReduce(edges);
+}
+
+// Nodes are visited bottom up, building the set of nodes reachable from
+// each.  The children of a node are taken in order of level, so any child
+// reachable through another child is seen after that child and so found to
+// be already reachable.  O(|V||E|/w) for machine word size w.
+void DirectedLayering::transitivelyReduce(const std::vector<cola::Edge>& edges)
+{
+    typedef unsigned long Word;
+    const unsigned bits = sizeof(Word) * 8;
+    const unsigned n = m_levels.size();
+    const unsigned words = (n + bits - 1) / bits;
+
+    std::vector<std::vector<std::pair<unsigned, unsigned> > > children(n);
+    std::vector<unsigned> parentEdges(n, 0);
+    for (unsigned i = 0; i < edges.size(); ++i)
+    {
+        if (m_acyclic[i])
+        {
+            unsigned v = edges[i].second;
+            children[edges[i].first].push_back(
+                    std::make_pair(m_levels[v], i));
+            ++parentEdges[v];
+        }
+    }
+
+    std::vector<unsigned> order;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (m_levels[i] > 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), LowerLevel(m_levels));
+
+    std::vector<std::vector<Word> > reachable(n);
+    for (std::vector<unsigned>::reverse_iterator it = order.rbegin();
+            it != order.rend(); ++it)
+    {
+        unsigned u = *it;
+        std::vector<std::pair<unsigned, unsigned> >& out = children[u];
+        std::sort(out.begin(), out.end());
+        std::vector<Word>& reach = reachable[u];
+        reach.resize(words, 0);
+        for (size_t c = 0; c < out.size(); ++c)
+        {
+            unsigned e = out[c].second;
+            unsigned v = edges[e].second;
+            if (reach[v / bits] & (Word(1) << (v % bits)))
+            {
+                m_implied[e] = true;
+            }
+            else
+            {
+                reach[v / bits] |= Word(1) << (v % bits);
+                const std::vector<Word>& reachV = reachable[v];
+                for (unsigned w = 0; w < reachV.size(); ++w)
+                {
+                    reach[w] |= reachV[w];
+                }
+            }
+            if (--parentEdges[v] == 0)
+            {
+                // Every parent of v has now been visited.
+                std::vector<Word>().swap(reachable[v]);
+            }
+        }
+    }
+}
+
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -0,0 +1,84 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2011  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#ifndef DIRECTEDLAYERING_H
+#define DIRECTEDLAYERING_H
+
+#include <vector>
+
+#include "libcola/cola.h"
+
+namespace dunnart {
+
+/**
+ * Works out which directed edges should be given downward constraints in
+ * the FLOW and LAYERED layout modes, and the level of each node.
+ *
+ * Edges that close cycles are found with OGDF's greedy cycle removal
+ * heuristic, and are the only ones left unconstrained.  The remaining
+ * edges form a DAG, which is ranked by OGDF's longest path ranking, and
+ * transitively reduced: an edge whose ends are already joined by a longer
+ * path of constrained edges needs no separation constraint of its own.
+ */
+class DirectedLayering
+{
+    public:
+        /**
+         * @param nodeCount  the number of nodes.
+         * @param edges      the directed edges, each from its start to
+         *                   the node that should be placed after it.
+         */
+        DirectedLayering(unsigned nodeCount,
+                const std::vector<cola::Edge>& edges);
+
+        /// whether the edge is part of the acyclic subgraph, i.e., can
+        /// be constrained without conflicting with the other edges.
+        bool isAcyclic(unsigned edge) const {
+            return m_acyclic[edge];
+        }
+        /// whether the edge is acyclic but its constraint is implied by
+        /// a path of other acyclic edges.
+        bool isImplied(unsigned edge) const {
+            return m_implied[edge];
+        }
+        /// the level of the node, starting from 1, or 0 if the node has
+        /// no acyclic edges.
+        unsigned level(unsigned node) const {
+            return m_levels[node];
+        }
+        unsigned maxLevel(void) const {
+            return m_max_level;
+        }
+
+    private:
+        void transitivelyReduce(const std::vector<cola::Edge>& edges);
+
+        std::vector<bool> m_acyclic;
+        std::vector<bool> m_implied;
+        std::vector<unsigned> m_levels;
+        unsigned m_max_level;
+};
+
+}
+
+#endif // DIRECTEDLAYERING_H
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
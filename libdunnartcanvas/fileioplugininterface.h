@@ -37,6 +37,7 @@
 namespace dunnart {
 
 class Canvas;
+class DiagramWriter;
 
 //! @brief   Dunnart File IO Plugin Interface.
 //!
@@ -88,11 +89,41 @@ class FileIOPluginInterface
         virtual bool loadDiagramFromFile(Canvas *canvas,
                 const QFileInfo& fileInfo, QString& errorMessage) = 0;
 
+        //! @brief   Returns whether this plugin can save through a
+        //!          DiagramWriter, with writeDiagram().
+        //!
+        //! Only diagrams saved this way can be written on a background
+        //! thread.
+        //!
+        virtual bool canWriteDiagram(void) const
+        {
+            return false;
+        }
+
+        //! @brief   Writes the diagram on a canvas through the given
+        //!          DiagramWriter.
+        //!
+        //! This is called on the GUI thread.  The writer may stream to the
+        //! file, or record a snapshot that is written out later on another
+        //! thread, so everything must be passed to the writer rather than
+        //! written to the file directly.
+        //!
+        //! @returns Whether the diagram was written successfully.
+        //!
+        virtual bool writeDiagram(Canvas *canvas, const QFileInfo& fileInfo,
+                DiagramWriter& writer, QString& errorMessage)
+        {
+            Q_UNUSED (canvas)
+            Q_UNUSED (fileInfo)
+            Q_UNUSED (writer)
+            Q_UNUSED (errorMessage)
+            return false;
+        }
 };
 
 }
 
-#define FileIOPluginInterface_iid "org.dunnart.dunnart.FileIOPluginInterface/1.0"
+#define FileIOPluginInterface_iid "org.dunnart.dunnart.FileIOPluginInterface/1.1"
 
 Q_DECLARE_INTERFACE(dunnart::FileIOPluginInterface, FileIOPluginInterface_iid)
 
@@ -44,6 +44,7 @@
 #include "libdunnartcanvas/handle.h"
 // cola object definitions:
 #include "libcola/cola.h"
+#include "libcola/shortest_paths_cache.h"
 #include "libtopology/topology_graph.h"
 #include "libvpsc/rectangle.h"
 #include "libdunnartcanvas/graphlayout.h"
@@ -55,69 +56,42 @@
 #include "libdunnartcanvas/template-constraints.h"
 #include "libdunnartcanvas/canvasview.h"
 #include "libdunnartcanvas/canvas.h"
-#include "libdunnartcanvas/stronglyconnectedcomponents.h"
+#include "libdunnartcanvas/directedlayering.h"
 
 namespace dunnart {
 
 using namespace std;
 using namespace vpsc;
 
-// Convenience structure for levelAssignmentTraverse algorithm.
+// Convenience structure for the level information of layered layout.
 struct NodeLevelInfo
 {
         NodeLevelInfo()
-            : isRoot(true),
-              sighted(false),
-              level(0),
-              parentVisits(0)
+            : level(0)
         {
         }
 
     std::set<unsigned> children;
     std::set<unsigned> parents;
-    bool isRoot;
-    bool sighted;
     unsigned level;
-    unsigned parentVisits;
 };
 
-// This is similar to Kahn's 1962 topological sorting algorithm.
-// It is O(|V|+|E|).  It starts from each root, incrementing the levels
-// as it moves down the tree.  It waits when it gets to a node with multiple
-// parents and waits until it has been visited from every parent, and then
-// continues from there with the maximum level.
-// It also keeps track of the highestLevel, for later convenience.
-static void levelAssignmentTraverse(unsigned ind, unsigned newLevel,
-        unsigned& maxLevel, std::vector<NodeLevelInfo>& nodeInfo)
-{
-    // Set the node level.
-    nodeInfo[ind].level = qMax(nodeInfo[ind].level, newLevel);
-    maxLevel = qMax(maxLevel, nodeInfo[ind].level);
-    nodeInfo[ind].parentVisits++;
-
-    if (nodeInfo[ind].parentVisits < nodeInfo[ind].parents.size())
-    {
-        // Stop until we've reached this from every parent.
-        return;
-    }
-
-    // Recurse to set node levels of children.
-    for (std::set<unsigned>::iterator it = nodeInfo[ind].children.begin();
-            it != nodeInfo[ind].children.end(); ++it)
-    {
-        levelAssignmentTraverse(*it, nodeInfo[ind].level + 1, maxLevel,
-                nodeInfo);
-    }
-}
-
 
 GraphData::GraphData(Canvas *canvas, bool ignoreEdges, 
-        GraphLayout::Mode mode, bool beautify, unsigned topologyNodesCount) 
+        GraphLayout::Mode mode, bool beautify, unsigned topologyNodesCount,
+        GraphData *previous) 
     : canvas_(canvas),
       topologyNodesCount(topologyNodesCount) 
 {
     Q_UNUSED (beautify)
 
+    if (previous != NULL)
+    {
+        // Indicator constraints of the previous graph are looked up by the
+        // conversions below, and those left over at the end were removed.
+        previousConstraints = previous->indicatorConstraints;
+    }
+
     pageBoundary = QRectF();
     // Note that in Dunnart the coordinates of shapes are their top-left corners
     // while in constrained_majorization_layout we use the centres.
@@ -126,12 +100,12 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
             canvas_->optLayeredAlignmentPosition();
 
     // create nodes
-    QList<CanvasItem *> canvasObjects = canvas->items();
+    QList<ShapeObj *> canvasShapes = canvas->shapes();
     double xMin = DBL_MAX, xMax = -DBL_MAX;
     double yMin = DBL_MAX, yMax = -DBL_MAX;
-    for(int i = 0; i < canvasObjects.size(); ++i)
+    for(int i = 0; i < canvasShapes.size(); ++i)
     {
-        if (ShapeObj *shape = isShapeForLayout(canvasObjects.at(i)))
+        if (ShapeObj *shape = isShapeForLayout(canvasShapes.at(i)))
         {
             size_t nodeIndex = shapeToNode(shape);
 
@@ -146,10 +120,10 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
 
     // Determine cluster heirarchy for shape-based clusters.
     QSet<cola::Cluster *> allShapeClusters;
-    for (int i = 0; i < canvasObjects.size(); ++i)
+    for (int i = 0; i < canvasShapes.size(); ++i)
     {
         // Compute cola::cluster objects and their child nodes.
-        if (ShapeObj *shape = isShapeForLayout(canvasObjects.at(i)))
+        if (ShapeObj *shape = isShapeForLayout(canvasShapes.at(i)))
         {
             QList<ShapeObj *> children = shape->containedShapes();
             if (!children.empty())
@@ -181,11 +155,11 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
             }
         }
     }
-    for (int i = 0; i < canvasObjects.size(); ++i)
+    for (int i = 0; i < canvasShapes.size(); ++i)
     {
         // Assign some cola::cluster objects as child clusters of other
         // cola::cluster objects.
-        if (ShapeObj *shape = isShapeForLayout(canvasObjects.at(i)))
+        if (ShapeObj *shape = isShapeForLayout(canvasShapes.at(i)))
         {
             QList<ShapeObj *> children = shape->containedShapes();
             if (!children.empty())
@@ -215,12 +189,9 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
     vector<Separation*> separationlist;
     if (!ignoreEdges)
     {
-        for (int i = 0; i < canvasObjects.size(); ++i)
+        foreach (Connector *conn, canvas->connectors())
         {
-            if (Connector *conn = dynamic_cast<Connector *> (canvasObjects.at(i)))
-            {    
-                connectorToEdge(conn);
-            }
+            connectorToEdge(conn);
         }
         setupMultiEdges();
 
@@ -246,16 +217,12 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
 
             // Set up downward edge constraints.
             // In the case that the graph isn't a DAG, i.e., has cycles, we
-            // don't constrain any of the edges that form a cycle.  We do
-            // this by computing the strongly connected components for the
-            // Graph and only add a downward edge constraint between two
-            // nodes (connector endpoints) if they are not part of the same
-            // strongly connected component.
-            SCCDetector cycleDetector;
-            QVector<int> sccIndexes =
-                    cycleDetector.stronglyConnectedComponentIndexes(this);
-            std::vector<NodeLevelInfo> nodeInfo(shape_vec.size());
-
+            // leave unconstrained a small set of edges whose removal breaks
+            // every cycle.  Of the rest, an edge only needs a constraint of
+            // its own if it isn't implied by a longer path of other
+            // downward edges.
+            std::vector<cola::Edge> directedEdges;
+            std::vector<uint> directedConns;
             for (uint i = 0; i < conn_vec.size(); ++i)
             {
                 if ( ! conn_vec[i]->isDirected() ||
@@ -268,17 +235,30 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
                 }
 
                 cola::Edge edge = edges[i];
-                if (sccIndexes[edge.first] != sccIndexes[edge.second])
+                unsigned firstIndex = (flipped) ? edge.second : edge.first;
+                unsigned secondIndex = (flipped) ? edge.first : edge.second;
+                directedEdges.push_back(
+                        std::make_pair(firstIndex, secondIndex));
+                directedConns.push_back(i);
+            }
+            DirectedLayering layering(shape_vec.size(), directedEdges);
+            std::vector<NodeLevelInfo> nodeInfo(shape_vec.size());
+
+            for (uint d = 0; d < directedEdges.size(); ++d)
+            {
+                Connector *conn = conn_vec[directedConns[d]];
+                if (layering.isAcyclic(d))
                 {
-#ifdef DIRECTED_CONSTRAINT_DEBUG
-                    cout << "generating directed constraint for conn("
-                            << conn_vec[i]->getId() << ")" << endl;
-#endif
-                    unsigned firstIndex = (flipped) ? edge.second : edge.first;
-                    unsigned secondIndex = (flipped) ? edge.first : edge.second;
+                    unsigned firstIndex = directedEdges[d].first;
+                    unsigned secondIndex = directedEdges[d].second;
 
-                    if (mode == GraphLayout::FLOW)
+                    if ((mode == GraphLayout::FLOW) && 
+                            !layering.isImplied(d))
                     {
+#ifdef DIRECTED_CONSTRAINT_DEBUG
+                        cout << "generating directed constraint for conn("
+                                << conn->getId() << ")" << endl;
+#endif
                         ccs.push_back(new cola::SeparationConstraint(dimension,
                                 firstIndex, secondIndex,
                                 (canvas_->m_ideal_connector_length *
@@ -291,30 +271,23 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
                         // layers together.
                         nodeInfo[firstIndex].children.insert(secondIndex);
                         nodeInfo[secondIndex].parents.insert(firstIndex);
-                        nodeInfo[firstIndex].sighted = true;
-                        nodeInfo[secondIndex].sighted = true;
-                        nodeInfo[secondIndex].isRoot = false;
                     }
-                    conn_vec[i]->setHasDownwardConstraint(true);
+                    conn->setHasDownwardConstraint(true);
                 }
                 else
                 {
-                    conn_vec[i]->setHasDownwardConstraint(false);
+                    conn->setHasDownwardConstraint(false);
                 }
             }
 
             // Apply level constraints.
             if (mode == GraphLayout::LAYERED)
             {
-                // Assign levels for each node.
-                unsigned maxLevel = 0;
+                // Levels for each node, from a longest path ranking.
+                unsigned maxLevel = layering.maxLevel();
                 for (size_t ind = 0; ind < shape_vec.size(); ++ind)
                 {
-                    if (nodeInfo[ind].isRoot && nodeInfo[ind].sighted)
-                    {
-                        levelAssignmentTraverse(ind, nodeInfo[ind].level + 1,
-                                maxLevel, nodeInfo);
-                    }
+                    nodeInfo[ind].level = layering.level(ind);
                 }
 
                 // Create list of nodes in each level and remember the size
@@ -563,14 +536,14 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
     pageBoundary.setTopLeft(pageBoundary.topLeft() + margin);
     pageBoundary.setBottomRight(pageBoundary.bottomRight() - margin);
 
-    generateRectangleConstraints(canvasObjects);
+    generateRectangleConstraints(canvasShapes);
 
-    for (int i = 0; i < canvasObjects.size(); ++i)
+    QList<Indicator *> canvasIndicators = canvas->indicators();
+    for (int i = 0; i < canvasIndicators.size(); ++i)
     {
-        QGraphicsItem *co = canvasObjects.at(i);
+        Indicator *co = canvasIndicators.at(i);
         Guideline *guide = dynamic_cast<Guideline *> (co);
         Distribution *distro = dynamic_cast<Distribution *> (co);
-        Cluster *cluster = dynamic_cast<Cluster *> (co);
         Separation *separation = dynamic_cast<Separation *> (co);
         if (guide) {
             guideToAlignmentConstraint(guide);
@@ -580,7 +553,12 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
             distrolist.push_back(distro);
         } else if (separation) {
             separationlist.push_back(separation);
-        } else if (cluster && !cluster->isCollapsed()) {
+        }
+    }
+    for (int i = 0; i < canvasShapes.size(); ++i)
+    {
+        Cluster *cluster = dynamic_cast<Cluster *> (canvasShapes.at(i));
+        if (cluster && !cluster->isCollapsed()) {
             dunnartClusterToCluster(cluster);
         } 
     }
@@ -597,13 +575,12 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
 
     // Templates rely on the other constraints have been handled
     // (and had variables assigned for them).
-    QList<CanvasItem *> canvas_items = canvas_->items();
-    for (int i = 0; i < canvas_items.size(); ++i)
+    for (int i = 0; i < canvasIndicators.size(); ++i)
     {
         LinearTemplate *linear = 
-                dynamic_cast<LinearTemplate *> (canvas_items.at(i));
+                dynamic_cast<LinearTemplate *> (canvasIndicators.at(i));
         BranchedTemplate *branched =
-                dynamic_cast<BranchedTemplate *> (canvas_items.at(i));
+                dynamic_cast<BranchedTemplate *> (canvasIndicators.at(i));
         if (linear)
         {
             linearTemplateToConstraints(linear);
@@ -634,9 +611,9 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
         // has the shape's center position (its vertex pos) and the offset 
         // from that pos being dependant on the shape's dimensions
         //shape_select(lastFreehand);
-        for(int i = 0; i < canvasObjects.size(); ++i)
+        for(int i = 0; i < canvasShapes.size(); ++i)
         {
-            if (ShapeObj *shape = isShapeForLayout(canvasObjects.at(i)))
+            if (ShapeObj *shape = isShapeForLayout(canvasShapes.at(i)))
             {
                 double w = shape->width();
                 double h = shape->height();  
@@ -665,6 +642,13 @@ GraphData::GraphData(Canvas *canvas, bool ignoreEdges,
            (int) topologyRoutes.size());
 #endif
 
+    constraintChanges.removed = previousConstraints.size();
+    previousConstraints.clear();
+    if (previous != NULL)
+    {
+        releaseReusedConstraints(previous);
+    }
+
     qDebug("GraphData ctor done: ccs=%d, rs=%d",
            (int) ccs.size(), (int) rs.size());
 }
@@ -728,19 +712,100 @@ struct GDCopyClusterVertex {
 };
 
 
+/**
+ * The helper router used by generateRoutes().  It persists across layout
+ * restarts (see takeCachesFrom()) so that only the shapes, clusters and
+ * connectors that have changed since the last time need to be updated.
+ * Objects are keyed by the internal ID of the canvas item they represent.
+ */
+class TopologyRoutesRouter {
+public:
+    TopologyRoutesRouter()
+        : router(new Avoid::Router(Avoid::PolyLineRouting))
+    {
+        // We need to use rubber-banding for generating topologyRoutes.
+        router->RubberBandRouting=true;
+        // Use rotational sweep for point visibility
+        router->UseLeesAlgorithm = true;
+        // Don't use invisibility graph.
+        router->InvisibilityGrph = false;
+    }
+    ~TopologyRoutesRouter() {
+        delete router;
+    }
+    struct Conn {
+        Avoid::ConnRef *ref;
+        // internal IDs of the endpoint shapes
+        std::pair<unsigned, unsigned> ends;
+        // the connector's route on the canvas when last traced or reused
+        Avoid::PolyLine canvasRoute;
+    };
+    Avoid::Router *router;
+    std::map<unsigned, Avoid::ShapeRef *> shapes;
+    std::map<unsigned, Avoid::ClusterRef *> clusters;
+    std::map<unsigned, Conn> conns;
+};
+
+static bool samePolygon(const Avoid::Polygon& a, const Avoid::Polygon& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (!(a.ps[i] == b.ps[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether two routes bend around the same corners of the same shapes, in the
+// same order, wherever those shapes now are.  Bends that aren't at a shape 
+// corner must be at the same position.  The endpoints are ignored, since 
+// they may be at the centres or the boundaries of the shapes they connect.
+static bool sameBends(const Avoid::PolyLine& a, const Avoid::PolyLine& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 1; i + 1 < a.size(); ++i)
+    {
+        const Avoid::Point& p = a.ps[i];
+        const Avoid::Point& q = b.ps[i];
+        if ((p.vn != q.vn) || (p.id != q.id))
+        {
+            return false;
+        }
+        // Vertex numbers 0 to 3 are the corners of the shape with that ID.
+        if ((p.vn > 3) && !(p == q))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void GraphData::generateRoutes() {
     // find feasible topologyRoutes for edges
-    Avoid::Router *router = new Avoid::Router(Avoid::PolyLineRouting);
-    // We need to use rubber-banding for generating topologyRoutes.
-    bool generate_topologyRoutes_with_rubber_banding = true;
-    if (generate_topologyRoutes_with_rubber_banding)
+    if (topologyRouter.get() == NULL)
     {
-        router->RubberBandRouting=true;
+        topologyRouter.reset(new TopologyRoutesRouter());
     }
-    // Use rotational sweep for point visibility
-    router->UseLeesAlgorithm = true;
-    // Don't use invisibility graph.
-    router->InvisibilityGrph = false;
+    Avoid::Router *router = topologyRouter->router;
+    std::map<unsigned, Avoid::ShapeRef *>& shapeRefs = topologyRouter->shapes;
+    std::map<unsigned, Avoid::ClusterRef *>& clusterRefs =
+            topologyRouter->clusters;
+    std::map<unsigned, TopologyRoutesRouter::Conn>& connRefs =
+            topologyRouter->conns;
+    bool generate_topologyRoutes_with_rubber_banding = true;
+
+    // Only shapes that are new or have moved or resized since the last 
+    // time are passed to the router, so only visibility for these needs
+    // to be recomputed.
     std::map<unsigned int, unsigned> idMap;
     for(unsigned i=0;
             i<min(topologyNodesCount,(unsigned int)shape_vec.size());++i) {
@@ -761,11 +826,35 @@ void GraphData::generateRoutes() {
 #ifdef PATHDEBUG
         qDebug("Shape[%3d]:  %g. %g - %g %g", shapeID, x, y, X, Y);
 #endif
-        new Avoid::ShapeRef(router, shapePoly, shapeID);
+        std::map<unsigned, Avoid::ShapeRef *>::iterator found =
+                shapeRefs.find(shapeID);
+        if (found == shapeRefs.end())
+        {
+            shapeRefs[shapeID] = new Avoid::ShapeRef(router, shapePoly, 
+                    shapeID);
+        }
+        else if (!samePolygon(found->second->polygon(), shapePoly))
+        {
+            router->moveShape(found->second, shapePoly);
+        }
+    }
+    for (std::map<unsigned, Avoid::ShapeRef *>::iterator it = 
+            shapeRefs.begin(); it != shapeRefs.end(); )
+    {
+        if (idMap.find(it->first) == idMap.end())
+        {
+            router->deleteShape(it->second);
+            shapeRefs.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
     }
     // process transaction so shapes are added to the router before
     // we try and reference them with the cluster boundaries.
     router->processTransaction();
+    std::set<unsigned> clusterIDs;
     for(unsigned i=0; i < topologyRoutes.size(); ++i)
     {
         topology::Edge *e = topologyRoutes[i];
@@ -780,9 +869,44 @@ void GraphData::generateRoutes() {
             clusterPoly.ps[n] = points[n];
         }
         unsigned int clusterID = dunnartClusters[i]->internalId();
-        new Avoid::ClusterRef(router, clusterPoly, clusterID);
+        clusterIDs.insert(clusterID);
+        std::map<unsigned, Avoid::ClusterRef *>::iterator found =
+                clusterRefs.find(clusterID);
+        if (found == clusterRefs.end())
+        {
+            clusterRefs[clusterID] = 
+                    new Avoid::ClusterRef(router, clusterPoly, clusterID);
+        }
+        else
+        {
+            found->second->setNewPoly(clusterPoly);
+        }
+    }
+    for (std::map<unsigned, Avoid::ClusterRef *>::iterator it = 
+            clusterRefs.begin(); it != clusterRefs.end(); )
+    {
+        if (clusterIDs.find(it->first) == clusterIDs.end())
+        {
+            router->deleteCluster(it->second);
+            clusterRefs.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
     }
  
+    // Connectors already known to the router between the same shapes, whose
+    // route on the canvas still bends around the same shape corners as it
+    // did the last time, just have their endpoints updated, and are 
+    // rubber-banded from their previous routes when the transaction is 
+    // processed.  Others are new, or have since been rerouted differently 
+    // or edited, so they are traced along their current route on the 
+    // canvas.
+    vector<Avoid::ConnRef *> routedConns(conn_vec.size(), 
+            (Avoid::ConnRef *) NULL);
+    std::set<unsigned> connIDs;
+    routeChanges = RouteChanges();
     for(unsigned i=0;i<conn_vec.size();++i) {
         cola::Edge e=edges[i];
         if(e.first>=topologyNodesCount||e.second>=topologyNodesCount)
@@ -790,13 +914,35 @@ void GraphData::generateRoutes() {
         Avoid::ConnRef *connRef;
         unsigned int connID = conn_vec[i]->internalId();
         vpsc::Rectangle* r0=rs[e.first], *r1=rs[e.second];
-        Avoid::Point srcPt(r0->getCentreX(),r0->getCentreY());
-        Avoid::Point dstPt(r1->getCentreX(),r1->getCentreY());
+        ShapeObj *shape0 = getShape(e.first), *shape1 = getShape(e.second);
+        std::pair<unsigned, unsigned> ends(
+                (shape0) ? shape0->internalId() : 0,
+                (shape1) ? shape1->internalId() : 0);
+        connIDs.insert(connID);
+        std::map<unsigned, TopologyRoutesRouter::Conn>::iterator found =
+                connRefs.find(connID);
+        const Avoid::PolyLine& oldRoute = conn_vec[i]->avoidRef->route();
+        if ((found != connRefs.end()) && (found->second.ends == ends) &&
+                sameBends(found->second.canvasRoute, oldRoute))
+        {
+            connRef = found->second.ref;
+            connRef->setEndpoints(
+                    Avoid::Point(r0->getCentreX(),r0->getCentreY()),
+                    Avoid::Point(r1->getCentreX(),r1->getCentreY()));
+            found->second.canvasRoute = oldRoute;
+            routedConns[i] = connRef;
+            ++routeChanges.reused;
+            continue;
+        }
+        else if (found != connRefs.end())
+        {
+            router->deleteConnector(found->second.ref);
+            connRefs.erase(found);
+        }
 #ifdef PATHDEBUG
         qDebug("=Conn[%3d]================================================",
                 connID);
 #endif
-        const Avoid::PolyLine& oldRoute = conn_vec[i]->avoidRef->route();
         if (generate_topologyRoutes_with_rubber_banding && !oldRoute.empty()) {
             Avoid::Point srcPt(r0->getCentreX(),r0->getCentreY());
             Avoid::Point dstPt(oldRoute.ps[1].x,oldRoute.ps[1].y);
@@ -840,6 +986,36 @@ void GraphData::generateRoutes() {
             connRef = new Avoid::ConnRef(router, srcPt, dstPt, connID);
             router->processTransaction();
         }
+        TopologyRoutesRouter::Conn conn;
+        conn.ref = connRef;
+        conn.ends = ends;
+        conn.canvasRoute = oldRoute;
+        connRefs[connID] = conn;
+        routedConns[i] = connRef;
+        ++routeChanges.traced;
+    }
+    for (std::map<unsigned, TopologyRoutesRouter::Conn>::iterator it = 
+            connRefs.begin(); it != connRefs.end(); )
+    {
+        if (connIDs.find(it->first) == connIDs.end())
+        {
+            router->deleteConnector(it->second.ref);
+            connRefs.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    router->processTransaction();
+
+    for(unsigned i=0;i<conn_vec.size();++i) {
+        Avoid::ConnRef *connRef = routedConns[i];
+        if (connRef == NULL)
+        {
+            continue;
+        }
+        cola::Edge e=edges[i];
         const Avoid::PolyLine& route = connRef->route();
         vector<topology::EdgePoint*> eps;
         //cout << "addToPath(vs[" << e.first << "],EdgePoint::CENTRE);" << endl;
@@ -881,7 +1057,6 @@ void GraphData::generateRoutes() {
     }
     assert(topology::assertNoSegmentRectIntersection(topologyNodes,topologyRoutes));
     assert(topology::assertConvexBends(topologyRoutes));
-    delete router;
 }
 /**
  * We construct the constraints as we create the graph, so they need to be cleaned up
@@ -891,6 +1066,90 @@ GraphData::~GraphData() {
     for_each(topologyRoutes.begin(),topologyRoutes.end(),delete_object());
 }
 
+void GraphData::takeCachesFrom(GraphData *previous)
+{
+    shortestPaths = previous->shortestPaths;
+    topologyRouter = previous->topologyRouter;
+}
+
+/**
+ * Looks up the constraint built for an indicator by the previous GraphData.
+ * It can be used again if its key is the same, since then it constrains the
+ * same variables in the same way, and if every constraint it refers to has
+ * itself been reused.
+ * @return the constraint to reuse, or NULL if a new one must be created.
+ */
+cola::CompoundConstraint *GraphData::reusableConstraint(Indicator *indicator,
+        const std::vector<double>& key, bool referencesReused)
+{
+    IndicatorConstraints::iterator prev = 
+            previousConstraints.find(indicator->internalId());
+    if (prev == previousConstraints.end())
+    {
+        ++constraintChanges.added;
+        return NULL;
+    }
+    cola::CompoundConstraint *cc = NULL;
+    if (referencesReused && (prev->second.key == key))
+    {
+        cc = prev->second.constraint;
+        reusedConstraints.insert(cc);
+        ++constraintChanges.reused;
+    }
+    else
+    {
+        ++constraintChanges.modified;
+    }
+    previousConstraints.erase(prev);
+    return cc;
+}
+
+void GraphData::addIndicatorConstraint(Indicator *indicator,
+        const std::vector<double>& key, cola::CompoundConstraint *cc)
+{
+    IndicatorConstraint& entry = indicatorConstraints[indicator->internalId()];
+    entry.key = key;
+    entry.constraint = cc;
+    ccMap[indicator] = cc;
+    ccs.push_back(cc);
+}
+
+/**
+ * Reused constraints are now owned by this GraphData, so are removed from
+ * the previous one to stop them being deleted along with it.
+ */
+void GraphData::releaseReusedConstraints(GraphData *previous)
+{
+    if (reusedConstraints.empty())
+    {
+        return;
+    }
+    cola::CompoundConstraints remaining;
+    for (cola::CompoundConstraints::iterator c = previous->ccs.begin();
+            c != previous->ccs.end(); ++c)
+    {
+        if (!isReused(*c))
+        {
+            remaining.push_back(*c);
+        }
+    }
+    previous->ccs.swap(remaining);
+    previous->ccMap.clear();
+    previous->indicatorConstraints.clear();
+}
+
+const cola::ShortestPathsCache& GraphData::getShortestPaths()
+{
+    if (shortestPaths.get() == NULL)
+    {
+        shortestPaths.reset(new cola::ShortestPathsCache());
+    }
+    // This is cheap when the nodes and edges are unchanged, and otherwise
+    // only does as much work as the change requires.
+    shortestPaths->update(rs.size(), edges, edgeLengths);
+    return *shortestPaths;
+}
+
 /**
  * Either constructs or gets an existing dummy/real node for the specified node
  * handle.  Specifically, if the handle indicates the centre, return the actual
@@ -1144,7 +1403,7 @@ void GraphData::setupMultiEdges() {
 
 
 void GraphData::generateRectangleConstraints(
-        QList<CanvasItem *>& canvasChildren)
+        QList<ShapeObj *>& canvasChildren)
 {
     if (!canvas_->m_rectangle_constraint_test)
     {
@@ -1176,11 +1435,9 @@ void GraphData::generateRectangleConstraints(
 void GraphData::guideToAlignmentConstraint(Guideline* guide) {
     vpsc::Dim dim = 
             (guide->get_dir()==GUIDE_TYPE_HORI) ? vpsc::YDIM : vpsc::XDIM;
-    cola::AlignmentConstraint *ac = 
-            new cola::AlignmentConstraint(dim, guide->position());
-    ccMap[guide]=ac;
-    ac->indicator=(void*)guide;
-    ccs.push_back(ac);
+    // The key is the dimension followed by the node and offset of each
+    // attached shape.
+    std::vector<double> key(1, dim);
     for(RelsList::iterator i = guide->relationships.begin();
             i!=guide->relationships.end();i++) {
         double offset = 0;
@@ -1203,9 +1460,24 @@ void GraphData::guideToAlignmentConstraint(Guideline* guide) {
                 default: // ALIGN_CENTER, ALIGN_MIDDLE: offset=0
                     break;
             }
-            ac->addShape(snMap[s], offset);
+            key.push_back(snMap[s]);
+            key.push_back(offset);
+        }
+    }
+    cola::AlignmentConstraint *ac = static_cast<cola::AlignmentConstraint *>
+            (reusableConstraint(guide, key));
+    if (ac) {
+        // Start from where the guideline is now, as a new one would.
+        ac->fixPos(guide->position());
+        ac->unfixPos();
+    } else {
+        ac = new cola::AlignmentConstraint(dim, guide->position());
+        for (size_t k = 1; k < key.size(); k += 2) {
+            ac->addShape((unsigned) key[k], key[k + 1]);
         }
     }
+    ac->indicator=(void*)guide;
+    addIndicatorConstraint(guide, key, ac);
 }
 
 
@@ -1351,25 +1623,42 @@ void GraphData::distroToDistributionConstraint(Distribution* distro)
     }
     dirctn d = distro->relationships.front()->guide->get_dir();
     vpsc::Dim dim = (d==GUIDE_TYPE_HORI) ? vpsc::YDIM : vpsc::XDIM;
-    cola::DistributionConstraint* dc = new cola::DistributionConstraint(dim);
-    dc->indicator = (void *) distro;
-    ccMap[distro]=dc;
-    dc->sep = distro->getSeparation();
+    // The key is the dimension followed by the IDs of each pair of guides.
+    std::vector<double> key(1, dim);
+    bool referencesReused = true;
     for (RelsList::iterator i = distro->relationships.begin();
             i!=distro->relationships.end();i++) 
     {
         Guideline* g1 = (*i)->guide;
         Guideline* g2 = (*i)->guide2;
-        cola::AlignmentConstraint *ac1 =
-                (cola::AlignmentConstraint *) ccMap[g1];
-        cola::AlignmentConstraint *ac2 = 
-                (cola::AlignmentConstraint *) ccMap[g2];
-        assert(ac1!=NULL);
-        assert(ac2!=NULL);
-        dc->addAlignmentPair(ac1, ac2);
-        d=g1->get_dir();
-    }
-    ccs.push_back(dc);
+        key.push_back(g1->internalId());
+        key.push_back(g2->internalId());
+        referencesReused = referencesReused && 
+                isReused(ccMap[g1]) && isReused(ccMap[g2]);
+    }
+    cola::DistributionConstraint* dc = 
+            static_cast<cola::DistributionConstraint *>
+            (reusableConstraint(distro, key, referencesReused));
+    if (dc == NULL)
+    {
+        dc = new cola::DistributionConstraint(dim);
+        for (RelsList::iterator i = distro->relationships.begin();
+                i!=distro->relationships.end();i++) 
+        {
+            Guideline* g1 = (*i)->guide;
+            Guideline* g2 = (*i)->guide2;
+            cola::AlignmentConstraint *ac1 =
+                    (cola::AlignmentConstraint *) ccMap[g1];
+            cola::AlignmentConstraint *ac2 = 
+                    (cola::AlignmentConstraint *) ccMap[g2];
+            assert(ac1!=NULL);
+            assert(ac2!=NULL);
+            dc->addAlignmentPair(ac1, ac2);
+        }
+    }
+    dc->indicator = (void *) distro;
+    dc->setSeparation(distro->getSeparation());
+    addIndicatorConstraint(distro, key, dc);
 }
 /**
  * Creates cola::MultiSeparationConstraint for a dunnart Separation.
@@ -1385,27 +1674,42 @@ void GraphData::separationToMultiSeparationConstraint(Separation* sep)
     dirctn d = sep->relationships.front()->guide->get_dir();
     vpsc::Dim dim = (d==GUIDE_TYPE_HORI) ? vpsc::YDIM : vpsc::XDIM;
     bool equality = false; // Distributions have replaced equality separations.
-    cola::MultiSeparationConstraint* c =
-            new cola::MultiSeparationConstraint(dim, sep->gap, equality);
-    c->indicator = (void *) sep;
-    ccMap[sep]=c;
+    // The key is the dimension followed by the IDs of each pair of guides.
+    std::vector<double> key(1, dim);
+    bool referencesReused = true;
     for(RelsList::iterator i = sep->relationships.begin();
             i!=sep->relationships.end();i++) {
         Guideline* g1 = (*i)->guide;
         Guideline* g2 = (*i)->guide2;
-        cola::AlignmentConstraint *ac1 =
-                (cola::AlignmentConstraint *) ccMap[g1];
-        cola::AlignmentConstraint *ac2 =
-                (cola::AlignmentConstraint *) ccMap[g2];
-        assert(ac1!=NULL);
-        assert(ac2!=NULL);
-        c->addAlignmentPair(ac1, ac2);
-        d=g1->get_dir();
-    }
-    ccs.push_back(c);
+        key.push_back(g1->internalId());
+        key.push_back(g2->internalId());
+        referencesReused = referencesReused && 
+                isReused(ccMap[g1]) && isReused(ccMap[g2]);
+    }
+    cola::MultiSeparationConstraint* c = 
+            static_cast<cola::MultiSeparationConstraint *>
+            (reusableConstraint(sep, key, referencesReused));
+    if (c == NULL)
+    {
+        c = new cola::MultiSeparationConstraint(dim, sep->gap, equality);
+        for(RelsList::iterator i = sep->relationships.begin();
+                i!=sep->relationships.end();i++) {
+            Guideline* g1 = (*i)->guide;
+            Guideline* g2 = (*i)->guide2;
+            cola::AlignmentConstraint *ac1 =
+                    (cola::AlignmentConstraint *) ccMap[g1];
+            cola::AlignmentConstraint *ac2 =
+                    (cola::AlignmentConstraint *) ccMap[g2];
+            assert(ac1!=NULL);
+            assert(ac2!=NULL);
+            c->addAlignmentPair(ac1, ac2);
+        }
+    }
+    c->indicator = (void *) sep;
+    c->setSeparation(sep->gap);
+    addIndicatorConstraint(sep, key, c);
 }
 
-
 }
 // vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
 
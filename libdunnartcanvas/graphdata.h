@@ -40,6 +40,10 @@ namespace topology {
     class Edge;
 }
 
+namespace cola {
+    class ShortestPathsCache;
+}
+
 namespace dunnart {
 
 
@@ -51,15 +55,33 @@ class CPoint;
 class GraphvizLayout;
 #endif
 class Canvas;
+class TopologyRoutesRouter;
 /**
  * GraphLayout constructs a cola graph representation from dunnart objects and maintains the
  * graph structure and various mapping lookups here
  */
 class GraphData {
 public:
+    /** builds the cola graph for the canvas.  If the GraphData built for
+     * the previous run of layout on the canvas is given, the compound
+     * constraints for guidelines, distributions and separations whose
+     * structure is unchanged since then are taken over from it rather than
+     * being created again, so they keep their identity across restarts.
+     */
     GraphData(Canvas *canvas, bool ignoreEdges, GraphLayout::Mode mode, 
-            bool beautify, unsigned topologyNodesCount);
+            bool beautify, unsigned topologyNodesCount,
+            GraphData *previous = NULL);
+    /** generates topologyRoutes for the edges by routing them with a helper
+     * poly-line router.  The router is kept and only updated with changes
+     * the next time this is called (including on a GraphData that has
+     * taken it over with takeCachesFrom()).
+     */
     void generateRoutes();
+    /** takes over the shortest path lengths and topology routing router
+     * built for the previous GraphData of the same canvas, so that these
+     * only need updating with the changes to the graph since then.
+     */
+    void takeCachesFrom(GraphData *previous);
     ~GraphData(); 
     /** once edges are loaded the following detects multi-edges and sets up the
      * connector so that they are rendered with offsets.
@@ -86,6 +108,25 @@ public:
         assert(i!=ccMap.end());
         return i->second;
     }
+    /// counts of the constraint indicators added, removed or modified
+    /// since the previous GraphData, and of those whose constraints were
+    /// taken over from it unchanged.
+    struct ConstraintChanges {
+        ConstraintChanges() : added(0), removed(0), modified(0), reused(0) {}
+        unsigned added, removed, modified, reused;
+    };
+    const ConstraintChanges& getConstraintChanges() const {
+        return constraintChanges;
+    }
+    /// counts of the connectors whose topology routes were traced afresh,
+    /// and of those reused from the previous call, by generateRoutes().
+    struct RouteChanges {
+        RouteChanges() : traced(0), reused(0) {}
+        unsigned traced, reused;
+    };
+    const RouteChanges& getRouteChanges() const {
+        return routeChanges;
+    }
     // the following getters return the graph data in the
     // most suitable format for cola layout algorithm constructors.
     cola::RootCluster* getRootCluster() {
@@ -113,6 +154,12 @@ public:
     double getIdealEdgeLength(unsigned i) {
         return edgeLengths[i];
     }
+    /** returns the all-pairs shortest path lengths for the graph, in the
+     * form expected by the cola::ConstrainedFDLayout constructor.  These
+     * are only updated when the graph structure has changed since they
+     * were last requested.
+     */
+    const cola::ShortestPathsCache& getShortestPaths();
     Canvas *canvas_;
     // The following members form the basic graph and constraint definitions
     //! Bounding boxes for each of the real nodes in the graph.
@@ -134,7 +181,7 @@ public:
     void connectorToEdge(Connector* conn);
     void dunnartClusterToCluster(Cluster* cluster);
     void guideToAlignmentConstraint(Guideline* guide);
-    void generateRectangleConstraints(QList<CanvasItem *>& canvasChildren);
+    void generateRectangleConstraints(QList<ShapeObj *>& canvasChildren);
     void distroToDistributionConstraint(Distribution* distro);
     void separationToMultiSeparationConstraint(Separation* sep);
     void linearTemplateToConstraints(LinearTemplate* templatPtr);
@@ -149,6 +196,21 @@ private:
         return id;
     }
     void setUpRootCluster();
+    /// the compound constraint for an indicator, along with a key
+    /// describing its structure (dimension, variables and offsets).
+    struct IndicatorConstraint {
+        std::vector<double> key;
+        cola::CompoundConstraint *constraint;
+    };
+    typedef std::map<unsigned, IndicatorConstraint> IndicatorConstraints;
+    cola::CompoundConstraint *reusableConstraint(Indicator *indicator,
+            const std::vector<double>& key, bool referencesReused = true);
+    void addIndicatorConstraint(Indicator *indicator,
+            const std::vector<double>& key, cola::CompoundConstraint *cc);
+    bool isReused(cola::CompoundConstraint *cc) const {
+        return reusedConstraints.find(cc) != reusedConstraints.end();
+    }
+    void releaseReusedConstraints(GraphData *previous);
     unsigned getConnectionPoint(const CPoint& connPointInfo);
     std::map<ShapeObj*, unsigned> snMap;
     QMap<ShapeObj*, cola::Cluster *> rectClusterShapeMap;
@@ -160,11 +222,19 @@ private:
     std::vector<double> edgeLengths;
     std::vector<Cluster*> dunnartClusters;
     unsigned orthogonalEdgeCountX, orthogonalEdgeCountY;
+    //! indicator constraints, by indicator internal ID
+    IndicatorConstraints indicatorConstraints;
+    //! those of the previous GraphData not yet looked at while building
+    IndicatorConstraints previousConstraints;
+    std::set<cola::CompoundConstraint *> reusedConstraints;
+    ConstraintChanges constraintChanges;
+    RouteChanges routeChanges;
+    std::auto_ptr<cola::ShortestPathsCache> shortestPaths;
+    std::auto_ptr<TopologyRoutesRouter> topologyRouter;
 #ifndef NOGRAPHVIZ
     std::auto_ptr<GraphvizLayout> graphvizLayout;
 #endif
     friend class PostIteration;
-    friend class SCCDetector;
 };
 
 }
@@ -24,13 +24,21 @@
  *            Michael Wybrow  <http://michael.wybrow.info/>
 */
 
+#include <climits>
+
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "libdunnartcanvas/canvas.h"
 
 #include "libdunnartcanvas/graphdata.h"
 
 #include "libcola/cola.h"
+#include "libcola/connected_components.h"
+#include "libcola/shortest_paths_cache.h"
 #include "libdunnartcanvas/oldcanvas.h"
 #include "libdunnartcanvas/shape.h"
 #include "libdunnartcanvas/connector.h"
@@ -56,23 +64,17 @@
 namespace dunnart {
 
 static const int ANIMATION_DURATION = 100;
+// Time, in milliseconds, one step of the layout animation may take before
+// we give up animating and move shapes straight to their new positions.
+static const qint64 ANIMATION_FRAME_BUDGET = 25;
 
-// The order that we process returned PosInfos in.  Order matters because the
-// guideline length with depend on the positions of the aligned shapes, etc.
-enum PosInfoProcessOrder 
-{
-    PosInfoProcessOrderShape,
-    PosInfoProcessOrderGuideline,
-    PosInfoProcessOrderDistribution,
-    PosInfoProcessOrderSeparation,
-    PosInfoProcessOrderOther
-};
+// Set in m_frame_published when the GUI is yet to take that frame.
+static const int LayoutFrameFresh = 4;
+static const int LayoutFrameIndexMask = 3;
 
 using namespace std;
 using cola::delete_object;
 
-PosInfos debugHUDPositions;
-
 class LayoutThread : public QThread
 {
     public:
@@ -97,7 +99,12 @@ GraphLayout::GraphLayout(Canvas *canvas)
       m_canvas(canvas),
       m_graph(NULL),
       m_is_running(false),
-      retPositionsHandled(true),
+      m_synchronous(0),
+      m_frame_writing(0),
+      m_frame_reading(1),
+      m_frame_published(2),
+      m_frame_generation(0),
+      m_timings(NULL),
       outputDebugFiles(false),
       positionChangesFromDunnart(false),
       interruptFromDunnart(true),
@@ -133,155 +140,29 @@ GraphData *GraphLayout::getGraphData(void)
 // The following structure hierarchy is used for interthread communication
 
 PosInfo::PosInfo()
-    : debugHUD(false),
-      processOrder(PosInfoProcessOrderOther),
-      HUDTimer(0)
-{
-}
-
-PosInfo::PosInfo(bool debugHUD, unsigned short HUDTimer)
-    : debugHUD(debugHUD),
-      processOrder(PosInfoProcessOrderOther),
-      HUDTimer(HUDTimer)
 {
 }
 
 
 /**
- * used to report a conflicting (or unsatisfiable) constraint condition.
- */
-struct ConflictPosInfo : PosInfo {
-    CanvasItem *obj1;
-    CanvasItem *obj2;
-    ConflictPosInfo(CanvasItem *c1, CanvasItem *c2):
-        obj1(c1),
-        obj2(c2) { }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        if (obj1)
-        {
-            obj1->setConstraintConflict(true);
-        }
-        if (obj2)
-        {
-            obj2->setConstraintConflict(true);
-        }
-    }
-};
-/**
- * causes dunnart to draw a circle at a specified location for debug purposes.
- */
-struct TracePointPosInfo : PosInfo {
-    TracePointPosInfo(QPointF p):
-        PosInfo(true,100),p(p) { }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-    }
-#ifdef DEBUG_OVERLAY
-    void myProcessHUD(SDL_Surface *sur)
-    {
-        filledCircleRGBA(sur, (int)x, (int)y, 1, 0, 0, 255, 80);
-    }
-#endif
-    QPointF p;
-};
-/**
- * causes dunnart to draw a line at a specified location for debug purposes.
- */
-struct TraceLinePosInfo : PosInfo {
-    TraceLinePosInfo(QPointF p0, QPointF p1, unsigned colour=0):
-        PosInfo(true,30),p0(p0),p1(p1),colour(colour) { }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-    }
-#ifdef DEBUG_OVERLAY
-    void myProcessHUD(SDL_Surface *sur)
-    {
-        int r=colour==0?255:0;
-        int g=colour==1?255:0;
-        int b=colour==2?255:0;
-        lineRGBA(sur, (int)x0, (int)y0, (int)x1, (int)y1, r, g, b, 80);
-    }
-#endif
-    QPointF p0, p1;
-    unsigned colour;
-};
-
-// Animates shape movement.
-class ShapePositionAnimation : public QVariantAnimation
-{
-    public:
-        ShapePositionAnimation(ShapeObj *shape)
-            :m_shape(shape)
-        {
-        }
-        ~ShapePositionAnimation()
-        {
-        }
-        void updateCurrentValue(const QVariant &value)
-        {
-            m_shape->CanvasItem::setPos(value.toPointF());
-        }
-    private:
-        ShapeObj *m_shape;
-};
-
-/**
- * communicate position update info for a dunnart Shape from layout.
+ * tells layout that a dunnart Shape is fixed in position, and maybe resized.
  */
 struct ShapePosInfo : PosInfo {
     ShapeObj* shapePtr;
     QRectF shapeRect;
-    bool locked;
     bool resized;
-    ShapePosInfo(ShapeObj *p, double x, double y):
-        shapePtr(p),
-        locked(false),
-        resized(false) 
-    { 
-        double buffer = shapePtr->canvas()->optShapeNonoverlapPadding();
-        shapeRect = shapePtr->shapeRect(buffer);
-        shapeRect.moveCenter(QPointF(x, y));
-        processOrder = PosInfoProcessOrderShape;
-    }
 
     /**
      * This shape is locked at xPos, yPos and graphlayout can't change it.
      */
     ShapePosInfo(ShapeObj* s, bool resized=false):
         shapePtr(s),
-        locked(true),
         resized(resized)
     {
-        processOrder = PosInfoProcessOrderShape,
         assert(shapePtr!=NULL);
         double buffer = shapePtr->canvas()->optShapeNonoverlapPadding();
         shapeRect = shapePtr->shapeRect(buffer);
     }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        ConstraintDebug("**  SHAPE\n");
-        if (!locked)
-        {
-            //QPointF diff = shapeRect.center() - shapePtr->centrePos();
-            //qDebug("Moving shape: (%g,%g)  %g\n", centreX, centreY,
-            //        diff.manhattanLength());
-
-            // Do shape movement as an animation.
-            ShapePositionAnimation *animation =
-                    new ShapePositionAnimation(shapePtr);
-            animation->setDuration(ANIMATION_DURATION);
-            animation->setStartValue(shapePtr->centrePos());
-            animation->setEndValue(shapeRect.center());
-            canvas->m_animation_group->addAnimation(animation);
-        }
-    }
     void fixGraphLayoutPosition(GraphData*, cola::Locks&, cola::Resizes&);
 };
 
@@ -303,72 +184,6 @@ struct CopyClusterVertex {
     vector<Avoid::Point>& points;
     unsigned i;
 };
-/**
- * communicate position update info for a dunnart Cluster from layout.
- */
-struct ClusterPosInfo : PosInfo
-{
-    ClusterPosInfo(GraphLayout& gl, Cluster *dc, topology::Edge const *e)
-        : clusterPtr(dc),
-          hasBoundary(true),
-          hasFixedSizeAndPosition(false)
-    {
-        unsigned n = e->nSegments + 1;
-        points.resize(n);
-        e->forEachEdgePoint(CopyClusterVertex(gl, points));
-    }
-    ClusterPosInfo(Cluster *dc, double x, double y)
-        : clusterPtr(dc),
-          hasBoundary(false),
-          hasFixedSizeAndPosition(true),
-          centrePos(x, y)
-    { 
-        points.clear();
-    }
-    ClusterPosInfo(Cluster *dc)
-        : clusterPtr(dc),
-          hasBoundary(false),
-          hasFixedSizeAndPosition(false)
-    { 
-        points.clear();
-    }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        if (hasBoundary)
-        {
-            /*
-            printf("Have boundary: ");
-            for(unsigned i=0;i<x.size();i++) {
-                printf("(%f,%f)",x[i],y[i]);
-            }
-            printf("\n");
-            */
-            clusterPtr->setNewBoundary(points);
-        } 
-        else if (hasFixedSizeAndPosition)
-        {
-            clusterPtr->setCentrePos(centrePos);
-        }
-        else
-        {
-            //printf("No boundary!\n");
-            clusterPtr->recomputeBoundary();
-        }
-    }
-
-    // The dunnart cluster shape pointer.
-    Cluster *clusterPtr;
-    // Points comprising the cluster boundary.
-    bool hasBoundary;
-    vector<Avoid::Point> points;
-    // Used to return the position of fixed size parent shapes.
-    bool hasFixedSizeAndPosition;
-    QPointF centrePos;
-};
-
-
 /**
  * Functor for use in forEach loop over the points in a topology::Edge to copy
  * each EdgePoint into an Avoid::PolyLine
@@ -388,80 +203,24 @@ struct CopyPoint {
     unsigned i;
 };
 /**
- * communicate path update info for a dunnart Conn from layout.
- */
-struct ConnPosInfo : PosInfo {
-    Avoid::PolyLine route;
-    Connector* conn;
-    ConnPosInfo(const GraphData* g, Connector* conn, cola::Edge const& e,
-            double x0, double y0, double x1, double y1)
-        : conn(conn)
-    {
-        route = Avoid::PolyLine(2);
-        Avoid::Point& p=route.ps[0];
-        p.x=x0;
-        p.y=y0;
-        p.id=g->getShape(e.first)->internalId();
-        p.vn=4;
-        
-        Avoid::Point& p2=route.ps[1];
-        p2.x=x1;
-        p2.y=y1;
-        p2.id=g->getShape(e.second)->internalId();
-        p2.vn=4;
-    }
-    ConnPosInfo(const GraphData* g, Connector* conn,topology::Edge const *e)
-            : conn(conn) 
-    {
-        // Copy the new route into dunnart:
-        route = Avoid::PolyLine(e->nSegments+1);
-        e->forEachEdgePoint(CopyPoint(g,route));
-    }
-    ~ConnPosInfo() {
-    }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        //printf("ConnPosInfo::process()\n");
-        bool updateLibavoid = true;
-        conn->applyNewRoute(route, updateLibavoid);
-    }
-};
-
-/**
- * communicate position update info for a dunnart Guideline corresponding to a set of layout constraints from layout.
+ * tells layout that a dunnart Guideline corresponding to a set of layout constraints is fixed in position.
  */
 struct GuidelinePosInfo : PosInfo {
     Guideline *guidePtr;
     double gPos;
-    bool hasPos;
     GuidelinePosInfo(Guideline *g, double gp): guidePtr(g), gPos(gp)
     {
-        processOrder = PosInfoProcessOrderGuideline;
-        hasPos = true;
     }
-    GuidelinePosInfo(Guideline *g): guidePtr(g)
-    {
-        processOrder = PosInfoProcessOrderGuideline;
-        hasPos = false;
-    }
-    void process(Canvas *canvas)
+    void fixGraphLayoutPosition(GraphData*,cola::Locks&,cola::Resizes&);
+    cola::CompoundConstraint *constraint(GraphData *g)
     {
-        Q_UNUSED (canvas)
-
-        if (guidePtr)
-        {
-            ConstraintDebug("**  GUIDELINE\n");
-            guidePtr->updateFromLayout(gPos, hasPos);
-        }
+        return g->getConstraint(guidePtr);
     }
-    void fixGraphLayoutPosition(GraphData*,cola::Locks&,cola::Resizes&);
 };
 
 /**
- * communicate position update info for a dunnart Template 
- * corresponding to a set of layout constraints from layout.
+ * tells layout that a dunnart Template 
+ * corresponding to a set of layout constraints is fixed in position.
  */
 struct TemplatePosInfo : PosInfo {
     Template *templatePtr;
@@ -470,12 +229,6 @@ struct TemplatePosInfo : PosInfo {
         : templatePtr(lt), 
           templatePos(gp) 
     { }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        templatePtr->updatePositionFromSolver(templatePos, false);
-    }
     void fixGraphLayoutPosition(GraphData* g,cola::Locks&,cola::Resizes&) 
     {
         LinearTemplateConstraint *ltc 
@@ -491,61 +244,41 @@ struct TemplatePosInfo : PosInfo {
           btc->fixPos(templatePos);
         }
     }
+    cola::CompoundConstraint *constraint(GraphData *g)
+    {
+        return g->getConstraint(templatePtr);
+    }
 };
 
 /**
- * communicate position update info for a dunnart Distribution corresponding to a set of layout constraints from layout.
+ * tells layout that a dunnart Distribution corresponding to a set of layout constraints is fixed in spacing.
  */
 struct DistributionPosInfo : PosInfo {
     Distribution *distroPtr;
     double dSep;
     DistributionPosInfo(Distribution *d, double ds): distroPtr(d), dSep(ds)
     {
-        processOrder = PosInfoProcessOrderDistribution;
     }
-    void process(Canvas *canvas)
+    void fixGraphLayoutPosition(GraphData*,cola::Locks&,cola::Resizes&);
+    cola::CompoundConstraint *constraint(GraphData *g)
     {
-        Q_UNUSED (canvas)
-
-        ConstraintDebug("**  DISTRIBUTION\n");
-        distroPtr->updateFromLayout(dSep);
+        return g->getConstraint(distroPtr);
     }
-    void fixGraphLayoutPosition(GraphData*,cola::Locks&,cola::Resizes&);
 };
 
 /**
- * communicate position update info for a dunnart Separation corresponding to a set of layout constraints from layout.
+ * tells layout that a dunnart Separation corresponding to a set of layout constraints is fixed in spacing.
  */
 struct SeparationPosInfo : PosInfo {
     Separation *sepPtr;
     double sSep; 
     SeparationPosInfo(Separation *s, double ss): sepPtr(s), sSep(ss)
     {
-        processOrder = PosInfoProcessOrderSeparation;
-    }
-    void process(Canvas *canvas)
-    {
-        Q_UNUSED (canvas)
-
-        ConstraintDebug("**  SEPARATION\n");
-        sepPtr->updateFromLayout(sSep);
     }
     void fixGraphLayoutPosition(GraphData*,cola::Locks&,cola::Resizes&);
-};
-
-/**
- * communicate overrun of page bounds from layout
- */
-struct PageBoundsPosInfo : PosInfo {
-    double minX, maxX, minY, maxY;
-    PageBoundsPosInfo(double minX, double maxX, double minY, double maxY) 
-        : minX(minX), maxX(maxX), minY(minY), maxY(maxY) {}
-    void process(Canvas *canvas)
+    cola::CompoundConstraint *constraint(GraphData *g)
     {
-        double page_buffer = canvas->visualPageBuffer();
-        canvas->setExpandedPage(QRectF(
-                QPointF(minX - page_buffer, minY - page_buffer),
-                QPointF(maxX + page_buffer, maxY + page_buffer)));
+        return g->getConstraint(sepPtr);
     }
 };
 
@@ -584,13 +317,10 @@ void GraphLayout::setInterruptFromDunnart(void)
     positionChangesFromDunnart = false;
     m_layout_signal_mutex.unlock();
 
-    // Clear any return PosInfos since they may now refer to
-    // invalid CanvasItems.
-    m_return_positions_mutex.lock();
-    clearReturnPosInfos();
-    retPositionsHandled = true;
+    // Drop any frames already published or being filled, since they may
+    // now refer to invalid CanvasItems.
+    m_frame_generation.ref();
     m_canvas->m_animation_group->clear();
-    m_return_positions_mutex.unlock();
 }
 
 void GraphLayout::setRestartFromDunnart(void)
@@ -640,9 +370,19 @@ void SeparationPosInfo::fixGraphLayoutPosition(GraphData* g,cola::Locks&,cola::R
 struct PreIteration : cola::PreIteration {
     PreIteration(GraphLayout& gl) : cola::PreIteration(gl.locks, gl.resizes), gl(gl) {}
     bool operator()() {
+        return update(NULL);
+    }
+    /**
+     * Reads the fixed positions.  Locks and resizes are collected for every
+     * shape, but if ownConstraints is given, only the compound constraints
+     * it holds are fixed, so that constraints being solved by another 
+     * thread are left alone.
+     */
+    bool update(const set<cola::CompoundConstraint *> *ownConstraints) {
         gl.m_layout_signal_mutex.lock();
         changed=gl.positionChangesFromDunnart;
-        bool interrupt = gl.interruptFromDunnart | gl.freeShiftFromDunnart;
+        bool interrupt = !gl.m_synchronous.loadAcquire() &&
+                (gl.interruptFromDunnart | gl.freeShiftFromDunnart);
         gl.m_layout_signal_mutex.unlock();
         if (interrupt) { 
             qDebug("User interrupt detected in PreIteration!");
@@ -653,6 +393,12 @@ struct PreIteration : cola::PreIteration {
         gl.resizes.clear();
         for (PosInfos::iterator p=gl.fixedPositions.begin();
                 p!=gl.fixedPositions.end();p++) {
+            if (ownConstraints) {
+                cola::CompoundConstraint *c = (*p)->constraint(gl.m_graph);
+                if (c && (ownConstraints->count(c) == 0)) {
+                    continue;
+                }
+            }
             (*p)->fixGraphLayoutPosition(gl.m_graph,locks,resizes);
         }
         gl.m_changed_list_mutex.unlock();
@@ -662,42 +408,62 @@ struct PreIteration : cola::PreIteration {
 };
 
 /**
- * creates the correct type of PosInfo object for a cola::CompoundConstraint.
- * @return the PosInfo object or NULL if no constraint is applicable.
+ * adds the position or spacing of the indicator for a cola::CompoundConstraint
+ * to the frame, if it has one.
  */
-PosInfo* returnPosInfoFactory(cola::CompoundConstraint *c) {
+static void addConstraintToFrame(cola::CompoundConstraint *c,
+        LayoutFrame& frame) {
     if(cola::AlignmentConstraint *ac = dynamic_cast<cola::AlignmentConstraint*>(c)) {
+        LayoutFrame::GuidelinePosition entry;
+        entry.guideline = (Guideline*)ac->indicator;
+        entry.position = 0;
+        entry.hasPosition = false;
         if(ac->isFixed()) {
             ac->unfixPos();
-            return new GuidelinePosInfo((Guideline*)ac->indicator);
         } 
-        if(ac->indicator==NULL) { // no gui object associated with this alignment
-            return NULL;
+        else if(ac->indicator==NULL) { // no gui object associated with this alignment
+            return;
+        }
+        else {
+            entry.position = ac->position();
+            entry.hasPosition = true;
         }
-        return new GuidelinePosInfo((Guideline*)ac->indicator, ac->position());
+        frame.guidelines.push_back(entry);
+        return;
     }
     if(cola::DistributionConstraint *dc = dynamic_cast<cola::DistributionConstraint*>(c)) {
-        return new DistributionPosInfo((Distribution *)dc->indicator, dc->sep);
+        LayoutFrame::DistributionSpace entry;
+        entry.distribution = (Distribution *)dc->indicator;
+        entry.space = dc->sep;
+        frame.distributions.push_back(entry);
+        return;
     }
     if(cola::MultiSeparationConstraint *sc = dynamic_cast<cola::MultiSeparationConstraint*>(c)) {
-        return new SeparationPosInfo((Separation *)sc->indicator, sc->sep);
+        LayoutFrame::SeparationGap entry;
+        entry.separation = (Separation *)sc->indicator;
+        entry.gap = sc->sep;
+        frame.separations.push_back(entry);
+        return;
     }
+    LayoutFrame::TemplatePosition entry;
     if(LinearTemplateConstraint *ltc = dynamic_cast<LinearTemplateConstraint*>(c)) {
         if(ltc->isFixed) {
             ltc->unfixPos();
-            return NULL;
+            return;
         } 
-        return new TemplatePosInfo((LinearTemplate *)ltc->indicator, ltc->position);
+        entry.templatePtr = (LinearTemplate *)ltc->indicator;
+        entry.position = ltc->position;
+        frame.templates.push_back(entry);
     }
-    if(BranchedTemplateConstraint *btc = dynamic_cast<BranchedTemplateConstraint*>(c)){
+    else if(BranchedTemplateConstraint *btc = dynamic_cast<BranchedTemplateConstraint*>(c)){
         if(btc->isFixed) {
             btc->unfixPos();
-            return NULL;
+            return;
         }
-        return new TemplatePosInfo((BranchedTemplate *)btc->indicator, btc->position);
+        entry.templatePtr = (BranchedTemplate *)btc->indicator;
+        entry.position = btc->position;
+        frame.templates.push_back(entry);
     }
-
-    return NULL;
 }
 /**
  * A functor that is called at the end of each iteration of cola::ConstrainedMajorizationLayout.
@@ -711,7 +477,7 @@ public:
           gl(gl) { }
     /**
      * Called by cola::ConstrainedMajorizationLayout after each layout iteration.
-     * Returns new layout by populating the list gl.retPositions list with PosInfo objects.
+     * Returns new layout by filling and publishing a LayoutFrame.
      * @param new_stress stress level after last iteration
      * @param X node coordinates after last move
      * @param Y node coordinates after last move
@@ -720,51 +486,84 @@ public:
     bool operator()(const double new_stress,
                 valarray<double> & X, valarray<double> & Y)
     {
-        bool ready = false;
-        
-        while (!ready)
-        {
-            gl.m_return_positions_mutex.lock();
-            ready = gl.retPositionsHandled;
-            gl.m_return_positions_mutex.unlock();
+        // Read before checking for interrupts, so that a frame started
+        // before an interrupt is sure to be dropped by the GUI.
+        int generation = gl.m_frame_generation.loadAcquire();
 
+        // When running synchronously there is no GUI thread to hand
+        // positions to or take interruptions from.
+        if (!gl.m_synchronous.loadAcquire())
+        {
             gl.m_layout_signal_mutex.lock();
             bool finish = gl.askedToFinish;
+            bool interrupt = gl.interruptFromDunnart | gl.freeShiftFromDunnart;
             gl.m_layout_signal_mutex.unlock();
             if (finish)
             {
                 return true;
             }
+            if(interrupt||gl.restartFromDunnart) {
+                reset();
+            }
+            if (interrupt)
+            {
+                qDebug("User interrupt detected in PostIteration!");
+                gl.m_layout_signal_mutex.lock();
+                gl.interruptFromDunnart = true;
+                if (gl.freeShiftFromDunnart)
+                {
+                    gl.positionChangesFromDunnart=false;
+                }
+                gl.m_layout_signal_mutex.unlock();
+                return true;
+            }
         }
 
-        gl.m_layout_signal_mutex.lock();
-        bool interrupt = gl.interruptFromDunnart | gl.freeShiftFromDunnart;
-        gl.m_layout_signal_mutex.unlock();
-        if(interrupt||gl.restartFromDunnart) {
-            reset();
-        }
-        if (interrupt)
+        if (publishLayout(generation, X, Y))
         {
-            qDebug("User interrupt detected in PostIteration!");
-            gl.m_layout_signal_mutex.lock();
-            gl.interruptFromDunnart = true;
-            if (gl.freeShiftFromDunnart)
-            {
-                gl.positionChangesFromDunnart=false;
-            }
-            gl.m_layout_signal_mutex.unlock();
+            // Unsatisfiable constraints exist.
             return true;
         }
-
-        gl.m_return_positions_mutex.lock();
-        gl.clearReturnPosInfos();
+        //printf("Stress=%f\n",new_stress);
+        //SDL_Delay(3000);
+        bool converged = TestConvergence::operator()(new_stress,X,Y);
+        /*
+        if(iterations<10) { // sometimes layout stops too early without this
+            converged = false;
+        }
+        */
+        return converged;
+        //return true;
+        //return false;
+    }
+    /**
+     * Publishes a LayoutFrame holding the given node positions, along with
+     * guide positions, unsatisfiable constraints, cluster boundaries and
+     * connector routes.  This does not check for interrupts, so it is also
+     * used to publish the final positions of a layout.
+     * @param generation frame generation, read before any interrupt check
+     * @param X node coordinates
+     * @param Y node coordinates
+     * @return true if unsatisfiable constraints exist
+     */
+    bool publishLayout(const int generation,
+            valarray<double> & X, valarray<double> & Y)
+    {
+        LayoutFrame& frame = gl.frameForWriting();
+        frame.clear();
+        frame.generation = generation;
         for (unsigned i = 0; i < n; i++) {
             ShapeObj* shape = gl.m_graph->getShape(i);
             if (shape && (gl.fixedShapeLookup.find(shape) == 
                           gl.fixedShapeLookup.end())) 
             {
-                gl.retPositions.push_back(
-                        new ShapePosInfo(shape, X[i], Y[i]));
+                LayoutFrame::Node node;
+                node.shape = shape;
+                node.x = X[i];
+                node.y = Y[i];
+                node.width = gl.m_graph->rs[i]->width();
+                node.height = gl.m_graph->rs[i]->height();
+                frame.nodes.push_back(node);
             }
         }
 
@@ -784,20 +583,18 @@ public:
                 pby = pc->getActualLeftMargin(vpsc::VERTICAL);
                 pbY = pc->getActualRightMargin(vpsc::VERTICAL);
             }
-            if(PosInfo* pi = returnPosInfoFactory(c)) {
-                gl.retPositions.push_back(pi);
-            }
+            addConstraintToFrame(c, frame);
         }
         bool unsatisfiedConstraintsExist=false;
         for(cola::UnsatisfiableConstraintInfos::iterator i=gl.unsatisfiableX.begin();
                 i!=gl.unsatisfiableX.end();i++) {
-            gl.showUnsatisfiable(*i);
+            gl.showUnsatisfiable(*i, frame);
             unsatisfiedConstraintsExist=true;
             delete *i;
         }
         for(cola::UnsatisfiableConstraintInfos::iterator i=gl.unsatisfiableY.begin();
                 i!=gl.unsatisfiableY.end();i++) {
-            gl.showUnsatisfiable(*i);
+            gl.showUnsatisfiable(*i, frame);
             unsatisfiedConstraintsExist=true;
             delete *i;
         }
@@ -810,8 +607,8 @@ public:
         gl.unsatisfiableY.clear();
 
         if(pageBoundChange) {
-            gl.retPositions.push_back(
-                    new PageBoundsPosInfo(pbx,pbX,pby,pbY));
+            frame.hasPageBounds = true;
+            frame.pageBounds = QRectF(QPointF(pbx, pby), QPointF(pbX, pbY));
         }
 
         // Update cluster boundaries and connector routes
@@ -824,26 +621,30 @@ public:
                 assert(e->lastSegment->end->node->id
                         <gl.m_graph->topologyNodesCount);
                 if(!e->cycle()) {
-                    gl.retPositions.push_back( new
-                            ConnPosInfo(gl.m_graph,
-                                (Connector*)gl.m_graph->conn_vec[e->id], e));
+                    // Copy the new route into dunnart:
+                    LayoutFrame::Route& route = frame.nextRoute();
+                    route.connector = (Connector*)gl.m_graph->conn_vec[e->id];
+                    route.route.ps.resize(e->nSegments+1);
+                    e->forEachEdgePoint(CopyPoint(gl.m_graph,route.route));
                 } else {
-                    Cluster* c=gl.m_graph->dunnartClusters[e->id];
-                    gl.retPositions.push_back( new ClusterPosInfo(gl, c, e) );
+                    LayoutFrame::ClusterBoundary& cluster =
+                            frame.nextCluster();
+                    cluster.cluster = gl.m_graph->dunnartClusters[e->id];
+                    cluster.hasBoundary = true;
+                    cluster.points.resize(e->nSegments + 1);
+                    e->forEachEdgePoint(CopyClusterVertex(gl, cluster.points));
                 }
-                //for(unsigned j=0;j<gl.graph->topologyRoutes[i]->debugLines.size();j++) {
-                    //straightener::DebugLine &l=gl.graph->topologyRoutes[i]->debugLines[j];
-                    //gl.retPositions.push_back(
-                            //new TraceLinePosInfo(l.x0,l.y0,l.x1,l.y1,l.colour));
-                //}
-                //gl.graph->topologyRoutes[i]->debugLines.clear();
             }
             for (unsigned i = 0; i < gl.m_graph->dunnartClusters.size(); ++i)
             {
                 Cluster* c = gl.m_graph->dunnartClusters[i];
                 if (c && c->rectangular)
                 {
-                    gl.retPositions.push_back( new ClusterPosInfo(c) );
+                    LayoutFrame::ClusterBoundary& cluster =
+                            frame.nextCluster();
+                    cluster.cluster = c;
+                    cluster.hasBoundary = false;
+                    cluster.points.clear();
                 }
             }
             if (gl.m_canvas->optPreserveTopology())
@@ -853,30 +654,68 @@ public:
                     unsigned u=e.first, v=e.second;
                     if(u>=gl.m_graph->topologyNodesCount
                        ||v>=gl.m_graph->topologyNodesCount) {
-                        gl.retPositions.push_back( new
-                            ConnPosInfo(gl.m_graph,
-                                (Connector*)gl.m_graph->conn_vec[i], e,
-                                X[u],Y[u],X[v],Y[v]));
+                        LayoutFrame::Route& route = frame.nextRoute();
+                        route.connector = (Connector*)gl.m_graph->conn_vec[i];
+                        route.route.ps.resize(2);
+                        Avoid::Point& p=route.route.ps[0];
+                        p.x=X[u];
+                        p.y=Y[u];
+                        p.id=gl.m_graph->getShape(u)->internalId();
+                        p.vn=4;
+                        Avoid::Point& p2=route.route.ps[1];
+                        p2.x=X[v];
+                        p2.y=Y[v];
+                        p2.id=gl.m_graph->getShape(v)->internalId();
+                        p2.vn=4;
                     }
                 }
             }
         } 
-        gl.m_return_positions_mutex.unlock();
-        QCoreApplication::postEvent(gl.m_canvas, new LayoutUpdateEvent(),
-                Qt::LowEventPriority);
+        // Only wake the GUI if it has taken the last frame; otherwise an
+        // update is already pending, and will pick up this frame instead.
+        if (gl.publishFrame() && !gl.m_synchronous.loadAcquire())
+        {
+            QCoreApplication::postEvent(gl.m_canvas, new LayoutUpdateEvent(),
+                    Qt::LowEventPriority);
+        }
+        return unsatisfiedConstraintsExist;
+    }
+    /**
+     * Publishes a LayoutFrame holding just the node positions and sizes, to 
+     * show progress while the components of the graph are still being laid
+     * out separately, and guide positions are still changing.
+     * @param X node coordinates
+     * @param Y node coordinates
+     * @param W node widths
+     * @param H node heights
+     */
+    void publishNodes(const valarray<double>& X, const valarray<double>& Y,
+            const valarray<double>& W, const valarray<double>& H)
+    {
+        int generation = gl.m_frame_generation.loadAcquire();
 
-        if(unsatisfiedConstraintsExist) return true;
-        //printf("Stress=%f\n",new_stress);
-        //SDL_Delay(3000);
-        bool converged = TestConvergence::operator()(new_stress,X,Y);
-        /*
-        if(iterations<10) { // sometimes layout stops too early without this
-            converged = false;
+        LayoutFrame& frame = gl.frameForWriting();
+        frame.clear();
+        frame.generation = generation;
+        for (unsigned i = 0; i < n; i++) {
+            ShapeObj* shape = gl.m_graph->getShape(i);
+            if (shape && (gl.fixedShapeLookup.find(shape) == 
+                          gl.fixedShapeLookup.end())) 
+            {
+                LayoutFrame::Node node;
+                node.shape = shape;
+                node.x = X[i];
+                node.y = Y[i];
+                node.width = W[i];
+                node.height = H[i];
+                frame.nodes.push_back(node);
+            }
+        }
+        if (gl.publishFrame())
+        {
+            QCoreApplication::postEvent(gl.m_canvas, new LayoutUpdateEvent(),
+                    Qt::LowEventPriority);
         }
-        */
-        return converged;
-        //return true;
-        //return false;
     }
 private:
     unsigned n;
@@ -884,6 +723,263 @@ private:
 };
 
 
+/**
+ * Positions and sizes of all nodes, gathered from the components of the 
+ * graph as they are laid out concurrently, so that their progress can be 
+ * shown in the GUI.
+ */
+class ComponentProgress {
+public:
+    ComponentProgress(PostIteration& postIter, const vpsc::Rectangles& rs,
+            const bool publish)
+        : postIter(postIter),
+          publish(publish),
+          X(rs.size()),
+          Y(rs.size()),
+          W(rs.size()),
+          H(rs.size())
+    {
+        for (unsigned i = 0; i < rs.size(); ++i)
+        {
+            X[i] = rs[i]->getCentreX();
+            Y[i] = rs[i]->getCentreY();
+            W[i] = rs[i]->width();
+            H[i] = rs[i]->height();
+        }
+        sinceLastFrame.start();
+    }
+    /**
+     * Records the positions of a component's nodes after an iteration of its
+     * layout and, at most every frameInterval milliseconds, shows the 
+     * positions of all nodes in the GUI.  Called on the thread laying out 
+     * that component, so the component's rectangles are safe to read.
+     */
+    void update(const cola::Component *component,
+            const valarray<double>& componentX, 
+            const valarray<double>& componentY)
+    {
+        QMutexLocker guard(&mutex);
+        for (unsigned j = 0; j < component->node_ids.size(); ++j)
+        {
+            const unsigned i = component->node_ids[j];
+            X[i] = componentX[j];
+            Y[i] = componentY[j];
+            W[i] = component->rects[j]->width();
+            H[i] = component->rects[j]->height();
+        }
+        if (publish && (sinceLastFrame.elapsed() >= frameInterval))
+        {
+            postIter.publishNodes(X, Y, W, H);
+            sinceLastFrame.restart();
+        }
+    }
+private:
+    static const int frameInterval = 20;
+    PostIteration& postIter;
+    const bool publish;
+    QMutex mutex;
+    QElapsedTimer sinceLastFrame;
+    valarray<double> X, Y, W, H;
+};
+
+
+/**
+ * Functor passed to cola for call-back before each iteration of the layout
+ * of a single connected component.  It runs the PreIteration shared by all
+ * components (one at a time) and passes on the locks and resizes that apply
+ * to nodes in this component, using the component's node indices.  Only
+ * this component's compound constraints are fixed, since the others may be
+ * in use by the threads laying out other components.
+ */
+struct ComponentPreIteration : cola::PreIteration {
+    ComponentPreIteration(PreIteration& shared, QMutex& mutex,
+            const vector<cola::Component *>& nodeComponents,
+            const vector<unsigned>& localIndices,
+            cola::Component *component,
+            cola::Locks& componentLocks, cola::Resizes& componentResizes)
+        : cola::PreIteration(componentLocks, componentResizes),
+          shared(shared),
+          mutex(mutex),
+          nodeComponents(nodeComponents),
+          localIndices(localIndices),
+          component(component),
+          constraints(component->ccs.begin(), component->ccs.end()) { }
+    bool operator()() {
+        QMutexLocker guard(&mutex);
+        if (!shared.update(&constraints)) {
+            return false;
+        }
+        changed = shared.changed;
+        locks.clear();
+        resizes.clear();
+        for (cola::Locks::iterator l = shared.locks.begin();
+                l != shared.locks.end(); ++l) {
+            unsigned id = l->getID();
+            if (nodeComponents[id] == component) {
+                locks.push_back(cola::Lock(localIndices[id], 
+                        l->pos(vpsc::HORIZONTAL), l->pos(vpsc::VERTICAL)));
+            }
+        }
+        for (cola::Resizes::iterator r = shared.resizes.begin();
+                r != shared.resizes.end(); ++r) {
+            unsigned id = r->getID();
+            if (nodeComponents[id] == component) {
+                const vpsc::Rectangle *t = r->getTarget();
+                resizes.push_back(cola::Resize(localIndices[id], 
+                        t->getMinX(), t->getMinY(), t->width(), t->height()));
+            }
+        }
+        return true;
+    }
+    PreIteration& shared;
+    QMutex& mutex;
+    const vector<cola::Component *>& nodeComponents;
+    const vector<unsigned>& localIndices;
+    cola::Component *component;
+    const set<cola::CompoundConstraint *> constraints;
+};
+
+/**
+ * Convergence test for the layout of a single connected component.  It 
+ * reports the component's progress after each iteration.  Only the
+ * unsatisfiable constraints found in the final iteration are kept, since 
+ * there is no PostIteration to report and clear them after each iteration.
+ */
+class ComponentConvergence : public cola::TestConvergence {
+public:
+    ComponentConvergence(unsigned maxiterations,
+            const cola::Component *component, ComponentProgress& progress,
+            cola::UnsatisfiableConstraintInfos& unsatisfiableX,
+            cola::UnsatisfiableConstraintInfos& unsatisfiableY)
+        : cola::TestConvergence(1e-5, maxiterations),
+          component(component),
+          progress(progress),
+          unsatisfiableX(unsatisfiableX),
+          unsatisfiableY(unsatisfiableY) { }
+    bool operator()(const double new_stress,
+                valarray<double> & X, valarray<double> & Y)
+    {
+        progress.update(component, X, Y);
+        bool converged = TestConvergence::operator()(new_stress,X,Y);
+        if (!converged) {
+            for_each(unsatisfiableX.begin(), unsatisfiableX.end(), 
+                    delete_object());
+            unsatisfiableX.clear();
+            for_each(unsatisfiableY.begin(), unsatisfiableY.end(), 
+                    delete_object());
+            unsatisfiableY.clear();
+        }
+        return converged;
+    }
+private:
+    const cola::Component *component;
+    ComponentProgress& progress;
+    cola::UnsatisfiableConstraintInfos& unsatisfiableX;
+    cola::UnsatisfiableConstraintInfos& unsatisfiableY;
+};
+
+/**
+ * Lays out a single connected component, with its own ConstrainedFDLayout
+ * instance, on a worker thread.
+ */
+class ComponentLayoutTask : public QRunnable
+{
+    public:
+        ComponentLayoutTask(cola::Component *component,
+                ComponentPreIteration *preIteration,
+                ComponentProgress& progress,
+                const vector<double>& elengths, 
+                const cola::ShortestPathsCache& shortestPaths,
+                const double idealLength, const bool preventOverlaps, 
+                const unsigned maxiterations, const bool timed)
+            : component(component),
+              stress(0),
+              preIteration(preIteration),
+              progress(progress),
+              shortestPaths(shortestPaths),
+              idealLength(idealLength),
+              preventOverlaps(preventOverlaps),
+              maxiterations(maxiterations),
+              timed(timed)
+        {
+            setAutoDelete(false);
+            if (!elengths.empty())
+            {
+                for (size_t i = 0; i < component->edge_ids.size(); ++i)
+                {
+                    this->elengths.push_back(
+                            elengths[component->edge_ids[i]]);
+                }
+            }
+        }
+        void run(void)
+        {
+            // Take this component's path lengths from those for the 
+            // whole graph rather than computing them again.
+            const unsigned n = component->node_ids.size();
+            vector<double> pathLengths(n * n);
+            vector<double *> pathLengthRows(n);
+            for (unsigned i = 0; i < n; ++i)
+            {
+                pathLengthRows[i] = &pathLengths[i * n];
+            }
+            shortestPaths.copyPathLengths(component->node_ids,
+                    &pathLengthRows[0]);
+
+            ComponentConvergence done(maxiterations, component, progress,
+                    unsatisfiableX, unsatisfiableY);
+            cola::ConstrainedFDLayout alg(component->rects, 
+                    component->edges, idealLength, preventOverlaps, 
+                    elengths, &done, preIteration, &pathLengthRows[0]);
+            alg.setConstraints(component->ccs);
+            alg.setUnsatisfiableConstraintInfo(&unsatisfiableX,
+                    &unsatisfiableY);
+            alg.setPhaseTimings((timed) ? &timings : NULL);
+            alg.run(true,true);
+            if (timed)
+            {
+                stress = alg.computeStress();
+            }
+        }
+        cola::Component *component;
+        cola::UnsatisfiableConstraintInfos unsatisfiableX, unsatisfiableY;
+        cola::PhaseTimings timings;
+        double stress;
+    private:
+        ComponentPreIteration *preIteration;
+        ComponentProgress& progress;
+        const cola::ShortestPathsCache& shortestPaths;
+        vector<double> elengths;
+        const double idealLength;
+        const bool preventOverlaps;
+        const unsigned maxiterations;
+        const bool timed;
+};
+
+// Converts the variable indices of unsatisfiable constraints found when 
+// laying out a component back to indices for the whole graph.  Dummy 
+// variables, past the end of the component's nodes, don't correspond to
+// any variable in the whole graph and are given the index noNode.
+static void moveUnsatisfiableToGraph(cola::UnsatisfiableConstraintInfos& from,
+        const cola::Component *component, 
+        cola::UnsatisfiableConstraintInfos& to)
+{
+    const unsigned noNode = UINT_MAX;
+    const unsigned componentSize = component->node_ids.size();
+    for (cola::UnsatisfiableConstraintInfos::iterator i = from.begin();
+            i != from.end(); ++i)
+    {
+        cola::UnsatisfiableConstraintInfo *info = *i;
+        info->leftVarIndex = (info->leftVarIndex < componentSize) ?
+                component->node_ids[info->leftVarIndex] : noNode;
+        info->rightVarIndex = (info->rightVarIndex < componentSize) ?
+                component->node_ids[info->rightVarIndex] : noNode;
+        to.push_back(info);
+    }
+    from.clear();
+}
+
+
 
 int GraphLayout::initThread()
 {
@@ -946,59 +1042,92 @@ int GraphLayout::initThread()
 
 }
 
-// Animation that is used to redraw connectors.
-class ObjectsRepositionedAnimation : public QAbstractAnimation
+// Animates the movement of all shapes moved by a layout update.  Each step
+// moves every shape, then redraws connectors and the selection cue once.
+// If a step takes longer than the frame budget, then the remaining steps
+// would be too slow to look like movement anyway, so the shapes are moved
+// straight to their new positions instead.
+class LayoutAnimation : public QAbstractAnimation
 {
     public:
-        ObjectsRepositionedAnimation(Canvas *canvas)
-            :m_canvas(canvas)
+        LayoutAnimation(Canvas *canvas)
+            : m_canvas(canvas),
+              m_finished(false)
         {
         }
-        ~ObjectsRepositionedAnimation()
+        ~LayoutAnimation()
         {
         }
+        void addMove(ShapeObj *shape, const QPointF& endPos)
+        {
+            Move move = { shape, shape->centrePos(), endPos };
+            m_moves.push_back(move);
+        }
         int duration(void) const
         {
             return ANIMATION_DURATION;
         }
         void updateCurrentTime(const int value)
         {
-            Q_UNUSED (value)
+            if (m_finished || (value == 0))
+            {
+                // Nothing has moved yet.
+                return;
+            }
+            QElapsedTimer timer;
+            timer.start();
 
-            m_canvas->updateConnectorsForLayout();
+            qreal progress = qMin(qreal(1), value / qreal(duration()));
+            moveShapes(progress);
+            if ((progress < 1) && (timer.elapsed() > ANIMATION_FRAME_BUDGET))
+            {
+                moveShapes(1);
+            }
+        }
+    private:
+        struct Move
+        {
+            ShapeObj *shape;
+            QPointF startPos;
+            QPointF endPos;
+        };
+        void moveShapes(const qreal progress)
+        {
+            m_canvas->beginLayoutStep();
+            for (size_t i = 0; i < m_moves.size(); ++i)
+            {
+                const Move& move = m_moves[i];
+                move.shape->CanvasItem::setPos(move.startPos +
+                        (move.endPos - move.startPos) * progress);
+            }
+            m_finished = (progress >= 1);
+
+            m_canvas->updateConnectorsForLayout(m_finished);
 
             // Update selection cue after nodes have moved.
             bool computePositions = true;
             m_canvas->repositionAndShowSelectionResizeHandles(computePositions);
         }
-    private:
+
         Canvas *m_canvas;
+        std::vector<Move> m_moves;
+        bool m_finished;
 };
 
-struct CmpPosInfoPtrs
-{
-    bool operator()(const PosInfo *a, const PosInfo *b)
-    {
-        return a->processOrder < b->processOrder;
-    }
-};
 /**
  * called by the GUI thread to handle changes in position of objects from the layout thread
  */
 int GraphLayout::processReturnPositions()
 {
-    PosInfos returnPositions;
-
-    m_return_positions_mutex.lock();
-    returnPositions = retPositions;
-    retPositions.clear();
-    retPositionsHandled = true;
-    m_return_positions_mutex.unlock();
-
-    int movesCount = returnPositions.size();
-    //qDebug() << "processReturnPositions: retPositions.size() = " <<
-    //        returnPositions.size();
-    returnPositions.sort(CmpPosInfoPtrs());
+    LayoutFrame *frame = takeLatestFrame();
+    if (frame == NULL)
+    {
+        return 0;
+    }
+    int movesCount = frame->nodes.size() + frame->guidelines.size() +
+            frame->distributions.size() + frame->separations.size() +
+            frame->templates.size() + frame->routesCount +
+            frame->clustersCount;
 
     ConstraintDebug("\n*******START**********\n");
 
@@ -1006,31 +1135,100 @@ int GraphLayout::processReturnPositions()
     m_canvas->m_animation_group->stop();
     m_canvas->m_animation_group->clear();
 
+    // Order matters, because the guideline length will depend on the
+    // positions of the aligned shapes, etc.
     m_canvas->m_processing_layout_updates = true;
-    while (!returnPositions.empty())
+    ConstraintDebug("**  SHAPE\n");
+    // Do shape movement as an animation.
+    const bool synchronous = m_synchronous.loadAcquire();
+    LayoutAnimation *animation =
+            (synchronous) ? NULL : new LayoutAnimation(m_canvas);
+    for (size_t i = 0; i < frame->nodes.size(); ++i)
+    {
+        const LayoutFrame::Node& node = frame->nodes[i];
+        QPointF centre(node.x, node.y);
+        if (synchronous)
+        {
+            node.shape->CanvasItem::setPos(centre);
+        }
+        else if (centre != node.shape->centrePos())
+        {
+            animation->addMove(node.shape, centre);
+        }
+    }
+    ConstraintDebug("**  GUIDELINE\n");
+    for (size_t i = 0; i < frame->guidelines.size(); ++i)
     {
-        PosInfo* info = returnPositions.front();
-        info->process(m_canvas);
-        returnPositions.pop_front();
-#ifdef DEBUG_OVERLAY
-        if (info->debugHUD)
+        const LayoutFrame::GuidelinePosition& entry = frame->guidelines[i];
+        if (entry.guideline)
         {
-            debugHUDPositions.push_back(info);
+            entry.guideline->updateFromLayout(entry.position,
+                    entry.hasPosition);
+        }
+    }
+    ConstraintDebug("**  DISTRIBUTION\n");
+    for (size_t i = 0; i < frame->distributions.size(); ++i)
+    {
+        frame->distributions[i].distribution->updateFromLayout(
+                frame->distributions[i].space);
+    }
+    ConstraintDebug("**  SEPARATION\n");
+    for (size_t i = 0; i < frame->separations.size(); ++i)
+    {
+        frame->separations[i].separation->updateFromLayout(
+                frame->separations[i].gap);
+    }
+    for (size_t i = 0; i < frame->templates.size(); ++i)
+    {
+        frame->templates[i].templatePtr->updatePositionFromSolver(
+                frame->templates[i].position, false);
+    }
+    for (size_t i = 0; i < frame->conflicts.size(); ++i)
+    {
+        // used to report a conflicting (or unsatisfiable) constraint.
+        if (frame->conflicts[i].first)
+        {
+            frame->conflicts[i].first->setConstraintConflict(true);
+        }
+        if (frame->conflicts[i].second)
+        {
+            frame->conflicts[i].second->setConstraintConflict(true);
+        }
+    }
+    if (frame->hasPageBounds)
+    {
+        // communicate overrun of page bounds from layout
+        double page_buffer = m_canvas->visualPageBuffer();
+        m_canvas->setExpandedPage(frame->pageBounds.adjusted(
+                -page_buffer, -page_buffer, page_buffer, page_buffer));
+    }
+    for (size_t i = 0; i < frame->routesCount; ++i)
+    {
+        bool updateLibavoid = true;
+        frame->routes[i].connector->applyNewRoute(frame->routes[i].route,
+                updateLibavoid);
+    }
+    for (size_t i = 0; i < frame->clustersCount; ++i)
+    {
+        LayoutFrame::ClusterBoundary& cluster = frame->clusters[i];
+        if (cluster.hasBoundary)
+        {
+            cluster.cluster->setNewBoundary(cluster.points);
         }
         else
         {
-            delete info;
+            cluster.cluster->recomputeBoundary();
         }
-#else
-        delete info;
-#endif
     }
     m_canvas->m_processing_layout_updates = false;
 
-    // Finish every animation step off with ObjectsRepositionedAnimation
-    // which can be used to redraw connectors.  Then start the animation.
-    ObjectsRepositionedAnimation *animation =
-            new ObjectsRepositionedAnimation(m_canvas);
+    if (synchronous)
+    {
+        // Shapes were moved directly.
+        return movesCount;
+    }
+
+    // The animation also redraws connectors, even if no shapes moved.
     m_canvas->m_animation_group->addAnimation(animation);
     m_canvas->m_animation_group->start();
 
@@ -1048,20 +1246,88 @@ void GraphLayout::lockShape(ShapeObj* shape)
     }
 }
 
-void GraphLayout::clearReturnPosInfos(void)
+
+LayoutFrame::LayoutFrame()
+    : generation(0),
+      hasPageBounds(false),
+      routesCount(0),
+      clustersCount(0)
 {
-    retPositionsHandled = false;
-    for_each(retPositions.begin(), retPositions.end(), delete_object());
-    retPositions.clear();
+}
+
+void LayoutFrame::clear(void)
+{
+    nodes.clear();
+    guidelines.clear();
+    distributions.clear();
+    separations.clear();
+    templates.clear();
+    conflicts.clear();
+    hasPageBounds = false;
+    routesCount = 0;
+    clustersCount = 0;
+}
+
+LayoutFrame::Route& LayoutFrame::nextRoute(void)
+{
+    if (routesCount == routes.size())
+    {
+        routes.push_back(Route());
+    }
+    return routes[routesCount++];
+}
+
+LayoutFrame::ClusterBoundary& LayoutFrame::nextCluster(void)
+{
+    if (clustersCount == clusters.size())
+    {
+        clusters.push_back(ClusterBoundary());
+    }
+    return clusters[clustersCount++];
+}
+
+// Only ever called by the thread running the layout.
+LayoutFrame& GraphLayout::frameForWriting(void)
+{
+    return m_frames[m_frame_writing];
+}
+
+// Makes the frame just written the published frame, and takes the old one
+// to write next.  Returns true if the GUI had taken the old one, i.e., has
+// no update pending.
+bool GraphLayout::publishFrame(void)
+{
+    int old = m_frame_published.fetchAndStoreOrdered(
+            m_frame_writing | LayoutFrameFresh);
+    m_frame_writing = old & LayoutFrameIndexMask;
+    return !(old & LayoutFrameFresh);
+}
+
+// Called by the GUI thread.  Returns the latest frame published since the
+// last call, or NULL if there isn't one or it is out of date.
+LayoutFrame *GraphLayout::takeLatestFrame(void)
+{
+    if (!(m_frame_published.loadAcquire() & LayoutFrameFresh))
+    {
+        return NULL;
+    }
+    int old = m_frame_published.fetchAndStoreOrdered(m_frame_reading);
+    m_frame_reading = old & LayoutFrameIndexMask;
+    LayoutFrame *frame = &m_frames[m_frame_reading];
+    if (frame->generation != m_frame_generation.loadAcquire())
+    {
+        return NULL;
+    }
+    return frame;
 }
 
 void GraphLayout::addPinnedShapesToFixedList(void)
 {
     CanvasItemsList list;
-    QList<CanvasItem *> canvas_items = m_canvas->items();
-    for (int i = 0; i < canvas_items.size(); ++i)
+    QList<ShapeObj *> canvas_shapes = m_canvas->shapes();
+    for (int i = 0; i < canvas_shapes.size(); ++i)
     {
-        if (ShapeObj *shape = isShapeForLayout(canvas_items.at(i))) 
+        if (ShapeObj *shape = isShapeForLayout(canvas_shapes.at(i))) 
         {
             if (shape->isPinned())
             {
@@ -1103,7 +1369,7 @@ void GraphLayout::unpinAllShapes(QWidget ** c)
 {
     Q_UNUSED (c)
 
-    foreach (CanvasItem *item, m_canvas->items())
+    foreach (ShapeObj *item, m_canvas->shapes())
     {
         if (ShapeObj *shape = isShapeForLayout(item))
         {
@@ -1211,6 +1477,37 @@ bool GraphLayout::isRunning(void) const
     return m_is_running;
 }
 
+void GraphLayout::runSynchronously(LayoutTimings *timings)
+{
+    // Interrupt the layout thread and wait for it to go idle, since it
+    // would otherwise share m_graph with us.
+    setLayoutSuspended(true);
+    setInterruptFromDunnart();
+    bool running = true;
+    while (running)
+    {
+        m_layout_signal_mutex.lock();
+        running = m_is_running;
+        m_layout_signal_mutex.unlock();
+        if (running)
+        {
+            QThread::msleep(1);
+        }
+    }
+
+    m_synchronous.storeRelease(1);
+    m_timings = timings;
+    ignoreEdges = false;
+    runLevel = 0;
+    run(true);
+    processReturnPositions();
+    runLevel = 1;
+    run(true);
+    processReturnPositions();
+    m_timings = NULL;
+    m_synchronous.storeRelease(0);
+}
+
 void GraphLayout::setOptimizationMethod(OptimizationMethod newOM)
 {
     optimizationMethod = newOM;
@@ -1224,13 +1521,24 @@ void GraphLayout::setOptimizationMethod(OptimizationMethod newOM)
 void GraphLayout::initialise(void)
 {
     qDebug("GraphLayout::initialise: runlevel=%d",runLevel);
-    if (m_graph!=NULL)
-    {
-        delete m_graph;
-    }
+    GraphData *previous = m_graph;
     bool beautify = (runLevel == 1) ? true : false;
+    // The graph usually hasn't changed, or has changed only slightly, 
+    // so hand the constraints and what was computed for it on to the new
+    // GraphData.
+    QElapsedTimer timer;
+    timer.start();
     m_graph = new GraphData(m_canvas, ignoreEdges, mode,
-            beautify, topologyNodesCount);
+            beautify, topologyNodesCount, previous);
+    if (previous!=NULL)
+    {
+        m_graph->takeCachesFrom(previous);
+        delete previous;
+    }
+    if (m_timings)
+    {
+        m_timings->graph += timer.nsecsElapsed() / 1e9;
+    }
 }
 
 
@@ -1249,12 +1557,29 @@ void GraphLayout::run(const bool shouldReinitialise)
 
     vector<double> elengths;
     m_graph->getEdgeLengths(elengths);
+    QElapsedTimer timer;
+    timer.start();
+    const cola::ShortestPathsCache& shortestPaths = 
+            m_graph->getShortestPaths();
+    if (m_timings)
+    {
+        m_timings->shortestPaths += timer.nsecsElapsed() / 1e9;
+    }
+
+    if ((runLevel == 0) && !outputDebugFiles &&
+            runComponentsInParallel(preIter, postIter, elengths,
+                    shortestPaths))
+    {
+        return;
+    }
 
     cola::ConstrainedFDLayout alg(m_graph->rs, m_graph->edges,
             m_canvas->optIdealEdgeLengthModifier(),
-            m_canvas->optPreventOverlaps(), elengths, &postIter, &preIter);
+            m_canvas->optPreventOverlaps(), elengths, &postIter, &preIter,
+            shortestPaths.pathLengths());
     alg.setConstraints(m_graph->ccs);
     alg.setClusterHierarchy(&(m_graph->clusterHierarchy));
+    alg.setPhaseTimings((m_timings) ? &m_timings->layout : NULL);
     if (runLevel == 1)
     {
         if (shouldReinitialise)
@@ -1289,6 +1614,10 @@ void GraphLayout::run(const bool shouldReinitialise)
     }
     alg.setUnsatisfiableConstraintInfo(&unsatisfiableX,&unsatisfiableY);
     alg.run(true,true);
+    if (m_timings)
+    {
+        m_timings->stress = alg.computeStress();
+    }
     if (outputDebugFiles)
     {
         alg.outputInstanceToSVG();
@@ -1296,24 +1625,188 @@ void GraphLayout::run(const bool shouldReinitialise)
 }
 
 
+/**
+ * Lays out each connected component of the graph concurrently, in its own
+ * solver instance, and then packs any components that overlap so they no 
+ * longer do, leaving components with fixed or pinned shapes where they are.
+ * Nodes related by a compound constraint are treated as connected, so such
+ * constraints are still solved jointly.  Node positions are reported to the
+ * GUI as the components are laid out, and everything else once they have 
+ * all finished.
+ * @return false if the graph is too small to be worth splitting up, or 
+ *         can't be split up, in which case nothing has been done and it 
+ *         should be laid out as a whole.
+ */
+bool GraphLayout::runComponentsInParallel(PreIteration& preIter, 
+        PostIteration& postIter, const vector<double>& elengths,
+        const cola::ShortestPathsCache& shortestPaths)
+{
+    // Below this many nodes, the cost of finding the components and 
+    // starting threads outweighs the time saved.
+    static const unsigned minimumNodes = 200;
+    if (m_graph->rs.size() < minimumNodes)
+    {
+        return false;
+    }
+    if (!m_graph->clusterHierarchy.clusters.empty())
+    {
+        // Cluster hierarchies may span components.
+        return false;
+    }
+    for (cola::CompoundConstraints::iterator c = m_graph->ccs.begin();
+            c != m_graph->ccs.end(); ++c)
+    {
+        if (dynamic_cast<LinearTemplateConstraint *> (*c) ||
+            dynamic_cast<BranchedTemplateConstraint *> (*c) ||
+            dynamic_cast<RectangleConstraint *> (*c))
+        {
+            // These refer to nodes by index in ways that can't be remapped
+            // to the indices of nodes within a component.
+            return false;
+        }
+    }
+
+    vector<cola::Component *> components;
+    cola::connectedComponents(m_graph->rs, m_graph->edges, m_graph->ccs,
+            components);
+    if (components.size() < 2)
+    {
+        for_each(components.begin(), components.end(), delete_object());
+        return false;
+    }
+
+    // Read before the components are laid out, so that if the canvas
+    // changes in the meantime the GUI will drop the final frame.
+    const int generation = m_frame_generation.loadAcquire();
+
+    const unsigned n = m_graph->rs.size();
+    vector<cola::Component *> nodeComponents(n);
+    vector<unsigned> localIndices(n);
+    for (size_t i = 0; i < components.size(); ++i)
+    {
+        cola::Component *component = components[i];
+        for (unsigned j = 0; j < component->node_ids.size(); ++j)
+        {
+            nodeComponents[component->node_ids[j]] = component;
+            localIndices[component->node_ids[j]] = j;
+        }
+        component->mapConstraintsToComponent();
+    }
+
+    QMutex preIterationMutex;
+    ComponentProgress progress(postIter, m_graph->rs,
+            !m_synchronous.loadAcquire());
+    vector<cola::Locks> componentLocks(components.size());
+    vector<cola::Resizes> componentResizes(components.size());
+    vector<ComponentPreIteration *> preIterations;
+    vector<ComponentLayoutTask *> tasks;
+    QThreadPool pool;
+    for (size_t i = 0; i < components.size(); ++i)
+    {
+        ComponentPreIteration *componentPreIter = new ComponentPreIteration(
+                preIter, preIterationMutex, nodeComponents, localIndices,
+                components[i], componentLocks[i], componentResizes[i]);
+        preIterations.push_back(componentPreIter);
+        ComponentLayoutTask *task = new ComponentLayoutTask(components[i],
+                componentPreIter, progress, elengths, shortestPaths,
+                m_canvas->optIdealEdgeLengthModifier(),
+                m_canvas->optPreventOverlaps(), graph_layout_iterations,
+                m_timings != NULL);
+        tasks.push_back(task);
+        pool.start(task);
+    }
+    pool.waitForDone();
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        ComponentLayoutTask *task = tasks[i];
+        task->component->mapConstraintsFromComponent();
+        moveUnsatisfiableToGraph(task->unsatisfiableX, task->component,
+                unsatisfiableX);
+        moveUnsatisfiableToGraph(task->unsatisfiableY, task->component,
+                unsatisfiableY);
+    }
+    if (m_timings)
+    {
+        m_timings->stress = 0;
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            const cola::PhaseTimings& timings = tasks[i]->timings;
+            m_timings->layout.forces += timings.forces;
+            m_timings->layout.projection += timings.projection;
+            m_timings->layout.topology += timings.topology;
+            m_timings->layout.feasibility += timings.feasibility;
+            m_timings->layout.iterations += timings.iterations;
+            m_timings->stress += tasks[i]->stress;
+        }
+    }
+    for_each(tasks.begin(), tasks.end(), delete_object());
+    for_each(preIterations.begin(), preIterations.end(), delete_object());
+
+    if (m_canvas->optPreventOverlaps())
+    {
+        // Components holding a shape the user has moved, resized or pinned,
+        // or a guideline the user has moved, stay where they are.  Others
+        // take their guidelines with them as they move.
+        set<unsigned> fixedComponents;
+        m_changed_list_mutex.lock();
+        for (unsigned i = 0; i < components.size(); ++i)
+        {
+            const cola::CompoundConstraints& ccs = components[i]->ccs;
+            for (unsigned j = 0; j < ccs.size(); ++j)
+            {
+                cola::AlignmentConstraint *ac = 
+                        dynamic_cast<cola::AlignmentConstraint *> (ccs[j]);
+                if (ac && ac->isFixed())
+                {
+                    fixedComponents.insert(i);
+                    break;
+                }
+            }
+            const vector<unsigned>& ids = components[i]->node_ids;
+            for (unsigned j = 0; j < ids.size(); ++j)
+            {
+                ShapeObj *shape = m_graph->getShape(ids[j]);
+                if (shape && (fixedShapeLookup.find(shape) != 
+                        fixedShapeLookup.end()))
+                {
+                    fixedComponents.insert(i);
+                    break;
+                }
+            }
+        }
+        m_changed_list_mutex.unlock();
+        cola::separateComponents(components, fixedComponents);
+    }
+    for_each(components.begin(), components.end(), delete_object());
+
+    // Report the final positions back to the GUI.  This is done even if an
+    // interrupt is pending, since the components have already been moved
+    // and packed; the GUI drops the frame if the canvas has changed.
+    valarray<double> X(n), Y(n);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        X[i] = m_graph->rs[i]->getCentreX();
+        Y[i] = m_graph->rs[i]->getCentreY();
+    }
+    postIter.publishLayout(generation, X, Y);
+    return true;
+}
+
+
 void GraphLayout::setOutputDebugFiles(const bool value)
 {
     outputDebugFiles = value;
 }
 
-void GraphLayout::showUnsatisfiable(cola::UnsatisfiableConstraintInfo* i)
+void GraphLayout::showUnsatisfiable(cola::UnsatisfiableConstraintInfo* i,
+        LayoutFrame& frame)
 {
     qWarning("%s", i->toString().c_str());
 
     ShapeObj *s1 = m_graph->getShape(i->leftVarIndex);
     ShapeObj *s2 = m_graph->getShape(i->rightVarIndex);
-    if(s1 && s2) {
-        retPositions.push_back(
-                new TraceLinePosInfo(
-                    s1->centrePos(), s2->centrePos(), 0));
-    }
-    
-    retPositions.push_back(new ConflictPosInfo(s1, s2));
+    frame.conflicts.push_back(std::make_pair(s1, s2));
 }
 
 }
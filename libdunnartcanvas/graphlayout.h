@@ -27,13 +27,16 @@
 #ifndef GRAPHLAYOUT_H
 #define GRAPHLAYOUT_H
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QSet>
 
 #include <set>
+#include <vector>
 
 #include "libcola/cola.h"
+#include "libavoid/geomtypes.h"
 #include "libdunnartcanvas/shape.h"
 #include "libdunnartcanvas/canvas.h"
 
@@ -41,53 +44,40 @@ namespace vpsc {
     class Rectangle;
 };
 
+namespace cola {
+    class ShortestPathsCache;
+};
+
 namespace dunnart {
 
 class GraphLayout;
 class Cluster;
+class Connector;
+class Guideline;
+class Distribution;
+class Separation;
+class Template;
 class GraphData;
 class LayoutThread;
+struct PreIteration;
+class PostIteration;
 
 /**
- * A PosInfo is used primarily to pass position info for shapes and constraint
- * widgets between the GUI and graph layout threads.  At the end of each layout
- * iteration, the PostIteration callback creates a list of PosInfos containing
- * the updated positions of all objects.  The GUI thread later calls process()
- * to handle the updated positions.  Optionally, processHUD may be called by
- * the GUI thread to draw a debug "Head Up Display" for the associated
- * shape/widget.  PosInfos can also be created by the GUI thread to tell the
- * layout thread that certain objects should be fixed at their current position
- * (these are processed by the layout thread by calling
- * fixGraphLayoutPosition().
+ * A PosInfo is created by the GUI thread to tell the layout thread that
+ * certain objects should be fixed at their current position (these are
+ * processed by the layout thread by calling fixGraphLayoutPosition()).
+ * Positions are passed back the other way in a LayoutFrame.
  */
 class PosInfo
 {
 public:
     PosInfo();
-    PosInfo(bool debugHUD, unsigned short HUDTimer);
-
-    // called by GUI thread to whatever needs to be done with the
-    // object after each layout iteration
-    virtual void process(Canvas *canvas) = 0;
-
-    // called by GUI thread to draw any debug HUD
-    bool processHUD(QPixmap *sur) {
-        if(debugHUD) {
-            HUDTimer--;
-            myProcessHUD(sur);
-            return HUDTimer>0;
-        }
-        return false;
-    };
 
     virtual bool isNull(void)
     {
         return true;
     }
 
-    // HUD details specific to implementation
-    virtual void myProcessHUD(QPixmap *sur) { Q_UNUSED (sur) };
-
     // called by graphlayout thread to fix the position of objects
     virtual void fixGraphLayoutPosition(GraphData* g,cola::Locks& locks,cola::Resizes& resizes)
     {
@@ -96,21 +86,121 @@ public:
         Q_UNUSED (resizes)
     }
 
+    // the compound constraint whose position or spacing this fixes, if any
+    virtual cola::CompoundConstraint *constraint(GraphData *g)
+    {
+        Q_UNUSED (g)
+        return NULL;
+    }
+
     virtual ~PosInfo() {};
 
-    // allows HUDs to be controlled at a finer level of granularity
-    bool debugHUD;
-    unsigned int processOrder;
 protected:
     GraphLayout *gl;
-private:
-    // controls the life time of the HUD, i.e. the number of times it is to be redrawn
-    unsigned short HUDTimer;
 };
 typedef std::list<PosInfo *> PosInfos;
 
 struct ShapePosInfo;
 
+/**
+ * A LayoutFrame holds the result of one layout iteration, for the GUI
+ * thread to apply: a flat array of node boxes plus small side tables for
+ * the constraint indicators and, at run level 1, connector routes and
+ * cluster boundaries.  Frames are reused from iteration to iteration, so
+ * once their tables have grown filling them doesn't allocate.
+ */
+struct LayoutFrame
+{
+    // The layout's box for a shape, including non-overlap padding.
+    struct Node
+    {
+        ShapeObj *shape;
+        double x, y;
+        double width, height;
+    };
+    struct GuidelinePosition
+    {
+        Guideline *guideline;
+        double position;
+        bool hasPosition;
+    };
+    struct DistributionSpace
+    {
+        Distribution *distribution;
+        double space;
+    };
+    struct SeparationGap
+    {
+        Separation *separation;
+        double gap;
+    };
+    struct TemplatePosition
+    {
+        Template *templatePtr;
+        double position;
+    };
+    struct Route
+    {
+        Connector *connector;
+        Avoid::PolyLine route;
+    };
+    struct ClusterBoundary
+    {
+        Cluster *cluster;
+        // Otherwise the cluster's boundary is recomputed from its members.
+        bool hasBoundary;
+        std::vector<Avoid::Point> points;
+    };
+
+    LayoutFrame();
+    void clear(void);
+    // Returns the next entry of routes or clusters, reusing old entries so
+    // their point vectors keep their capacity.
+    Route& nextRoute(void);
+    ClusterBoundary& nextCluster(void);
+
+    // The value of GraphLayout's frame generation when the frame was
+    // started.  Frames from an earlier generation may refer to items
+    // that no longer exist, and are dropped.
+    int generation;
+    std::vector<Node> nodes;
+    std::vector<GuidelinePosition> guidelines;
+    std::vector<DistributionSpace> distributions;
+    std::vector<SeparationGap> separations;
+    std::vector<TemplatePosition> templates;
+    std::vector<std::pair<CanvasItem *, CanvasItem *> > conflicts;
+    bool hasPageBounds;
+    QRectF pageBounds;
+    std::vector<Route> routes;
+    size_t routesCount;
+    std::vector<ClusterBoundary> clusters;
+    size_t clustersCount;
+};
+
+/**
+ * Elapsed time, in seconds, spent in each phase of layout by GraphLayout,
+ * for profiling.  Times are added to on each run, so the same instance may
+ * be used to total several runs.  When components of the graph are laid out
+ * concurrently, their times, iterations and stresses are added together.
+ */
+struct LayoutTimings
+{
+    LayoutTimings()
+        : graph(0),
+          shortestPaths(0),
+          stress(0)
+    {
+    }
+    //! Building the GraphData for the canvas.
+    double graph;
+    //! Computing the shortest paths between nodes.
+    double shortestPaths;
+    //! The phases of cola layout.
+    cola::PhaseTimings layout;
+    //! The stress of the last layout, not a time.
+    double stress;
+};
+
 /**
  * GraphLayout is a singleton class (there should only ever be one layout instance)
  * which provides the interface between the dunnart GUI
@@ -182,6 +272,11 @@ public:
     void setOutputDebugFiles(const bool value);
     //! whether the layout thread is currently active.
     bool isRunning(void) const;
+    //! lays out the canvas to convergence in the calling thread, through
+    //  both run levels, moving shapes directly rather than animating them.
+    //  The layout thread is suspended first, and left suspended.  If 
+    //  timings is given, the time spent in each phase is added to it.
+    void runSynchronously(LayoutTimings *timings = NULL);
 
 private:
     Canvas *m_canvas;
@@ -189,13 +284,23 @@ private:
     //! the graph itself and mappings to/from dunnart objects
     GraphData *m_graph;
     bool m_is_running;
-    // The following are lists of PosInfo used to communicate between the GUI
-    PosInfos retPositions;
+    // Set while runSynchronously() is laying out in the calling thread.
+    // It is read by both threads, so is atomic.
+    QAtomicInt m_synchronous;
+    // Layout results are passed to the GUI through a triple buffer.  The
+    // layout thread fills m_frames[m_frame_writing], then swaps it with
+    // the published frame, which the GUI swaps with m_frames[
+    // m_frame_reading] when it next takes an update.  Neither thread
+    // waits for the other, and the GUI always gets the latest frame.
+    LayoutFrame m_frames[3];
+    int m_frame_writing;
+    int m_frame_reading;
+    QAtomicInt m_frame_published;
+    QAtomicInt m_frame_generation;
+    LayoutTimings *m_timings;
     PosInfos fixedPositions;
-    bool retPositionsHandled;
     bool outputDebugFiles;
     // The following control IPC between layout and GUI threads
-    QMutex m_return_positions_mutex;
     QMutex m_layout_mutex;
     QWaitCondition m_layout_wait_condition;
     QMutex m_layout_signal_mutex;
@@ -213,11 +318,17 @@ private:
 
     cola::UnsatisfiableConstraintInfos unsatisfiableX, unsatisfiableY;
     void run(const bool shouldReinitialise);
-    void showUnsatisfiable(cola::UnsatisfiableConstraintInfo* i);
+    bool runComponentsInParallel(PreIteration& preIter, 
+            PostIteration& postIter, const std::vector<double>& elengths,
+            const cola::ShortestPathsCache& shortestPaths);
+    void showUnsatisfiable(cola::UnsatisfiableConstraintInfo* i,
+            LayoutFrame& frame);
     void addToFixedList(CanvasItemsList & objList);
     void addPinnedShapesToFixedList(void);
     void addToResizedList(CanvasItemsList & objList);
-    void clearReturnPosInfos(void);
+    LayoutFrame& frameForWriting(void);
+    bool publishFrame(void);
+    LayoutFrame *takeLatestFrame(void);
 
     friend struct PreIteration;
     friend class PostIteration;
@@ -86,7 +86,10 @@ SOURCES += \
     ui/shapepickerdialog.cpp \
     connectorhandles.cpp \
     ui/undohistorydialog.cpp \
-    stronglyconnectedcomponents.cpp \
+    directedlayering.cpp \
+    diagramreader.cpp \
+    diagramwriter.cpp \
+    xmlelementsnapshot.cpp \
     connectionpininfo.cpp \
     canvasapplication.cpp \
     pluginapplicationmanager.cpp \
@@ -139,7 +142,10 @@ HEADERS += \
     ui/shapepickerdialog.h \
     connectorhandles.h \
     ui/undohistorydialog.h \
-    stronglyconnectedcomponents.h \
+    directedlayering.h \
+    diagramreader.h \
+    diagramwriter.h \
+    xmlelementsnapshot.h \
     connectionpininfo.h \
     shapeplugininterface.h \
     fileioplugininterface.h \
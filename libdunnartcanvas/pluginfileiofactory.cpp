@@ -118,6 +118,28 @@ bool PluginFileIOFactory::saveDiagramToFile(Canvas *canvas,
     return false;
 }
 
+bool PluginFileIOFactory::canWriteDiagram(const QFileInfo& fileInfo) const
+{
+    QString fileExtension = fileInfo.suffix();
+    return m_file_saving_handlers.contains(fileExtension) &&
+            m_file_saving_handlers[fileExtension]->canWriteDiagram();
+}
+
+bool PluginFileIOFactory::writeDiagram(Canvas *canvas,
+        const QFileInfo& fileInfo, DiagramWriter& writer,
+        QString& errorMessage)
+{
+    if (canWriteDiagram(fileInfo))
+    {
+        return m_file_saving_handlers[fileInfo.suffix()]->
+                writeDiagram(canvas, fileInfo, writer, errorMessage);
+    }
+
+    // This shouldn't really happen, but just in case.
+    errorMessage = QObject::tr("File handler plugin was not available.");
+    return false;
+}
+
 bool PluginFileIOFactory::loadDiagramFromFile(Canvas *canvas,
         const QFileInfo& fileInfo, QString& errorMessage)
 {
@@ -36,6 +36,7 @@ class QFileInfo;
 namespace dunnart {
 
 class Canvas;
+class DiagramWriter;
 class FileIOPluginInterface;
 
 typedef QMap<QString, FileIOPluginInterface *> FileIOHandlers;
@@ -49,6 +50,9 @@ public:
             QString& errorMessage);
     bool loadDiagramFromFile(Canvas *canvas, const QFileInfo& fileInfo,
             QString& errorMessage);
+    bool canWriteDiagram(const QFileInfo& fileInfo) const;
+    bool writeDiagram(Canvas *canvas, const QFileInfo& fileInfo,
+            DiagramWriter& writer, QString& errorMessage);
     QString openableFileTypesString(void) const;
     QString openableFileFiltersString(void) const;
     QString saveableFileFiltersString(void) const;
@@ -104,6 +104,8 @@ void ShapeObj::routerAdd(void)
     int pid = poly._id;
     assert(avoidRef == NULL);
     avoidRef = new Avoid::ShapeRef(router, poly, pid);
+    m_router_centre = centrePos();
+    m_router_size = size();
 
     for (int i = 0; i < m_connection_pins.size(); ++i)
     {
@@ -162,6 +164,7 @@ void ShapeObj::routerRemove(void)
         return;
     }
     Avoid::Router *router = canvas()->router();
+    canvas()->m_router_moved_shapes.remove(this);
 
     // Delete shape
     router->deleteShape(avoidRef);
@@ -175,11 +178,30 @@ void ShapeObj::routerMove(void)
     {
         return;
     }
-    Avoid::Router *router = canvas()->router();
+    Canvas *canvas = this->canvas();
+    if (canvas->m_in_layout_step)
+    {
+        // The canvas passes this on once the layout step is done.
+        canvas->m_router_moved_shapes.insert(this);
+        return;
+    }
+    canvas->m_router_moved_shapes.remove(this);
+    Avoid::Router *router = canvas->router();
 
     // Move shape
     Avoid::Polygon poly = polygon();
     router->moveShape(avoidRef, poly);
+    m_router_centre = centrePos();
+    m_router_size = size();
+}
+
+
+qreal ShapeObj::routerMoveDistance(void) const
+{
+    QPointF moved = centrePos() - m_router_centre;
+    QSizeF resized = size() - m_router_size;
+    return qMax(qMax(qAbs(moved.x()), qAbs(moved.y())),
+            qMax(qAbs(resized.width()), qAbs(resized.height())));
 }
 
 
@@ -342,6 +364,24 @@ void ShapeObj::paint(QPainter *painter,
     assert(painter->isActive());
     bool showDecorations = canvas() && ! canvas()->isRenderingForPrinting();
 
+    if (canvas() &&
+            (canvas()->renderDetail(painter) == Canvas::RenderSimplified))
+    {
+        // Zoomed well out, so just draw a box.
+        QPen pen(strokeColour());
+        pen.setCosmetic(true);
+        if ( isSelected() && canvas()->inSelectionMode() )
+        {
+            pen.setColor(QColor(0, 255, 255));
+        }
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(pen);
+        painter->setBrush(QBrush(fillColour()));
+        painter->drawRect(QRectF(-width() / 2, -height() / 2,
+                width(), height()));
+        return;
+    }
+
     if ( isSelected() && showDecorations && canvas()->inSelectionMode() )
     {
         QColor colour(0, 255, 255, 100);
@@ -777,6 +817,34 @@ void ShapeObj::setCentrePos(const QPointF & pos)
     CanvasItem::setPos(pos);
 }
 
+void ShapeObj::cmd_setCentrePos(const QPointF newCentrePos)
+{
+    if (centrePos() == newCentrePos)
+    {
+        return;
+    }
+    if (canvas())
+    {
+        canvas()->currentUndoMacro()->addShapeGeometry(this, centrePos(),
+                size(), newCentrePos, size());
+    }
+    setCentrePos(newCentrePos);
+}
+
+void ShapeObj::cmd_setSize(const QSizeF newSize)
+{
+    if (size() == newSize)
+    {
+        return;
+    }
+    if (canvas())
+    {
+        canvas()->currentUndoMacro()->addShapeGeometry(this, centrePos(),
+                size(), centrePos(), newSize);
+    }
+    setSize(newSize);
+}
+
 QPointF ShapeObj::centrePos(void) const
 {
     return pos();
@@ -807,7 +875,9 @@ void ShapeObj::paintShapeDecorations(QPainter *painter)
     }
 #endif
 
-    if ( ! m_is_collapsed )
+    // Labels are unreadable when zoomed well out, and slow to lay out.
+    if ( ! m_is_collapsed && ( ! canvas() ||
+            (canvas()->renderDetail(painter) == Canvas::RenderFullDetail) ) )
     {
         paintLabel(painter);
     }
@@ -914,28 +984,35 @@ static int wrapQString(const QString& text, int width,
 }
 #endif
 
-void ShapeObj::addXmlProps(const unsigned int subset, QDomElement& node,
-        QDomDocument& doc)
+XmlElementSnapshot ShapeObj::xmlSnapshot(const unsigned int subset)
+{
+    XmlElementSnapshot element("dunnart:node");
+    snapshotXmlProps(subset, element);
+    return element;
+}
+
+void ShapeObj::snapshotXmlProps(const unsigned int subset,
+        XmlElementSnapshot& element)
 {
-    CanvasItem::addXmlProps(subset, node, doc);
+    CanvasItem::snapshotXmlProps(subset, element);
 
     if (subset & XMLSS_IMOVE)
     {
-        newProp(node, x_centreX, x());
-        newProp(node, x_centreY, y());
+        newProp(element, x_centreX, x());
+        newProp(element, x_centreY, y());
     }
 
     if (subset & XMLSS_IRESIZE)
     {
-        newProp(node, x_width, width());
-        newProp(node, x_height, height());
+        newProp(element, x_width, width());
+        newProp(element, x_height, height());
     }
     
     if (subset & XMLSS_ILABEL)
     {
         if (! m_label.isEmpty())
         {
-            newProp(node, x_label, m_label);
+            newProp(element, x_label, m_label);
         }
     }
 
@@ -947,7 +1024,7 @@ void ShapeObj::addXmlProps(const unsigned int subset, QDomElement& node,
             value = value.sprintf("%02x%02x%02x%02x", m_fill_colour.red(),
                     m_fill_colour.green(), m_fill_colour.blue(),
                     m_fill_colour.alpha());
-            newProp(node, x_fillCol, value);
+            newProp(element, x_fillCol, value);
         }
         if (m_stroke_colour != shLineCol)
         {
@@ -955,19 +1032,19 @@ void ShapeObj::addXmlProps(const unsigned int subset, QDomElement& node,
             value = value.sprintf("%02x%02x%02x%02x", m_stroke_colour.red(),
                     m_stroke_colour.green(), m_stroke_colour.blue(),
                     m_stroke_colour.alpha());
-            newProp(node, x_lineCol, value);
+            newProp(element, x_lineCol, value);
         }
 
         if (m_detail_level != 1)
         {
             QString value;
             value = value.sprintf("%u", m_detail_level);
-            newProp(node, "detailLevel", value);
+            newProp(element, "detailLevel", value);
         }
 
         if (m_is_pinned)
         {
-            newProp(node, x_lockedPosition, "1");
+            newProp(element, x_lockedPosition, "1");
         }
 
         // Store info about all connection pins other than the centre one,
@@ -975,8 +1052,7 @@ void ShapeObj::addXmlProps(const unsigned int subset, QDomElement& node,
         QString pinRepStr;
         for (int i = 1; i < m_connection_pins.size(); ++i)
         {
-            QDomElement pinNode = m_connection_pins[i].pinAsDomElement(doc);
-            node.appendChild(pinNode);
+            element.appendChild(m_connection_pins[i].pinAsXmlSnapshot());
         }
     }
 }
@@ -101,9 +101,6 @@ class ShapeObj: public CanvasItem
     // QMarginsF not handled by qtpropertybrowser.
     //Q_PROPERTY (QMarginsF containmentPadding READ containmentPadding() WRITE setContainmentPadding())
 
-    UNDO_ACTION (ShapeObj, QPointF, centrePos, setCentrePos, UNDO_SHAPE_POS, "move shape")
-    UNDO_ACTION (ShapeObj, QSizeF, size, setSize, UNDO_SHAPE_SIZE, "resize shape")
-
     public:
         ShapeObj(const QString& itemType);
         virtual ~ShapeObj();
@@ -146,8 +143,9 @@ class ShapeObj: public CanvasItem
 
         virtual void cascade_distance(int dist, unsigned int dir,
                 CanvasItem **path);
-        virtual void addXmlProps(const unsigned int subset, QDomElement& node,
-                QDomDocument& doc);
+        virtual XmlElementSnapshot xmlSnapshot(const unsigned int subset);
+        virtual void snapshotXmlProps(const unsigned int subset,
+                XmlElementSnapshot& element);
 
         void addContainedShape(ShapeObj *shape);
         void addContainedShapes(QList<ShapeObj *>& shapes);
@@ -177,6 +175,10 @@ class ShapeObj: public CanvasItem
         virtual void setSize(const QSizeF& size);
         void setPosAndSize(const QPointF& newCentrePos, const QSizeF& newSize);
         virtual void setCentrePos(const QPointF & pos);
+        // As setCentrePos() and setSize(), but recorded in the current
+        // undo macro.
+        void cmd_setCentrePos(const QPointF newCentrePos);
+        void cmd_setSize(const QSizeF newSize);
         virtual Avoid::Polygon polygon(void) const;
         void paintLabel(QPainter *painter);
         virtual QRectF labelBoundingRect(void) const;
@@ -265,8 +267,16 @@ class ShapeObj: public CanvasItem
         uint m_detail_level;
         bool m_being_resized;
         QMarginsF m_containment_padding;
+        // Geometry last passed to the router.
+        QPointF m_router_centre;
+        QSizeF m_router_size;
+
+        // How far the shape has moved or resized since its geometry was
+        // last passed to the router.
+        qreal routerMoveDistance(void) const;
 
         friend class Cluster;
+        friend class Canvas;
 };
 
 typedef std::list<ShapeObj *> ShapeList;
@@ -139,6 +139,26 @@ void SvgShape::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
     assert(painter->isActive());
     assert(option);
 
+    QRectF rect = shapeRect();
+    rect.moveTopLeft(QPointF(0,0));
+
+    if (canvas() &&
+            (canvas()->renderDetail(painter) == Canvas::RenderSimplified))
+    {
+        // Zoomed well out, so just draw a box rather than the SVG.
+        QPen pen(strokeColour());
+        pen.setCosmetic(true);
+        if ( isSelected() && canvas()->inSelectionMode() )
+        {
+            pen.setColor(QColor(0, 255, 255));
+        }
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(pen);
+        painter->setBrush(QBrush(fillColour()));
+        painter->drawRect(rect);
+        return;
+    }
+
     bool showDecorations = canvas() && ! canvas()->isRenderingForPrinting();
     if ( isSelected() && showDecorations && canvas()->inSelectionMode() )
     {
@@ -150,8 +170,6 @@ void SvgShape::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
         painter->setPen(highlight);
         //painter->setBrush(QBrush(QColor(0, 255, 255, 100)));
 
-        QRectF rect = shapeRect();
-        rect.moveTopLeft(QPointF(0,0));
         painter->drawRect(rect);
     }
 
@@ -54,6 +54,10 @@ class LinearTemplateConstraint : public cola::CompoundConstraint
 //            printf("---- %g\n", sep);
         }
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void)
+        {
+            variable = NULL;
+        }
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& cs,
                 std::vector<vpsc::Rectangle*>& bbs);
@@ -121,6 +125,11 @@ class RectangleConstraint : public cola::CompoundConstraint
             stateListY = std::vector<double>(idList.size(), 0); 
         }
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void)
+        {
+            xVariableLow = xVariableHigh = NULL;
+            yVariableLow = yVariableHigh = NULL;
+        }
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& cs,
                 std::vector<vpsc::Rectangle*>& bbs);
@@ -178,6 +187,10 @@ class BranchedTemplateConstraint : public cola::CompoundConstraint
         }
 
         void generateVariables(const vpsc::Dim dim, vpsc::Variables& vars);
+        void clearVariables(void)
+        {
+            variable = NULL;
+        }
         void generateSeparationConstraints(const vpsc::Dim dim, 
                 vpsc::Variables& vars, vpsc::Constraints& cs,
                 std::vector<vpsc::Rectangle*>& bbs);
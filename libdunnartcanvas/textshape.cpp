@@ -361,20 +361,16 @@ const unsigned int TextShape::getFontSize(void)
 #endif
 
 
-QDomElement TextShape::to_QDomElement(const unsigned int subset, 
-        QDomDocument& doc)
+void TextShape::snapshotXmlProps(const unsigned int subset,
+        XmlElementSnapshot& element)
 {
-    QDomElement node = doc.createElement("dunnart:node");
-    
     if (subset & XMLSS_IOTHER)
     {
-        //newProp(node, x_label, txtStr);
-        newProp(node, x_fontSize, fontSize);
+        //newProp(element, x_label, txtStr);
+        newProp(element, x_fontSize, fontSize);
     }
 
-    addXmlProps(subset, node, doc);
-
-    return node;
+    ShapeObj::snapshotXmlProps(subset, element);
 }
 
 
@@ -42,8 +42,8 @@ class TextShape: public ShapeObj
 
         virtual void initWithXMLProperties(Canvas *canvas,
                 const QDomElement& node, const QString& ns);
-        virtual QDomElement to_QDomElement(const unsigned int subset,
-                QDomDocument& doc);
+        virtual void snapshotXmlProps(const unsigned int subset,
+                XmlElementSnapshot& element);
         Avoid::Polygon polygon(void) const;
         virtual void setLabel(const QString& label);
 
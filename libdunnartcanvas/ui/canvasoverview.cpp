@@ -122,32 +122,28 @@ class CanvasOverviewWidget : public QWidget
 
             // Draw edges in overview for each connector on the canvas.
             painter.setPen(QColor(0, 0, 0, 100));
-            QList<CanvasItem *> items = canvas->items();
-            for (int i = 0; i < items.count(); ++i)
+            foreach (Connector *connector, canvas->connectors())
             {
-                Connector *connector = dynamic_cast<Connector *> (items.at(i));
-                if (connector)
+                QPair<ShapeObj *, ShapeObj *> endShapes =
+                        connector->getAttachedShapes();
+                if (!endShapes.first || !endShapes.second)
                 {
-                    QPair<ShapeObj *, ShapeObj *> endShapes =
-                            connector->getAttachedShapes();
-                    if (!endShapes.first || !endShapes.second)
-                    {
-                        continue;
-                    }
-
-                    QLineF line(endShapes.first->centrePos(),
-                                endShapes.second->centrePos());
-                    painter.drawLine(m_transform.map(line));
+                    continue;
                 }
+
+                QLineF line(endShapes.first->centrePos(),
+                            endShapes.second->centrePos());
+                painter.drawLine(m_transform.map(line));
             }
 
             // Draw light rectangles in overview for each cluster on canvas.
             painter.setPen(Qt::darkGray);
             painter.setBrush(Qt::lightGray);
             QRectF shapeRect;
-            for (int i = 0; i < items.count(); ++i)
+            QList<ShapeObj *> shapes = canvas->shapes();
+            for (int i = 0; i < shapes.count(); ++i)
             {
-                Cluster *cluster = dynamic_cast<Cluster *> (items.at(i));
+                Cluster *cluster = dynamic_cast<Cluster *> (shapes.at(i));
                 if (cluster)
                 {
                     shapeRect.setSize(cluster->size());
@@ -160,11 +156,11 @@ class CanvasOverviewWidget : public QWidget
             // Draw Rectangles in overview for each shape on the canvas.
             painter.setPen(Qt::black);
             painter.setBrush(Qt::darkGray);
-            for (int i = 0; i < items.count(); ++i)
+            for (int i = 0; i < shapes.count(); ++i)
             {
-                ShapeObj *shape = dynamic_cast<ShapeObj *> (items.at(i));
-                Cluster *cluster = dynamic_cast<Cluster *> (items.at(i));
-                if (shape && !cluster)
+                ShapeObj *shape = shapes.at(i);
+                Cluster *cluster = dynamic_cast<Cluster *> (shape);
+                if (!cluster)
                 {
                     // Clusters are also shapes.
                     shapeRect.setSize(shape->size());
@@ -26,16 +26,25 @@
 #include "libdunnartcanvas/undo.h"
 #include "libdunnartcanvas/canvas.h"
 #include "libdunnartcanvas/canvasitem.h"
+#include "libdunnartcanvas/shape.h"
 
 namespace dunnart {
 
+// A rough estimate of the memory used by each command other than shape
+// geometry changes.
+static const qint64 x_commandMemoryUsage = 128;
+
 UndoMacro::UndoMacro(Canvas *canvas)
-    : m_canvas(canvas)
+    : m_canvas(canvas),
+      m_discarded(false),
+      m_done(false),
+      m_counted_usage(0)
 {
 }
 
 UndoMacro::~UndoMacro()
 {
+    uncount();
     foreach (QUndoCommand *cmd, m_undo_commands)
     {
         delete cmd;
@@ -45,6 +54,7 @@ UndoMacro::~UndoMacro()
 
 void UndoMacro::addCommand(QUndoCommand *command)
 {
+    m_canvas->countEdit();
     for (int i = 0; i < m_undo_commands.size(); ++i)
     {
         if (m_undo_commands.at(i)->mergeWith(command))
@@ -53,11 +63,113 @@ void UndoMacro::addCommand(QUndoCommand *command)
             return;
         }
     }
+    if (!m_undo_commands.empty() &&
+            (m_undo_commands.last()->id() == UNDO_SHAPE_GEOMETRY))
+    {
+        // Nothing more will be recorded into the previous command.
+        static_cast<CmdShapeGeometry *> (m_undo_commands.last())->squeeze();
+    }
     m_undo_commands.append(command);
 }
 
+void UndoMacro::addShapeGeometry(ShapeObj *shape, const QPointF& oldCentre,
+        const QSizeF& oldSize, const QPointF& newCentre,
+        const QSizeF& newSize)
+{
+    m_canvas->countEdit();
+
+    // Consecutive geometry changes share a command.  Once some other
+    // command comes between, a new one is started, so that changes are
+    // still undone in the order they were made.
+    CmdShapeGeometry *cmd = NULL;
+    if (!m_undo_commands.empty() &&
+            (m_undo_commands.last()->id() == UNDO_SHAPE_GEOMETRY))
+    {
+        cmd = static_cast<CmdShapeGeometry *> (m_undo_commands.last());
+    }
+    else
+    {
+        cmd = new CmdShapeGeometry();
+        m_undo_commands.append(cmd);
+    }
+    cmd->addShapeGeometry(shape, oldCentre, oldSize, newCentre, newSize);
+}
+
+qint64 UndoMacro::memoryUsage(void) const
+{
+    qint64 usage = sizeof(UndoMacro);
+    foreach (QUndoCommand *cmd, m_undo_commands)
+    {
+        if (cmd->id() == UNDO_SHAPE_GEOMETRY)
+        {
+            usage += static_cast<CmdShapeGeometry *> (cmd)->memoryUsage();
+        }
+        else
+        {
+            usage += x_commandMemoryUsage;
+        }
+    }
+    return usage;
+}
+
+void UndoMacro::squeeze(void)
+{
+    foreach (QUndoCommand *cmd, m_undo_commands)
+    {
+        if (cmd->id() == UNDO_SHAPE_GEOMETRY)
+        {
+            static_cast<CmdShapeGeometry *> (cmd)->squeeze();
+        }
+    }
+}
+
+void UndoMacro::discard(void)
+{
+    if (m_discarded)
+    {
+        return;
+    }
+    foreach (QUndoCommand *cmd, m_undo_commands)
+    {
+        delete cmd;
+    }
+    m_undo_commands.clear();
+    m_discarded = true;
+    uncount();
+#if QT_VERSION >= 0x050900
+    // Have the undo stack delete the macro when it reaches it.
+    setObsolete(true);
+#endif
+}
+
+void UndoMacro::uncount(void)
+{
+    if (m_counted_usage == 0)
+    {
+        return;
+    }
+    // Macros are discarded from the oldest end and deleted by the stack
+    // from the newest, so either end finds this one quickly.
+    QList<UndoMacro *>& kept = m_canvas->m_undo_macros_kept;
+    if (!kept.isEmpty() && (kept.first() == this))
+    {
+        kept.removeFirst();
+    }
+    else
+    {
+        kept.removeAt(kept.lastIndexOf(this));
+    }
+    m_canvas->m_undo_memory_usage -= m_counted_usage;
+    m_counted_usage = 0;
+}
+
 void UndoMacro::undo()
 {
+    m_done = false;
+    if (m_discarded)
+    {
+        return;
+    }
     //qDebug("- Undo:");
     for (int i = m_undo_commands.size() - 1; i >= 0; --i)
     {
@@ -69,6 +181,11 @@ void UndoMacro::undo()
 
 void UndoMacro::redo()
 {
+    m_done = true;
+    if (m_discarded)
+    {
+        return;
+    }
     //qDebug("- Redo:");
     for (int i = 0; i < m_undo_commands.size(); ++i)
     {
@@ -83,6 +200,105 @@ void UndoMacro::redo()
 }
 
 
+CmdShapeGeometry::CmdShapeGeometry()
+    : QUndoCommand("change shape geometry")
+{
+}
+
+int CmdShapeGeometry::id(void) const
+{
+    return UNDO_SHAPE_GEOMETRY;
+}
+
+void CmdShapeGeometry::addShapeGeometry(ShapeObj *shape,
+        const QPointF& oldCentre, const QSizeF& oldSize,
+        const QPointF& newCentre, const QSizeF& newSize)
+{
+    if (m_shape_indexes.empty() && !m_shapes.empty())
+    {
+        // Recording again after squeeze().
+        for (int i = 0; i < m_shapes.size(); ++i)
+        {
+            m_shape_indexes.insert(m_shapes[i], i);
+        }
+    }
+
+    int index = m_shape_indexes.value(shape, -1);
+    if (index == -1)
+    {
+        index = m_shapes.size();
+        m_shapes.append(shape);
+        m_shape_indexes.insert(shape, index);
+
+        m_values.resize(m_values.size() + VALUES_PER_SHAPE);
+        qreal *values = m_values.data() + (index * VALUES_PER_SHAPE);
+        values[OLD_X] = oldCentre.x();
+        values[OLD_Y] = oldCentre.y();
+        values[OLD_WIDTH] = oldSize.width();
+        values[OLD_HEIGHT] = oldSize.height();
+    }
+
+    // Later changes to the same shape just replace where it ended up.
+    qreal *values = m_values.data() + (index * VALUES_PER_SHAPE);
+    values[NEW_X] = newCentre.x();
+    values[NEW_Y] = newCentre.y();
+    values[NEW_WIDTH] = newSize.width();
+    values[NEW_HEIGHT] = newSize.height();
+}
+
+qint64 CmdShapeGeometry::memoryUsage(void) const
+{
+    return sizeof(CmdShapeGeometry) +
+            (m_shapes.capacity() * sizeof(ShapeObj *)) +
+            (m_values.capacity() * sizeof(qreal)) +
+            (m_shape_indexes.capacity() *
+                    (sizeof(ShapeObj *) + sizeof(int) + sizeof(void *)));
+}
+
+void CmdShapeGeometry::squeeze(void)
+{
+    m_shapes.squeeze();
+    m_values.squeeze();
+    m_shape_indexes = QHash<ShapeObj *, int>();
+}
+
+void CmdShapeGeometry::undo()
+{
+    for (int i = m_shapes.size() - 1; i >= 0; --i)
+    {
+        const qreal *values = m_values.constData() + (i * VALUES_PER_SHAPE);
+        QSizeF oldSize(values[OLD_WIDTH], values[OLD_HEIGHT]);
+        QPointF oldCentre(values[OLD_X], values[OLD_Y]);
+        if (oldSize != QSizeF(values[NEW_WIDTH], values[NEW_HEIGHT]))
+        {
+            m_shapes[i]->setSize(oldSize);
+        }
+        if (oldCentre != QPointF(values[NEW_X], values[NEW_Y]))
+        {
+            m_shapes[i]->setCentrePos(oldCentre);
+        }
+    }
+}
+
+void CmdShapeGeometry::redo()
+{
+    for (int i = 0; i < m_shapes.size(); ++i)
+    {
+        const qreal *values = m_values.constData() + (i * VALUES_PER_SHAPE);
+        QPointF newCentre(values[NEW_X], values[NEW_Y]);
+        QSizeF newSize(values[NEW_WIDTH], values[NEW_HEIGHT]);
+        if (newCentre != QPointF(values[OLD_X], values[OLD_Y]))
+        {
+            m_shapes[i]->setCentrePos(newCentre);
+        }
+        if (newSize != QSizeF(values[OLD_WIDTH], values[OLD_HEIGHT]))
+        {
+            m_shapes[i]->setSize(newSize);
+        }
+    }
+}
+
+
 CmdCanvasSceneAddItem::CmdCanvasSceneAddItem(Canvas *canvas, CanvasItem *item)
     : QUndoCommand("add item to canvas"),
       m_canvas(canvas),
@@ -27,6 +27,8 @@
 #define UNDO_H
 
 #include <QList>
+#include <QHash>
+#include <QVector>
 #include <QUndoCommand>
 
 #include "libdunnartcanvas/canvas.h"
@@ -35,6 +37,7 @@ namespace dunnart {
 
 class Canvas;
 class CanvasItem;
+class ShapeObj;
 
 // The UndoMacro represents an object we can push to the undo stack
 // immediately, but that may has some of it's items modified later by
@@ -43,6 +46,12 @@ class CanvasItem;
 // to the undo stack and the SIGNALS are sent at the wrong time.  Hence,
 // we manually handle addition and merging in addCommand.
 //
+// Shape moves and resizes are by far the most common changes, and a
+// single drag or resize of a large selection may change hundreds of
+// shapes many times over.  So rather than a command each, they are
+// recorded with addShapeGeometry() into packed arrays, with one entry
+// per changed shape.
+//
 class UndoMacro : public QUndoCommand
 {
     public:
@@ -51,9 +60,61 @@ class UndoMacro : public QUndoCommand
         virtual void undo();
         virtual void redo();
         void addCommand(QUndoCommand *command);
+        // Records a shape's geometry changing.  The change is not applied.
+        void addShapeGeometry(ShapeObj *shape, const QPointF& oldCentre,
+                const QSizeF& oldSize, const QPointF& newCentre,
+                const QSizeF& newSize);
+        // An estimate, in bytes, of the memory used by the macro.
+        qint64 memoryUsage(void) const;
+        // Frees memory only needed while the macro is still being added to.
+        void squeeze(void);
+        // Frees everything the macro has recorded, leaving it doing
+        // nothing.  Used to drop the oldest history once the undo stack
+        // grows past Canvas::undoMemoryLimit().
+        void discard(void);
     private:
+        // Takes the macro's memory off the canvas's running total.
+        void uncount(void);
+
         Canvas *m_canvas;
         QList<QUndoCommand *> m_undo_commands;
+        bool m_discarded;
+        bool m_done;
+        // What Canvas::endUndoMacro() added to the running total.
+        qint64 m_counted_usage;
+
+        friend class Canvas;
+};
+
+
+// Geometry changes to any number of shapes.  The shapes are held in one
+// array and their centres and sizes, before and after, in another, so
+// undo and redo only touch shapes that actually changed.  Before and
+// after values are kept, rather than differences, so undo puts shapes
+// back exactly even if the layout has moved them since.
+//
+class CmdShapeGeometry : public QUndoCommand
+{
+    public:
+        CmdShapeGeometry();
+        virtual int id(void) const;
+        virtual void undo();
+        virtual void redo();
+        void addShapeGeometry(ShapeObj *shape, const QPointF& oldCentre,
+                const QSizeF& oldSize, const QPointF& newCentre,
+                const QSizeF& newSize);
+        qint64 memoryUsage(void) const;
+        void squeeze(void);
+    private:
+        enum {
+            OLD_X, OLD_Y, OLD_WIDTH, OLD_HEIGHT,
+            NEW_X, NEW_Y, NEW_WIDTH, NEW_HEIGHT,
+            VALUES_PER_SHAPE
+        };
+        QVector<ShapeObj *> m_shapes;
+        QVector<qreal> m_values;
+        // Index of each shape in m_shapes.  Only kept while recording.
+        QHash<ShapeObj *, int> m_shape_indexes;
 };
 
 
@@ -87,8 +148,7 @@ class CmdCanvasSceneRemoveItem : public QUndoCommand
 
 
 enum {
-    UNDO_SHAPE_POS  = 1,
-    UNDO_SHAPE_SIZE,
+    UNDO_SHAPE_GEOMETRY  = 1,
     UNDO_GUIDELINE_POS
 };
 
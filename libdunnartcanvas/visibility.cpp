@@ -130,16 +130,10 @@ void nudgeConnectors(Canvas *canvas, const double nudgeDist,
 
     if (displayUpdate)
     {
-        QList<CanvasItem *> canvas_items = canvas->items();
-        for (int i = 0; i < canvas_items.size(); ++i)
+        foreach (Connector *conn, canvas->connectors())
         {
-            Connector *conn =
-                    dynamic_cast<Connector *> (canvas_items.at(i));
-            if (conn)
-            {
-                conn->applyNewRoute(conn->avoidRef->displayRoute());
-                conn->update();
-            }
+            conn->applyNewRoute(conn->avoidRef->displayRoute());
+            conn->update();
         }
     }
 }
@@ -195,14 +189,8 @@ static void identifyPointWithCircle(double xc, double yc, int r, int g, int b)
 //
 static void resetConnectorColors(Canvas *canvas)
 {
-    QList<CanvasItem *> canvas_items = canvas->items();
-    for (int i = 0; i < canvas_items.size(); ++i)
+    foreach (Connector *conn, canvas->connectors())
     {
-        Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-        if (!conn)
-        {
-            continue;
-        }
         conn->restoreColour();
     }
 }
@@ -300,24 +288,16 @@ static int calcConnectorIntersections(Canvas *canvas, PtOrderMap *ptOrders,
     int crossingsN = 0;
 
     // Do segment splitting.
-    QList<CanvasItem *> canvas_items = canvas->items();
-    for (int i = 0; i < canvas_items.size(); ++i)
+    QList<Connector *> canvas_conns = canvas->connectors();
+    for (int i = 0; i < canvas_conns.size(); ++i)
     {
         Point lastInt(INFINITY, INFINITY);
-        Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-        if (!conn)
-        {
-            continue;
-        }
+        Connector *conn = canvas_conns.at(i);
         
-        for (int j = (i + 1); j < canvas_items.size(); ++j)
+        for (int j = (i + 1); j < canvas_conns.size(); ++j)
         {
             Point lastInt2(INFINITY, INFINITY);
-            Connector *conn2 = dynamic_cast<Connector *> (canvas_items.at(j));
-            if (!conn2)
-            {
-                continue;
-            }
+            Connector *conn2 = canvas_conns.at(j);
             
             if (queryConn && (queryConn != conn) && (queryConn != conn2))
             {
@@ -336,23 +316,15 @@ static int calcConnectorIntersections(Canvas *canvas, PtOrderMap *ptOrders,
         }
     }
 
-    for (int i = 0; i < canvas_items.size(); ++i)
+    for (int i = 0; i < canvas_conns.size(); ++i)
     {
         Point lastInt(INFINITY, INFINITY);
-        Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-        if (!conn)
-        {
-            continue;
-        }
+        Connector *conn = canvas_conns.at(i);
         
-        for (int j = (i + 1); j < canvas_items.size(); ++j)
+        for (int j = (i + 1); j < canvas_conns.size(); ++j)
         {
             Point lastInt2(INFINITY, INFINITY);
-            Connector *conn2 = dynamic_cast<Connector *> (canvas_items.at(j));
-            if (!conn2)
-            {
-                continue;
-            }
+            Connector *conn2 = canvas_conns.at(j);
             
             if (queryConn && (queryConn != conn) && (queryConn != conn2))
             {
@@ -432,14 +404,9 @@ void reroute_all_connectors(Canvas *canvas)
 
 void redraw_connectors(Canvas *canvas)
 {
-    QList<CanvasItem *> canvas_items = canvas->items();
-    for (int i = 0; i < canvas_items.size(); ++i)
+    foreach (Connector *conn, canvas->connectors())
     {
-        Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-        if (conn)
-        {
-            conn->reapplyRoute();
-        }
+        conn->reapplyRoute();
     }
 }
 
@@ -453,14 +420,9 @@ void reroute_connectors(Canvas *canvas, const bool force,
     if (router->SimpleRouting)
     {
         router->processTransaction();
-        QList<CanvasItem *> canvas_items = canvas->items();
-        for (int i = 0; i < canvas_items.size(); ++i)
+        foreach (Connector *conn, canvas->connectors())
         {
-            Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-            if (conn)
-            {
-                conn->forceReroute();
-            }
+            conn->forceReroute();
         }
         return;
     }
@@ -468,16 +430,10 @@ void reroute_connectors(Canvas *canvas, const bool force,
     if (force)
     {
         //printf("+++++ Making all libavoid paths invalid\n");
-        QList<CanvasItem *> canvas_items = canvas->items();
-        for (int i = 0; i < canvas_items.size(); ++i)
+        foreach (Connector *conn, canvas->connectors())
         {
-            Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-
-            if (conn)
-            {
-                conn->avoidRef->makePathInvalid();
-                conn->forceReroute();
-            }
+            conn->avoidRef->makePathInvalid();
+            conn->forceReroute();
         }
     }
     bool changes = router->processTransaction();
@@ -486,13 +442,10 @@ void reroute_connectors(Canvas *canvas, const bool force,
     if (changes)
     {
         int rconns = 0;
-        QList<CanvasItem *> canvas_items = canvas->items();
-        for (int i = 0; i < canvas_items.size(); ++i)
+        foreach (Connector *conn, canvas->connectors())
         {
-            Connector *conn =
-                    dynamic_cast<Connector *> (canvas_items.at(i));
-            if (conn &&  (!(router->SelectiveReroute) ||
-                     conn->avoidRef->needsRepaint() || force))
+            if (!(router->SelectiveReroute) ||
+                     conn->avoidRef->needsRepaint() || force)
             {
                 conn->updateFromLibavoid();
                 rconns++;
@@ -529,14 +482,10 @@ void reroute_connectors(Canvas *canvas, const bool force,
                 }
             }
             tallies.erase(maxIt);
-            QList<CanvasItem *> canvas_items = canvas->items();
-            for (int i = 0; i < canvas_items.size(); ++i)
+            Connector *conn = dynamic_cast<Connector *>
+                    (canvas->getItemByInternalId(maxID));
+            if (conn)
             {
-                Connector *conn = dynamic_cast<Connector *> (canvas_items.at(i));
-                if (!conn || (maxID != conn->internalId()))
-                {
-                    continue;
-                }
                 conn->rerouteAvoidingIntersections();
             }
         }
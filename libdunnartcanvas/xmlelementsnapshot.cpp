@@ -0,0 +1,224 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+#include <QDomNode>
+#include <QDomElement>
+#include <QDomDocument>
+#include <QXmlStreamWriter>
+
+#include "libdunnartcanvas/xmlelementsnapshot.h"
+
+namespace dunnart {
+
+
+XmlElementSnapshot::XmlElementSnapshot()
+    : m_kind(NullNode)
+{
+}
+
+
+XmlElementSnapshot::XmlElementSnapshot(const QString& name)
+    : m_kind(ElementNode),
+      m_name(name)
+{
+}
+
+
+XmlElementSnapshot::XmlElementSnapshot(const QDomNode& node)
+    : m_kind(NullNode)
+{
+    if (node.isElement())
+    {
+        m_kind = ElementNode;
+        m_name = node.nodeName();
+        QDomNamedNodeMap attrs = node.attributes();
+        for (int i = 0; i < attrs.count(); ++i)
+        {
+            QDomNode attr = attrs.item(i);
+            m_attributes.append(qMakePair(attr.nodeName(),
+                    attr.nodeValue()));
+        }
+        for (QDomNode child = node.firstChild(); !child.isNull();
+                child = child.nextSibling())
+        {
+            XmlElementSnapshot childSnapshot(child);
+            if (!childSnapshot.isNull())
+            {
+                m_children.append(childSnapshot);
+            }
+        }
+    }
+    else if (node.isCDATASection())
+    {
+        // Checked before text, since CDATA sections are also text nodes.
+        m_kind = CDATANode;
+        m_name = node.nodeValue();
+    }
+    else if (node.isText())
+    {
+        m_kind = TextNode;
+        m_name = node.nodeValue();
+    }
+    else if (node.isComment())
+    {
+        m_kind = CommentNode;
+        m_name = node.nodeValue();
+    }
+}
+
+
+bool XmlElementSnapshot::isNull(void) const
+{
+    return (m_kind == NullNode);
+}
+
+
+QString XmlElementSnapshot::name(void) const
+{
+    return m_name;
+}
+
+
+void XmlElementSnapshot::setName(const QString& name)
+{
+    m_name = name;
+}
+
+
+QString XmlElementSnapshot::attribute(const QString& name) const
+{
+    for (int i = 0; i < m_attributes.size(); ++i)
+    {
+        if (m_attributes[i].first == name)
+        {
+            return m_attributes[i].second;
+        }
+    }
+    return QString();
+}
+
+
+void XmlElementSnapshot::setAttribute(const QString& name,
+        const QString& value)
+{
+    // Items only have a handful of attributes, so a list is quicker
+    // than a hash here.
+    for (int i = 0; i < m_attributes.size(); ++i)
+    {
+        if (m_attributes[i].first == name)
+        {
+            m_attributes[i].second = value;
+            return;
+        }
+    }
+    m_attributes.append(qMakePair(name, value));
+}
+
+
+void XmlElementSnapshot::removeAttribute(const QString& name)
+{
+    for (int i = 0; i < m_attributes.size(); ++i)
+    {
+        if (m_attributes[i].first == name)
+        {
+            m_attributes.removeAt(i);
+            return;
+        }
+    }
+}
+
+
+void XmlElementSnapshot::appendChild(const XmlElementSnapshot& child)
+{
+    m_children.append(child);
+}
+
+
+void XmlElementSnapshot::addToDomElement(QDomElement& element,
+        QDomDocument& doc) const
+{
+    for (int i = 0; i < m_attributes.size(); ++i)
+    {
+        element.setAttribute(m_attributes[i].first, m_attributes[i].second);
+    }
+    foreach (const XmlElementSnapshot& child, m_children)
+    {
+        switch (child.m_kind)
+        {
+            case ElementNode:
+            {
+                QDomElement childElement = doc.createElement(child.m_name);
+                child.addToDomElement(childElement, doc);
+                element.appendChild(childElement);
+                break;
+            }
+            case TextNode:
+                element.appendChild(doc.createTextNode(child.m_name));
+                break;
+            case CDATANode:
+                element.appendChild(doc.createCDATASection(child.m_name));
+                break;
+            case CommentNode:
+                element.appendChild(doc.createComment(child.m_name));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+void XmlElementSnapshot::write(QXmlStreamWriter& writer) const
+{
+    switch (m_kind)
+    {
+        case ElementNode:
+            writer.writeStartElement(m_name);
+            for (int i = 0; i < m_attributes.size(); ++i)
+            {
+                writer.writeAttribute(m_attributes[i].first,
+                        m_attributes[i].second);
+            }
+            foreach (const XmlElementSnapshot& child, m_children)
+            {
+                child.write(writer);
+            }
+            writer.writeEndElement();
+            break;
+        case TextNode:
+            writer.writeCharacters(m_name);
+            break;
+        case CDATANode:
+            writer.writeCDATA(m_name);
+            break;
+        case CommentNode:
+            writer.writeComment(m_name);
+            break;
+        default:
+            break;
+    }
+}
+
+
+}
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -0,0 +1,93 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+//! @file
+//! XmlElementSnapshot class.  An XML element held as plain values.
+
+#ifndef XMLELEMENTSNAPSHOT_H_
+#define XMLELEMENTSNAPSHOT_H_
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+class QDomNode;
+class QDomElement;
+class QDomDocument;
+class QXmlStreamWriter;
+
+namespace dunnart {
+
+
+//! @brief  An XML element, with its attributes and children, held as
+//!         plain values.
+//!
+//! Unlike a QDomElement, a snapshot doesn't belong to a document and
+//! shares nothing with the node it was made from, so it may be copied
+//! to and written from another thread while the original is changed.
+//!
+class XmlElementSnapshot
+{
+    public:
+        XmlElementSnapshot();
+        explicit XmlElementSnapshot(const QString& name);
+        //! Copies the node and everything in it.
+        explicit XmlElementSnapshot(const QDomNode& node);
+
+        bool isNull(void) const;
+        QString name(void) const;
+        void setName(const QString& name);
+        QString attribute(const QString& name) const;
+        //! Sets the named attribute, replacing any existing value.
+        void setAttribute(const QString& name, const QString& value);
+        void removeAttribute(const QString& name);
+        void appendChild(const XmlElementSnapshot& child);
+
+        //! Adds the attributes and children to the given DOM element.
+        void addToDomElement(QDomElement& element, QDomDocument& doc) const;
+        //! Writes the element to the given stream.  Names are written as
+        //! they are, so any namespace prefixes must already be declared
+        //! by the enclosing document.
+        void write(QXmlStreamWriter& writer) const;
+
+    private:
+        enum Kind
+        {
+            NullNode,
+            ElementNode,
+            TextNode,
+            CDATANode,
+            CommentNode
+        };
+
+        Kind m_kind;
+        // The tag name of an element, or the text of any other node.
+        QString m_name;
+        QList<QPair<QString, QString> > m_attributes;
+        QList<XmlElementSnapshot> m_children;
+};
+
+
+}
+#endif // XMLELEMENTSNAPSHOT_H_
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
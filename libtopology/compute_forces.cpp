@@ -26,7 +26,9 @@
 // cmath needs ::strcpy_s under MinGW so include cstring.
 #include <cstring>
 
+#include <cmath>
 #include <valarray>
+#include <vector>
 
 #include "libvpsc/assertions.h"
 #include "libcola/sparse_matrix.h"
@@ -36,232 +38,128 @@ using std::valarray;
 
 namespace topology {
 /*
- * @param u an EdgePoint
- * @param v another EdgePoint
- * @param dx x distance between u and v
- * @param dy y distance between u and v
- * @param dx2 squared x distance between u and v
- * @param dy2 squared y distance between u and v
- * @return euclidean distance between a pair of EdgePoint (u,v)
+ * The geometry of one edge path, flattened into contiguous arrays so that
+ * the quantities used by the rules below are computed in tight loops
+ * (which the compiler can vectorise) rather than once per rule evaluation.
+ * Segment j runs from path[j] to path[j+1], and in the scan dimension:
+ *   dx[j]   distance from the end to the start of the segment
+ *   dx2[j]  dx[j] squared
+ *   l[j]    euclidean length of the segment
+ *   t[j]    dx[j]/l[j]
+ * and at each bend point j (0<j<n-1), bend[j] = t[j-1] - t[j].
  */
-static double len(const EdgePoint* u, const EdgePoint* v,
-        double& dx, double& dy,
-        double& dx2, double& dy2) {
-    dx=u->posX()-v->posX();
-    dy=u->posY()-v->posY();
-    dx2=dx*dx;
-    dy2=dy*dy;
-    return sqrt(dx2+dy2);
-}
-static double gRule1(vpsc::Dim dim, const EdgePoint* a, const EdgePoint* b) {
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    return dxab/lab;
+struct PathGeometry {
+    std::vector<unsigned> ids;
+    std::vector<double> x, y, dx, dx2, l, t, bend;
+    void compute(vpsc::Dim dim, const ConstEdgePoints& path) {
+        const size_t n=path.size();
+        ids.resize(n);
+        x.resize(n);
+        y.resize(n);
+        for(size_t j=0;j<n;j++) {
+            const EdgePoint* p=path[j];
+            ids[j]=p->node->id;
+            x[j]=dim==vpsc::HORIZONTAL?p->posX():p->posY();
+            y[j]=dim==vpsc::HORIZONTAL?p->posY():p->posX();
+        }
+        dx.resize(n-1);
+        dx2.resize(n-1);
+        l.resize(n-1);
+        t.resize(n-1);
+        for(size_t j=0;j<n-1;j++) {
+            const double ddx=x[j]-x[j+1], ddy=y[j]-y[j+1];
+            dx[j]=ddx;
+            dx2[j]=ddx*ddx;
+            l[j]=sqrt(dx2[j]+ddy*ddy);
+        }
+        for(size_t j=0;j<n-1;j++) {
+            COLA_ASSERT(l[j]!=0);
+            t[j]=dx[j]/l[j];
+        }
+        bend.resize(n);
+        for(size_t j=1;j<n-1;j++) {
+            bend[j]=t[j-1]-t[j];
+        }
+    }
+};
+/*
+ * The rules below give the gradient and hessian entries for the path
+ * stress in terms of the segments of a PathGeometry.  Segments are
+ * identified by index; a, b, c, d are consecutive segments.
+ */
+static inline double gRule1(const PathGeometry& p, unsigned a) {
+    return p.t[a];
 }
-static double gRule2(vpsc::Dim dim, const EdgePoint* a, const EdgePoint* b,
-        const EdgePoint* c)
-{
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    double dxbc, dybc, dxbc2, dybc2;
-    double lbc=dim==vpsc::HORIZONTAL?
-        len(b,c,dxbc,dybc,dxbc2,dybc2):
-        len(b,c,dybc,dxbc,dybc2,dxbc2);
-    COLA_ASSERT(lbc!=0);
-    return dxab/lab - dxbc/lbc;
+static inline double gRule2(const PathGeometry& p, unsigned b) {
+    return p.bend[b];
 }
-static double hRuleD1(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-          const double dl)
+static inline double hRuleD1(const PathGeometry& p, unsigned a,
+        const double dl)
 {
-    double dx, dy, dx2, dy2;
-    double l=dim==vpsc::HORIZONTAL?
-        len(u,v,dx,dy,dx2,dy2):
-        len(u,v,dy,dx,dy2,dx2);
-    COLA_ASSERT(l!=0);
+    const double l=p.l[a], dx2=p.dx2[a];
     return dl*(dx2/(l*l*l) - 1/l) + dx2/(l*l);
 }
-static double hRuleD2(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-          const EdgePoint* w, const double dl)
+static inline double hRuleD2(const PathGeometry& p, unsigned b,
+        const double dl)
 {
-    double dxuv, dyuv, dxuv2, dyuv2;
-    double luv=dim==vpsc::HORIZONTAL?
-        len(u,v,dxuv,dyuv,dxuv2,dyuv2):
-        len(u,v,dyuv,dxuv,dyuv2,dxuv2);
-    COLA_ASSERT(luv!=0);
-    double dxvw, dyvw, dxvw2, dyvw2;
-    double lvw=dim==vpsc::HORIZONTAL?
-        len(v,w,dxvw,dyvw,dxvw2,dyvw2):
-        len(v,w,dyvw,dxvw,dyvw2,dxvw2);
-    COLA_ASSERT(lvw!=0);
-    double p1=dl*(dxuv2/(luv*luv*luv) - 1/luv + dxvw2/(lvw*lvw*lvw) - 1/lvw);
-    double p2=(dxuv/luv - dxvw/lvw);
+    const double luv=p.l[b-1], lvw=p.l[b];
+    double p1=dl*(p.dx2[b-1]/(luv*luv*luv) - 1/luv
+            + p.dx2[b]/(lvw*lvw*lvw) - 1/lvw);
+    double p2=p.bend[b];
     return p1+p2*p2;
 }
-static double hRule2(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-         const EdgePoint* w, const double dl)
+static inline double hRule2(const PathGeometry& p, unsigned a, unsigned b,
+        const double dl)
 {
-    double dxuv, dyuv, dxuv2, dyuv2;
-    double luv=dim==vpsc::HORIZONTAL?
-        len(u,v,dxuv,dyuv,dxuv2,dyuv2):
-        len(u,v,dyuv,dxuv,dyuv2,dxuv2);
-    COLA_ASSERT(luv!=0);
-    double dxvw, dyvw, dxvw2, dyvw2;
-    double lvw=dim==vpsc::HORIZONTAL?
-        len(v,w,dxvw,dyvw,dxvw2,dyvw2):
-        len(v,w,dyvw,dxvw,dyvw2,dxvw2);
-    COLA_ASSERT(lvw!=0);
+    const double luv=p.l[a], lvw=p.l[b], dxuv2=p.dx2[a];
     return -dl*dxuv2/(luv*luv*luv)
         +dl/luv
         -dxuv2/(luv*luv)
-        +dxuv*dxvw/(luv*lvw);
+        +p.dx[a]*p.dx[b]/(luv*lvw);
 }
-static double hRule3(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-        const EdgePoint* w, const double dl)
+static inline double hRule3(const PathGeometry& p, unsigned a, unsigned b,
+        const double dl)
 {
-    double dxuv, dyuv, dxuv2, dyuv2;
-    double luv=dim==vpsc::HORIZONTAL?
-        len(u,v,dxuv,dyuv,dxuv2,dyuv2):
-        len(u,v,dyuv,dxuv,dyuv2,dxuv2);
-    COLA_ASSERT(luv!=0);
-    double dxvw, dyvw, dxvw2, dyvw2;
-    double lvw=dim==vpsc::HORIZONTAL?
-        len(v,w,dxvw,dyvw,dxvw2,dyvw2):
-        len(v,w,dyvw,dxvw,dyvw2,dxvw2);
-    COLA_ASSERT(lvw!=0);
+    const double luv=p.l[a], lvw=p.l[b], dxvw2=p.dx2[b];
     return -dl*dxvw2/(lvw*lvw*lvw)
         -dxvw2/(lvw*lvw)
         +dl/lvw
-        +dxuv*dxvw/(luv*lvw);
+        +p.dx[a]*p.dx[b]/(luv*lvw);
 }
-static double hRule4(vpsc::Dim dim, const EdgePoint* a, const EdgePoint* b,
-        const EdgePoint* c, const EdgePoint* d)
-{
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    double dxcd, dycd, dxcd2, dycd2;
-    double lcd=dim==vpsc::HORIZONTAL?
-        len(c,d,dxcd,dycd,dxcd2,dycd2):
-        len(c,d,dycd,dxcd,dycd2,dxcd2);
-    COLA_ASSERT(lcd!=0);
-    return -dxab*dxcd/(lab*lcd);
+static inline double hRule4(const PathGeometry& p, unsigned a, unsigned c) {
+    return -p.dx[a]*p.dx[c]/(p.l[a]*p.l[c]);
 }
-static double hRule56(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-        const EdgePoint* a, const EdgePoint* b, const EdgePoint* c)
+/*
+ * tuv is t for the segment (u,v) in the direction from u to v, b is the
+ * bend point between segments b-1 and b.
+ */
+static inline double hRule56(const PathGeometry& p, const double tuv,
+        unsigned b)
 {
-    double dxuv, dyuv, dxuv2, dyuv2;
-    double luv=dim==vpsc::HORIZONTAL?
-        len(u,v,dxuv,dyuv,dxuv2,dyuv2):
-        len(u,v,dyuv,dxuv,dyuv2,dxuv2);
-    COLA_ASSERT(luv!=0);
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    double dxbc, dybc, dxbc2, dybc2;
-    double lbc=dim==vpsc::HORIZONTAL?
-        len(b,c,dxbc,dybc,dxbc2,dybc2):
-        len(b,c,dybc,dxbc,dybc2,dxbc2);
-    COLA_ASSERT(lbc!=0);
-    return dxuv/luv * ( dxbc/lbc - dxab/lab );
+    return tuv * -p.bend[b];
 }
-static double hRule7(vpsc::Dim dim, const EdgePoint* a, const EdgePoint* b,
-        const EdgePoint* c, const EdgePoint* d, const double dl)
+static inline double hRule7(const PathGeometry& p, unsigned b,
+        const double dl)
 {
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    double dxbc, dybc, dxbc2, dybc2;
-    double lbc=dim==vpsc::HORIZONTAL?
-        len(b,c,dxbc,dybc,dxbc2,dybc2):
-        len(b,c,dybc,dxbc,dybc2,dxbc2);
-    COLA_ASSERT(lbc!=0);
-    double dxcd, dycd, dxcd2, dycd2;
-    double lcd=dim==vpsc::HORIZONTAL?
-        len(c,d,dxcd,dycd,dxcd2,dycd2):
-        len(c,d,dycd,dxcd,dycd2,dxcd2);
-    COLA_ASSERT(lcd!=0);
+    const double lbc=p.l[b], dxbc2=p.dx2[b];
     return dl*(1/lbc - dxbc2/(lbc*lbc*lbc))
-        +(dxab/lab - dxbc/lbc)*(dxbc/lbc - dxcd/lcd);
-}
-static double hRule8(vpsc::Dim dim, const EdgePoint* u, const EdgePoint* v,
-        const EdgePoint* w, const EdgePoint* a, const EdgePoint* b,
-        const EdgePoint* c)
-{
-    double dxuv, dyuv, dxuv2, dyuv2;
-    double luv=dim==vpsc::HORIZONTAL?
-        len(u,v,dxuv,dyuv,dxuv2,dyuv2):
-        len(u,v,dyuv,dxuv,dyuv2,dxuv2);
-    COLA_ASSERT(luv!=0);
-    double dxvw, dyvw, dxvw2, dyvw2;
-    double lvw=dim==vpsc::HORIZONTAL?
-        len(v,w,dxvw,dyvw,dxvw2,dyvw2):
-        len(v,w,dyvw,dxvw,dyvw2,dxvw2);
-    COLA_ASSERT(lvw!=0);
-    double dxab, dyab, dxab2, dyab2;
-    double lab=dim==vpsc::HORIZONTAL?
-        len(a,b,dxab,dyab,dxab2,dyab2):
-        len(a,b,dyab,dxab,dyab2,dxab2);
-    COLA_ASSERT(lab!=0);
-    double dxbc, dybc, dxbc2, dybc2;
-    double lbc=dim==vpsc::HORIZONTAL?
-        len(b,c,dxbc,dybc,dxbc2,dybc2):
-        len(b,c,dybc,dxbc,dybc2,dxbc2);
-    COLA_ASSERT(lbc!=0);
-    return (dxuv/luv - dxvw/lvw) * (dxab/lab - dxbc/lbc);
+        +p.bend[b]*p.bend[b+1];
 }
-/*
- * a wrapper for a SparseMap so that we can index it by two EdgePoint
- */
-struct SparseMapMap {
-    cola::SparseMap &H;
-    SparseMapMap(cola::SparseMap &H) : H(H) {}
-    double& operator()(const EdgePoint *i, const EdgePoint* j) {
-        return H(i->node->id,j->node->id);
-    }
-};
-/*
- * a wrapper for a valarray so that we can index it by an EdgePoint
- */
-template <typename T>
-struct ArrayMap {
-    valarray<T>& a;
-    ArrayMap(valarray<T>& a) : a(a) {}
-    double& operator[](const EdgePoint *i) {
-        return a[i->node->id];
-    }
-};
 /*
  * Compute the forces associated with each EdgePoint (bend or end point) along each each
  * on the nodes/rectangles in the graph.
  */
-void TopologyConstraints::computeForces(valarray<double>& gradient,
-        cola::SparseMap& hessian)
+void TopologyConstraints::computeForces(valarray<double>& g,
+        cola::SparseMap& H)
 {
     FILE_LOG(logDEBUG1) << "TopologyConstraints::computeForces";
-    SparseMapMap H(hessian);
-    ArrayMap<double> g(gradient);
-    const EdgePoint *u,*v,*w;
+    ConstEdgePoints path;
+    PathGeometry p;
+    unsigned u,v,w;
     for(Edges::const_iterator i=edges.begin();i!=edges.end();i++) {
         //printf("Straightening path:\n");
         //edges[i]->print();
         Edge* e=*i;
-        ConstEdgePoints path;
-        e->getPath(path);
-        unsigned n=path.size();
-        FILE_LOG(logDEBUG2) << "  path: n="<<n;
-        COLA_ASSERT(n>=2);
         double d=e->idealLength;
 
         double weight=2.0/(d*d);
@@ -269,13 +167,21 @@ void TopologyConstraints::computeForces(valarray<double>& gradient,
 
         if(dl>=0) continue;
 
+        path.clear();
+        e->getPath(path);
+        unsigned n=path.size();
+        FILE_LOG(logDEBUG2) << "  path: n="<<n;
+        COLA_ASSERT(n>=2);
+        p.compute(dim,path);
+        const std::vector<unsigned>& id=p.ids;
+
         // first and last entries
         // gradient
-        u=path[0]; v=path[1];
-        COLA_ASSERT(v->inSegment->length()>0);
-        double h=weight*hRuleD1(dim,u,v,dl);
+        u=id[0]; v=id[1];
+        COLA_ASSERT(path[1]->inSegment->length()>0);
+        double h=weight*hRuleD1(p,0,dl);
         H(u,u)+=h;
-        double g1=weight*dl*gRule1(dim,u,v);
+        double g1=weight*dl*gRule1(p,0);
         g[u]-=g1;
         if(n==2||dl>0) {
             // rule 1
@@ -285,63 +191,66 @@ void TopologyConstraints::computeForces(valarray<double>& gradient,
             H(v,u)-=h;
             continue;
         }
-        u=path[n-2]; v=path[n-1];
-        g[v]+=weight*dl*gRule1(dim,u,v);
-        H(v,v)+=weight*hRuleD1(dim,u,v,dl);
+        v=id[n-1];
+        g[v]+=weight*dl*gRule1(p,n-2);
+        H(v,v)+=weight*hRuleD1(p,n-2,dl);
         // remaining diagonal entries
         for(unsigned j=1;j<n-1;j++) {
-            u=path[j-1], v=path[j], w=path[j+1];
-            COLA_ASSERT(v->inSegment->length()>0);
-            COLA_ASSERT(w->inSegment->length()>0);
-            H(v,v)+=weight*hRuleD2(dim,u,v,w,dl);
-            g[v]+=weight*dl*gRule2(dim,u,v,w);
+            v=id[j];
+            COLA_ASSERT(path[j]->inSegment->length()>0);
+            COLA_ASSERT(path[j+1]->inSegment->length()>0);
+            H(v,v)+=weight*hRuleD2(p,j,dl);
+            g[v]+=weight*dl*gRule2(p,j);
         }
 
         // off diagonal entries
         // hRule 2
-        u=path[0], v=path[1], w=path[2];
-        h=weight*hRule2(dim,u,v,w,dl);
+        u=id[0], v=id[1];
+        h=weight*hRule2(p,0,1,dl);
         H(u,v)+=h;
         H(v,u)+=h;
         // hRule 3
-        u=path[n-3], v=path[n-2], w=path[n-1];
-        h=weight*hRule3(dim,u,v,w,dl);
+        v=id[n-2], w=id[n-1];
+        h=weight*hRule3(p,n-3,n-2,dl);
         H(v,w)+=h;
         H(w,v)+=h;
         // hRule 4
-        u=path[0], v=path[n-1];
-        h=weight*hRule4(dim,u,path[1],path[n-2],v);
+        u=id[0], v=id[n-1];
+        h=weight*hRule4(p,0,n-2);
         H(u,v)+=h;
         H(v,u)+=h;
         if(n==3) continue;
         for(unsigned j=2;j<n-1;j++) {
             // hRule 5
-            u=path[0],v=path[j];
-            h=weight*hRule56(dim,u,path[1],path[j-1],v,path[j+1]);
+            u=id[0],v=id[j];
+            h=weight*hRule56(p,p.t[0],j);
             H(u,v)+=h;
             H(v,u)+=h;
-            // hRule 6
-            u=path[n-1], v=path[n-1-j];
-            h=weight*hRule56(dim,u,path[n-2],path[n-1-j-1],v,path[n-1-j+1]);
+            // hRule 6: the first segment runs backwards from the end
+            u=id[n-1], v=id[n-1-j];
+            h=weight*hRule56(p,-p.t[n-2],n-1-j);
             H(u,v)+=h;
             H(v,u)+=h;
             // hRule 7
-            u=path[j-1], v=path[j];
-            h=weight*hRule7(dim,path[j-2],u,v,path[j+1],dl);
+            u=id[j-1], v=id[j];
+            h=weight*hRule7(p,j-1,dl);
             H(u,v)+=h;
             H(v,u)+=h;
         } 
+        // hRule 8 is just the product of the bends at each pair of
+        // non-adjacent bend points
         for(unsigned j=1;j<n-3;j++) {
+            u=id[j];
             for(unsigned k=j+2;k<n-1;k++) {
-                u=path[j]; v=path[k];
-                h=weight*hRule8(dim,path[j-1],u,path[j+1],path[k-1],v,path[k+1]);
+                v=id[k];
+                h=weight*(p.bend[j]*p.bend[k]);
                 H(u,v)+=h;
                 H(v,u)+=h;
             }
         }
     }
-    for(unsigned i=0;i<gradient.size();i++) {
-        COLA_ASSERT(gradient[i]==gradient[i]);
+    for(unsigned i=0;i<g.size();i++) {
+        COLA_ASSERT(g[i]==g[i]);
     }
     /*
     for(unsigned i=0;i<edges.size();i++) {
@@ -28,6 +28,24 @@
 #include "libtopology/topology_log.h"
 using namespace std;
 namespace topology {
+void* TriConstraint::operator new(size_t size) {
+    return ObjectPool<TriConstraint>::allocate(size);
+}
+void TriConstraint::operator delete(void* ptr, size_t size) {
+    ObjectPool<TriConstraint>::deallocate(ptr, size);
+}
+void* BendConstraint::operator new(size_t size) {
+    return ObjectPool<BendConstraint>::allocate(size);
+}
+void BendConstraint::operator delete(void* ptr, size_t size) {
+    ObjectPool<BendConstraint>::deallocate(ptr, size);
+}
+void* StraightConstraint::operator new(size_t size) {
+    return ObjectPool<StraightConstraint>::allocate(size);
+}
+void StraightConstraint::operator delete(void* ptr, size_t size) {
+    ObjectPool<StraightConstraint>::deallocate(ptr, size);
+}
 /* 
  * @return the maximum move we can make along the line from initial to
  * final positions without violating this constraint
@@ -88,6 +88,9 @@ namespace topology {
          * checks initial positions
          */
         bool assertFeasible() const;
+        // allocated from an ObjectPool
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr, size_t size);
     private:
         double slack(const double, const double, const double) const;
     };
@@ -134,6 +137,9 @@ namespace topology {
         void satisfy();
         std::string toString() const;
         unsigned getEdgeID() const;
+        // allocated from an ObjectPool
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr, size_t size);
     };
     /*
      * A constraint between a Node and a Segment that is activated when
@@ -165,6 +171,9 @@ namespace topology {
         unsigned getEdgeID() const {
             return segment->edge->id;
         }
+        // allocated from an ObjectPool
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr, size_t size);
     };
     /*
      * Define a topology over a diagram by generating a set of
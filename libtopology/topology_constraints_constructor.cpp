@@ -28,6 +28,8 @@
  * \author Tim Dwyer
  * \date Dec 2007
  */
+#include <deque>
+
 #include "libvpsc/assertions.h"
 #include "libvpsc/constraint.h"
 #include "libcola/cola.h"
@@ -40,62 +42,98 @@
 using namespace std;
 using vpsc::Rectangle;
 namespace topology {
-struct SegmentOpen;
-struct NodeOpen;
-typedef list<SegmentOpen*> OpenSegments;
-typedef map<double,NodeOpen*> OpenNodes;
+struct Event;
+typedef list<Event*> OpenSegments;
+typedef map<double,Event*> OpenNodes;
 
 /*
  * The scan algorithm works by processing events in the order they 
- * are encountered by the scan line.
+ * are encountered by the scan line.  There is an opening and a closing
+ * event for the top and bottom (or left and right sides depending on scan
+ * direction) of the rectangle associated with each node, and for each end
+ * of each segment.  Since a new set of events is generated for every scan,
+ * events are plain values stored together in an EventQueue rather than
+ * individually allocated objects.
  */
 struct Event {
-    // an event is either an opening or closing of some object
-    bool open;
+    /*
+     * The kinds of event, in the order in which they are processed when
+     * they occur at the same scan position:
+     *  - close nodes before we open new ones so we don't generate
+     *    unnecessary non-overlap constraints;
+     *  - segment opens come after node closes but before segment closes,
+     *    so that we handle segments parallel to the scan line properly;
+     *  - segment closes come before node opens.
+     */
+    enum Type { NodeClose, SegmentOpen, SegmentClose, NodeOpen };
+    Type type;
     // the position of the scan line at which the event is triggered
     double pos;
     vpsc::Dim scanDim;
-    Event(bool open, double pos) : open(open), pos(pos), scanDim(vpsc::UNSET) {}
-    virtual ~Event() {};
+    // the node of a node event
+    Node *node;
+    // the segment of a segment event
+    Segment *s;
+    /* for closing events, the corresponding opening, which holds the
+     * position of the node or segment in openNodes or openSegments.
+     */
+    Event *opening;
+    OpenNodes::iterator openNodesIndex;
+    OpenSegments::iterator openSegmentsIndex;
+
+    Event(Type type, double pos, vpsc::Dim dim, Node *v, Segment *s,
+            Event *opening)
+        : type(type), pos(pos), scanDim(dim), node(v), s(s), opening(opening)
+    {
+    }
+    static Event nodeOpen(vpsc::Dim dim, Node *v) {
+        return Event(NodeOpen, v->rect->getMinD(vpsc::conjugate(dim)),
+                dim, v, NULL, NULL);
+    }
+    static Event nodeClose(vpsc::Dim dim, Node *v, Event *o) {
+        COLA_ASSERT(o->node == v);
+        return Event(NodeClose, v->rect->getMaxD(vpsc::conjugate(dim)),
+                dim, v, NULL, o);
+    }
+    static Event segmentOpen(vpsc::Dim dim, Segment *s) {
+        return Event(SegmentOpen, s->getMin(dim)->pos(vpsc::conjugate(dim)),
+                dim, NULL, s, NULL);
+    }
+    static Event segmentClose(vpsc::Dim dim, Segment *s, Event *o) {
+        COLA_ASSERT(o->s == s);
+        return Event(SegmentClose, s->getMax(dim)->pos(vpsc::conjugate(dim)),
+                dim, NULL, s, o);
+    }
     /*
      * process is called for each event in pos order as part of the scan
      * algorithm to generate topology constraints.
      */
-    virtual void process(OpenNodes& openNodes, OpenSegments& openSegments) = 0;
-    virtual string toString() = 0;
-};
-/*
- * There is a NodeEvent for the top and bottom (or left and right sides depending on
- * scan direction) of the rectangle associated with each node
- */
-struct NodeEvent : Event {
-    Node *node;
-    NodeEvent(bool open, double pos, Node *v)
-        : Event(open,pos), node(v)
+    void process(OpenNodes& openNodes, OpenSegments& openSegments,
+            vpsc::Constraints& cs)
     {
+        switch(type) {
+            case NodeOpen:
+                processNodeOpen(openNodes, openSegments);
+                break;
+            case NodeClose:
+                processNodeClose(openNodes, openSegments, cs);
+                break;
+            case SegmentOpen:
+                // add to list of open segments
+                openSegmentsIndex=openSegments.insert(openSegments.end(),this);
+                break;
+            case SegmentClose:
+                // remove the opening from the list of open segments
+                openSegments.erase(opening->openSegmentsIndex);
+                break;
+        }
     }
-    ~NodeEvent(){}
     /*
-     * Topology constraints are generated for the opening and closing 
-     * edges of each node and every open segment at pos.
+     * at node openings the node is placed in the list of #openNodes and a
+     * topology constraint is created for one side of the node rectangle and
+     * every open segment.
      */
-    void createStraightConstraints(OpenSegments& openSegments,
-            const Node *leftNeighbour, const Node *rightNeighbour);
-};
-/*
- * at node openings the node is placed in the list of #openNodes and a
- * topology constraint is created for one side of the node rectangle and
- * every open segment.
- */
-struct NodeOpen : NodeEvent {
-    /// position in openNodes
-    OpenNodes::iterator openListIndex;
-    NodeOpen(vpsc::Dim dim, Node *node)
-        : NodeEvent(true,node->rect->getMinD(vpsc::conjugate(dim)),node)
-    {
-        scanDim = dim;
-    }
-    void process(OpenNodes& openNodes, OpenSegments& openSegments)
+    void processNodeOpen(OpenNodes& openNodes, OpenSegments& openSegments)
     {
         FILE_LOG(logDEBUG) << "NodeOpen::process()";
         pair<OpenNodes::iterator,bool> r =
@@ -111,8 +149,8 @@ struct NodeOpen : NodeEvent {
             printf("  id1=%d, id2=%d\n",n1->id, n2->id);
         }
         COLA_ASSERT(r.second);
-        openListIndex = r.first;
-        OpenNodes::iterator right=openListIndex, left=openListIndex;
+        openNodesIndex = r.first;
+        OpenNodes::iterator right=openNodesIndex, left=openNodesIndex;
         Node *leftNeighbour=NULL, *rightNeighbour=NULL;
         if(left!=openNodes.begin()) {
             leftNeighbour=(--left)->second->node;
@@ -122,142 +160,73 @@ struct NodeOpen : NodeEvent {
         }
         createStraightConstraints(openSegments, leftNeighbour,rightNeighbour);
     }
-    string toString() {
-        stringstream s;
-        s<<"NodeOpen@"<<pos;
-        return s.str();
-    }
-};
-/*
- * at node closings the node is removed from the list of #openNodes and
- * topology constraints are created for the remaining side of the node
- * rectangle and every open segment.  Also, non-overlap constraints
- * are created between the node and its immediate neighbours in openNodes.
- */
-struct NodeClose : NodeEvent {
-    /* we store the opening corresponding to this closing so that we can
-     * delete it and remove it from the list of OpenNodes.
-     */
-    NodeOpen* opening;
-    vpsc::Constraints& cs;
-    NodeClose(vpsc::Dim dim, Node* node, NodeOpen* o, vpsc::Constraints& cs)
-        : NodeEvent(false,node->rect->getMaxD(vpsc::conjugate(dim)),node)
-        , opening(o)
-        , cs(cs)
-    {
-        COLA_ASSERT(opening->node == node);
-        scanDim = dim;
-    }
-    void createNonOverlapConstraint(const Node* left, const Node* right)
-    {
-        FILE_LOG(logDEBUG)<<"NodeClose::createNonOverlapConstraint left="<<left<<" right="<<right;
-        //double overlap = left->rect->overlapD(vpsc::conjugate(scanDim),right->rect);
-        //if(overlap>1e-5) {
-            double g = left->rect->length(scanDim) + right->rect->length(scanDim);
-            g/=2.0;
-            //if(scanDim==vpsc::HORIZONTAL) {
-                g+=1e-7;
-            //}
-            //COLA_ASSERT(l->getPosition() + g <= r->getPosition());
-            cs.push_back(new vpsc::Constraint(left->var, right->var, g));
-        //}
-    }
     /*
-     * remove opening from openNodes, cleanup, and generate
-     * TopologyConstraints.
+     * at node closings the node is removed from the list of #openNodes and
+     * topology constraints are created for the remaining side of the node
+     * rectangle and every open segment.  Also, non-overlap constraints
+     * are created between the node and its immediate neighbours in openNodes.
      */
-    void process(OpenNodes& openNodes, OpenSegments& openSegments)
+    void processNodeClose(OpenNodes& openNodes, OpenSegments& openSegments,
+            vpsc::Constraints& cs)
     {
         FILE_LOG(logDEBUG) << "NodeClose::process()";
-        OpenNodes::iterator nodePos=opening->openListIndex;
+        OpenNodes::iterator nodePos=opening->openNodesIndex;
         OpenNodes::iterator right=nodePos, left=nodePos;
         Node *leftNeighbour=NULL, *rightNeighbour=NULL;
         if(left!=openNodes.begin()) {
             leftNeighbour=(--left)->second->node;
-            createNonOverlapConstraint(leftNeighbour,node);
+            createNonOverlapConstraint(leftNeighbour,node,cs);
         }
         if((++right)!=openNodes.end()) {
             rightNeighbour=right->second->node;
-            createNonOverlapConstraint(node,rightNeighbour);
+            createNonOverlapConstraint(node,rightNeighbour,cs);
         }
         openNodes.erase(nodePos);
-        delete opening;
         // create StraightConstraint from scanpos in every open edge 
         // visible before left and right from node
         createStraightConstraints(openSegments, leftNeighbour,rightNeighbour);
-        delete this;
     }
-    string toString() {
-        stringstream s;
-        s<<"NodeClose@"<<pos;
-        return s.str();
-    }
-};
-/*
- * Segment events occur at each end of a segment
- */
-struct SegmentEvent : Event {
-    Segment *s;
-    SegmentEvent(vpsc::Dim dim, bool open, EdgePoint* v, Segment *s)
-        : Event(open,v->pos(vpsc::conjugate(dim))), s(s) {}
-};
-/*
- * at a segment open we add the segment to the list of open segments
- */
-struct SegmentOpen : SegmentEvent {
-    /// position in openSegments
-    OpenSegments::iterator openListIndex;
-    SegmentOpen(vpsc::Dim dim, Segment *s)
-        : SegmentEvent(dim, true,s->getMin(dim),s)
+    void createNonOverlapConstraint(const Node* left, const Node* right,
+            vpsc::Constraints& cs)
     {
-        scanDim = dim;
-    }
-    /// add to list of open segments
-    void process(OpenNodes& openNodes, OpenSegments& openSegments)
-    {
-        COLA_UNUSED(openNodes);
-
-        openListIndex=openSegments.insert(openSegments.end(),this);
+        FILE_LOG(logDEBUG)<<"NodeClose::createNonOverlapConstraint left="<<left<<" right="<<right;
+        //double overlap = left->rect->overlapD(vpsc::conjugate(scanDim),right->rect);
+        //if(overlap>1e-5) {
+            double g = left->rect->length(scanDim) + right->rect->length(scanDim);
+            g/=2.0;
+            //if(scanDim==vpsc::HORIZONTAL) {
+                g+=1e-7;
+            //}
+            //COLA_ASSERT(l->getPosition() + g <= r->getPosition());
+            cs.push_back(new vpsc::Constraint(left->var, right->var, g));
+        //}
     }
+    /*
+     * Topology constraints are generated for the opening and closing 
+     * edges of each node and every open segment at pos.
+     */
+    void createStraightConstraints(OpenSegments& openSegments,
+            const Node *leftNeighbour, const Node *rightNeighbour);
     string toString() {
+        static const char* names[] =
+            { "NodeClose", "SegmentOpen", "SegmentClose", "NodeOpen" };
         stringstream s;
-        s<<"SegmentOpen@"<<pos;
+        s<<names[type]<<"@"<<pos;
         return s.str();
     }
 };
 /*
- * at a segment closing we remove the segment from the list of openings and cleanup
+ * The events of one scan.  A deque never moves its elements as it grows,
+ * so closing events can safely point to their openings.
  */
-struct SegmentClose : SegmentEvent {
-    /// opening corresponding to this closing
-    SegmentOpen* opening;
-    SegmentClose(vpsc::Dim dim, Segment *s, SegmentOpen* so)
-        : SegmentEvent(dim, false,s->getMax(dim),s), opening(so)
-    {
-        COLA_ASSERT(opening->s==s);
-        scanDim = dim;
-    }
-    void process(OpenNodes& openNodes, OpenSegments& openSegments)
-    {
-        COLA_UNUSED(openNodes);
-
-        openSegments.erase(opening->openListIndex);
-        delete opening;
-        delete this;
-    }
-    string toString() {
-        stringstream s;
-        s<<"SegmentClose@"<<pos;
-        return s.str();
-    }
-};
+typedef deque<Event> EventQueue;
 /* 
  * Create topology constraint from scanpos in every open segment to node.
  * Segments must not be on-top-of rectangles.
  */
-void NodeEvent::createStraightConstraints(OpenSegments& openSegments,
+void Event::createStraightConstraints(OpenSegments& openSegments,
         const Node* leftNeighbour, const Node* rightNeighbour) {
-    FILE_LOG(logDEBUG)<<"NodeEvent::createStraightConstraints():node->id="<<node->id<<" pos="<<pos;
+    FILE_LOG(logDEBUG)<<"Event::createStraightConstraints():node->id="<<node->id<<" pos="<<pos;
     const double 
         leftLimit=leftNeighbour?leftNeighbour->rect->getCentreD(scanDim):-DBL_MAX,
         rightLimit=rightNeighbour?rightNeighbour->rect->getCentreD(scanDim):DBL_MAX;
@@ -286,55 +255,11 @@ void NodeEvent::createStraightConstraints(OpenSegments& openSegments,
     }
 }
 struct CompareEvents {
-    bool operator() (Event *const &a, Event *const &b) const {
-        if(a==b) {
-            // Irreflexivity
-            return false;
-        }
-        if(a->pos < b->pos) {
-            return true;
-        } else if(a->pos==b->pos) {
-            NodeOpen *aNO=dynamic_cast<NodeOpen*>(a),
-                     *bNO=dynamic_cast<NodeOpen*>(b);
-            NodeClose *aNC=dynamic_cast<NodeClose*>(a),
-                      *bNC=dynamic_cast<NodeClose*>(b);
-            SegmentOpen *aSO=dynamic_cast<SegmentOpen*>(a),
-                     *bSO=dynamic_cast<SegmentOpen*>(b);
-            SegmentClose *aSC=dynamic_cast<SegmentClose*>(a),
-                      *bSC=dynamic_cast<SegmentClose*>(b);
-
-            // segment opens before closes so that we handle
-            // segments parallel to the scan line properly
-            if(aSO&&bSC) return true;
-            if(aSC&&bSO) return false;
-            // Segment closes at same pos as Node opens, Segment first
-            if(aSC&&bNO) return true;
-            if(bSC&&aNO) return false;
-            // Segment opens at the same position as Node closes, Node first
-            if(aSO&&bNC) return false;
-            if(bSO&&aNC) return true;
-            // Segment opens at the same position as node opens, segment
-            // comes first
-            if(aSO&&bNO) return true;
-            if(bSO&&aNO) return false;
-            // Segment closes at the same position as node closes, node
-            // comes first
-            if(aSC&&bNC) return false;
-            if(bSC&&aNC) return true;
-
-            // close nodes before we open new ones so we don't generate
-            // unnecessary non-overlap constraints
-            if(aNO&&bNC) {
-                COLA_ASSERT(aNO->node!=bNC->node); // no zero height nodes thanks!
-                return false;
-            }
-            if(aNC&&bNO) {
-                COLA_ASSERT(aNC->node!=bNO->node); 
-                return true;
-            }
+    bool operator() (const Event *a, const Event *b) const {
+        if(a->pos != b->pos) {
+            return a->pos < b->pos;
         }
-        // Transitivity of equivalence
-        return false;
+        return a->type < b->type;
     }
 };
 TriConstraint::TriConstraint(vpsc::Dim dim, const Node *u, const Node *v,
@@ -502,7 +427,7 @@ struct CreateBendConstraints
 };
 struct CreateSegmentEvents
 {
-    CreateSegmentEvents(vector<Event*>& events, vpsc::Dim dim)
+    CreateSegmentEvents(EventQueue& events, vpsc::Dim dim)
         : events(events),
           scanDim(dim)
     { }
@@ -512,13 +437,11 @@ struct CreateSegmentEvents
         if (s->start->pos(vpsc::conjugate(scanDim)) !=
                 s->end->pos(vpsc::conjugate(scanDim)))
         {
-            SegmentOpen *open=new SegmentOpen(scanDim, s);
-            SegmentClose *close=new SegmentClose(scanDim, s, open);
-            events.push_back(open);
-            events.push_back(close);
+            events.push_back(Event::segmentOpen(scanDim, s));
+            events.push_back(Event::segmentClose(scanDim, s, &events.back()));
         }
     }
-    vector<Event*>& events;
+    EventQueue& events;
     vpsc::Dim scanDim;
 };
 
@@ -665,7 +588,7 @@ TopologyConstraints::TopologyConstraints(const vpsc::Dim axisDim, Nodes& nodes,
     COLA_ASSERT(noOverlaps());
     COLA_ASSERT(assertNoSegmentRectIntersection(nodes,edges));
 
-    vector<Event*> events;
+    EventQueue events;
     
     // We handle rectangular cluster non-overlap by creating two fake shapes 
     // for each cluster with zero width for the left and right side cluster 
@@ -684,10 +607,8 @@ TopologyConstraints::TopologyConstraints(const vpsc::Dim axisDim, Nodes& nodes,
             i != e; ++i)
     {
         Node* v=*i;
-        NodeOpen *open=new NodeOpen(dim, v);
-        NodeClose *close=new NodeClose(dim, v,open,cs);
-        events.push_back(open);
-        events.push_back(close);
+        events.push_back(Event::nodeOpen(dim, v));
+        events.push_back(Event::nodeClose(dim, v, &events.back()));
     }
     list<EdgePoint*> pruneList;
     for(Edges::const_iterator i=edges.begin(),e=edges.end();i!=e;++i) {
@@ -703,11 +624,15 @@ TopologyConstraints::TopologyConstraints(const vpsc::Dim axisDim, Nodes& nodes,
                 CreateSegmentEvents(events, dim),true);
     }
     // process events in top to bottom order
-    sort(events.begin(),events.end(),CompareEvents());
-    for (vector<Event *>::iterator curr = events.begin();
-            curr != events.end(); ++curr)
+    vector<Event*> order(events.size());
+    for(size_t i=0;i<events.size();++i) {
+        order[i]=&events[i];
+    }
+    sort(order.begin(),order.end(),CompareEvents());
+    for (vector<Event *>::iterator curr = order.begin();
+            curr != order.end(); ++curr)
     {
-        (*curr)->process(openNodes, openSegments);
+        (*curr)->process(openNodes, openSegments, cs);
     }
     COLA_ASSERT(openSegments.empty());
     COLA_ASSERT(openNodes.empty());
@@ -85,7 +85,9 @@ Log<T>::~Log()
 template <typename T>
 TLogLevel& Log<T>::ReportingLevel()
 {
-    static TLogLevel reportingLevel = logDEBUG4;
+    // Per thread, since each TopologyConstraints sets it and several may
+    // be constructed at once.
+    static thread_local TLogLevel reportingLevel = logDEBUG4;
     return reportingLevel;
 }
 
@@ -19,6 +19,9 @@
 
 #ifndef TOPOLOGY_UTIL_H
 #define TOPOLOGY_UTIL_H
+#include <cstddef>
+#include <new>
+#include <vector>
 namespace topology {
 /*
  * templated delete functor for use in for_each loop over vector
@@ -40,5 +43,78 @@ T sum_over(InputIterator beg, InputIterator end, T init, Operation op)
     init = init + op(*beg);
     return init;
 }
+/*
+ * Storage for the many small objects of type T that are created and
+ * destroyed on every layout iteration, for use by class-specific
+ * operator new and delete.  Freed objects are kept on a free list for
+ * reuse rather than being returned to the heap.  Each thread has its own
+ * pool, released when the thread exits, so objects must be deleted on the
+ * thread that created them.  Requests for other sizes (i.e. for classes
+ * derived from T) are passed on to the global operators.
+ */
+template <typename T>
+class ObjectPool
+{
+public:
+    static void* allocate(size_t size)
+    {
+        if(size!=sizeof(T)) {
+            return ::operator new(size);
+        }
+        Pool& p=pool();
+        if(p.freeList==NULL) {
+            p.grow();
+        }
+        Block* b=p.freeList;
+        p.freeList=b->next;
+        return b;
+    }
+    static void deallocate(void* ptr, size_t size)
+    {
+        if(ptr==NULL) {
+            return;
+        }
+        if(size!=sizeof(T)) {
+            ::operator delete(ptr);
+            return;
+        }
+        Pool& p=pool();
+        Block* b=static_cast<Block*>(ptr);
+        b->next=p.freeList;
+        p.freeList=b;
+    }
+private:
+    union Block {
+        Block* next;
+        char storage[sizeof(T)];
+        // for alignment
+        double d;
+        void* v;
+    };
+    struct Pool {
+        static const size_t blocksPerChunk=256;
+        Pool() : freeList(NULL) {}
+        ~Pool() {
+            for(size_t i=0;i<chunks.size();++i) {
+                delete [] chunks[i];
+            }
+        }
+        void grow() {
+            Block* chunk=new Block[blocksPerChunk];
+            chunks.push_back(chunk);
+            for(size_t i=blocksPerChunk;i>0;--i) {
+                chunk[i-1].next=freeList;
+                freeList=&chunk[i-1];
+            }
+        }
+        Block* freeList;
+        std::vector<Block*> chunks;
+    };
+    static Pool& pool()
+    {
+        static thread_local Pool p;
+        return p;
+    }
+};
 } // namespace topology
 #endif // TOPOLOGY_UTIL_H
@@ -83,6 +83,7 @@ Block::Block(Blocks *blocks, Variable* const v)
     //, weight(0)
     //, wposn(0)
     , deleted(false)
+    , splitChecked(false)
     , timeStamp(0)
     , in(NULL)
     , out(NULL)
@@ -169,6 +170,7 @@ void Block::merge(Block *b, Constraint *c, double dist) {
     f<<"    merging: "<<*b<<"dist="<<dist<<endl;
 #endif
     c->active=true;
+    splitChecked=false;
     //wposn+=b->wposn-dist*b->weight;
     //weight+=b->weight;
     for(Vit i=b->vars->begin();i!=b->vars->end();++i) {
@@ -82,6 +82,9 @@ public:
 	void setUpOutConstraints();
 	double cost();
 	bool deleted;
+	// Set by Solver::refine() once the block is found to need no split,
+	// and cleared when the block changes.
+	bool splitChecked;
 	long timeStamp;
 	PairingHeap<Constraint*,CompareConstraints> *in;
 	PairingHeap<Constraint*,CompareConstraints> *out;
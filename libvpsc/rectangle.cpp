@@ -43,8 +43,8 @@ using std::vector;
 
 namespace vpsc {
 
-double Rectangle::xBorder = 0;
-double Rectangle::yBorder = 0;
+thread_local double Rectangle::xBorder = 0;
+thread_local double Rectangle::yBorder = 0;
 
 std::ostream& operator <<(std::ostream &os, const Rectangle &r) {
     os << "Hue[0.17],Rectangle[{"<<r.getMinX()<<","<<r.getMinY()<<"},{"<<r.getMaxX()<<","<<r.getMaxY()<<"}]";
@@ -112,43 +112,41 @@ struct Node;
 struct CmpNodePos { bool operator()(const Node* u, const Node* v) const; };
 
 typedef set<Node*,CmpNodePos> NodeSet;
+typedef vector<Node*> NodeList;
 
+/*
+ * The nodes for one call to generateXConstraints or generateYConstraints
+ * are all held in a single array, and their neighbour lists are plain
+ * vectors.  A neighbour is not removed from a list when it closes, it is
+ * just skipped (and the list sorted) when the owner of the list closes.
+ * coveredBy marks the nodes already constrained to be left or right of the
+ * node that is closing, through one of its nearer neighbours.
+ */
 struct Node {
     Variable *v;
     Rectangle *r;
     double pos;
     Node *firstAbove, *firstBelow;
-    NodeSet *leftNeighbours, *rightNeighbours;
+    NodeList leftNeighbours, rightNeighbours;
+    // position in the scanline, while open
+    NodeSet::iterator scanlinePos;
+    bool closed;
+    const Node *coveredBy;
     Node(Variable *v, Rectangle *r, double p) 
         : v(v),r(r),pos(p),
           firstAbove(NULL), firstBelow(NULL),
-          leftNeighbours(NULL), rightNeighbours(NULL)
-     
+          closed(false), coveredBy(NULL)
     {
         COLA_ASSERT(r->width()<1e40);
     }
-    ~Node() {
-        delete leftNeighbours;
-        delete rightNeighbours;
-    }
-    void addLeftNeighbour(Node *u) {
-        COLA_ASSERT(leftNeighbours!=NULL);
-        leftNeighbours->insert(u);
-    }
-    void addRightNeighbour(Node *u) {
-        COLA_ASSERT(rightNeighbours!=NULL);
-        rightNeighbours->insert(u);
-    }
-    void setNeighbours(NodeSet *left, NodeSet *right) {
-        leftNeighbours=left;
-        rightNeighbours=right;
-        for(NodeSet::iterator i=left->begin();i!=left->end();++i) {
-            Node *v=*(i);
-            v->addRightNeighbour(this);
+    void setNeighbours() {
+        for(NodeList::iterator i=leftNeighbours.begin();
+                i!=leftNeighbours.end();++i) {
+            (*i)->rightNeighbours.push_back(this);
         }
-        for(NodeSet::iterator i=right->begin();i!=right->end();++i) {
-            Node *v=*(i);
-            v->addLeftNeighbour(this);
+        for(NodeList::iterator i=rightNeighbours.begin();
+                i!=rightNeighbours.end();++i) {
+            (*i)->leftNeighbours.push_back(this);
         }
     }
 };
@@ -163,36 +161,55 @@ bool CmpNodePos::operator() (const Node* u, const Node* v) const {
     }
     return u < v;
 }
+/*
+ * Removes the nodes which have already closed from the list, and sorts
+ * the rest into scanline order.
+ */
+static void openNeighbours(NodeList& ns) {
+    NodeList::iterator last=ns.begin();
+    for(NodeList::iterator i=ns.begin();i!=ns.end();++i) {
+        if(!(*i)->closed) {
+            *last++=*i;
+        }
+    }
+    ns.erase(last,ns.end());
+    std::sort(ns.begin(),ns.end(),CmpNodePos());
+}
+
+/*
+ * Marks the nodes in ns as already being constrained relative to v.
+ */
+static void coverNeighbours(const NodeList& ns, const Node *v) {
+    for(NodeList::const_iterator i=ns.begin();i!=ns.end();++i) {
+        (*i)->coveredBy=v;
+    }
+}
 
-NodeSet* getLeftNeighbours(NodeSet &scanline,Node *v) {
-    NodeSet *leftv = new NodeSet;
-    NodeSet::iterator i=scanline.find(v);
+static void getLeftNeighbours(NodeSet &scanline,Node *v) {
+    NodeSet::iterator i=v->scanlinePos;
     while(i!=scanline.begin()) {
         Node *u=*(--i);
         if(u->r->overlapX(v->r)<=0) {
-            leftv->insert(u);
-            return leftv;
+            v->leftNeighbours.push_back(u);
+            return;
         }
         if(u->r->overlapX(v->r)<=u->r->overlapY(v->r)) {
-            leftv->insert(u);
+            v->leftNeighbours.push_back(u);
         }
     }
-    return leftv;
 }
-NodeSet* getRightNeighbours(NodeSet &scanline,Node *v) {
-    NodeSet *rightv = new NodeSet;
-    NodeSet::iterator i=scanline.find(v);
+static void getRightNeighbours(NodeSet &scanline,Node *v) {
+    NodeSet::iterator i=v->scanlinePos;
     for(++i;i!=scanline.end(); ++i) {
         Node *u=*(i);
         if(u->r->overlapX(v->r)<=0) {
-            rightv->insert(u);
-            return rightv;
+            v->rightNeighbours.push_back(u);
+            return;
         }
         if(u->r->overlapX(v->r)<=u->r->overlapY(v->r)) {
-            rightv->insert(u);
+            v->rightNeighbours.push_back(u);
         }
     }
-    return rightv;
 }
 
 typedef enum {Open, Close} EventType;
@@ -235,13 +252,20 @@ void generateXConstraints(const Rectangles& rs, const Variables& vars,
 {
     const unsigned n = rs.size();
     COLA_ASSERT(vars.size()>=n);
+    vector<Node> nodes;
+    nodes.reserve(n);
+    vector<Event> eventPool;
+    eventPool.reserve(2*n);
     Event **events=new Event*[2*n];
     unsigned i,ctr=0;
     for(i=0;i<n;i++) {
         vars[i]->desiredPosition=rs[i]->getCentreX();
-        Node *v = new Node(vars[i],rs[i],rs[i]->getCentreX());
-        events[ctr++]=new Event(Open,v,rs[i]->getMinY());
-        events[ctr++]=new Event(Close,v,rs[i]->getMaxY());
+        nodes.push_back(Node(vars[i],rs[i],rs[i]->getCentreX()));
+        Node *v = &nodes.back();
+        eventPool.push_back(Event(Open,v,rs[i]->getMinY()));
+        events[ctr++]=&eventPool.back();
+        eventPool.push_back(Event(Close,v,rs[i]->getMaxY()));
+        events[ctr++]=&eventPool.back();
     }
     qsort((Event*)events, (size_t)2*n, sizeof(Event*), compare_events );
 
@@ -250,20 +274,19 @@ void generateXConstraints(const Rectangles& rs, const Variables& vars,
         Event *e=events[i];
         Node *v=e->v;
         if(e->type==Open) {
-            scanline.insert(v);
+            v->scanlinePos=scanline.insert(v).first;
             if(useNeighbourLists) {
-                v->setNeighbours(
-                    getLeftNeighbours(scanline,v),
-                    getRightNeighbours(scanline,v)
-                );
+                getLeftNeighbours(scanline,v);
+                getRightNeighbours(scanline,v);
+                v->setNeighbours();
             } else {
-                NodeSet::iterator it=scanline.find(v);
+                NodeSet::iterator it=v->scanlinePos;
                 if(it!=scanline.begin()) {
                     Node *u=*(--it);
                     v->firstAbove=u;
                     u->firstBelow=v;
                 }
-                it=scanline.find(v);
+                it=v->scanlinePos;
                 if(++it!=scanline.end()) {
                     Node *u=*it;
                     v->firstBelow=u;
@@ -271,28 +294,42 @@ void generateXConstraints(const Rectangles& rs, const Variables& vars,
                 }
             }
         } else {
-            size_t result;
             // Close event
             if(useNeighbourLists) {
-                for(NodeSet::iterator i=v->leftNeighbours->begin();
-                    i!=v->leftNeighbours->end();i++
+                // Neighbours are visited nearest first.  A neighbour u 
+                // that is also a neighbour of a nearer one w is skipped,
+                // since the constraints between u, w and v already keep u
+                // at least as far from v as a constraint between u and v 
+                // would.  This caps the constraints to the transitive 
+                // reduction along each neighbour list.
+                openNeighbours(v->leftNeighbours);
+                for(NodeList::reverse_iterator i=v->leftNeighbours.rbegin();
+                    i!=v->leftNeighbours.rend();i++
                 ) {
                     Node *u=*i;
+                    if(u->coveredBy==v) {
+                        continue;
+                    }
                     double sep = (v->r->width()+u->r->width())/2.0;
                     cs.push_back(new Constraint(u->v,v->v,sep));
-                    result=u->rightNeighbours->erase(v);
-                    COLA_ASSERT(result==1);
+                    coverNeighbours(u->leftNeighbours,v);
                 }
                 
-                for(NodeSet::iterator i=v->rightNeighbours->begin();
-                    i!=v->rightNeighbours->end();i++
+                openNeighbours(v->rightNeighbours);
+                for(NodeList::iterator i=v->rightNeighbours.begin();
+                    i!=v->rightNeighbours.end();i++
                 ) {
                     Node *u=*i;
+                    if(u->coveredBy==v) {
+                        continue;
+                    }
                     double sep = (v->r->width()+u->r->width())/2.0;
                     cs.push_back(new Constraint(v->v,u->v,sep));
-                    result=u->leftNeighbours->erase(v);
-                    COLA_ASSERT(result==1);
+                    coverNeighbours(u->rightNeighbours,v);
                 }
+                // free the lists now rather than when all nodes are done
+                NodeList().swap(v->leftNeighbours);
+                NodeList().swap(v->rightNeighbours);
             } else {
                 Node *l=v->firstAbove, *r=v->firstBelow;
                 if(l!=NULL) {
@@ -306,11 +343,9 @@ void generateXConstraints(const Rectangles& rs, const Variables& vars,
                     r->firstAbove=v->firstAbove;
                 }
             }
-            result=scanline.erase(v);
-            COLA_ASSERT(result==1);
-            delete v;
+            scanline.erase(v->scanlinePos);
+            v->closed=true;
         }
-        delete e;
     }
     COLA_ASSERT(scanline.size()==0);
     delete [] events;
@@ -325,6 +360,10 @@ void generateYConstraints(const Rectangles& rs, const Variables& vars,
 {
     const unsigned n = rs.size();
     COLA_ASSERT(vars.size()>=n);
+    vector<Node> nodes;
+    nodes.reserve(n);
+    vector<Event> eventPool;
+    eventPool.reserve(2*n);
     Event **events=new Event*[2*n];
     unsigned ctr=0;
     Rectangles::const_iterator ri=rs.begin(), re=rs.end();
@@ -333,29 +372,29 @@ void generateYConstraints(const Rectangles& rs, const Variables& vars,
         Rectangle* r=*ri;
         Variable* v=*vi;
         v->desiredPosition=r->getCentreY();
-        Node *node = new Node(v,r,r->getCentreY());
+        nodes.push_back(Node(v,r,r->getCentreY()));
+        Node *node = &nodes.back();
         COLA_ASSERT(r->getMinX()<r->getMaxX());
-        events[ctr++]=new Event(Open,node,r->getMinX());
-        events[ctr++]=new Event(Close,node,r->getMaxX());
+        eventPool.push_back(Event(Open,node,r->getMinX()));
+        events[ctr++]=&eventPool.back();
+        eventPool.push_back(Event(Close,node,r->getMaxX()));
+        events[ctr++]=&eventPool.back();
     }
     COLA_ASSERT(ri==rs.end());
     qsort((Event*)events, (size_t)2*n, sizeof(Event*), compare_events );
     NodeSet scanline;
-#ifndef NDEBUG
-    size_t deletes=0;
-#endif
     for(unsigned i=0;i<2*n;i++) {
         Event *e=events[i];
         Node *v=e->v;
         if(e->type==Open) {
-            scanline.insert(v);
-            NodeSet::iterator it=scanline.find(v);
+            v->scanlinePos=scanline.insert(v).first;
+            NodeSet::iterator it=v->scanlinePos;
             if(it!=scanline.begin()) {
                 Node *u=*(--it);
                 v->firstAbove=u;
                 u->firstBelow=v;
             }
-            it=scanline.find(v);
+            it=v->scanlinePos;
             if(++it!=scanline.end())     {
                 Node *u=*it;
                 v->firstBelow=u;
@@ -374,18 +413,11 @@ void generateYConstraints(const Rectangles& rs, const Variables& vars,
                 cs.push_back(new Constraint(v->v,r->v,sep));
                 r->firstAbove=v->firstAbove;
             }
-#ifndef NDEBUG
-            deletes++;
-            size_t erased=
-#endif
-            scanline.erase(v);
-            COLA_ASSERT(erased==1);
-            delete v;
+            scanline.erase(v->scanlinePos);
+            v->closed=true;
         }
-        delete e;
     }
     COLA_ASSERT(scanline.size()==0);
-    COLA_ASSERT(deletes==n);
     delete [] events;
 }
 #include "libvpsc/linesegment.h"
@@ -232,8 +232,11 @@ public:
      * size considered in one axis to be slightly different to that considered
      * in the other axis for example, to avoid numerical precision problems in
      * the axis-by-axis overlap removal process.
+     *
+     * The borders are held per thread, so layouts running concurrently on
+     * different threads do not see each other's borders.
      */
-    static double xBorder,yBorder;
+    static thread_local double xBorder,yBorder;
     static void setXBorder(double x) {xBorder=x;}
     static void setYBorder(double y) {yBorder=y;}
     
@@ -166,14 +166,25 @@ void Solver::refine() {
         size_t length = bs->size();
         for (size_t i = 0; i < length; ++i)
         {
+            // The constraint heaps of blocks changed by the last split may
+            // be out of date.  Rather than rebuilding every heap, drop them
+            // and let the next split build just those it needs.
             Block *b = bs->at(i);
-            b->setUpInConstraints();
-            b->setUpOutConstraints();
+            delete b->in;
+            b->in = NULL;
+            delete b->out;
+            b->out = NULL;
         }
         for (size_t i = 0; i < length; ++i)
         {
             Block *b = bs->at(i);
+            if (b->splitChecked)
+            {
+                // Unchanged since it was found to need no split.
+                continue;
+            }
             Constraint *c=b->findMinLM();
+            b->splitChecked = true;
             if(c!=NULL && c->lm<LAGRANGIAN_TOLERANCE) {
 #ifdef LIBVPSC_LOGGING
                 ofstream f(LOGFILE,ios::app);
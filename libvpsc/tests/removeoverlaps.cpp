@@ -0,0 +1,93 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libvpsc - A solver for the problem of Variable Placement with
+ *           Separation Constraints.
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+
+/*
+ * Timing test for overlap removal on large diagrams.  100,000 randomly
+ * placed rectangles, about as tightly packed as those of a large diagram
+ * after layout, have their overlaps removed.  The time taken is printed,
+ * and no rectangles may overlap afterwards.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "libvpsc/rectangle.h"
+
+using namespace vpsc;
+
+static const unsigned RECTANGLES = 100000;
+// The rectangles are 20 by 20 on average, and are placed in a square that
+// is SPACING wide for each rectangle along its side.
+static const double SPACING = 30;
+
+// Returns the time taken by f, in milliseconds.
+template <typename F>
+static double timed(F f)
+{
+    std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+// A small linear congruential generator, so that every run sees the same
+// rectangles.
+static double nextRandom(unsigned& state)
+{
+    state = (state * 1103515245u) + 12345u;
+    return ((state >> 8) & 0xffff) / 65536.0;
+}
+
+static void makeRectangles(Rectangles& rs)
+{
+    const double side = sqrt((double) RECTANGLES) * SPACING;
+    unsigned state = 1;
+    for (unsigned i = 0; i < RECTANGLES; ++i)
+    {
+        double x = nextRandom(state) * side;
+        double y = nextRandom(state) * side;
+        double w = 5 + nextRandom(state) * 30;
+        double h = 5 + nextRandom(state) * 30;
+        rs.push_back(new Rectangle(x, x + w, y, y + h));
+    }
+}
+
+int main(void)
+{
+    int result = 0;
+
+    Rectangles rs;
+    makeRectangles(rs);
+    double time = timed([&] { removeoverlaps(rs); });
+    printf("Removed overlaps between %u rectangles in %.1fms.\n",
+            RECTANGLES, time);
+    if (!noRectangleOverlaps(rs))
+    {
+        printf("Overlaps remain.\n");
+        result = 1;
+    }
+    for_each(rs.begin(), rs.end(), delete_object());
+    return result;
+}
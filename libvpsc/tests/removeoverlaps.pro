@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = vpsc-removeoverlaps
+
+include(tests.pri)
+
+# Input
+SOURCES += removeoverlaps.cpp
@@ -0,0 +1,19 @@
+CONFIG += console thread testcase
+
+DEPENDPATH += ../..
+INCLUDEPATH += ../..
+
+include(../../common_options.qmake)
+CONFIG -= qt app_bundle
+
+# Tests are run in place rather than installed with the application.
+DESTDIR = $$OUT_PWD
+
+macx {
+LIBS += -L$$DUNNARTBASE/Dunnart.app/Contents/Frameworks
+}
+else {
+LIBS += -L$$DUNNARTBASE/build
+unix:QMAKE_RPATHDIR += $$DUNNARTBASE/build
+}
+LIBS += -lvpsc
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+# Each test is its own program, built and run by "make check".
+SUBDIRS = \
+	removeoverlaps.pro \
+	threadedoverlap.pro
@@ -0,0 +1,131 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libvpsc - A solver for the problem of Variable Placement with
+ *           Separation Constraints.
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+/*
+ * Stress test for the per-thread rectangle borders.  Several overlap
+ * removals, each with its own border, are run at once on different threads
+ * and must give exactly the same result as when they are run one after
+ * another.  If the borders were shared, the threads would pick up each
+ * other's borders and results would differ.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <thread>
+
+#include "libvpsc/rectangle.h"
+
+using namespace vpsc;
+
+static const unsigned JOBS = 8;
+static const unsigned ROUNDS = 5;
+static const unsigned RECTANGLES = 400;
+
+struct Job
+{
+    unsigned seed;
+    double border;
+    std::vector<double> result;
+};
+
+// A small linear congruential generator, so that every job and every run
+// sees the same rectangles.
+static double nextRandom(unsigned& state)
+{
+    state = (state * 1103515245u) + 12345u;
+    return ((state >> 8) & 0xffff) / 65536.0;
+}
+
+static void runJob(Job *job)
+{
+    unsigned state = job->seed;
+    Rectangle::setXBorder(job->border);
+    Rectangle::setYBorder(job->border);
+
+    Rectangles rs;
+    for (unsigned i = 0; i < RECTANGLES; ++i)
+    {
+        double x = nextRandom(state) * 500;
+        double y = nextRandom(state) * 500;
+        double w = 5 + nextRandom(state) * 30;
+        double h = 5 + nextRandom(state) * 30;
+        rs.push_back(new Rectangle(x, x + w, y, y + h));
+    }
+
+    removeoverlaps(rs);
+
+    job->result.clear();
+    for (unsigned i = 0; i < rs.size(); ++i)
+    {
+        job->result.push_back(rs[i]->getCentreX());
+        job->result.push_back(rs[i]->getCentreY());
+        delete rs[i];
+    }
+    Rectangle::setXBorder(0);
+    Rectangle::setYBorder(0);
+}
+
+static std::vector<Job> makeJobs(void)
+{
+    std::vector<Job> jobs(JOBS);
+    for (unsigned i = 0; i < JOBS; ++i)
+    {
+        jobs[i].seed = i + 1;
+        // Give each job a different border, so sharing shows up.
+        jobs[i].border = i * 0.5;
+    }
+    return jobs;
+}
+
+int main(void)
+{
+    std::vector<Job> serial = makeJobs();
+    for (unsigned i = 0; i < JOBS; ++i)
+    {
+        runJob(&serial[i]);
+    }
+
+    unsigned differing = 0;
+    for (unsigned round = 0; round < ROUNDS; ++round)
+    {
+        std::vector<Job> parallel = makeJobs();
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < JOBS; ++i)
+        {
+            threads.push_back(std::thread(runJob, &parallel[i]));
+        }
+        for (unsigned i = 0; i < JOBS; ++i)
+        {
+            threads[i].join();
+        }
+
+        for (unsigned i = 0; i < JOBS; ++i)
+        {
+            if (parallel[i].result != serial[i].result)
+            {
+                ++differing;
+            }
+        }
+    }
+
+    printf("%u of %u concurrent overlap removals differed from serial "
+            "runs.\n", differing, JOBS * ROUNDS);
+    return (differing == 0) ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = vpsc-threadedoverlap
+
+include(tests.pri)
+
+# Input
+SOURCES += threadedoverlap.cpp
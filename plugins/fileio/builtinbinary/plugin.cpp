@@ -0,0 +1,731 @@
+/*
+ * Dunnart - Constraint-based Diagram Editor
+ *
+ * Copyright (C) 2014  Monash University
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ *
+*/
+
+//! @file
+//! Plugin that adds support for reading and writing diagrams in a binary
+//! encoding of Dunnart's annotated SVG description, one row per item.
+
+#include <QtWidgets>
+#include <QObject>
+#include <QFileInfo>
+#include <QDomDocument>
+#include <QSaveFile>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "libdunnartcanvas/fileioplugininterface.h"
+#include "libdunnartcanvas/canvas.h"
+#include "libdunnartcanvas/canvasitem.h"
+#include "libdunnartcanvas/svgshape.h"
+#include "libdunnartcanvas/diagramreader.h"
+
+using namespace dunnart;
+
+
+// The binary format holds exactly the Dunnart description that the
+// annotated SVG format does, so the two round-trip through each other,
+// except for shapes drawn from SVG, which it can't hold.
+// All values are little endian quint32s, except doubles, which are stored
+// as the little endian quint64 of their bits.
+//
+//   header:     "DUNNARTB", version
+//   strings:    count, end offset of each string, then their UTF-8 bytes
+//   namespaces: count, then (prefix, URI) string pairs
+//   page:       whether there is a page, then x, y, width, height
+//   schemas:    count, then for each, tag name, column count and a
+//               column name for each
+//   tables:     count, then for each, kind, row count and the rows
+//
+// Each row is a node.  Element nodes give a schema, a value for each of
+// its columns, a child count and then the children.  Text, CDATA and
+// comment nodes give their text.  Strings are all given as indices into
+// the string table.
+//
+// Elements with the same tag name and attribute names share a schema,
+// so, for example, each shape is a row of attribute values in the shapes
+// table.  The tables are written options first, then shapes, clusters,
+// connectors, constraints and finally nodes in external namespaces.
+
+static const char x_binaryMagic[] = "DUNNARTB";
+static const quint32 x_binaryVersion = 1;
+// Nodes are read recursively, so nesting is limited to keep a corrupt file
+// from overflowing the stack.  Diagrams nest far less deeply than this.
+static const quint32 x_maxNodeDepth = 64;
+
+enum BinaryTableKind
+{
+    TABLE_OPTIONS,
+    TABLE_SHAPES,
+    TABLE_CLUSTERS,
+    TABLE_CONNECTORS,
+    TABLE_CONSTRAINTS,
+    TABLE_EXTERNAL,
+    TABLE_LAST
+};
+
+enum BinaryNodeType
+{
+    NODE_ELEMENT,
+    NODE_TEXT,
+    NODE_CDATA,
+    NODE_COMMENT
+};
+
+
+// Builds the file in memory, interning strings and schemas as it goes.
+class BinaryDiagramWriter
+{
+    public:
+        BinaryDiagramWriter()
+        {
+            for (int kind = 0; kind < TABLE_LAST; ++kind)
+            {
+                m_rows[kind] = 0;
+            }
+        }
+        void addNode(BinaryTableKind kind, const QDomNode& node)
+        {
+            QByteArray& table = m_tables[kind];
+            ++m_rows[kind];
+            appendNode(table, node);
+        }
+        void addNamespace(const QString& prefix, const QString& uri)
+        {
+            m_namespaces.append(string(prefix));
+            m_namespaces.append(string(uri));
+        }
+        QByteArray data(const QRectF& page)
+        {
+            QByteArray out(x_binaryMagic, sizeof(x_binaryMagic) - 1);
+            appendU32(out, x_binaryVersion);
+
+            appendU32(out, m_string_ends.size());
+            foreach (quint32 end, m_string_ends)
+            {
+                appendU32(out, end);
+            }
+            out.append(m_string_data);
+
+            appendU32(out, m_namespaces.size() / 2);
+            foreach (quint32 index, m_namespaces)
+            {
+                appendU32(out, index);
+            }
+
+            appendU32(out, (page.isEmpty()) ? 0 : 1);
+            appendDouble(out, page.x());
+            appendDouble(out, page.y());
+            appendDouble(out, page.width());
+            appendDouble(out, page.height());
+
+            appendU32(out, m_schemas.size());
+            foreach (const QVector<quint32>& schema, m_schemas)
+            {
+                appendU32(out, schema[0]);
+                appendU32(out, schema.size() - 1);
+                for (int i = 1; i < schema.size(); ++i)
+                {
+                    appendU32(out, schema[i]);
+                }
+            }
+
+            appendU32(out, TABLE_LAST);
+            for (int kind = 0; kind < TABLE_LAST; ++kind)
+            {
+                appendU32(out, kind);
+                appendU32(out, m_rows[kind]);
+                out.append(m_tables[kind]);
+            }
+            return out;
+        }
+
+    private:
+        static void appendU32(QByteArray& out, quint32 value)
+        {
+            uchar bytes[4];
+            qToLittleEndian<quint32>(value, bytes);
+            out.append(reinterpret_cast<const char *>(bytes), 4);
+        }
+        static void appendDouble(QByteArray& out, double value)
+        {
+            quint64 bits;
+            memcpy(&bits, &value, sizeof(bits));
+            uchar bytes[8];
+            qToLittleEndian<quint64>(bits, bytes);
+            out.append(reinterpret_cast<const char *>(bytes), 8);
+        }
+        quint32 string(const QString& value)
+        {
+            QHash<QString, quint32>::const_iterator it =
+                    m_string_indices.constFind(value);
+            if (it != m_string_indices.constEnd())
+            {
+                return it.value();
+            }
+            quint32 index = m_string_ends.size();
+            m_string_data.append(value.toUtf8());
+            m_string_ends.append(m_string_data.size());
+            m_string_indices.insert(value, index);
+            return index;
+        }
+        void appendNode(QByteArray& out, const QDomNode& node)
+        {
+            if (node.isElement())
+            {
+                // Columns are sorted so that elements with the same
+                // attributes share a schema however the DOM orders them.
+                QDomNamedNodeMap attrs = node.attributes();
+                QStringList names;
+                for (int i = 0; i < attrs.count(); ++i)
+                {
+                    names.append(attrs.item(i).nodeName());
+                }
+                names.sort();
+
+                QVector<quint32> schema;
+                schema.append(string(node.nodeName()));
+                foreach (const QString& name, names)
+                {
+                    schema.append(string(name));
+                }
+                QHash<QVector<quint32>, quint32>::const_iterator it =
+                        m_schema_indices.constFind(schema);
+                quint32 schemaIndex;
+                if (it != m_schema_indices.constEnd())
+                {
+                    schemaIndex = it.value();
+                }
+                else
+                {
+                    schemaIndex = m_schemas.size();
+                    m_schemas.append(schema);
+                    m_schema_indices.insert(schema, schemaIndex);
+                }
+
+                appendU32(out, NODE_ELEMENT);
+                appendU32(out, schemaIndex);
+                foreach (const QString& name, names)
+                {
+                    appendU32(out, string(attrs.namedItem(name).nodeValue()));
+                }
+
+                QDomNodeList children = node.childNodes();
+                appendU32(out, children.count());
+                for (int i = 0; i < children.count(); ++i)
+                {
+                    appendNode(out, children.item(i));
+                }
+                return;
+            }
+
+            if (node.isCDATASection())
+            {
+                appendU32(out, NODE_CDATA);
+            }
+            else if (node.isText())
+            {
+                appendU32(out, NODE_TEXT);
+            }
+            else
+            {
+                // Nothing else is read or written by Dunnart, so
+                // processing instructions and the like are kept as
+                // comments rather than breaking the child count.
+                appendU32(out, NODE_COMMENT);
+            }
+            appendU32(out, string(node.nodeValue()));
+        }
+
+        QHash<QString, quint32> m_string_indices;
+        QVector<quint32> m_string_ends;
+        QByteArray m_string_data;
+        QVector<quint32> m_namespaces;
+        QList<QVector<quint32> > m_schemas;
+        QHash<QVector<quint32>, quint32> m_schema_indices;
+        QByteArray m_tables[TABLE_LAST];
+        quint32 m_rows[TABLE_LAST];
+};
+
+
+// Reads values from the (usually memory mapped) file, noting rather than
+// overrunning a truncated or corrupt file.
+class BinaryCursor
+{
+    public:
+        BinaryCursor(const uchar *data, qint64 size)
+            : m_data(data),
+              m_size(size),
+              m_pos(0),
+              m_ok(true)
+        {
+        }
+        bool ok(void) const
+        {
+            return m_ok;
+        }
+        void fail(void)
+        {
+            m_ok = false;
+            m_pos = m_size;
+        }
+        const uchar *take(qint64 bytes)
+        {
+            if (!m_ok || (bytes < 0) || (bytes > (m_size - m_pos)))
+            {
+                fail();
+                return NULL;
+            }
+            const uchar *data = m_data + m_pos;
+            m_pos += bytes;
+            return data;
+        }
+        quint32 u32(void)
+        {
+            const uchar *data = take(4);
+            return (data) ? qFromLittleEndian<quint32>(data) : 0;
+        }
+        double f64(void)
+        {
+            const uchar *data = take(8);
+            quint64 bits = (data) ? qFromLittleEndian<quint64>(data) : 0;
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+    private:
+        const uchar *m_data;
+        qint64 m_size;
+        qint64 m_pos;
+        bool m_ok;
+};
+
+
+// Strings are left as UTF-8 in the file and only decoded when first used.
+class BinaryStringTable
+{
+    public:
+        BinaryStringTable()
+            : m_ends(NULL),
+              m_data(NULL),
+              m_size(0),
+              m_count(0)
+        {
+        }
+        bool read(BinaryCursor& cursor)
+        {
+            m_count = cursor.u32();
+            m_ends = cursor.take(qint64(m_count) * 4);
+            if (!cursor.ok())
+            {
+                return false;
+            }
+            m_size = (m_count > 0) ? end(m_count - 1) : 0;
+            m_data = cursor.take(m_size);
+            m_strings.resize(m_count);
+            return cursor.ok();
+        }
+        QString at(quint32 index, BinaryCursor& cursor)
+        {
+            if (index >= m_count)
+            {
+                cursor.fail();
+                return QString();
+            }
+            QString& value = m_strings[index];
+            if (value.isNull())
+            {
+                quint32 start = (index > 0) ? end(index - 1) : 0;
+                // Offsets are only checked here, so a corrupt one can't
+                // point outside the string data.
+                if ((end(index) < start) || (end(index) > m_size))
+                {
+                    cursor.fail();
+                    return QString();
+                }
+                value = QString::fromUtf8(
+                        reinterpret_cast<const char *>(m_data + start),
+                        end(index) - start);
+                if (value.isNull())
+                {
+                    // Empty, but marked as decoded.
+                    value = QString("");
+                }
+            }
+            return value;
+        }
+
+    private:
+        quint32 end(quint32 index) const
+        {
+            return qFromLittleEndian<quint32>(m_ends + (index * 4));
+        }
+
+        const uchar *m_ends;
+        const uchar *m_data;
+        quint32 m_size;
+        quint32 m_count;
+        QVector<QString> m_strings;
+};
+
+
+// Rebuilds each row as the element the SVG reader would have built, and
+// creates items from it in exactly the same way.
+class BinaryDiagramReader : public DiagramReader
+{
+    public:
+        BinaryDiagramReader(Canvas *canvas, BinaryCursor& cursor,
+                BinaryStringTable& strings,
+                const QMap<QString, QString>& namespaces)
+            : DiagramReader(canvas),
+              m_cursor(cursor),
+              m_strings(strings),
+              m_namespaces(namespaces)
+        {
+        }
+        bool readSchemas(void)
+        {
+            quint32 count = m_cursor.u32();
+            for (quint32 i = 0; (i < count) && m_cursor.ok(); ++i)
+            {
+                QStringList schema;
+                schema.append(m_strings.at(m_cursor.u32(), m_cursor));
+                quint32 columns = m_cursor.u32();
+                for (quint32 c = 0; (c < columns) && m_cursor.ok(); ++c)
+                {
+                    schema.append(m_strings.at(m_cursor.u32(), m_cursor));
+                }
+                m_schemas.append(schema);
+            }
+            return m_cursor.ok();
+        }
+        bool readTables(void)
+        {
+            quint32 tables = m_cursor.u32();
+            for (quint32 t = 0; (t < tables) && m_cursor.ok(); ++t)
+            {
+                // The kind only groups rows.  How each is read is decided
+                // by its element, just as for SVG.
+                m_cursor.u32();
+                quint32 rows = m_cursor.u32();
+                for (quint32 r = 0; (r < rows) && m_cursor.ok(); ++r)
+                {
+                    QDomNode node = readNode(0);
+                    if (node.isElement() && m_cursor.ok())
+                    {
+                        QDomElement element = node.toElement();
+                        readElementTree(element);
+                    }
+                }
+            }
+            if (!m_cursor.ok())
+            {
+                return false;
+            }
+            finishReading();
+            return true;
+        }
+
+    private:
+        QString namespaceFor(const QString& qualifiedName) const
+        {
+            int colon = qualifiedName.indexOf(':');
+            if (colon < 0)
+            {
+                return QString();
+            }
+            QString prefix = qualifiedName.left(colon);
+            if (prefix == x_dunnartNs)
+            {
+                return x_dunnartURI;
+            }
+            return m_namespaces.value(prefix);
+        }
+        QDomNode readNode(const quint32 depth)
+        {
+            if (depth >= x_maxNodeDepth)
+            {
+                m_cursor.fail();
+                return QDomNode();
+            }
+            quint32 type = m_cursor.u32();
+            if (type != NODE_ELEMENT)
+            {
+                QString text = m_strings.at(m_cursor.u32(), m_cursor);
+                if (type == NODE_TEXT)
+                {
+                    return m_document.createTextNode(text);
+                }
+                else if (type == NODE_CDATA)
+                {
+                    return m_document.createCDATASection(text);
+                }
+                else if (type == NODE_COMMENT)
+                {
+                    return m_document.createComment(text);
+                }
+                m_cursor.fail();
+                return QDomNode();
+            }
+
+            quint32 schemaIndex = m_cursor.u32();
+            if (schemaIndex >= (quint32) m_schemas.size())
+            {
+                m_cursor.fail();
+                return QDomNode();
+            }
+            const QStringList& schema = m_schemas.at(schemaIndex);
+            QDomElement element = m_document.createElementNS(
+                    namespaceFor(schema[0]), schema[0]);
+            for (int c = 1; c < schema.size(); ++c)
+            {
+                element.setAttributeNS(namespaceFor(schema[c]), schema[c],
+                        m_strings.at(m_cursor.u32(), m_cursor));
+            }
+            quint32 children = m_cursor.u32();
+            for (quint32 i = 0; (i < children) && m_cursor.ok(); ++i)
+            {
+                element.appendChild(readNode(depth + 1));
+            }
+            return element;
+        }
+
+        BinaryCursor& m_cursor;
+        BinaryStringTable& m_strings;
+        QMap<QString, QString> m_namespaces;
+        QList<QStringList> m_schemas;
+        QDomDocument m_document;
+};
+
+
+//! @brief  Plugin class that adds support for loading and saving diagrams
+//!         in a row-per-item binary encoding.
+//!
+//! The format holds the same description of the diagram as Dunnart's
+//! annotated SVG, but without the SVG drawing, and with its strings and
+//! attribute names stored once each.  Each item is a row of attribute
+//! values.  Files are memory mapped for reading, but the whole diagram is
+//! still read and its items created when it is opened, rather than lazily.
+//! Diagrams with shapes drawn from SVG can't be saved in this format.
+//!
+class BuiltinBinaryFileIOPlugin : public QObject, public FileIOPluginInterface
+{
+    Q_OBJECT
+        Q_INTERFACES (dunnart::FileIOPluginInterface)
+        Q_PLUGIN_METADATA (IID "org.dunnart.BuiltinBinaryFileIOPlugin")
+
+    public:
+        BuiltinBinaryFileIOPlugin()
+        {
+        }
+        QStringList saveableFileExtensions(void) const
+        {
+            QStringList fileTypes;
+            fileTypes << "dunnart";
+            return fileTypes;
+        }
+        QStringList loadableFileExtensions(void) const
+        {
+            QStringList fileTypes;
+            fileTypes << "dunnart";
+            return fileTypes;
+        }
+        QString fileExtensionDescription(const QString& extension) const
+        {
+            if (extension == "dunnart")
+            {
+                return "Dunnart Binary Diagram";
+            }
+            return QString();
+        }
+        bool saveDiagramToFile(Canvas *canvas, const QFileInfo& fileInfo,
+                QString& errorMessage);
+        bool loadDiagramFromFile(Canvas *canvas, const QFileInfo& fileInfo,
+                QString& errorMessage);
+};
+
+
+static BinaryTableKind tableKindForElement(const QDomElement& element)
+{
+    QString type = nodeAttribute(element, QString(), x_type);
+    if (type.isEmpty())
+    {
+        type = nodeAttribute(element, x_dunnartNs, x_type);
+    }
+    switch (CanvasItem::loadPassForType(type))
+    {
+        case PASS_CLUSTERS:
+            return TABLE_CLUSTERS;
+        case PASS_CONNECTORS:
+            return TABLE_CONNECTORS;
+        case PASS_RELATIONSHIPS:
+            return TABLE_CONSTRAINTS;
+        default:
+            return TABLE_SHAPES;
+    }
+}
+
+
+bool BuiltinBinaryFileIOPlugin::saveDiagramToFile(Canvas *canvas,
+        const QFileInfo& fileInfo, QString& errorMessage)
+{
+    // SVG shapes are drawn from the SVG the diagram was loaded from,
+    // which this format has nowhere to keep.
+    foreach (CanvasItem *canvasObj, canvas->items())
+    {
+        if (dynamic_cast<SvgShape *> (canvasObj))
+        {
+            errorMessage = tr("The diagram contains shapes drawn from SVG, "
+                    "which can't be saved in the binary format.  Save it "
+                    "as SVG instead.");
+            return false;
+        }
+    }
+
+    BinaryDiagramWriter writer;
+    QDomDocument doc;
+
+    QMap<QString, QString>::const_iterator i =
+            canvas->m_extra_namespaces_map.constBegin();
+    while (i != canvas->m_extra_namespaces_map.constEnd())
+    {
+        writer.addNamespace(i.key(), i.value());
+        ++i;
+    }
+
+    writer.addNode(TABLE_OPTIONS,
+            canvas->writeLayoutOptionsToDomElement(doc));
+
+    foreach (CanvasItem *canvasObj, canvas->items())
+    {
+        QDomElement node = canvasObj->to_QDomElement(XMLSS_ALL, doc);
+        writer.addNode(tableKindForElement(node), node);
+    }
+
+    QDomNode externalNode;
+    foreach (externalNode, canvas->m_external_node_list)
+    {
+        writer.addNode(TABLE_EXTERNAL, externalNode);
+    }
+
+    QSaveFile file(fileInfo.absoluteFilePath());
+    if ( ! file.open(QIODevice::WriteOnly) )
+    {
+        errorMessage = tr("File could not be opened for writing.");
+        return false;
+    }
+    file.write(writer.data(canvas->pageRect()));
+    if ( ! file.commit() )
+    {
+        errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+bool BuiltinBinaryFileIOPlugin::loadDiagramFromFile(Canvas *canvas,
+        const QFileInfo& fileInfo, QString& errorMessage)
+{
+    QFile file(fileInfo.absoluteFilePath());
+    if ( ! file.open(QIODevice::ReadOnly) )
+    {
+        errorMessage = tr("File could not be opened for reading.");
+        return false;
+    }
+
+    // Map the file rather than reading it, where the platform allows.
+    QByteArray contents;
+    const uchar *data = file.map(0, file.size());
+    if (data == NULL)
+    {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar *>(contents.constData());
+    }
+    BinaryCursor cursor(data, (contents.isNull()) ? file.size() :
+            contents.size());
+
+    const uchar *magic = cursor.take(sizeof(x_binaryMagic) - 1);
+    if ((magic == NULL) ||
+            (memcmp(magic, x_binaryMagic, sizeof(x_binaryMagic) - 1) != 0))
+    {
+        errorMessage = tr("This is not a Dunnart binary diagram.");
+        return false;
+    }
+    quint32 version = cursor.u32();
+    if (version > x_binaryVersion)
+    {
+        errorMessage = tr("This diagram was saved by a newer version of "
+                "Dunnart (format version %1).").arg(version);
+        return false;
+    }
+
+    BinaryStringTable strings;
+    strings.read(cursor);
+
+    QMap<QString, QString> namespaces;
+    quint32 namespaceCount = cursor.u32();
+    for (quint32 n = 0; (n < namespaceCount) && cursor.ok(); ++n)
+    {
+        QString prefix = strings.at(cursor.u32(), cursor);
+        QString uri = strings.at(cursor.u32(), cursor);
+        namespaces.insert(prefix, uri);
+    }
+
+    bool hasPage = cursor.u32();
+    QRectF page;
+    page.setX(cursor.f64());
+    page.setY(cursor.f64());
+    page.setWidth(cursor.f64());
+    page.setHeight(cursor.f64());
+
+    BinaryDiagramReader reader(canvas, cursor, strings, namespaces);
+    if (!cursor.ok() || !reader.readSchemas())
+    {
+        errorMessage = tr("The file is truncated or corrupt.");
+        return false;
+    }
+
+    // Set up everything the SVG file header would have.
+    canvas->m_extra_namespaces_map.unite(namespaces);
+    if (hasPage)
+    {
+        canvas->setPageRect(page);
+    }
+
+    if (!reader.readTables())
+    {
+        errorMessage = tr("The file is truncated or corrupt.");
+        return false;
+    }
+    return true;
+}
+
+
+// Because there is no header file, we need to load the MOC file here to
+// cause Qt to generate it for us.
+#include "plugin.moc"
+
+// vim: filetype=cpp ts=4 sw=4 et tw=0 wm=0 cindent
@@ -37,6 +37,8 @@
 #include "libdunnartcanvas/shape.h"
 #include "libdunnartcanvas/connectionpininfo.h"
 #include "libdunnartcanvas/connector.h"
+#include "libdunnartcanvas/diagramreader.h"
+#include "libdunnartcanvas/diagramwriter.h"
 #include "libdunnartcanvas/undo.h"
 
 
@@ -86,22 +88,88 @@ class BuiltinLayoutFileIOPlugin : public QObject, public FileIOPluginInterface
         }
         bool saveDiagramToFile(Canvas *canvas, const QFileInfo& fileInfo,
                 QString& errorMessage);
+        bool canWriteDiagram(void) const
+        {
+            return true;
+        }
+        bool writeDiagram(Canvas *canvas, const QFileInfo& fileInfo,
+                DiagramWriter& writer, QString& errorMessage);
         bool loadDiagramFromFile(Canvas *canvas, const QFileInfo& fileInfo,
                 QString& errorMessage);
-        void recursiveReadLayoutXML(Canvas *canvas, const QDomNode& start,
-                const QString& dunnartNS, int pass);
         void createFromLayoutXML(Canvas *canvas, const QDomElement& node,
                 const QString& dunnartURI, int pass);
 };
 
+
+//! @brief  Reads .layout documents, creating each node as it is read and
+//!         each edge once all the nodes exist.
+//!
+class LayoutDiagramReader : public DiagramReader
+{
+    public:
+        LayoutDiagramReader(Canvas *canvas, BuiltinLayoutFileIOPlugin *plugin)
+            : DiagramReader(canvas),
+              m_plugin(plugin)
+        {
+        }
+
+    protected:
+        bool startElement(QDomElement& element)
+        {
+            return ((element.localName() == "options") &&
+                    (element.prefix() == x_dunnartNs)) ||
+                    (element.localName() == "node") ||
+                    (element.localName() == "edge");
+        }
+        void readElement(const QDomElement& element)
+        {
+            if (element.localName() == "options")
+            {
+                m_canvas->loadLayoutOptionsFromDomElement(element);
+            }
+            else if (element.localName() == "node")
+            {
+                addItem(element, "", PASS_SHAPES);
+            }
+            else
+            {
+                addItem(element, "", PASS_CONNECTORS);
+            }
+        }
+        void createItem(const QDomElement& element, const QString& dunnartNs,
+                int pass)
+        {
+            m_plugin->createFromLayoutXML(m_canvas, element, dunnartNs, pass);
+        }
+
+    private:
+        BuiltinLayoutFileIOPlugin *m_plugin;
+};
+
 bool BuiltinLayoutFileIOPlugin::saveDiagramToFile(Canvas *canvas,
         const QFileInfo& fileInfo, QString& errorMessage)
 {
-    QString outputFilename = fileInfo.absoluteFilePath();
-    QDomDocument doc("layout");
+    DiagramWriter writer;
+    if ( ! writer.open(fileInfo.absoluteFilePath(), errorMessage) )
+    {
+        return false;
+    }
+    if ( ! writeDiagram(canvas, fileInfo, writer, errorMessage) )
+    {
+        return false;
+    }
+    return writer.commit(errorMessage);
+}
+
+
+bool BuiltinLayoutFileIOPlugin::writeDiagram(Canvas *canvas,
+        const QFileInfo& fileInfo, DiagramWriter& writer,
+        QString& errorMessage)
+{
+    Q_UNUSED (fileInfo)
+    Q_UNUSED (errorMessage)
 
-    QDomElement root = doc.createElement("layout");
-    doc.appendChild(root);
+    writer.writeText("<!DOCTYPE layout>\n<layout>\n");
 
     QList<CanvasItem *> canvas_items = canvas->items();
     int canvas_count = canvas_items.size();
@@ -113,12 +181,11 @@ bool BuiltinLayoutFileIOPlugin::saveDiagramToFile(Canvas *canvas,
 
         // The layout format differs only slightly from Dunnart's native
         // annotated SVG ouput, so we rewrite the few attributes necessary.
-        QDomElement node = canvasObj->to_QDomElement(XMLSS_ALL, doc);
+        XmlElementSnapshot node = canvasObj->xmlSnapshot(XMLSS_ALL);
         if (node.attribute("type") == "connector")
         {
             // Edges are "edge" elements and don't have the type attribute.
-            node.setPrefix(QString());
-            node.setTagName("edge");
+            node.setName("edge");
             node.removeAttribute("type");
 
             // Layout format doesn't have the libavoidPath attribute.
@@ -127,8 +194,7 @@ bool BuiltinLayoutFileIOPlugin::saveDiagramToFile(Canvas *canvas,
         else
         {
             // Nodes are "node" elements.
-            node.setPrefix(QString());
-            node.setTagName("node");
+            node.setName("node");
 
             if (node.attribute("type") == "rect")
             {
@@ -137,18 +203,9 @@ bool BuiltinLayoutFileIOPlugin::saveDiagramToFile(Canvas *canvas,
                 node.removeAttribute("type");
             }
         }
-        root.appendChild(node);
+        writer.writeElement(node);
     }
-
-    // Write DOM document to the file.
-    QFile xmlFile(outputFilename);
-    if ( ! xmlFile.open(QIODevice::WriteOnly) )
-    {
-        errorMessage = tr("File could not be opened for writing.");
-        return false;
-    }
-    xmlFile.write(doc.toString().toUtf8());
-    xmlFile.close();
+    writer.writeText("</layout>\n");
 
     return true;
 }
@@ -158,7 +215,6 @@ bool BuiltinLayoutFileIOPlugin::loadDiagramFromFile(Canvas *canvas,
         const QFileInfo& fileInfo, QString& errorMessage)
 {
     QString filename = fileInfo.absoluteFilePath();
-    QDomDocument doc(filename);
     QFile file(filename);
     if ( ! file.open(QIODevice::ReadOnly) )
     {
@@ -166,59 +222,22 @@ bool BuiltinLayoutFileIOPlugin::loadDiagramFromFile(Canvas *canvas,
         return false;
     }
 
-    QString parsingError;
-    int errorLine;
-    int errorColumn;
-    if (!doc.setContent(&file, true, &parsingError, &errorLine, &errorColumn))
-    {
-        file.close();
-        errorMessage = tr("Error reading XML: %1:%2: %3").arg(errorLine).
-                arg(errorColumn).arg(parsingError);
-        return false;
-    }
-    file.close();
-
-    QDomElement root = doc.documentElement();
-
     // The layout format is intended for using to layout diagrams
     // and networks of a fixed strucutre, so we disable structural
     // editing.
     canvas->setOptStructuralEditingDisabled(true);
 
-    for (int pass = 0; pass < PASS_LAST; ++pass)
+    QString parsingError;
+    LayoutDiagramReader reader(canvas, this);
+    if (!reader.read(&file, parsingError))
     {
-        recursiveReadLayoutXML(canvas, root, x_dunnartNs, pass);
+        file.close();
+        errorMessage = tr("Error reading XML: %1").arg(parsingError);
+        return false;
     }
-    return true;
-}
-
-
-void BuiltinLayoutFileIOPlugin::recursiveReadLayoutXML(Canvas *canvas,
-        const QDomNode& start, const QString& dunnartNS, int pass)
-{
-    for (QDomNode curr = start; !curr.isNull(); curr = curr.nextSibling())
-    {
-        if (curr.isElement())
-        {
-            const QDomElement element = curr.toElement();
-
-            if (pass == PASS_SHAPES)
-            {
-                if ((element.localName() == "options") &&
-                    (element.prefix() == x_dunnartNs))
-                {
-                    canvas->loadLayoutOptionsFromDomElement(element);
-                }
-            }
+    file.close();
 
-            if ( (element.localName() == "node") ||
-                 (element.localName() == "edge") )
-            {
-                createFromLayoutXML(canvas, element, "", pass);
-            }
-        }
-        recursiveReadLayoutXML(canvas, curr.firstChild(), dunnartNS, pass);
-    }
+    return true;
 }
 
 
@@ -35,10 +35,82 @@
 #include "libdunnartcanvas/fileioplugininterface.h"
 #include "libdunnartcanvas/canvas.h"
 #include "libdunnartcanvas/canvasitem.h"
+#include "libdunnartcanvas/diagramreader.h"
+#include "libdunnartcanvas/diagramwriter.h"
 
 using namespace dunnart;
 
 
+static void renameAttribute(QDomElement& element, const QString& from,
+        const QString& to)
+{
+    QDomAttr attribute = element.attributeNode(from);
+    if (attribute.isNull())
+    {
+        return;
+    }
+    QString value = attribute.value();
+    QString namespaceURI = (to.contains(':')) ?
+            attribute.namespaceURI() : QString();
+    element.removeAttributeNode(attribute);
+    element.setAttributeNS(namespaceURI, to, value);
+}
+
+
+//! @brief  Reads Dunnart's annotated SVG, including files written by
+//!         Dunnart version 1.
+//!
+//! We can open files from Dunnart Ver 1 by rewriting some properties.
+//! This is still required for opening older Pro-origami files.  Each
+//! element is rewritten as it is read, so this doesn't need the whole
+//! file in memory.
+//!
+class SVGDiagramReader : public DiagramReader
+{
+    public:
+        SVGDiagramReader(Canvas *canvas)
+            : DiagramReader(canvas)
+        {
+        }
+
+    protected:
+        bool startElement(QDomElement& element)
+        {
+            if ((element.nodeName() == "sodipodi:guide") &&
+                (nodeAttribute(element, x_dunnartNs, x_type) == "indGuide"))
+            {
+                // A v1 guideline description.
+                renameAttribute(element, "direction", "foo");
+                renameAttribute(element, "position", "bar");
+                element.setPrefix(x_dunnartNs);
+                element.setTagName("node");
+            }
+            if (element.localName() == "node")
+            {
+                renameAttribute(element, "dunnart:type", "type");
+            }
+            renameAttribute(element, "dunnart:direction", "direction");
+            renameAttribute(element, "dunnart:position", "position");
+            renameAttribute(element, "dunnart:sepDistance", "sepDistance");
+            renameAttribute(element, "dunnart:xPos", "dunnart:cx");
+            renameAttribute(element, "dunnart:yPos", "dunnart:cy");
+
+            QDomNamedNodeMap attrs = element.attributes();
+            for (int i = 0; i < attrs.length(); ++i)
+            {
+                QDomAttr attr = attrs.item(i).toAttr();
+                if (attr.name().endsWith("avoidBuffer") &&
+                        (attr.value() == "10"))
+                {
+                    attr.setValue("6");
+                }
+            }
+
+            return DiagramReader::startElement(element);
+        }
+};
+
+
 //! @brief  Plugin class that adds support for loading and saving Dunnart's
 //!         native annotated SVG file format.
 //!
@@ -87,6 +159,26 @@ class BuiltinSVGFileIOPlugin : public QObject, public FileIOPluginInterface
         bool saveDiagramToFile(Canvas *canvas, const QFileInfo& fileInfo,
                 QString& errorMessage)
         {
+            DiagramWriter writer;
+            if ( ! writer.open(fileInfo.absoluteFilePath(), errorMessage) )
+            {
+                return false;
+            }
+            if ( ! writeDiagram(canvas, fileInfo, writer, errorMessage) )
+            {
+                return false;
+            }
+            return writer.commit(errorMessage);
+        }
+        bool canWriteDiagram(void) const
+        {
+            return true;
+        }
+        bool writeDiagram(Canvas *canvas, const QFileInfo& fileInfo,
+                DiagramWriter& writer, QString& errorMessage)
+        {
+            Q_UNUSED (errorMessage)
+
             QString outputFilename = fileInfo.absoluteFilePath();
             QRectF viewBox = canvas->pageRect();
             if (viewBox.size().isEmpty())
@@ -146,13 +238,7 @@ class BuiltinSVGFileIOPlugin : public QObject, public FileIOPluginInterface
                 ++i;
             }
 
-            QFile svgFile(outputFilename);
-            if ( ! svgFile.open(QIODevice::WriteOnly) )
-            {
-                errorMessage = tr("File could not be opened for writing.");
-                return false;
-            }
-            svgFile.write(svgStr.toUtf8());
+            writer.writeText(svgStr);
 
             canvas->setRenderingForPrinting(true);
             QList<CanvasItem *> canvas_items = canvas->items();
@@ -170,50 +256,43 @@ class BuiltinSVGFileIOPlugin : public QObject, public FileIOPluginInterface
                 int lines = svg.count('\n');
                 if (lines > 3)
                 {
-                    svgFile.write(svg.toUtf8());
+                    writer.writeText(svg);
                 }
             }
             canvas->setRenderingForPrinting(false);
 
-            svgFile.write("<!-- Dunnart description -->\n");
-            QDomDocument doc("svg");
+            writer.writeText("<!-- Dunnart description -->\n");
 
-            QDomElement optionsNode = canvas->writeLayoutOptionsToDomElement(doc);
-            QString optionsNodeString = nodeToString(optionsNode);
-            svgFile.write(optionsNodeString.toUtf8());
+            QDomElement optionsNode = canvas->writeLayoutOptionsToDomElement(
+                    writer.document());
+            writer.writeNode(optionsNode);
 
             for (int i = 0; i < canvas_count; ++i)
             {
                 // Consider all the canvas items in reverse order, so they get drawn
                 // into the SVG file with the correct z-order.
                 CanvasItem *canvasObj = canvas_items.at(i);
-
-                QDomNode node = canvasObj->to_QDomElement(XMLSS_ALL, doc);
-                QString svgNodeString = nodeToString(node);
-                svgFile.write(svgNodeString.toUtf8());
+                writer.writeItem(canvasObj, XMLSS_ALL);
             }
 
             // Copy XML for any external namespaces we have saved
             if ( ! canvas->m_external_node_list.empty() )
             {
-                svgFile.write("<!-- External namespace nodes -->\n");
+                writer.writeText("<!-- External namespace nodes -->\n");
                 QDomNode externalNode;
                 foreach (externalNode, canvas->m_external_node_list)
                 {
-                    QString externalNodeString = nodeToString(externalNode);
-                    svgFile.write(externalNodeString.toUtf8());
+                    writer.writeNode(externalNode);
                 }
             }
 
-            svgFile.write(QByteArray("</svg>\n"));
-            svgFile.close();
+            writer.writeText("</svg>\n");
             return true;
         }
         bool loadDiagramFromFile(Canvas *canvas, const QFileInfo& fileInfo,
                 QString& errorMessage)
         {
             QString filename = fileInfo.absoluteFilePath();
-            QDomDocument doc(filename);
             QFile file(filename);
             if (!file.open(QIODevice::ReadOnly))
             {
@@ -221,60 +300,21 @@ class BuiltinSVGFileIOPlugin : public QObject, public FileIOPluginInterface
                 return false;
             }
 
+            // Items are created as the file is read, rather than from a
+            // DOM of the whole file.
             QString parsingError;
-            int errorLine;
-            int errorColumn;
-#if 1
-            // We can open files from Dunnart Ver 1 by rewriting some
-            // properties.  This is still required for opening older
-            // Pro-origami files
-            QTextStream stream(&file);
-            QString content = stream.readAll();
-            if (content.contains("sodipodi:guide dunnart:type=\"indGuide\""))
-            {
-                // This has v1 guideline descriptions that need to be rewritten.
-                content.replace(" direction=", " foo=");
-                content.replace(" position=", " bar=");
-                content.replace("sodipodi:guide", "dunnart:node");
-            }
-            content.replace("node dunnart:type=", "node type=");
-            content.replace("dunnart:direction=", "direction=");
-            content.replace("dunnart:position=", "position=");
-            content.replace("dunnart:sepDistance=", "sepDistance=");
-            content.replace("avoidBuffer=\"10\"", "avoidBuffer=\"6\"");
-            content.replace("dunnart:xPos=", "dunnart:cx=");
-            content.replace("dunnart:yPos=", "dunnart:cy=");
-            if (!doc.setContent(content, true, &parsingError, &errorLine, &errorColumn))
-#else
-            // Once we don't care, this is simpler.
-            if (!doc.setContent(&file, true, &parsingError, &errorLine, &errorColumn))
-#endif
+            SVGDiagramReader reader(canvas);
+            if (!reader.read(&file, parsingError))
             {
                 file.close();
-                errorMessage = tr("Error reading SVG: %1:%2: %3").arg(errorLine).
-                        arg(errorColumn).arg(parsingError);
+                errorMessage = tr("Error reading SVG: %1").arg(parsingError);
                 return false;
             }
             file.close();
             canvas->setSvgRendererForFile(filename);
 
-            QDomElement root = doc.documentElement();
-
-            for (int pass = 0; pass < PASS_LAST; ++pass)
-            {
-                canvas->recursiveReadSVG(root, x_dunnartNs, pass);
-            }
-
             return true;
         }
-        static QString nodeToString(const QDomNode& node)
-        {
-            QString nodeString;
-            QTextStream nodeTextStream(&nodeString);
-            node.save(nodeTextStream, 4);
-
-            return nodeString;
-        }
 };
 
 Q_PLUGIN_METADATA (IID "org.dunnart.BuiltinSVGFileIOPlugin")
@@ -5,7 +5,8 @@ TEMPLATE = subdirs
 
 SUBDIRS = builtinsvg \
             builtingml \
-            builtinlayout
+            builtinlayout \
+            builtinbinary
 
 packagesExist(libcgraph) {
     message("Has libcgraph")
@@ -152,7 +152,12 @@ class GraphvizFileIOPlugin : public QObject, public FileIOPluginInterface
             }
 
             // Determine view DPI.  Assume it is same in both dimensions.
-            int dpi = canvas->views().first()->logicalDpiX();
+            // Use the screen's if the canvas has no view, e.g., in batch
+            // mode.
+            int dpi = (canvas->views().isEmpty()) ?
+                    qRound(QGuiApplication::primaryScreen()->
+                            logicalDotsPerInchX()) :
+                    canvas->views().first()->logicalDpiX();
 
             Agraph_t *g = agread(fp, NULL);
 
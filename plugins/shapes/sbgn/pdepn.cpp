@@ -68,8 +68,10 @@ void PDEPN::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
     // Call the parent paint method, to draw the node and label
     ShapeObj::paint(painter, option, widget);
 
-    // Then draw the clone region if necessary
-    if (this->cloned == true) {
+    // Then draw the clone region if necessary.  When zoomed out, the
+    // parent draws only a plain box, so there is nothing to add.
+    if (this->cloned == true && (!canvas() ||
+            canvas()->renderDetail(painter) != Canvas::RenderSimplified)) {
         painter->setOpacity(0.95);
         painter->fillPath(this->clone_marker(), Qt::gray);
 
@@ -83,7 +85,11 @@ void PDEPN::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
 
 //        QRectF r(-width()/2, -height()/2*0.7, width(), height());
 //        painter->drawText(r, cloneLabel, QTextOption::NoWrap);
-        painter->drawText(-width()/2+8, height()*0.38, cloneLabel);
+        if (!canvas() ||
+                canvas()->renderDetail(painter) == Canvas::RenderFullDetail)
+        {
+            painter->drawText(-width()/2+8, height()*0.38, cloneLabel);
+        }
         // need this to redraw the node outlines, because the second clone marker paints over top node in multimers:
         painter->strokePath(painterPath(), painter->pen());
     }
@@ -114,6 +114,12 @@ class ClassShape: public RectangleShape {
                 const QDomElement& node, const QString& ns);
         QDomElement to_QDomElement(const unsigned int subset,
                 QDomDocument& doc);
+        // Class shapes are written by to_QDomElement(), so are snapshotted
+        // from its DOM rather than as plain shapes.
+        XmlElementSnapshot xmlSnapshot(const unsigned int subset)
+        {
+            return CanvasItem::xmlSnapshot(subset);
+        }
 
         void middle_click(const int& mouse_x, const int& mouse_y);
         